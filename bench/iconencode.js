@@ -0,0 +1,54 @@
+/* eslint-disable @typescript-eslint/no-require-imports */
+// Extract and encode the icons of a corpus of executables, as ICO and as PNG
+// Usage: node bench/iconencode.js [directory] [iterations]
+// The directory defaults to C:\Windows\System32 on Windows
+
+const fs = require('fs');
+const path = require('path');
+const autolib = require('../index');
+
+const directory = process.argv[2] || (process.platform === 'win32' ? 'C:\\Windows\\System32' : null);
+const iterations = parseInt(process.argv[3] || '5', 10);
+
+if (!directory) {
+  console.log('Usage: node bench/iconencode.js <directory with .exe/.dll files> [iterations]');
+  process.exit(0);
+}
+
+const corpus = fs.readdirSync(directory)
+  .filter((name) => /\.(exe|dll)$/i.test(name))
+  .map((name) => path.join(directory, name))
+  .filter((file) => {
+    try {
+      return autolib.getApplicationIcon(file).iconData !== undefined;
+    } catch {
+      return false;
+    }
+  });
+
+if (corpus.length === 0) {
+  console.log(`No icons found in ${directory}`);
+  process.exit(0);
+}
+
+function measure(label, format) {
+  const samples = [];
+  let bytes = 0;
+  for (let i = 0; i < iterations; i++) {
+    for (const file of corpus) {
+      const start = process.hrtime.bigint();
+      const icon = autolib.getApplicationIcon(file, { format });
+      samples.push(Number(process.hrtime.bigint() - start) / 1e6);
+      if (i === 0 && icon.iconData) bytes += icon.iconData.length;
+    }
+  }
+  samples.sort((a, b) => a - b);
+  const mean = samples.reduce((a, b) => a + b, 0) / samples.length;
+  const p50 = samples[Math.floor(samples.length * 0.5)];
+  const p99 = samples[Math.min(samples.length - 1, Math.floor(samples.length * 0.99))];
+  console.log(`${label.padEnd(10)} mean ${mean.toFixed(3)} ms  p50 ${p50.toFixed(3)} ms  p99 ${p99.toFixed(3)} ms  ${(bytes / 1024).toFixed(0)} KB`);
+}
+
+console.log(`${corpus.length} icons from ${directory}`);
+measure('ico', 'ico');
+measure('png', 'png');
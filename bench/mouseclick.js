@@ -0,0 +1,44 @@
+/* eslint-disable @typescript-eslint/no-require-imports */
+// Compare the native uinput click against spawning xdotool (Linux/X11 only)
+// Usage: node bench/mouseclick.js [iterations]
+
+const { spawnSync } = require('child_process');
+const autolib = require('../index');
+
+const iterations = parseInt(process.argv[2] || '100', 10);
+const x = 10;
+const y = 10;
+
+function measure(label, fn) {
+  const samples = [];
+  for (let i = 0; i < iterations; i++) {
+    const start = process.hrtime.bigint();
+    fn();
+    samples.push(Number(process.hrtime.bigint() - start) / 1e6);
+  }
+  samples.sort((a, b) => a - b);
+  const mean = samples.reduce((a, b) => a + b, 0) / samples.length;
+  const p50 = samples[Math.floor(samples.length * 0.5)];
+  const p99 = samples[Math.min(samples.length - 1, Math.floor(samples.length * 0.99))];
+  console.log(`${label.padEnd(10)} mean ${mean.toFixed(3)} ms  p50 ${p50.toFixed(3)} ms  p99 ${p99.toFixed(3)} ms`);
+}
+
+if (process.platform !== 'linux') {
+  console.log('This benchmark only runs on Linux');
+  process.exit(0);
+}
+
+// First call creates the uinput device: keep it out of the measurements
+if (autolib.mouseClick(x, y) !== 1) {
+  console.log('mouseClick failed: check write access to /dev/uinput and DISPLAY');
+  process.exit(1);
+}
+
+measure('autolib', () => autolib.mouseClick(x, y));
+
+const xdotool = spawnSync('xdotool', ['version']);
+if (xdotool.error) {
+  console.log('xdotool not found, skipping comparison');
+} else {
+  measure('xdotool', () => spawnSync('xdotool', ['mousemove', String(x), String(y), 'click', '1', 'mousemove', 'restore']));
+}
@@ -6,12 +6,34 @@
       "cflags_cc!": [ "-fno-exceptions" ],
       "sources": [
         "src/addon.c",
+        "src/log.c",
         "src/keysender.c",
+        "src/keytable.c",
+        "src/injector.c",
+        "src/batch.c",
+        "src/scheduler.c",
+        "src/textsender.c",
         "src/keymonitor.c",
+        "src/pointermonitor.c",
+        "src/keystate.c",
         "src/process.c",
+        "src/versioninfo.c",
+        "src/filemap.c",
+        "src/pe.c",
+        "src/icon.c",
+        "src/iconcache.c",
+        "src/image.c",
         "src/mouse.c",
         "src/selection.c",
-        "src/window.c"
+        "src/jsstring.c",
+        "src/watcher.c",
+        "src/selectionwatcher.c",
+        "src/foregroundwatcher.c",
+        "src/clipboard.c",
+        "src/window.c",
+        "src/desktopindex.c",
+        "src/x11.c",
+        "src/uinput.c"
       ],
       "include_dirs": [],
       "conditions": [
@@ -22,8 +44,7 @@
             }
           },
           "libraries": [
-            "psapi.lib",
-            "version.lib"
+            "psapi.lib"
           ]
         }],
         ["OS=='mac'", {
@@ -39,7 +60,10 @@
           ],
           "libraries": [
             "-lm",
-            "-levdev"
+            "-levdev",
+            "-lX11",
+            "-lXfixes",
+            "-lxcb"
           ]
         }]
       ]
@@ -21,18 +21,75 @@ try {
     getProductName: function() {
       throw new Error('autolib native module not loaded')
     },
+    getProductNames: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    getVersionInfo: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    setVersionCacheFile: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    getDesktopApplication: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    setDesktopIndexFile: function() {
+      throw new Error('autolib native module not loaded')
+    },
     getApplicationIcon: function() {
       throw new Error('autolib native module not loaded')
     },
+    getApplicationIcons: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    setIconCacheFile: function() {
+      throw new Error('autolib native module not loaded')
+    },
     sendKey: function() {
       throw new Error('autolib native module not loaded')
     },
+    sendKeyAsync: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    waitForKeysReleased: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    scheduleInput: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    setInputRate: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    typeText: function() {
+      throw new Error('autolib native module not loaded')
+    },
     mouseClick: function() {
       throw new Error('autolib native module not loaded')
     },
+    mouseActions: function() {
+      throw new Error('autolib native module not loaded')
+    },
     getSelectedText: function() {
       throw new Error('autolib native module not loaded')
     },
+    getSelectedTextAsync: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    clipboardFormats: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    readClipboard: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    writeClipboard: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    pasteText: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    copySelection: function() {
+      throw new Error('autolib native module not loaded')
+    },
     startKeyMonitor: function() {
       throw new Error('autolib native module not loaded')
     },
@@ -41,6 +98,45 @@ try {
     },
     isKeyMonitorRunning: function() {
       throw new Error('autolib native module not loaded')
+    },
+    startPointerMonitor: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    stopPointerMonitor: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    isPointerMonitorRunning: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    startSelectionWatcher: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    stopSelectionWatcher: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    isSelectionWatcherRunning: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    startForegroundWatcher: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    stopForegroundWatcher: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    isForegroundWatcherRunning: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    setLogLevel: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    getLogLevel: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    drainLog: function() {
+      throw new Error('autolib native module not loaded')
+    },
+    onLog: function() {
+      throw new Error('autolib native module not loaded')
     }
   }
 }
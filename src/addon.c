@@ -3,10 +3,28 @@
 #include <math.h>
 #include "keysender.h"
 #include "process.h"
+#include "icon.h"
+#include "iconcache.h"
+#include "image.h"
+#include "versioninfo.h"
+#include "desktopindex.h"
 #include "window.h"
 #include "selection.h"
+#include "jsstring.h"
 #include "mouse.h"
 #include "keymonitor.h"
+#include "pointermonitor.h"
+#include "selectionwatcher.h"
+#include "foregroundwatcher.h"
+#include "clipboard.h"
+#include "textsender.h"
+#include "injector.h"
+#include "batch.h"
+#include "keystate.h"
+#include "keytable.h"
+#include "scheduler.h"
+#include "log.h"
+#include <stdlib.h>
 
 #define MAX_PATH_LENGTH 260
 
@@ -53,11 +71,455 @@ static napi_value SendKeyWrapper(napi_env env, napi_callback_info info)
   return return_val;
 }
 
+// Read an optional unsigned integer property from an options object
+static bool GetOptionalUint32(napi_env env, napi_value object, const char* name, uint32_t* value)
+{
+  bool hasProperty = false;
+  if (napi_has_named_property(env, object, name, &hasProperty) != napi_ok || !hasProperty) {
+    return false;
+  }
+
+  napi_value property;
+  napi_valuetype type;
+  napi_get_named_property(env, object, name, &property);
+  if (napi_typeof(env, property, &type) != napi_ok || type != napi_number) {
+    return false;
+  }
+
+  return napi_get_value_uint32(env, property, value) == napi_ok;
+}
+
+typedef struct {
+  char* text;
+  size_t length;
+  TypeTextOptions options;
+} TypeTextRequest;
+
+static uint32_t TypeTextRun(void* data, uint32_t timeoutMs)
+{
+  (void)timeoutMs;
+  TypeTextRequest* request = (TypeTextRequest*)data;
+  return TypeText(request->text, request->length, &request->options);
+}
+
+static void TypeTextRelease(void* data)
+{
+  TypeTextRequest* request = (TypeTextRequest*)data;
+  free(request->text);
+  free(request);
+}
+
+static napi_value TypeTextWrapper(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  size_t argc = 2;
+  napi_value args[2];
+
+  // Get the arguments
+  status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  if (status != napi_ok || argc < 1)
+  {
+    napi_throw_error(env, NULL, "Expected a string argument");
+    return NULL;
+  }
+
+  // Get the string length first so any text size is accepted
+  size_t length = 0;
+  status = napi_get_value_string_utf8(env, args[0], NULL, 0, &length);
+  if (status != napi_ok)
+  {
+    napi_throw_error(env, NULL, "Expected a string argument");
+    return NULL;
+  }
+
+  TypeTextRequest* request = (TypeTextRequest*)calloc(1, sizeof(TypeTextRequest));
+  if (request == NULL) {
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
+  }
+  request->text = (char*)malloc(length + 1);
+  if (request->text == NULL) {
+    free(request);
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
+  }
+  napi_get_value_string_utf8(env, args[0], request->text, length + 1, &request->length);
+
+  // Get the optional pacing options
+  TypeTextDefaultOptions(&request->options);
+  if (argc >= 2) {
+    napi_valuetype type;
+    napi_typeof(env, args[1], &type);
+    if (type == napi_object) {
+      GetOptionalUint32(env, args[1], "chunkSize", &request->options.chunkSize);
+      GetOptionalUint32(env, args[1], "chunkDelay", &request->options.chunkDelay);
+    }
+  }
+  if (request->options.chunkSize > TYPE_TEXT_MAX_CHUNK_SIZE) {
+    request->options.chunkSize = TYPE_TEXT_MAX_CHUNK_SIZE;
+  }
+
+  // Type on the injector thread, in order with other injected input
+  return InjectorQueue(env, TypeTextRun, TypeTextRelease, request, INJECTOR_NO_TIMEOUT);
+}
+
+typedef struct {
+  char key[32];
+  bool useModifier;
+} SendKeyRequest;
+
+static uint32_t SendKeyRun(void* data, uint32_t timeoutMs)
+{
+  SendKeyRequest* request = (SendKeyRequest*)data;
+
+  // The request deadline also bounds the wait for pressed keys
+  uint32_t releaseTimeout = timeoutMs < SEND_KEY_RELEASE_TIMEOUT_MS ? timeoutMs : SEND_KEY_RELEASE_TIMEOUT_MS;
+  return SendKeyWithTimeout(request->key, request->useModifier, releaseTimeout);
+}
+
+static napi_value SendKeyAsyncWrapper(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  size_t argc = 3;
+  napi_value args[3];
+  uint32_t timeout = INJECTOR_NO_TIMEOUT;
+
+  // Get the arguments
+  status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  if (status != napi_ok || argc < 1)
+  {
+    napi_throw_error(env, NULL, "Expected a string argument");
+    return NULL;
+  }
+
+  SendKeyRequest* request = (SendKeyRequest*)calloc(1, sizeof(SendKeyRequest));
+  if (request == NULL) {
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
+  }
+
+  // Get the string value
+  status = napi_get_value_string_utf8(env, args[0], request->key, sizeof(request->key), NULL);
+  if (status != napi_ok)
+  {
+    free(request);
+    napi_throw_error(env, NULL, "Expected a string argument");
+    return NULL;
+  }
+
+  // Get the optional boolean argument
+  if (argc >= 2) {
+    status = napi_get_value_bool(env, args[1], &request->useModifier);
+    if (status != napi_ok)
+    {
+      free(request);
+      napi_throw_error(env, NULL, "Second argument must be a boolean");
+      return NULL;
+    }
+  }
+
+  // Get the optional timeout covering queueing and key release
+  if (argc >= 3) {
+    napi_valuetype type;
+    napi_typeof(env, args[2], &type);
+    if (type == napi_object) {
+      GetOptionalUint32(env, args[2], "timeout", &timeout);
+    }
+  }
+
+  return InjectorQueue(env, SendKeyRun, free, request, timeout);
+}
+
+typedef struct {
+  uint32_t modifiers;
+} WaitKeysRequest;
+
+static uint32_t WaitKeysRun(void* data, uint32_t timeoutMs)
+{
+  WaitKeysRequest* request = (WaitKeysRequest*)data;
+  // Honour the caller's timeout as is, the default only applies without one
+  uint32_t timeout = timeoutMs == INJECTOR_NO_TIMEOUT ? SEND_KEY_RELEASE_TIMEOUT_MS : timeoutMs;
+  return WaitForKeysReleased(request->modifiers, timeout) ? 0 : INJECTOR_TIMED_OUT;
+}
+
+static napi_value WaitForKeysReleasedWrapper(napi_env env, napi_callback_info info)
+{
+  size_t argc = 1;
+  napi_value args[1];
+  uint32_t timeout = INJECTOR_NO_TIMEOUT;
+
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+  WaitKeysRequest* request = (WaitKeysRequest*)calloc(1, sizeof(WaitKeysRequest));
+  if (request == NULL) {
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
+  }
+
+  // Get the optional options: { modifiers: ['shift', 'control', 'alt', 'meta'], timeout }
+  napi_valuetype type = napi_undefined;
+  if (argc >= 1) {
+    napi_typeof(env, args[0], &type);
+  }
+  if (type == napi_object) {
+    GetOptionalUint32(env, args[0], "timeout", &timeout);
+
+    bool hasModifiers = false;
+    napi_has_named_property(env, args[0], "modifiers", &hasModifiers);
+    if (hasModifiers) {
+      napi_value modifiers;
+      uint32_t count = 0;
+      napi_get_named_property(env, args[0], "modifiers", &modifiers);
+      if (napi_get_array_length(env, modifiers, &count) != napi_ok) {
+        free(request);
+        napi_throw_error(env, NULL, "modifiers must be an array of strings");
+        return NULL;
+      }
+      for (uint32_t i = 0; i < count; i++) {
+        napi_value element;
+        char name[16] = {0};
+        napi_get_element(env, modifiers, i, &element);
+        napi_get_value_string_utf8(env, element, name, sizeof(name), NULL);
+        if (strcmp(name, "shift") == 0) request->modifiers |= KEYSTATE_SHIFT;
+        else if (strcmp(name, "control") == 0) request->modifiers |= KEYSTATE_CONTROL;
+        else if (strcmp(name, "alt") == 0) request->modifiers |= KEYSTATE_ALT;
+        else if (strcmp(name, "meta") == 0) request->modifiers |= KEYSTATE_META;
+        else {
+          free(request);
+          napi_throw_error(env, NULL, "Unknown modifier (expected shift, control, alt or meta)");
+          return NULL;
+        }
+      }
+    }
+  }
+
+  return InjectorQueue(env, WaitKeysRun, free, request, timeout);
+}
+
+typedef struct {
+  ScheduledEvent* events;
+  size_t count;
+  ScheduleStats stats;
+} ScheduleRequest;
+
+static uint32_t ScheduleRun(void* data, uint32_t timeoutMs)
+{
+  (void)timeoutMs;
+  ScheduleRequest* request = (ScheduleRequest*)data;
+  return RunSchedule(request->events, request->count, &request->stats);
+}
+
+static napi_value ScheduleResolve(napi_env env, void* data, uint32_t result)
+{
+  ScheduleRequest* request = (ScheduleRequest*)data;
+
+  napi_value report, value;
+  napi_create_object(env, &report);
+  napi_create_uint32(env, result, &value);
+  napi_set_named_property(env, report, "result", value);
+  napi_create_uint32(env, request->stats.injected, &value);
+  napi_set_named_property(env, report, "injected", value);
+  napi_create_uint32(env, request->stats.failed, &value);
+  napi_set_named_property(env, report, "failed", value);
+  napi_create_double(env, request->stats.meanJitterUs, &value);
+  napi_set_named_property(env, report, "meanJitterUs", value);
+  napi_create_double(env, request->stats.maxJitterUs, &value);
+  napi_set_named_property(env, report, "maxJitterUs", value);
+  return report;
+}
+
+static void ScheduleRelease(void* data)
+{
+  ScheduleRequest* request = (ScheduleRequest*)data;
+  for (size_t i = 0; i < request->count; i++) {
+    free(request->events[i].text);
+  }
+  free(request->events);
+  free(request);
+}
+
+// Read an optional number property from an object
+static bool GetOptionalDouble(napi_env env, napi_value object, const char* name, double* value)
+{
+  bool hasProperty = false;
+  if (napi_has_named_property(env, object, name, &hasProperty) != napi_ok || !hasProperty) {
+    return false;
+  }
+
+  napi_value property;
+  napi_valuetype type;
+  napi_get_named_property(env, object, name, &property);
+  if (napi_typeof(env, property, &type) != napi_ok || type != napi_number) {
+    return false;
+  }
+
+  return napi_get_value_double(env, property, value) == napi_ok;
+}
+
+// Parse one scheduled event, returns an error message or NULL
+static const char* ParseScheduledEvent(napi_env env, napi_value object, ScheduledEvent* event)
+{
+  char type[16] = {0};
+  napi_value property;
+  napi_valuetype valueType;
+
+  if (napi_typeof(env, object, &valueType) != napi_ok || valueType != napi_object) {
+    return "Each event must be an object";
+  }
+
+  napi_get_named_property(env, object, "type", &property);
+  if (napi_get_value_string_utf8(env, property, type, sizeof(type), NULL) != napi_ok) {
+    return "Each event needs a type";
+  }
+
+  if (strcmp(type, "key") == 0 || strcmp(type, "keyDown") == 0 || strcmp(type, "keyUp") == 0) {
+    char key[32] = {0};
+    napi_get_named_property(env, object, "key", &property);
+    napi_get_value_string_utf8(env, property, key, sizeof(key), NULL);
+    event->keyCode = NativeKeyCode(LookupKey(key));
+    if (event->keyCode == KEY_UNMAPPED) {
+      return "Unrecognized key in key event";
+    }
+    bool hasModifier = false;
+    napi_has_named_property(env, object, "modifier", &hasModifier);
+    if (hasModifier) {
+      napi_get_named_property(env, object, "modifier", &property);
+      napi_get_value_bool(env, property, &event->useModifier);
+    }
+    event->type = type[3] == '\0' ? SCHEDULED_KEY : (type[3] == 'D' ? SCHEDULED_KEY_DOWN : SCHEDULED_KEY_UP);
+  } else if (strcmp(type, "text") == 0) {
+    size_t length = 0;
+    napi_get_named_property(env, object, "text", &property);
+    if (napi_get_value_string_utf8(env, property, NULL, 0, &length) != napi_ok) {
+      return "Text events need a text string";
+    }
+    event->text = (char*)malloc(length + 1);
+    if (event->text == NULL) {
+      return "Out of memory";
+    }
+    napi_get_value_string_utf8(env, property, event->text, length + 1, &event->length);
+    event->type = SCHEDULED_TEXT;
+  } else if (strcmp(type, "click") == 0) {
+    double x = 0, y = 0;
+    if (!GetOptionalDouble(env, object, "x", &x) || !GetOptionalDouble(env, object, "y", &y)) {
+      return "Click events need x and y";
+    }
+    event->x = (int)x;
+    event->y = (int)y;
+    event->type = SCHEDULED_CLICK;
+  } else {
+    return "Unknown event type (expected key, keyDown, keyUp, text or click)";
+  }
+
+  return NULL;
+}
+
+static napi_value ScheduleInputWrapper(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  size_t argc = 2;
+  napi_value args[2];
+  uint32_t count = 0;
+
+  status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  if (status != napi_ok || argc < 1 || napi_get_array_length(env, args[0], &count) != napi_ok) {
+    napi_throw_error(env, NULL, "Expected an array of events");
+    return NULL;
+  }
+
+  // Options: interval between events without an explicit offset, per target or explicit
+  char target[128] = {0};
+  double intervalMs = -1;
+  uint32_t timeout = INJECTOR_NO_TIMEOUT;
+  if (argc >= 2) {
+    napi_valuetype type;
+    napi_typeof(env, args[1], &type);
+    if (type == napi_object) {
+      bool hasTarget = false;
+      napi_has_named_property(env, args[1], "target", &hasTarget);
+      if (hasTarget) {
+        napi_value property;
+        napi_get_named_property(env, args[1], "target", &property);
+        napi_get_value_string_utf8(env, property, target, sizeof(target), NULL);
+      }
+      GetOptionalDouble(env, args[1], "interval", &intervalMs);
+      GetOptionalUint32(env, args[1], "timeout", &timeout);
+    }
+  }
+  uint64_t intervalNs = intervalMs >= 0 ? (uint64_t)(intervalMs * 1e6) : (uint64_t)GetInputRate(target[0] ? target : NULL) * 1000;
+
+  ScheduleRequest* request = (ScheduleRequest*)calloc(1, sizeof(ScheduleRequest));
+  if (request == NULL || (count > 0 && (request->events = (ScheduledEvent*)calloc(count, sizeof(ScheduledEvent))) == NULL)) {
+    free(request);
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
+  }
+
+  uint64_t offset = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    napi_value element;
+    napi_get_element(env, args[0], i, &element);
+
+    ScheduledEvent* event = &request->events[i];
+    request->count = i + 1;
+    const char* error = ParseScheduledEvent(env, element, event);
+    if (error != NULL) {
+      ScheduleRelease(request);
+      napi_throw_error(env, NULL, error);
+      return NULL;
+    }
+
+    // Explicit offsets in ms from the start, otherwise paced by the interval
+    double at;
+    if (GetOptionalDouble(env, element, "at", &at)) {
+      uint64_t explicitOffset = at > 0 ? (uint64_t)(at * 1e6) : 0;
+      if (i > 0 && explicitOffset < offset) {
+        ScheduleRelease(request);
+        napi_throw_error(env, NULL, "Event offsets must not decrease");
+        return NULL;
+      }
+      offset = explicitOffset;
+    } else if (i > 0) {
+      offset += intervalNs;
+    }
+    event->offsetNs = offset;
+  }
+
+  return InjectorQueueEx(env, ScheduleRun, ScheduleResolve, ScheduleRelease, request, timeout);
+}
+
+static napi_value SetInputRateWrapper(napi_env env, napi_callback_info info)
+{
+  size_t argc = 2;
+  napi_value args[2];
+  char target[128] = {0};
+  double intervalMs = 0;
+
+  napi_status status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  if (status != napi_ok || argc < 2 || napi_get_value_double(env, args[1], &intervalMs) != napi_ok || intervalMs < 0) {
+    napi_throw_error(env, NULL, "Expected a target and an interval in milliseconds");
+    return NULL;
+  }
+
+  // A null or undefined target sets the default
+  napi_valuetype type;
+  napi_typeof(env, args[0], &type);
+  if (type == napi_string) {
+    napi_get_value_string_utf8(env, args[0], target, sizeof(target), NULL);
+  }
+
+  SetInputRate(target[0] ? target : NULL, (uint32_t)(intervalMs * 1000));
+
+  napi_value undefined;
+  napi_get_undefined(env, &undefined);
+  return undefined;
+}
+
 static napi_value GetForemostWindowWrapper(napi_env env, napi_callback_info info)
 {
-#ifndef WIN32
+#if !defined(WIN32) && !defined(__linux__) && !defined(__APPLE__)
 
-  napi_throw_error(env, NULL, "This function is only available on Windows");
+  napi_throw_error(env, NULL, "This function is not available on this platform");
   return NULL;
 
 #else
@@ -75,7 +537,12 @@ static napi_value GetForemostWindowWrapper(napi_env env, napi_callback_info info
   // Create result object
   napi_value result;
   status = napi_create_object(env, &result);
-  
+  if (status != napi_ok) {
+    FreeWindowInfo(windowInfo);
+    napi_throw_error(env, NULL, "Failed to create result object");
+    return NULL;
+  }
+
   // Add exePath property
   if (windowInfo->exePath) {
     napi_value exePath;
@@ -162,77 +629,796 @@ static napi_value GetProductNameWrapper(napi_env env, napi_callback_info info)
 
 }
 
-static napi_value GetApplicationIconWrapper(napi_env env, napi_callback_info info)
+static napi_value SetIconCacheFileWrapper(napi_env env, napi_callback_info info)
 {
-#ifndef WIN32
+  size_t argc = 1;
+  napi_value args[1];
+  napi_valuetype type = napi_undefined;
 
-  napi_throw_error(env, NULL, "This function is only available on Windows");
-  return NULL;
+  napi_status status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  if (status == napi_ok && argc >= 1) {
+    napi_typeof(env, args[0], &type);
+  }
 
-#else
+  // null or undefined stops caching
+  bool ok = false;
+  if (type == napi_null || type == napi_undefined) {
+    ok = SetIconCacheFile(NULL);
+  } else {
+    size_t length = 0;
+    if (type != napi_string || napi_get_value_string_utf8(env, args[0], NULL, 0, &length) != napi_ok) {
+      napi_throw_error(env, NULL, "Expected a path string or null");
+      return NULL;
+    }
+    char* path = (char*)malloc(length + 1);
+    if (path == NULL) {
+      napi_throw_error(env, NULL, "Out of memory");
+      return NULL;
+    }
+    napi_get_value_string_utf8(env, args[0], path, length + 1, NULL);
+    ok = SetIconCacheFile(path);
+    free(path);
+  }
 
-  napi_status status;
+  napi_value result;
+  napi_get_boolean(env, ok, &result);
+  return result;
+}
+
+static napi_value GetVersionInfoWrapper(napi_env env, napi_callback_info info)
+{
   size_t argc = 1;
   napi_value args[1];
-  char exePath[MAX_PATH_LENGTH];
-  size_t exePathLength = 0;
-  
-  // Get the arguments (exe path)
-  status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
-  if (status != napi_ok || argc < 1) {
+  size_t length = 0;
+
+  napi_status status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  if (status != napi_ok || argc < 1 || napi_get_value_string_utf8(env, args[0], NULL, 0, &length) != napi_ok) {
     napi_throw_error(env, NULL, "Expected a string argument (exePath)");
     return NULL;
   }
-  
-  // Get the string value of exe path
-  status = napi_get_value_string_utf8(env, args[0], exePath, MAX_PATH_LENGTH, &exePathLength);
-  if (status != napi_ok) {
-    napi_throw_error(env, NULL, "Expected a string argument for exePath");
+  char* path = (char*)malloc(length + 1);
+  if (path == NULL) {
+    napi_throw_error(env, NULL, "Out of memory");
     return NULL;
   }
-  
-  // Create result object
+  napi_get_value_string_utf8(env, args[0], path, length + 1, NULL);
+
+  VersionInfo versionInfo;
+  bool found = GetVersionInfo(path, &versionInfo);
+  free(path);
+
   napi_value result;
-  status = napi_create_object(env, &result);
-  
-  // Get icon from the exe path
-  IconData* iconData = GetIconFromExePath(exePath);
-  if (iconData && iconData->data && iconData->size > 0) {
-    // Add icon data as Buffer
-    napi_value iconBuffer;
-    void* iconBufferData;
-    
-    status = napi_create_buffer(env, iconData->size, &iconBufferData, &iconBuffer);
-    if (status == napi_ok) {
-      memcpy(iconBufferData, iconData->data, iconData->size);
-      status = napi_set_named_property(env, result, "iconData", iconBuffer);
-      
-      // Add icon dimensions
-      napi_value iconWidth, iconHeight;
-      status = napi_create_int32(env, iconData->width, &iconWidth);
-      status = napi_set_named_property(env, result, "iconWidth", iconWidth);
-      status = napi_create_int32(env, iconData->height, &iconHeight);
-      status = napi_set_named_property(env, result, "iconHeight", iconHeight);
-    }
-    
-    // Free the icon data
-    FreeIconData(iconData);
+  if (!found) {
+    napi_get_null(env, &result);
+    return result;
+  }
+
+  napi_create_object(env, &result);
+  const char* names[] = { "productName", "fileDescription", "companyName", "fileVersion", "productVersion" };
+  const char* values[] = { versionInfo.productName, versionInfo.fileDescription, versionInfo.companyName, versionInfo.fileVersion, versionInfo.productVersion };
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    napi_value value;
+    napi_create_string_utf8(env, values[i], NAPI_AUTO_LENGTH, &value);
+    napi_set_named_property(env, result, names[i], value);
+  }
+  return result;
+}
+
+static napi_value SetVersionCacheFileWrapper(napi_env env, napi_callback_info info)
+{
+  size_t argc = 1;
+  napi_value args[1];
+  napi_valuetype type = napi_undefined;
+
+  napi_status status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  if (status == napi_ok && argc >= 1) {
+    napi_typeof(env, args[0], &type);
+  }
+
+  // null or undefined stops persisting
+  bool ok = false;
+  if (type == napi_null || type == napi_undefined) {
+    ok = SetVersionCacheFile(NULL);
   } else {
-    // No icon data, return empty object
-    status = napi_set_named_property(env, result, "iconData", NULL);
-    napi_value iconWidth, iconHeight;
-    status = napi_create_int32(env, 0, &iconWidth);
-    status = napi_set_named_property(env, result, "iconWidth", iconWidth);
-    status = napi_create_int32(env, 0, &iconHeight);
-    status = napi_set_named_property(env, result, "iconHeight", iconHeight);
+    size_t length = 0;
+    if (type != napi_string || napi_get_value_string_utf8(env, args[0], NULL, 0, &length) != napi_ok) {
+      napi_throw_error(env, NULL, "Expected a path string or null");
+      return NULL;
+    }
+    char* path = (char*)malloc(length + 1);
+    if (path == NULL) {
+      napi_throw_error(env, NULL, "Out of memory");
+      return NULL;
+    }
+    napi_get_value_string_utf8(env, args[0], path, length + 1, NULL);
+    ok = SetVersionCacheFile(path);
+    free(path);
+  }
+
+  napi_value result;
+  napi_get_boolean(env, ok, &result);
+  return result;
+}
+
+#ifdef __linux__
+// Copy an optional string argument, NULL for null or undefined
+static bool GetOptionalString(napi_env env, napi_value value, char** out)
+{
+  napi_valuetype type = napi_undefined;
+  size_t length = 0;
+  *out = NULL;
+  napi_typeof(env, value, &type);
+  if (type == napi_null || type == napi_undefined) {
+    return true;
+  }
+  if (type != napi_string || napi_get_value_string_utf8(env, value, NULL, 0, &length) != napi_ok) {
+    return false;
+  }
+  *out = (char*)malloc(length + 1);
+  if (*out != NULL) {
+    napi_get_value_string_utf8(env, value, *out, length + 1, NULL);
+  }
+  return true;
+}
+#endif
+
+static napi_value GetDesktopApplicationWrapper(napi_env env, napi_callback_info info)
+{
+#ifndef __linux__
+
+  napi_throw_error(env, NULL, "This function is only available on Linux");
+  return NULL;
+
+#else
+
+  size_t argc = 2;
+  napi_value args[2];
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+  // (exePath, wmClass), either may be null
+  char* exePath = NULL;
+  char* wmClass = NULL;
+  if ((argc >= 1 && !GetOptionalString(env, args[0], &exePath)) ||
+      (argc >= 2 && !GetOptionalString(env, args[1], &wmClass))) {
+    free(exePath);
+    napi_throw_error(env, NULL, "Expected exePath and wmClass strings or null");
+    return NULL;
+  }
+
+  DesktopApp app;
+  bool found = FindDesktopApp(wmClass, NULL, exePath, DESKTOP_INDEX_WAIT_MS, &app);
+  free(exePath);
+  free(wmClass);
+
+  napi_value result;
+  if (!found) {
+    napi_get_null(env, &result);
+    return result;
+  }
+
+  napi_create_object(env, &result);
+  const char* names[] = { "id", "name", "icon" };
+  const char* values[] = { app.id, app.name, app.icon };
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    napi_value value;
+    napi_create_string_utf8(env, values[i], NAPI_AUTO_LENGTH, &value);
+    napi_set_named_property(env, result, names[i], value);
+  }
+
+  // Categories=Network;WebBrowser; as an array
+  napi_value categories;
+  napi_create_array(env, &categories);
+  uint32_t count = 0;
+  for (const char* category = app.categories; *category != '\0'; ) {
+    size_t length = strcspn(category, ";");
+    if (length > 0) {
+      napi_value value;
+      napi_create_string_utf8(env, category, length, &value);
+      napi_set_element(env, categories, count++, value);
+    }
+    category += length + (category[length] == ';' ? 1 : 0);
+  }
+  napi_set_named_property(env, result, "categories", categories);
+  return result;
+
+#endif
+}
+
+static napi_value SetDesktopIndexFileWrapper(napi_env env, napi_callback_info info)
+{
+#ifndef __linux__
+
+  napi_throw_error(env, NULL, "This function is only available on Linux");
+  return NULL;
+
+#else
+
+  size_t argc = 1;
+  napi_value args[1];
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+  // null or undefined stops persisting
+  char* path = NULL;
+  if (argc >= 1 && !GetOptionalString(env, args[0], &path)) {
+    napi_throw_error(env, NULL, "Expected a path string or null");
+    return NULL;
+  }
+  bool ok = SetDesktopIndexFile(path);
+  free(path);
+
+  napi_value result;
+  napi_get_boolean(env, ok, &result);
+  return result;
+
+#endif
+}
+
+// Wrap a malloc'ed buffer without copying it
+// The allocation is reported to V8 so it weighs in garbage collection decisions
+// Runtimes that forbid external buffers (Electron sandbox) get a copy
+static void FreeBufferData(napi_env env, void* data, void* hint)
+{
+  int64_t adjusted;
+  napi_adjust_external_memory(env, -(int64_t)(uintptr_t)hint, &adjusted);
+  free(data);
+}
+
+static napi_value CreateBufferValue(napi_env env, unsigned char* data, size_t length)
+{
+  napi_value buffer = NULL;
+  if (length > 0 && napi_create_external_buffer(env, length, data, FreeBufferData, (void*)(uintptr_t)length, &buffer) == napi_ok) {
+    int64_t adjusted;
+    napi_adjust_external_memory(env, (int64_t)length, &adjusted);
+    return buffer;
+  }
+  void* copy = NULL;
+  if (napi_create_buffer_copy(env, length, data, &copy, &buffer) != napi_ok) {
+    buffer = NULL;
+  }
+  free(data);
+  return buffer;
+}
+
+// Read options.format ('ico' or 'png'), false if it is something else
+static bool GetImageFormatOption(napi_env env, napi_value options, ImageFormat* format)
+{
+  *format = IMAGE_FORMAT_ICO;
+  napi_valuetype type;
+  bool hasProperty = false;
+  if (napi_typeof(env, options, &type) != napi_ok || type != napi_object ||
+      napi_has_named_property(env, options, "format", &hasProperty) != napi_ok || !hasProperty) {
+    return true;
+  }
+
+  char name[8] = {0};
+  napi_value property;
+  napi_get_named_property(env, options, "format", &property);
+  if (napi_get_value_string_utf8(env, property, name, sizeof(name), NULL) != napi_ok) {
+    return false;
+  }
+  if (strcmp(name, "png") == 0) {
+    *format = IMAGE_FORMAT_PNG;
+    return true;
+  }
+  return strcmp(name, "ico") == 0;
+}
+
+// Build the { iconData, iconWidth, iconHeight } result and free the icon
+// The Buffer takes over the icon allocation as is
+static napi_value CreateIconValue(napi_env env, IconData* iconData)
+{
+  napi_value result;
+  napi_create_object(env, &result);
+
+  int width = 0, height = 0;
+  if (iconData && iconData->data && iconData->size > 0) {
+    napi_value iconBuffer = CreateBufferValue(env, (unsigned char*)iconData->data, (size_t)iconData->size);
+    iconData->data = NULL;
+    if (iconBuffer != NULL) {
+      napi_set_named_property(env, result, "iconData", iconBuffer);
+      width = iconData->width;
+      height = iconData->height;
+    }
+  }
+  FreeIconData(iconData);
+
+  // Dimensions are 0 when there is no icon
+  napi_value iconWidth, iconHeight;
+  napi_create_int32(env, width, &iconWidth);
+  napi_set_named_property(env, result, "iconWidth", iconWidth);
+  napi_create_int32(env, height, &iconHeight);
+  napi_set_named_property(env, result, "iconHeight", iconHeight);
+  return result;
+}
+
+static napi_value GetApplicationIconWrapper(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  size_t argc = 2;
+  napi_value args[2];
+  char exePath[MAX_PATH_LENGTH];
+  size_t exePathLength = 0;
+  
+  // Get the arguments (exe path, options)
+  status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  if (status != napi_ok || argc < 1) {
+    napi_throw_error(env, NULL, "Expected a string argument (exePath)");
+    return NULL;
+  }
+  
+  // Get the string value of exe path
+  status = napi_get_value_string_utf8(env, args[0], exePath, MAX_PATH_LENGTH, &exePathLength);
+  if (status != napi_ok) {
+    napi_throw_error(env, NULL, "Expected a string argument for exePath");
+    return NULL;
+  }
+
+  ImageFormat format = IMAGE_FORMAT_ICO;
+  uint32_t preferredSize = 0;
+  if (argc >= 2 && !GetImageFormatOption(env, args[1], &format)) {
+    napi_throw_error(env, NULL, "Expected options.format to be 'ico' or 'png'");
+    return NULL;
+  }
+  if (argc >= 2) {
+    napi_valuetype type;
+    if (napi_typeof(env, args[1], &type) == napi_ok && type == napi_object) {
+      GetOptionalUint32(env, args[1], "size", &preferredSize);
+    }
+  }
+  
+  // Get icon from the exe path (through the icon cache when there is one)
+  IconData* iconData = GetApplicationIcon(exePath, format, (int)(preferredSize <= INT32_MAX ? preferredSize : 0));
+  return CreateIconValue(env, iconData);
+}
+
+// getProductNames and getApplicationIcons run on the batch threads
+static void* ProductNameRun(const char* path, uint32_t variant)
+{
+  (void)variant;
+  char productName[VERSION_STRING_SIZE];
+  if (!GetVersionProductName(path, productName, sizeof(productName))) {
+    return NULL;
+  }
+  size_t length = strlen(productName);
+  char* result = (char*)malloc(length + 1);
+  if (result != NULL) {
+    memcpy(result, productName, length + 1);
+  }
+  return result;
+}
+
+static napi_value ProductNameResolve(napi_env env, void* result)
+{
+  napi_value value = NULL;
+  if (result != NULL) {
+    napi_create_string_utf8(env, (const char*)result, NAPI_AUTO_LENGTH, &value);
+    free(result);
+  }
+  return value;
+}
+
+static const BatchTask g_productNameTask = { ProductNameRun, ProductNameResolve, free };
+
+static napi_value GetProductNamesWrapper(napi_env env, napi_callback_info info)
+{
+  size_t argc = 1;
+  napi_value args[1];
+  napi_status status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  if (status != napi_ok || argc < 1) {
+    napi_throw_type_error(env, NULL, "Expected an array of paths");
+    return NULL;
+  }
+
+  return BatchQueue(env, &g_productNameTask, 0, args[0]);
+}
+
+// Icon variants pack the preferred size above the format
+#define ICON_VARIANT(format, size) (((uint32_t)(size) << 8) | (uint32_t)(format))
+
+static void* IconRun(const char* path, uint32_t variant)
+{
+  return GetApplicationIcon(path, (ImageFormat)(variant & 0xFF), (int)(variant >> 8));
+}
+
+static napi_value IconResolve(napi_env env, void* result)
+{
+  return CreateIconValue(env, (IconData*)result);
+}
+
+static void IconRelease(void* result)
+{
+  FreeIconData((IconData*)result);
+}
+
+static const BatchTask g_iconTask = { IconRun, IconResolve, IconRelease };
+
+static napi_value GetApplicationIconsWrapper(napi_env env, napi_callback_info info)
+{
+  size_t argc = 2;
+  napi_value args[2];
+  napi_status status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  if (status != napi_ok || argc < 1) {
+    napi_throw_type_error(env, NULL, "Expected an array of paths");
+    return NULL;
+  }
+
+  ImageFormat format = IMAGE_FORMAT_ICO;
+  uint32_t preferredSize = 0;
+  if (argc >= 2 && !GetImageFormatOption(env, args[1], &format)) {
+    napi_throw_error(env, NULL, "Expected options.format to be 'ico' or 'png'");
+    return NULL;
+  }
+  if (argc >= 2) {
+    napi_valuetype type;
+    if (napi_typeof(env, args[1], &type) == napi_ok && type == napi_object) {
+      GetOptionalUint32(env, args[1], "size", &preferredSize);
+    }
+  }
+  if (preferredSize > 0xFFFFFF) {
+    preferredSize = 0;
+  }
+
+  return BatchQueue(env, &g_iconTask, ICON_VARIANT(format, preferredSize), args[0]);
+}
+
+// Add this function to addon.c
+typedef struct {
+  uint32_t timeoutMs;
+  SelectedText text;
+} SelectedTextRequest;
+
+static uint32_t SelectedTextRun(void* data, uint32_t timeoutMs)
+{
+  SelectedTextRequest* request = (SelectedTextRequest*)data;
+  uint32_t wait = timeoutMs < request->timeoutMs ? timeoutMs : request->timeoutMs;
+  return GetSelectedText(&request->text, wait) ? 0 : 1;
+}
+
+static napi_value SelectedTextResolve(napi_env env, void* data, uint32_t result)
+{
+  SelectedTextRequest* request = (SelectedTextRequest*)data;
+  napi_value value = NULL;
+  if (result == 0) {
+    value = CreateSelectedTextValue(env, &request->text);
+  }
+  if (value == NULL) {
+    napi_get_null(env, &value);
+  }
+  return value;
+}
+
+static void SelectedTextRelease(void* data)
+{
+  SelectedTextRequest* request = (SelectedTextRequest*)data;
+  FreeSelectedText(&request->text);
+  free(request);
+}
+
+static napi_value GetSelectedTextAsyncWrapper(napi_env env, napi_callback_info info)
+{
+  size_t argc = 1;
+  napi_value args[1];
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+  SelectedTextRequest* request = (SelectedTextRequest*)calloc(1, sizeof(SelectedTextRequest));
+  if (request == NULL) {
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
+  }
+
+  // Optional time to wait for the selection owner
+  request->timeoutMs = SELECTION_TIMEOUT_MS;
+  if (argc >= 1) {
+    napi_valuetype type;
+    napi_typeof(env, args[0], &type);
+    if (type == napi_object) {
+      GetOptionalUint32(env, args[0], "timeout", &request->timeoutMs);
+    }
+  }
+
+  // Read on the injector thread, after any input queued before (a drag-select for instance)
+  return InjectorQueueEx(env, SelectedTextRun, SelectedTextResolve, SelectedTextRelease, request, INJECTOR_NO_TIMEOUT);
+}
+
+// Clipboard requests run on the injector thread so they stay ordered with input
+typedef struct {
+  uint32_t timeoutMs;
+  char* format;
+  unsigned char* data;
+  size_t length;
+  char** formats;
+  size_t count;
+  ClipboardItem* items;
+} ClipboardRequest;
+
+static void ClipboardRelease(void* data)
+{
+  ClipboardRequest* request = (ClipboardRequest*)data;
+  free(request->format);
+  free(request->data);
+  ClipboardFreeFormats(request->formats, request->count);
+  ClipboardFreeItems(request->items, request->count);
+  free(request);
+}
+
+static uint32_t ClipboardTimeout(ClipboardRequest* request, uint32_t timeoutMs)
+{
+  return timeoutMs < request->timeoutMs ? timeoutMs : request->timeoutMs;
+}
+
+// Read the optional { timeout } argument of clipboard requests
+static void GetClipboardOptions(napi_env env, napi_value options, ClipboardRequest* request)
+{
+  request->timeoutMs = CLIPBOARD_TIMEOUT_MS;
+  napi_valuetype type;
+  if (options != NULL && napi_typeof(env, options, &type) == napi_ok && type == napi_object) {
+    GetOptionalUint32(env, options, "timeout", &request->timeoutMs);
+  }
+}
+
+static uint32_t ClipboardFormatsRun(void* data, uint32_t timeoutMs)
+{
+  ClipboardRequest* request = (ClipboardRequest*)data;
+  return ClipboardFormats(&request->formats, &request->count, ClipboardTimeout(request, timeoutMs));
+}
+
+static napi_value ClipboardFormatsResolve(napi_env env, void* data, uint32_t result)
+{
+  ClipboardRequest* request = (ClipboardRequest*)data;
+  napi_value array;
+  napi_create_array_with_length(env, request->count, &array);
+  for (size_t i = 0; i < request->count; i++) {
+    napi_value name;
+    napi_create_string_utf8(env, request->formats[i], NAPI_AUTO_LENGTH, &name);
+    napi_set_element(env, array, (uint32_t)i, name);
+  }
+  return array;
+}
+
+static napi_value ClipboardFormatsWrapper(napi_env env, napi_callback_info info)
+{
+  size_t argc = 1;
+  napi_value args[1];
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+  ClipboardRequest* request = (ClipboardRequest*)calloc(1, sizeof(ClipboardRequest));
+  if (request == NULL) {
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
+  }
+  GetClipboardOptions(env, argc >= 1 ? args[0] : NULL, request);
+
+  return InjectorQueueEx(env, ClipboardFormatsRun, ClipboardFormatsResolve, ClipboardRelease, request, INJECTOR_NO_TIMEOUT);
+}
+
+static uint32_t ReadClipboardRun(void* data, uint32_t timeoutMs)
+{
+  ClipboardRequest* request = (ClipboardRequest*)data;
+  return ClipboardRead(request->format, ClipboardTimeout(request, timeoutMs), &request->data, &request->length);
+}
+
+static napi_value ReadClipboardResolve(napi_env env, void* data, uint32_t result)
+{
+  ClipboardRequest* request = (ClipboardRequest*)data;
+  napi_value value = NULL;
+  if (result == 0) {
+    // The buffer now belongs to the JS value
+    value = CreateBufferValue(env, request->data, request->length);
+    request->data = NULL;
+  }
+  if (value == NULL) {
+    napi_get_null(env, &value);
+  }
+  return value;
+}
+
+static napi_value ReadClipboardWrapper(napi_env env, napi_callback_info info)
+{
+  size_t argc = 2;
+  napi_value args[2];
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+  size_t length = 0;
+  if (argc < 1 || napi_get_value_string_utf8(env, args[0], NULL, 0, &length) != napi_ok) {
+    napi_throw_type_error(env, NULL, "Expected a format string");
+    return NULL;
+  }
+
+  ClipboardRequest* request = (ClipboardRequest*)calloc(1, sizeof(ClipboardRequest));
+  char* format = (char*)malloc(length + 1);
+  if (request == NULL || format == NULL) {
+    free(request);
+    free(format);
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
+  }
+  napi_get_value_string_utf8(env, args[0], format, length + 1, &length);
+  request->format = format;
+  GetClipboardOptions(env, argc >= 2 ? args[1] : NULL, request);
+
+  return InjectorQueueEx(env, ReadClipboardRun, ReadClipboardResolve, ClipboardRelease, request, INJECTOR_NO_TIMEOUT);
+}
+
+static uint32_t WriteClipboardRun(void* data, uint32_t timeoutMs)
+{
+  ClipboardRequest* request = (ClipboardRequest*)data;
+  return ClipboardWrite(request->items, request->count);
+}
+
+// Copy one { format: string | Buffer } entry
+static const char* ParseClipboardItem(napi_env env, napi_value key, napi_value value, ClipboardItem* item)
+{
+  size_t length = 0;
+  napi_get_value_string_utf8(env, key, NULL, 0, &length);
+  item->format = (char*)malloc(length + 1);
+  if (item->format == NULL) {
+    return "Out of memory";
+  }
+  napi_get_value_string_utf8(env, key, item->format, length + 1, &length);
+
+  bool isBuffer = false;
+  napi_is_buffer(env, value, &isBuffer);
+  if (isBuffer) {
+    void* bytes = NULL;
+    napi_get_buffer_info(env, value, &bytes, &length);
+    item->data = (unsigned char*)malloc(length ? length : 1);
+    if (item->data != NULL && length > 0) {
+      memcpy(item->data, bytes, length);
+    }
+  } else if (napi_get_value_string_utf8(env, value, NULL, 0, &length) == napi_ok) {
+    // Strings are stored as UTF-8
+    item->data = (unsigned char*)malloc(length + 1);
+    if (item->data != NULL) {
+      napi_get_value_string_utf8(env, value, (char*)item->data, length + 1, &length);
+    }
+  } else {
+    return "Clipboard values must be strings or Buffers";
+  }
+  if (item->data == NULL) {
+    return "Out of memory";
+  }
+  item->length = length;
+  return NULL;
+}
+
+static napi_value WriteClipboardWrapper(napi_env env, napi_callback_info info)
+{
+  size_t argc = 1;
+  napi_value args[1];
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+  napi_valuetype type = napi_undefined;
+  if (argc >= 1) {
+    napi_typeof(env, args[0], &type);
+  }
+  if (type != napi_object) {
+    napi_throw_type_error(env, NULL, "Expected an object mapping formats to data");
+    return NULL;
+  }
+
+  napi_value keys;
+  uint32_t keyCount = 0;
+  napi_get_property_names(env, args[0], &keys);
+  napi_get_array_length(env, keys, &keyCount);
+
+  ClipboardRequest* request = (ClipboardRequest*)calloc(1, sizeof(ClipboardRequest));
+  ClipboardItem* items = (ClipboardItem*)calloc(keyCount ? keyCount : 1, sizeof(ClipboardItem));
+  if (request == NULL || items == NULL) {
+    free(request);
+    free(items);
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
+  }
+  request->items = items;
+  request->count = keyCount;
+
+  for (uint32_t i = 0; i < keyCount; i++) {
+    napi_value key, value;
+    napi_get_element(env, keys, i, &key);
+    napi_get_property(env, args[0], key, &value);
+    const char* error = ParseClipboardItem(env, key, value, &items[i]);
+    if (error != NULL) {
+      ClipboardRelease(request);
+      napi_throw_type_error(env, NULL, error);
+      return NULL;
+    }
+  }
+
+  return InjectorQueue(env, WriteClipboardRun, ClipboardRelease, request, INJECTOR_NO_TIMEOUT);
+}
+
+typedef struct {
+  uint32_t timeoutMs;
+  char* text;
+  size_t length;
+} PasteTextRequest;
+
+static uint32_t PasteTextRun(void* data, uint32_t timeoutMs)
+{
+  PasteTextRequest* request = (PasteTextRequest*)data;
+  uint32_t wait = timeoutMs < request->timeoutMs ? timeoutMs : request->timeoutMs;
+  return ClipboardPasteText(request->text, request->length, wait);
+}
+
+static void PasteTextRelease(void* data)
+{
+  PasteTextRequest* request = (PasteTextRequest*)data;
+  free(request->text);
+  free(request);
+}
+
+static napi_value PasteTextWrapper(napi_env env, napi_callback_info info)
+{
+  size_t argc = 2;
+  napi_value args[2];
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+  size_t length = 0;
+  if (argc < 1 || napi_get_value_string_utf8(env, args[0], NULL, 0, &length) != napi_ok) {
+    napi_throw_type_error(env, NULL, "Expected a text string");
+    return NULL;
+  }
+
+  PasteTextRequest* request = (PasteTextRequest*)calloc(1, sizeof(PasteTextRequest));
+  char* text = (char*)malloc(length + 1);
+  if (request == NULL || text == NULL) {
+    free(request);
+    free(text);
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
+  }
+  napi_get_value_string_utf8(env, args[0], text, length + 1, &length);
+  request->text = text;
+  request->length = length;
+
+  // Optional time to wait for the target to read the clipboard
+  request->timeoutMs = CLIPBOARD_TIMEOUT_MS;
+  if (argc >= 2) {
+    napi_valuetype type;
+    napi_typeof(env, args[1], &type);
+    if (type == napi_object) {
+      GetOptionalUint32(env, args[1], "timeout", &request->timeoutMs);
+    }
+  }
+
+  return InjectorQueue(env, PasteTextRun, PasteTextRelease, request, INJECTOR_NO_TIMEOUT);
+}
+
+static uint32_t CopySelectionRun(void* data, uint32_t timeoutMs)
+{
+  ClipboardRequest* request = (ClipboardRequest*)data;
+  return ClipboardCopySelection(ClipboardTimeout(request, timeoutMs), &request->data, &request->length);
+}
+
+static napi_value CopySelectionResolve(napi_env env, void* data, uint32_t result)
+{
+  ClipboardRequest* request = (ClipboardRequest*)data;
+  napi_value value = NULL;
+  if (result == 0) {
+    napi_create_string_utf8(env, (const char*)request->data, request->length, &value);
+  }
+  if (value == NULL) {
+    napi_get_null(env, &value);
+  }
+  return value;
+}
+
+static napi_value CopySelectionWrapper(napi_env env, napi_callback_info info)
+{
+  size_t argc = 1;
+  napi_value args[1];
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+  ClipboardRequest* request = (ClipboardRequest*)calloc(1, sizeof(ClipboardRequest));
+  if (request == NULL) {
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
   }
-  
-  return result;
+  GetClipboardOptions(env, argc >= 1 ? args[0] : NULL, request);
 
-#endif
+  return InjectorQueueEx(env, CopySelectionRun, CopySelectionResolve, ClipboardRelease, request, INJECTOR_NO_TIMEOUT);
 }
 
-// Add this function to addon.c
 static napi_value SetForegroundWindowWrapper(napi_env env, napi_callback_info info)
 {
 #ifndef WIN32
@@ -276,18 +1462,13 @@ static napi_value SetForegroundWindowWrapper(napi_env env, napi_callback_info in
 
 static napi_value GetSelectedTextWrapper(napi_env env, napi_callback_info info)
 {
-
-  // Buffer to hold the selected text - adjust size as needed
-  char buffer[4096] = {0};
-  
-  // Call the GetSelectedText function
-  uint32_t result = GetSelectedText(buffer, sizeof(buffer));
+  // The text is allocated to the size of the selection
+  SelectedText text;
+  uint32_t result = GetSelectedText(&text, SELECTION_TIMEOUT_MS);
   
   // If successful, return the selected text as a string
   if (result) {
-    napi_value text_value;
-    napi_create_string_utf8(env, buffer, strlen(buffer), &text_value);
-    return text_value;
+    return CreateSelectedTextValue(env, &text);
   } else {
     // If failed, return null
     napi_value null_value;
@@ -366,8 +1547,8 @@ static napi_value ActivateWindowWrapper(napi_env env, napi_callback_info info)
 
 static napi_value MouseClickWrapper(napi_env env, napi_callback_info info)
 {
-#ifndef WIN32
-  napi_throw_error(env, NULL, "This function is only available on Windows");
+#if !defined(WIN32) && !defined(__linux__)
+  napi_throw_error(env, NULL, "This function is only available on Windows and Linux");
   return NULL;
 #else
   napi_status status;
@@ -408,6 +1589,166 @@ static napi_value MouseClickWrapper(napi_env env, napi_callback_info info)
 #endif
 }
 
+typedef struct {
+  PointerAction* actions;
+  size_t count;
+} MouseActionsRequest;
+
+static uint32_t MouseActionsRun(void* data, uint32_t timeoutMs)
+{
+  MouseActionsRequest* request = (MouseActionsRequest*)data;
+  return MouseActions(request->actions, request->count);
+}
+
+static void MouseActionsRelease(void* data)
+{
+  MouseActionsRequest* request = (MouseActionsRequest*)data;
+  free(request->actions);
+  free(request);
+}
+
+// Parse one pointer action, appending the native actions it expands to
+// Returns an error message or NULL
+static const char* ParsePointerAction(napi_env env, napi_value object, PointerAction* actions, size_t* count)
+{
+  char type[16] = {0};
+  napi_value property;
+  napi_valuetype valueType;
+
+  if (napi_typeof(env, object, &valueType) != napi_ok || valueType != napi_object) {
+    return "Each action must be an object";
+  }
+
+  napi_get_named_property(env, object, "type", &property);
+  if (napi_get_value_string_utf8(env, property, type, sizeof(type), NULL) != napi_ok) {
+    return "Each action needs a type";
+  }
+
+  if (strcmp(type, "wait") == 0) {
+    double ms = 0;
+    if (!GetOptionalDouble(env, object, "ms", &ms) || ms < 0) {
+      return "Wait actions need a positive ms";
+    }
+    PointerAction* action = &actions[(*count)++];
+    action->type = POINTER_WAIT;
+    action->waitMs = (uint32_t)ms;
+    return NULL;
+  }
+
+  if (strcmp(type, "wheel") == 0) {
+    PointerAction* action = &actions[(*count)++];
+    action->type = POINTER_WHEEL;
+    GetOptionalDouble(env, object, "deltaX", &action->deltaX);
+    GetOptionalDouble(env, object, "deltaY", &action->deltaY);
+    return NULL;
+  }
+
+  bool isMove = strcmp(type, "move") == 0;
+  bool isDown = strcmp(type, "down") == 0;
+  bool isUp = strcmp(type, "up") == 0;
+  bool isClick = strcmp(type, "click") == 0;
+  if (!isMove && !isDown && !isUp && !isClick) {
+    return "Unknown action type (expected move, down, up, click, wheel or wait)";
+  }
+
+  // Position: required for moves, optional for button actions
+  double x = 0, y = 0;
+  bool hasX = GetOptionalDouble(env, object, "x", &x);
+  bool hasY = GetOptionalDouble(env, object, "y", &y);
+  if (hasX != hasY || (isMove && !hasX)) {
+    return "Positions need both x and y";
+  }
+  if (hasX) {
+    PointerAction* action = &actions[(*count)++];
+    action->type = POINTER_MOVE;
+    action->x = (int)x;
+    action->y = (int)y;
+  }
+  if (isMove) {
+    return NULL;
+  }
+
+  PointerButton button = POINTER_BUTTON_LEFT;
+  bool hasButton = false;
+  napi_has_named_property(env, object, "button", &hasButton);
+  if (hasButton) {
+    char name[16] = {0};
+    napi_get_named_property(env, object, "button", &property);
+    napi_get_value_string_utf8(env, property, name, sizeof(name), NULL);
+    if (strcmp(name, "left") == 0) {
+      button = POINTER_BUTTON_LEFT;
+    } else if (strcmp(name, "right") == 0) {
+      button = POINTER_BUTTON_RIGHT;
+    } else if (strcmp(name, "middle") == 0) {
+      button = POINTER_BUTTON_MIDDLE;
+    } else if (strcmp(name, "x1") == 0) {
+      button = POINTER_BUTTON_X1;
+    } else if (strcmp(name, "x2") == 0) {
+      button = POINTER_BUTTON_X2;
+    } else {
+      return "Unknown button (expected left, right, middle, x1 or x2)";
+    }
+  }
+
+  // A click is a down and an up at the same position
+  if (isDown || isClick) {
+    PointerAction* action = &actions[(*count)++];
+    action->type = POINTER_DOWN;
+    action->button = button;
+  }
+  if (isUp || isClick) {
+    PointerAction* action = &actions[(*count)++];
+    action->type = POINTER_UP;
+    action->button = button;
+  }
+  return NULL;
+}
+
+static napi_value MouseActionsWrapper(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  size_t argc = 2;
+  napi_value args[2];
+  uint32_t count = 0;
+
+  status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  if (status != napi_ok || argc < 1 || napi_get_array_length(env, args[0], &count) != napi_ok) {
+    napi_throw_error(env, NULL, "Expected an array of actions");
+    return NULL;
+  }
+
+  uint32_t timeout = INJECTOR_NO_TIMEOUT;
+  if (argc >= 2) {
+    napi_valuetype type;
+    napi_typeof(env, args[1], &type);
+    if (type == napi_object) {
+      GetOptionalUint32(env, args[1], "timeout", &timeout);
+    }
+  }
+
+  // Each action expands to at most three native actions (move, down, up)
+  MouseActionsRequest* request = (MouseActionsRequest*)calloc(1, sizeof(MouseActionsRequest));
+  if (request == NULL || (count > 0 && (request->actions = (PointerAction*)calloc((size_t)count * 3, sizeof(PointerAction))) == NULL)) {
+    free(request);
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    napi_value element;
+    napi_get_element(env, args[0], i, &element);
+    const char* error = ParsePointerAction(env, element, request->actions, &request->count);
+    if (error != NULL) {
+      MouseActionsRelease(request);
+      napi_throw_error(env, NULL, error);
+      return NULL;
+    }
+  }
+
+  // The whole sequence runs on the injector thread, waits do not block the caller
+  return InjectorQueue(env, MouseActionsRun, MouseActionsRelease, request, timeout);
+}
+
 static napi_value StartKeyMonitorWrapper(napi_env env, napi_callback_info info)
 {
   napi_status status;
@@ -460,6 +1801,216 @@ static napi_value IsKeyMonitorRunningWrapper(napi_env env, napi_callback_info in
   return return_val;
 }
 
+static napi_value StartPointerMonitorWrapper(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  size_t argc = 2;
+  napi_value args[2];
+
+  // Get the callback argument
+  status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  napi_valuetype type;
+  if (status != napi_ok || argc < 1 || napi_typeof(env, args[0], &type) != napi_ok || type != napi_function) {
+    napi_throw_error(env, NULL, "Expected a callback function argument");
+    return NULL;
+  }
+
+  // Optional maximum number of move events per second
+  uint32_t rate = POINTER_MONITOR_DEFAULT_RATE;
+  if (argc >= 2 && napi_typeof(env, args[1], &type) == napi_ok && type == napi_object) {
+    GetOptionalUint32(env, args[1], "rate", &rate);
+  }
+
+  // Start the pointer monitor
+  int result = StartPointerMonitor(env, args[0], rate);
+
+  // Return the result
+  napi_value return_val;
+  napi_create_int32(env, result, &return_val);
+  return return_val;
+}
+
+static napi_value StopPointerMonitorWrapper(napi_env env, napi_callback_info info)
+{
+  (void)info;
+
+  int result = StopPointerMonitor();
+
+  napi_value return_val;
+  napi_create_int32(env, result, &return_val);
+  return return_val;
+}
+
+static napi_value IsPointerMonitorRunningWrapper(napi_env env, napi_callback_info info)
+{
+  (void)info;
+
+  bool running = IsPointerMonitorRunning();
+
+  napi_value return_val;
+  napi_get_boolean(env, running, &return_val);
+  return return_val;
+}
+
+static napi_value StartSelectionWatcherWrapper(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  size_t argc = 2;
+  napi_value args[2];
+
+  // Get the callback argument
+  status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  napi_valuetype type;
+  if (status != napi_ok || argc < 1 || napi_typeof(env, args[0], &type) != napi_ok || type != napi_function) {
+    napi_throw_error(env, NULL, "Expected a callback function argument");
+    return NULL;
+  }
+
+  // Optional quiet time before the text is read
+  uint32_t debounce = SELECTION_WATCHER_DEFAULT_DEBOUNCE_MS;
+  if (argc >= 2 && napi_typeof(env, args[1], &type) == napi_ok && type == napi_object) {
+    GetOptionalUint32(env, args[1], "debounce", &debounce);
+  }
+
+  // Start the selection watcher
+  int result = StartSelectionWatcher(env, args[0], debounce);
+
+  // Return the result
+  napi_value return_val;
+  napi_create_int32(env, result, &return_val);
+  return return_val;
+}
+
+static napi_value StopSelectionWatcherWrapper(napi_env env, napi_callback_info info)
+{
+  (void)info;
+
+  int result = StopSelectionWatcher();
+
+  napi_value return_val;
+  napi_create_int32(env, result, &return_val);
+  return return_val;
+}
+
+static napi_value IsSelectionWatcherRunningWrapper(napi_env env, napi_callback_info info)
+{
+  (void)info;
+
+  bool running = IsSelectionWatcherRunning();
+
+  napi_value return_val;
+  napi_get_boolean(env, running, &return_val);
+  return return_val;
+}
+
+static napi_value StartForegroundWatcherWrapper(napi_env env, napi_callback_info info)
+{
+  napi_status status;
+  size_t argc = 2;
+  napi_value args[2];
+
+  // Get the callback argument
+  status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  napi_valuetype type;
+  if (status != napi_ok || argc < 1 || napi_typeof(env, args[0], &type) != napi_ok || type != napi_function) {
+    napi_throw_error(env, NULL, "Expected a callback function argument");
+    return NULL;
+  }
+
+  // Optional quiet time before the window is read
+  uint32_t debounce = FOREGROUND_WATCHER_DEFAULT_DEBOUNCE_MS;
+  if (argc >= 2 && napi_typeof(env, args[1], &type) == napi_ok && type == napi_object) {
+    GetOptionalUint32(env, args[1], "debounce", &debounce);
+  }
+
+  // Start the foreground watcher
+  int result = StartForegroundWatcher(env, args[0], debounce);
+
+  // Return the result
+  napi_value return_val;
+  napi_create_int32(env, result, &return_val);
+  return return_val;
+}
+
+static napi_value StopForegroundWatcherWrapper(napi_env env, napi_callback_info info)
+{
+  (void)info;
+
+  int result = StopForegroundWatcher();
+
+  napi_value return_val;
+  napi_create_int32(env, result, &return_val);
+  return return_val;
+}
+
+static napi_value IsForegroundWatcherRunningWrapper(napi_env env, napi_callback_info info)
+{
+  (void)info;
+
+  bool running = IsForegroundWatcherRunning();
+
+  napi_value return_val;
+  napi_get_boolean(env, running, &return_val);
+  return return_val;
+}
+
+// Level names indexed by LOG_LEVEL_*
+static const char* g_logLevelNames[] = { "debug", "info", "warn", "error", "silent" };
+
+static napi_value SetLogLevelWrapper(napi_env env, napi_callback_info info)
+{
+  size_t argc = 1;
+  napi_value args[1];
+  char level[16] = {0};
+
+  napi_status status = napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+  if (status != napi_ok || argc < 1 || napi_get_value_string_utf8(env, args[0], level, sizeof(level), NULL) != napi_ok) {
+    napi_throw_error(env, NULL, "Expected a level (debug, info, warn, error or silent)");
+    return NULL;
+  }
+
+  for (int i = LOG_LEVEL_DEBUG; i <= LOG_LEVEL_SILENT; i++) {
+    if (strcmp(level, g_logLevelNames[i]) == 0) {
+      LogSetLevel(i);
+      napi_value undefined;
+      napi_get_undefined(env, &undefined);
+      return undefined;
+    }
+  }
+
+  napi_throw_error(env, NULL, "Expected a level (debug, info, warn, error or silent)");
+  return NULL;
+}
+
+static napi_value GetLogLevelWrapper(napi_env env, napi_callback_info info)
+{
+  (void)info;
+
+  napi_value return_val;
+  napi_create_string_utf8(env, g_logLevelNames[LogGetLevel()], NAPI_AUTO_LENGTH, &return_val);
+  return return_val;
+}
+
+static napi_value DrainLogWrapper(napi_env env, napi_callback_info info)
+{
+  (void)info;
+  return LogDrain(env);
+}
+
+static napi_value OnLogWrapper(napi_env env, napi_callback_info info)
+{
+  size_t argc = 1;
+  napi_value args[1] = { NULL };
+
+  napi_get_cb_info(env, info, &argc, args, NULL, NULL);
+
+  int result = LogSubscribe(env, argc >= 1 ? args[0] : NULL);
+
+  napi_value return_val;
+  napi_create_int32(env, result, &return_val);
+  return return_val;
+}
+
 static napi_value Init(napi_env env, napi_value exports)
 {
   napi_value result;
@@ -469,6 +2020,31 @@ static napi_value Init(napi_env env, napi_value exports)
   napi_value send_key_fn;
   napi_create_function(env, NULL, 0, SendKeyWrapper, NULL, &send_key_fn);
   napi_set_named_property(env, result, "sendKey", send_key_fn);
+
+  // Export sendKeyAsync
+  napi_value send_key_async_fn;
+  napi_create_function(env, NULL, 0, SendKeyAsyncWrapper, NULL, &send_key_async_fn);
+  napi_set_named_property(env, result, "sendKeyAsync", send_key_async_fn);
+
+  // Export waitForKeysReleased
+  napi_value wait_for_keys_released_fn;
+  napi_create_function(env, NULL, 0, WaitForKeysReleasedWrapper, NULL, &wait_for_keys_released_fn);
+  napi_set_named_property(env, result, "waitForKeysReleased", wait_for_keys_released_fn);
+
+  // Export scheduleInput
+  napi_value schedule_input_fn;
+  napi_create_function(env, NULL, 0, ScheduleInputWrapper, NULL, &schedule_input_fn);
+  napi_set_named_property(env, result, "scheduleInput", schedule_input_fn);
+
+  // Export setInputRate
+  napi_value set_input_rate_fn;
+  napi_create_function(env, NULL, 0, SetInputRateWrapper, NULL, &set_input_rate_fn);
+  napi_set_named_property(env, result, "setInputRate", set_input_rate_fn);
+
+  // Export typeText
+  napi_value type_text_fn;
+  napi_create_function(env, NULL, 0, TypeTextWrapper, NULL, &type_text_fn);
+  napi_set_named_property(env, result, "typeText", type_text_fn);
   
   // Export getForemostWindow
   napi_value get_foremost_window_fn;
@@ -485,16 +2061,81 @@ static napi_value Init(napi_env env, napi_value exports)
   napi_create_function(env, NULL, 0, GetProductNameWrapper, NULL, &get_product_name_fn);
   napi_set_named_property(env, result, "getProductName", get_product_name_fn);
 
+  // Export getVersionInfo
+  napi_value get_version_info_fn;
+  napi_create_function(env, NULL, 0, GetVersionInfoWrapper, NULL, &get_version_info_fn);
+  napi_set_named_property(env, result, "getVersionInfo", get_version_info_fn);
+
+  // Export setVersionCacheFile
+  napi_value set_version_cache_file_fn;
+  napi_create_function(env, NULL, 0, SetVersionCacheFileWrapper, NULL, &set_version_cache_file_fn);
+  napi_set_named_property(env, result, "setVersionCacheFile", set_version_cache_file_fn);
+
+  // Export getDesktopApplication
+  napi_value get_desktop_application_fn;
+  napi_create_function(env, NULL, 0, GetDesktopApplicationWrapper, NULL, &get_desktop_application_fn);
+  napi_set_named_property(env, result, "getDesktopApplication", get_desktop_application_fn);
+
+  // Export setDesktopIndexFile
+  napi_value set_desktop_index_file_fn;
+  napi_create_function(env, NULL, 0, SetDesktopIndexFileWrapper, NULL, &set_desktop_index_file_fn);
+  napi_set_named_property(env, result, "setDesktopIndexFile", set_desktop_index_file_fn);
+
   // Export getApplicationIcon
   napi_value get_application_icon_fn;
   napi_create_function(env, NULL, 0, GetApplicationIconWrapper, NULL, &get_application_icon_fn);
   napi_set_named_property(env, result, "getApplicationIcon", get_application_icon_fn);
   
+  // Export getProductNames
+  napi_value get_product_names_fn;
+  napi_create_function(env, NULL, 0, GetProductNamesWrapper, NULL, &get_product_names_fn);
+  napi_set_named_property(env, result, "getProductNames", get_product_names_fn);
+
+  // Export getApplicationIcons
+  napi_value get_application_icons_fn;
+  napi_create_function(env, NULL, 0, GetApplicationIconsWrapper, NULL, &get_application_icons_fn);
+  napi_set_named_property(env, result, "getApplicationIcons", get_application_icons_fn);
+
+  // Export setIconCacheFile
+  napi_value set_icon_cache_file_fn;
+  napi_create_function(env, NULL, 0, SetIconCacheFileWrapper, NULL, &set_icon_cache_file_fn);
+  napi_set_named_property(env, result, "setIconCacheFile", set_icon_cache_file_fn);
+
   // Export getSelectedText
   napi_value get_selected_text_fn;
   napi_create_function(env, NULL, 0, GetSelectedTextWrapper, NULL, &get_selected_text_fn);
   napi_set_named_property(env, result, "getSelectedText", get_selected_text_fn);
+
+  // Export getSelectedTextAsync
+  napi_value get_selected_text_async_fn;
+  napi_create_function(env, NULL, 0, GetSelectedTextAsyncWrapper, NULL, &get_selected_text_async_fn);
+  napi_set_named_property(env, result, "getSelectedTextAsync", get_selected_text_async_fn);
   
+  // Export clipboardFormats
+  napi_value clipboard_formats_fn;
+  napi_create_function(env, NULL, 0, ClipboardFormatsWrapper, NULL, &clipboard_formats_fn);
+  napi_set_named_property(env, result, "clipboardFormats", clipboard_formats_fn);
+
+  // Export readClipboard
+  napi_value read_clipboard_fn;
+  napi_create_function(env, NULL, 0, ReadClipboardWrapper, NULL, &read_clipboard_fn);
+  napi_set_named_property(env, result, "readClipboard", read_clipboard_fn);
+
+  // Export writeClipboard
+  napi_value write_clipboard_fn;
+  napi_create_function(env, NULL, 0, WriteClipboardWrapper, NULL, &write_clipboard_fn);
+  napi_set_named_property(env, result, "writeClipboard", write_clipboard_fn);
+
+  // Export pasteText
+  napi_value paste_text_fn;
+  napi_create_function(env, NULL, 0, PasteTextWrapper, NULL, &paste_text_fn);
+  napi_set_named_property(env, result, "pasteText", paste_text_fn);
+
+  // Export copySelection
+  napi_value copy_selection_fn;
+  napi_create_function(env, NULL, 0, CopySelectionWrapper, NULL, &copy_selection_fn);
+  napi_set_named_property(env, result, "copySelection", copy_selection_fn);
+
   // Export setForegroundWindow
   napi_value set_foreground_window_fn;
   napi_create_function(env, NULL, 0, SetForegroundWindowWrapper, NULL, &set_foreground_window_fn);
@@ -510,6 +2151,11 @@ static napi_value Init(napi_env env, napi_value exports)
   napi_create_function(env, NULL, 0, MouseClickWrapper, NULL, &simulate_mouse_click_fn);
   napi_set_named_property(env, result, "mouseClick", simulate_mouse_click_fn);
 
+  // Export mouseActions
+  napi_value mouse_actions_fn;
+  napi_create_function(env, NULL, 0, MouseActionsWrapper, NULL, &mouse_actions_fn);
+  napi_set_named_property(env, result, "mouseActions", mouse_actions_fn);
+
   // Export startKeyMonitor
   napi_value start_key_monitor_fn;
   napi_create_function(env, NULL, 0, StartKeyMonitorWrapper, NULL, &start_key_monitor_fn);
@@ -525,6 +2171,71 @@ static napi_value Init(napi_env env, napi_value exports)
   napi_create_function(env, NULL, 0, IsKeyMonitorRunningWrapper, NULL, &is_key_monitor_running_fn);
   napi_set_named_property(env, result, "isKeyMonitorRunning", is_key_monitor_running_fn);
 
+  // Export startPointerMonitor
+  napi_value start_pointer_monitor_fn;
+  napi_create_function(env, NULL, 0, StartPointerMonitorWrapper, NULL, &start_pointer_monitor_fn);
+  napi_set_named_property(env, result, "startPointerMonitor", start_pointer_monitor_fn);
+
+  // Export stopPointerMonitor
+  napi_value stop_pointer_monitor_fn;
+  napi_create_function(env, NULL, 0, StopPointerMonitorWrapper, NULL, &stop_pointer_monitor_fn);
+  napi_set_named_property(env, result, "stopPointerMonitor", stop_pointer_monitor_fn);
+
+  // Export isPointerMonitorRunning
+  napi_value is_pointer_monitor_running_fn;
+  napi_create_function(env, NULL, 0, IsPointerMonitorRunningWrapper, NULL, &is_pointer_monitor_running_fn);
+  napi_set_named_property(env, result, "isPointerMonitorRunning", is_pointer_monitor_running_fn);
+
+  // Export startSelectionWatcher
+  napi_value start_selection_watcher_fn;
+  napi_create_function(env, NULL, 0, StartSelectionWatcherWrapper, NULL, &start_selection_watcher_fn);
+  napi_set_named_property(env, result, "startSelectionWatcher", start_selection_watcher_fn);
+
+  // Export stopSelectionWatcher
+  napi_value stop_selection_watcher_fn;
+  napi_create_function(env, NULL, 0, StopSelectionWatcherWrapper, NULL, &stop_selection_watcher_fn);
+  napi_set_named_property(env, result, "stopSelectionWatcher", stop_selection_watcher_fn);
+
+  // Export isSelectionWatcherRunning
+  napi_value is_selection_watcher_running_fn;
+  napi_create_function(env, NULL, 0, IsSelectionWatcherRunningWrapper, NULL, &is_selection_watcher_running_fn);
+  napi_set_named_property(env, result, "isSelectionWatcherRunning", is_selection_watcher_running_fn);
+
+  // Export startForegroundWatcher
+  napi_value start_foreground_watcher_fn;
+  napi_create_function(env, NULL, 0, StartForegroundWatcherWrapper, NULL, &start_foreground_watcher_fn);
+  napi_set_named_property(env, result, "startForegroundWatcher", start_foreground_watcher_fn);
+
+  // Export stopForegroundWatcher
+  napi_value stop_foreground_watcher_fn;
+  napi_create_function(env, NULL, 0, StopForegroundWatcherWrapper, NULL, &stop_foreground_watcher_fn);
+  napi_set_named_property(env, result, "stopForegroundWatcher", stop_foreground_watcher_fn);
+
+  // Export isForegroundWatcherRunning
+  napi_value is_foreground_watcher_running_fn;
+  napi_create_function(env, NULL, 0, IsForegroundWatcherRunningWrapper, NULL, &is_foreground_watcher_running_fn);
+  napi_set_named_property(env, result, "isForegroundWatcherRunning", is_foreground_watcher_running_fn);
+
+  // Export setLogLevel
+  napi_value set_log_level_fn;
+  napi_create_function(env, NULL, 0, SetLogLevelWrapper, NULL, &set_log_level_fn);
+  napi_set_named_property(env, result, "setLogLevel", set_log_level_fn);
+
+  // Export getLogLevel
+  napi_value get_log_level_fn;
+  napi_create_function(env, NULL, 0, GetLogLevelWrapper, NULL, &get_log_level_fn);
+  napi_set_named_property(env, result, "getLogLevel", get_log_level_fn);
+
+  // Export drainLog
+  napi_value drain_log_fn;
+  napi_create_function(env, NULL, 0, DrainLogWrapper, NULL, &drain_log_fn);
+  napi_set_named_property(env, result, "drainLog", drain_log_fn);
+
+  // Export onLog
+  napi_value on_log_fn;
+  napi_create_function(env, NULL, 0, OnLogWrapper, NULL, &on_log_fn);
+  napi_set_named_property(env, result, "onLog", on_log_fn);
+
   return result;
 }
 
@@ -0,0 +1,370 @@
+#include "batch.h"
+#include "log.h"
+#include "threads.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Buckets of the in-flight job table
+#define BATCH_BUCKETS 256
+
+typedef struct BatchRequest BatchRequest;
+
+// One entry of a batch, waiting on the job of its path
+typedef struct BatchSlot {
+  BatchRequest* request;
+  uint32_t index;
+  struct BatchSlot* next;       // Next waiter of the same job
+} BatchSlot;
+
+struct BatchRequest {
+  napi_deferred deferred;
+  napi_ref results;             // Array resolved once every slot is filled
+  uint32_t remaining;
+  BatchSlot slots[];
+};
+
+typedef struct BatchJob {
+  const BatchTask* task;
+  uint32_t variant;
+  uint32_t hash;
+  void* result;
+  BatchSlot* waiters;
+  struct BatchJob* next;        // Work queue
+  struct BatchJob* nextInFlight; // In-flight table bucket
+  char path[];
+} BatchJob;
+
+static bool g_initialized = false;
+static bool g_stop = false;
+static Mutex g_mutex;
+static Condition g_condition;
+static Thread g_threads[BATCH_THREADS];
+static int g_threadCount = 0;
+static BatchJob* g_head = NULL;
+static BatchJob* g_tail = NULL;
+static napi_threadsafe_function g_tsfn = NULL;
+
+// Only touched on the JS thread: jobs stay in the table until resolved
+static BatchJob* g_inFlight[BATCH_BUCKETS];
+static uint32_t g_pending = 0;
+
+// FNV-1a over the path, mixed with the variant
+static uint32_t HashJob(const char* path, uint32_t variant) {
+  uint32_t hash = 2166136261u ^ variant;
+  for (const unsigned char* p = (const unsigned char*)path; *p; p++) {
+    hash = (hash ^ *p) * 16777619u;
+  }
+  return hash;
+}
+
+static BatchJob* FindJob(const BatchTask* task, uint32_t variant, uint32_t hash, const char* path) {
+  for (BatchJob* job = g_inFlight[hash % BATCH_BUCKETS]; job != NULL; job = job->nextInFlight) {
+    if (job->hash == hash && job->task == task && job->variant == variant && strcmp(job->path, path) == 0) {
+      return job;
+    }
+  }
+  return NULL;
+}
+
+static void RemoveJob(BatchJob* job) {
+  BatchJob** link = &g_inFlight[job->hash % BATCH_BUCKETS];
+  while (*link != NULL && *link != job) {
+    link = &(*link)->nextInFlight;
+  }
+  if (*link != NULL) {
+    *link = job->nextInFlight;
+  }
+}
+
+// Free a job that will not be resolved, and the requests only it was holding
+static void DropJob(napi_env env, BatchJob* job) {
+  if (job->result != NULL && job->task->release != NULL) {
+    job->task->release(job->result);
+  }
+  for (BatchSlot* slot = job->waiters; slot != NULL; ) {
+    BatchSlot* next = slot->next;
+    BatchRequest* request = slot->request;
+    if (--request->remaining == 0) {
+      napi_delete_reference(env, request->results);
+      free(request);
+    }
+    slot = next;
+  }
+  free(job);
+}
+
+// Fill the slots waiting on a job on the JS thread, resolving finished batches
+static void CompleteJob(napi_env env, napi_value js_callback, void* context, void* data) {
+  (void)js_callback;
+  (void)context;
+
+  // Teardown: Shutdown drops whatever is still in the table
+  if (env == NULL) {
+    return;
+  }
+
+  BatchJob* job = (BatchJob*)data;
+  RemoveJob(job);
+
+  napi_value value = job->task->resolve(env, job->result);
+  if (value == NULL) {
+    napi_get_null(env, &value);
+  }
+
+  for (BatchSlot* slot = job->waiters; slot != NULL; ) {
+    BatchSlot* next = slot->next;
+    BatchRequest* request = slot->request;
+    napi_value results;
+    napi_get_reference_value(env, request->results, &results);
+    napi_set_element(env, results, slot->index, value);
+
+    if (--request->remaining == 0) {
+      napi_resolve_deferred(env, request->deferred, results);
+      napi_delete_reference(env, request->results);
+      free(request);
+
+      // Let the process exit once nothing is in flight
+      if (--g_pending == 0) {
+        napi_unref_threadsafe_function(env, g_tsfn);
+      }
+    }
+    slot = next;
+  }
+
+  free(job);
+}
+
+static THREAD_PROC(BatchThread) {
+  (void)arg;
+
+  MutexLock(&g_mutex);
+  for (;;) {
+    while (g_head == NULL && !g_stop) {
+      ConditionWait(&g_condition, &g_mutex);
+    }
+    if (g_stop) {
+      break;
+    }
+
+    BatchJob* job = g_head;
+    g_head = job->next;
+    if (g_head == NULL) {
+      g_tail = NULL;
+    }
+    MutexUnlock(&g_mutex);
+
+    job->result = job->task->run(job->path, job->variant);
+
+    // On failure the environment is going away: Shutdown drops the job
+    napi_call_threadsafe_function(g_tsfn, job, napi_tsfn_blocking);
+
+    MutexLock(&g_mutex);
+  }
+  MutexUnlock(&g_mutex);
+
+  THREAD_RETURN;
+}
+
+static void Shutdown(void* arg) {
+  napi_env env = (napi_env)arg;
+
+  MutexLock(&g_mutex);
+  g_stop = true;
+  ConditionBroadcast(&g_condition);
+  MutexUnlock(&g_mutex);
+  for (int i = 0; i < g_threadCount; i++) {
+    ThreadJoin(g_threads[i]);
+  }
+  g_threadCount = 0;
+
+  // Queued, running and unresolved jobs are all in the table
+  for (int i = 0; i < BATCH_BUCKETS; i++) {
+    while (g_inFlight[i] != NULL) {
+      BatchJob* job = g_inFlight[i];
+      g_inFlight[i] = job->nextInFlight;
+      DropJob(env, job);
+    }
+  }
+  g_head = NULL;
+  g_tail = NULL;
+  g_pending = 0;
+
+  napi_release_threadsafe_function(g_tsfn, napi_tsfn_abort);
+  g_tsfn = NULL;
+  g_initialized = false;
+}
+
+static bool Initialize(napi_env env) {
+  if (g_initialized) {
+    return true;
+  }
+
+  napi_value resourceName;
+  napi_create_string_utf8(env, "Batch", NAPI_AUTO_LENGTH, &resourceName);
+
+  napi_status status = napi_create_threadsafe_function(
+    env,
+    NULL,                    // no JS function: CompleteJob resolves promises
+    NULL,                    // async_resource
+    resourceName,            // async_resource_name
+    0,                       // max_queue_size (0 = unlimited)
+    1,                       // initial_thread_count
+    NULL,                    // thread_finalize_data
+    NULL,                    // thread_finalize_cb
+    NULL,                    // context
+    CompleteJob,             // call_js_cb
+    &g_tsfn
+  );
+
+  if (status != napi_ok) {
+    LOG_ERROR("batch", "Failed to create threadsafe function");
+    return false;
+  }
+  napi_unref_threadsafe_function(env, g_tsfn);
+
+  MutexInit(&g_mutex);
+  ConditionInit(&g_condition);
+  g_stop = false;
+
+  // Run with fewer threads if some cannot be created
+  while (g_threadCount < BATCH_THREADS && ThreadCreate(&g_threads[g_threadCount], BatchThread, NULL)) {
+    g_threadCount++;
+  }
+  if (g_threadCount == 0) {
+    LOG_ERROR("batch", "Failed to create batch threads");
+    napi_release_threadsafe_function(g_tsfn, napi_tsfn_abort);
+    g_tsfn = NULL;
+    return false;
+  }
+
+  napi_add_env_cleanup_hook(env, Shutdown, env);
+  g_initialized = true;
+  return true;
+}
+
+napi_value BatchQueue(napi_env env, const BatchTask* task, uint32_t variant, napi_value paths) {
+  bool isArray = false;
+  uint32_t count = 0;
+  if (napi_is_array(env, paths, &isArray) != napi_ok || !isArray || napi_get_array_length(env, paths, &count) != napi_ok) {
+    napi_throw_type_error(env, NULL, "Expected an array of paths");
+    return NULL;
+  }
+
+  // Check every entry before queuing anything
+  for (uint32_t i = 0; i < count; i++) {
+    napi_value element;
+    napi_valuetype type = napi_undefined;
+    napi_get_element(env, paths, i, &element);
+    napi_typeof(env, element, &type);
+    if (type != napi_string) {
+      napi_throw_type_error(env, NULL, "Expected an array of paths");
+      return NULL;
+    }
+  }
+
+  if (!Initialize(env)) {
+    napi_throw_error(env, NULL, "Failed to start batch threads");
+    return NULL;
+  }
+
+  BatchRequest* request = (BatchRequest*)calloc(1, sizeof(BatchRequest) + (size_t)count * sizeof(BatchSlot));
+  if (request == NULL) {
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
+  }
+
+  napi_value promise, results;
+  napi_create_promise(env, &request->deferred, &promise);
+  napi_create_array_with_length(env, count, &results);
+
+  if (count == 0) {
+    napi_resolve_deferred(env, request->deferred, results);
+    free(request);
+    return promise;
+  }
+
+  napi_create_reference(env, results, 1, &request->results);
+  request->remaining = count;
+
+  // Keep the process alive until the promise settles
+  if (g_pending++ == 0) {
+    napi_ref_threadsafe_function(env, g_tsfn);
+  }
+
+  BatchJob* head = NULL;
+  BatchJob* last = NULL;
+  for (uint32_t i = 0; i < count; i++) {
+    napi_value element;
+    size_t length = 0;
+    napi_get_element(env, paths, i, &element);
+    napi_get_value_string_utf8(env, element, NULL, 0, &length);
+
+    BatchSlot* slot = &request->slots[i];
+    slot->request = request;
+    slot->index = i;
+
+    BatchJob* job = (BatchJob*)malloc(sizeof(BatchJob) + length + 1);
+    if (job == NULL) {
+      // Leave the entry null rather than failing the whole batch
+      napi_value null;
+      napi_get_null(env, &null);
+      napi_set_element(env, results, i, null);
+      request->remaining--;
+      continue;
+    }
+    napi_get_value_string_utf8(env, element, job->path, length + 1, &length);
+
+    // Join the job already running for this path
+    uint32_t hash = HashJob(job->path, variant);
+    BatchJob* existing = FindJob(task, variant, hash, job->path);
+    if (existing != NULL) {
+      free(job);
+      slot->next = existing->waiters;
+      existing->waiters = slot;
+      continue;
+    }
+
+    job->task = task;
+    job->variant = variant;
+    job->hash = hash;
+    job->result = NULL;
+    job->waiters = slot;
+    slot->next = NULL;
+    job->next = NULL;
+    job->nextInFlight = g_inFlight[hash % BATCH_BUCKETS];
+    g_inFlight[hash % BATCH_BUCKETS] = job;
+
+    if (last != NULL) {
+      last->next = job;
+    } else {
+      head = job;
+    }
+    last = job;
+  }
+
+  // Every allocation failed
+  if (request->remaining == 0) {
+    napi_resolve_deferred(env, request->deferred, results);
+    napi_delete_reference(env, request->results);
+    free(request);
+    if (--g_pending == 0) {
+      napi_unref_threadsafe_function(env, g_tsfn);
+    }
+    return promise;
+  }
+
+  if (head != NULL) {
+    MutexLock(&g_mutex);
+    if (g_tail != NULL) {
+      g_tail->next = head;
+    } else {
+      g_head = head;
+    }
+    g_tail = last;
+    ConditionBroadcast(&g_condition);
+    MutexUnlock(&g_mutex);
+  }
+
+  return promise;
+}
@@ -0,0 +1,42 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <node_api.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Worker threads running batch jobs
+#define BATCH_THREADS 4
+
+// Work function run on a worker thread for one path (UTF-8)
+// variant is the task parameter given to BatchQueue
+// Returns the result handed to BatchResolve, NULL if there is none
+typedef void* (*BatchRun)(const char* path, uint32_t variant);
+
+// Build the JS value of a result on the JS thread and free the result
+// Returns NULL to resolve with null
+typedef napi_value (*BatchResolve)(napi_env env, void* result);
+
+// Free a result that will never be resolved (environment teardown)
+typedef void (*BatchRelease)(void* result);
+
+typedef struct {
+  BatchRun run;
+  BatchResolve resolve;
+  BatchRelease release;
+} BatchTask;
+
+// Run a task for every path of a JS array on the worker threads
+// Jobs for the same task, variant and path that are already in flight (from
+// this batch or an earlier one) are run once and share their result value
+// Returns a promise resolving with the results in input order
+napi_value BatchQueue(napi_env env, const BatchTask* task, uint32_t variant, napi_value paths);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BATCH_H
@@ -0,0 +1,1481 @@
+#include "clipboard.h"
+#include "keysender.h"
+#include "log.h"
+#include "threads.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <ApplicationServices/ApplicationServices.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <unistd.h>
+#elif defined(__linux__)
+#include "x11.h"
+#include <X11/Xatom.h>
+#include <X11/extensions/Xfixes.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#else
+#include <unistd.h>
+#endif
+
+// Time given to the target to read a pasted text where reads cannot be observed
+#define PASTE_SETTLE_MS 150
+
+// Delay before the clipboard is restored once the target read it:
+// some applications read several formats in a row
+#define PASTE_RESTORE_DELAY_MS 100
+
+static void SleepMillis(uint32_t ms) {
+#ifdef _WIN32
+  Sleep(ms);
+#else
+  usleep(ms * 1000);
+#endif
+}
+
+// MIME types with a well known native equivalent
+typedef struct {
+  const char* mime;
+  const char* native;
+} FormatAlias;
+
+static char* CopyString(const char* value) {
+  size_t length = strlen(value);
+  char* copy = (char*)malloc(length + 1);
+  if (copy != NULL) {
+    memcpy(copy, value, length + 1);
+  }
+  return copy;
+}
+
+static const char* NativeFormat(const FormatAlias* aliases, const char* mime) {
+  for (const FormatAlias* alias = aliases; alias->mime != NULL; alias++) {
+    if (strcmp(alias->mime, mime) == 0) {
+      return alias->native;
+    }
+  }
+  return mime;
+}
+
+static const char* MimeFormat(const FormatAlias* aliases, const char* native) {
+  for (const FormatAlias* alias = aliases; alias->mime != NULL; alias++) {
+    if (strcmp(alias->native, native) == 0) {
+      return alias->mime;
+    }
+  }
+  return native;
+}
+
+// Append a copy of name unless already listed
+static bool AddFormat(char*** formats, size_t* count, size_t* capacity, const char* name) {
+  for (size_t i = 0; i < *count; i++) {
+    if (strcmp((*formats)[i], name) == 0) {
+      return true;
+    }
+  }
+  if (*count == *capacity) {
+    size_t grown = *capacity ? *capacity * 2 : 8;
+    char** resized = (char**)realloc(*formats, grown * sizeof(char*));
+    if (resized == NULL) {
+      return false;
+    }
+    *formats = resized;
+    *capacity = grown;
+  }
+  char* copy = CopyString(name);
+  if (copy == NULL) {
+    return false;
+  }
+  (*formats)[(*count)++] = copy;
+  return true;
+}
+
+void ClipboardFreeFormats(char** formats, size_t count) {
+  if (formats == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    free(formats[i]);
+  }
+  free(formats);
+}
+
+void ClipboardFreeItems(ClipboardItem* items, size_t count) {
+  if (items == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    free(items[i].format);
+    free(items[i].data);
+  }
+  free(items);
+}
+
+#ifdef _WIN32
+
+// ============================================================================
+// Windows: Win32 clipboard, owned by a hidden window on its own thread
+// ============================================================================
+
+static const FormatAlias g_aliases[] = {
+  { "text/html", "HTML Format" },
+  { "text/rtf", "Rich Text Format" },
+  { "image/png", "PNG" },
+  { NULL, NULL }
+};
+
+// Attempts to open a clipboard held by another process
+#define OPEN_RETRIES 10
+#define OPEN_RETRY_DELAY_MS 10
+
+// Signaled by WM_CLIPBOARDUPDATE
+static Mutex g_changeLock;
+static Condition g_changed;
+
+// Longest wait between two looks at the sequence number, in case an update is missed
+#define CHANGE_POLL_MS 50
+
+static void PlatformInitialize(void) {
+  MutexInit(&g_changeLock);
+  ConditionInit(&g_changed);
+}
+
+static volatile LONG g_ownerState = 0; // 0 not started, 1 starting, 2 running, 3 failed
+static HWND g_owner = NULL;
+
+static LRESULT CALLBACK OwnerProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+  if (msg == WM_CLIPBOARDUPDATE) {
+    MutexLock(&g_changeLock);
+    ConditionBroadcast(&g_changed);
+    MutexUnlock(&g_changeLock);
+    return 0;
+  }
+  return DefWindowProcW(hwnd, msg, wParam, lParam);
+}
+
+static DWORD WINAPI OwnerThread(LPVOID param) {
+  (void)param;
+  WNDCLASSW wc = {0};
+  wc.lpfnWndProc = OwnerProc;
+  wc.hInstance = GetModuleHandleW(NULL);
+  wc.lpszClassName = L"AutolibClipboardOwner";
+  RegisterClassW(&wc);
+
+  // The owner gets messages sent by other processes (WM_DESTROYCLIPBOARD...):
+  // it needs a thread that keeps pumping or they would block
+  HWND hwnd = CreateWindowExW(0, wc.lpszClassName, L"", 0, 0, 0, 0, 0, HWND_MESSAGE, NULL, wc.hInstance, NULL);
+  if (hwnd == NULL) {
+    InterlockedExchange(&g_ownerState, 3);
+    return 0;
+  }
+  g_owner = hwnd;
+  AddClipboardFormatListener(hwnd);
+  InterlockedExchange(&g_ownerState, 2);
+
+  MSG msg;
+  while (GetMessageW(&msg, NULL, 0, 0) > 0) {
+    DispatchMessageW(&msg);
+  }
+  return 0;
+}
+
+static HWND OwnerWindow(void) {
+  if (InterlockedCompareExchange(&g_ownerState, 1, 0) == 0) {
+    HANDLE thread = CreateThread(NULL, 0, OwnerThread, NULL, 0, NULL);
+    if (thread == NULL) {
+      InterlockedExchange(&g_ownerState, 3);
+    } else {
+      CloseHandle(thread);
+    }
+  }
+  while (g_ownerState == 1) {
+    Sleep(1);
+  }
+  return g_ownerState == 2 ? g_owner : NULL;
+}
+
+static bool OpenClipboardRetry(HWND owner) {
+  for (int attempt = 0; attempt < OPEN_RETRIES; attempt++) {
+    if (OpenClipboard(owner)) {
+      return true;
+    }
+    Sleep(OPEN_RETRY_DELAY_MS);
+  }
+  LOG_DEBUG("clipboard", "Unable to open the clipboard: %lu", GetLastError());
+  return false;
+}
+
+static UINT FormatId(const char* format) {
+  if (strcmp(format, "text/plain") == 0) {
+    return CF_UNICODETEXT;
+  }
+  return RegisterClipboardFormatA(NativeFormat(g_aliases, format));
+}
+
+// Parse a "Name:0000000123" header field of a CF_HTML block
+static bool HtmlOffset(const char* data, size_t length, const char* name, size_t* offset) {
+  size_t nameLength = strlen(name);
+  for (size_t i = 0; i + nameLength < length && data[i] != '<'; i++) {
+    if ((i == 0 || data[i - 1] == '\n') && memcmp(data + i, name, nameLength) == 0) {
+      *offset = (size_t)strtoul(data + i + nameLength, NULL, 10);
+      return true;
+    }
+  }
+  return false;
+}
+
+// Wrap an HTML document in the CF_HTML header
+static HGLOBAL HtmlToGlobal(const unsigned char* html, size_t length) {
+  static const char* header =
+    "Version:0.9\r\nStartHTML:%010u\r\nEndHTML:%010u\r\nStartFragment:%010u\r\nEndFragment:%010u\r\n";
+  static const char* prefix = "<html><body>\r\n<!--StartFragment-->";
+  static const char* suffix = "<!--EndFragment-->\r\n</body></html>";
+
+  char scratch[160];
+  size_t headerLength = (size_t)snprintf(scratch, sizeof(scratch), header, 0u, 0u, 0u, 0u);
+  size_t startHtml = headerLength;
+  size_t startFragment = startHtml + strlen(prefix);
+  size_t endFragment = startFragment + length;
+  size_t endHtml = endFragment + strlen(suffix);
+
+  HGLOBAL global = GlobalAlloc(GMEM_MOVEABLE, endHtml + 1);
+  if (global == NULL) {
+    return NULL;
+  }
+  char* target = (char*)GlobalLock(global);
+  snprintf(target, headerLength + 1, header, (unsigned)startHtml, (unsigned)endHtml, (unsigned)startFragment, (unsigned)endFragment);
+  memcpy(target + startHtml, prefix, strlen(prefix));
+  memcpy(target + startFragment, html, length);
+  memcpy(target + endFragment, suffix, strlen(suffix) + 1);
+  GlobalUnlock(global);
+  return global;
+}
+
+static HGLOBAL TextToGlobal(const unsigned char* text, size_t length) {
+  int units = length ? MultiByteToWideChar(CP_UTF8, 0, (const char*)text, (int)length, NULL, 0) : 0;
+  HGLOBAL global = GlobalAlloc(GMEM_MOVEABLE, ((size_t)units + 1) * sizeof(WCHAR));
+  if (global == NULL) {
+    return NULL;
+  }
+  WCHAR* target = (WCHAR*)GlobalLock(global);
+  if (units > 0) {
+    MultiByteToWideChar(CP_UTF8, 0, (const char*)text, (int)length, target, units);
+  }
+  target[units] = 0;
+  GlobalUnlock(global);
+  return global;
+}
+
+static HGLOBAL BytesToGlobal(const unsigned char* data, size_t length) {
+  HGLOBAL global = GlobalAlloc(GMEM_MOVEABLE, length ? length : 1);
+  if (global == NULL) {
+    return NULL;
+  }
+  if (length > 0) {
+    memcpy(GlobalLock(global), data, length);
+    GlobalUnlock(global);
+  }
+  return global;
+}
+
+static uint32_t PlatformFormats(char*** formats, size_t* count, uint32_t timeoutMs) {
+  (void)timeoutMs;
+  *formats = NULL;
+  *count = 0;
+  if (!OpenClipboardRetry(NULL)) {
+    return 3;
+  }
+
+  size_t capacity = 0;
+  bool ok = true;
+  char name[256];
+  for (UINT format = EnumClipboardFormats(0); ok && format != 0; format = EnumClipboardFormats(format)) {
+    if (format == CF_UNICODETEXT || format == CF_TEXT || format == CF_OEMTEXT) {
+      ok = AddFormat(formats, count, &capacity, "text/plain");
+    } else if (GetClipboardFormatNameA(format, name, sizeof(name)) > 0) {
+      ok = AddFormat(formats, count, &capacity, MimeFormat(g_aliases, name));
+    }
+    // Other predefined formats (bitmaps, locale...) have no portable name
+  }
+  CloseClipboard();
+
+  if (!ok) {
+    ClipboardFreeFormats(*formats, *count);
+    *formats = NULL;
+    *count = 0;
+    return 3;
+  }
+  return 0;
+}
+
+static uint32_t PlatformRead(const char* format, uint32_t timeoutMs, unsigned char** data, size_t* length) {
+  (void)timeoutMs;
+  *data = NULL;
+  *length = 0;
+
+  UINT id = FormatId(format);
+  if (id == 0) {
+    return 3;
+  }
+  if (!OpenClipboardRetry(NULL)) {
+    return 3;
+  }
+
+  HANDLE handle = GetClipboardData(id);
+  const unsigned char* source = handle != NULL ? (const unsigned char*)GlobalLock(handle) : NULL;
+  if (source == NULL) {
+    CloseClipboard();
+    return 3;
+  }
+  size_t size = GlobalSize(handle);
+  uint32_t result = 0;
+
+  if (id == CF_UNICODETEXT) {
+    // Stop at the terminator, the global block is often larger than the text
+    const WCHAR* text = (const WCHAR*)source;
+    size_t units = 0;
+    while (units < size / sizeof(WCHAR) && text[units] != 0) {
+      units++;
+    }
+    int bytes = units ? WideCharToMultiByte(CP_UTF8, 0, text, (int)units, NULL, 0, NULL, NULL) : 0;
+    *data = (unsigned char*)malloc((size_t)bytes + 1);
+    if (*data != NULL) {
+      if (bytes > 0) {
+        WideCharToMultiByte(CP_UTF8, 0, text, (int)units, (char*)*data, bytes, NULL, NULL);
+      }
+      *length = (size_t)bytes;
+    }
+  } else {
+    // CF_HTML: return the HTML document without the description header
+    size_t start = 0;
+    size_t end = size;
+    size_t value;
+    if (strcmp(format, "text/html") == 0) {
+      if (HtmlOffset((const char*)source, size, "StartHTML:", &value) && value < size) {
+        start = value;
+      }
+      if (HtmlOffset((const char*)source, size, "EndHTML:", &value) && value > start && value <= size) {
+        end = value;
+      }
+    }
+    if (id == RegisterClipboardFormatA("HTML Format") || id == RegisterClipboardFormatA("Rich Text Format")) {
+      // Text formats are NUL-terminated inside a rounded-up block
+      const unsigned char* nul = (const unsigned char*)memchr(source + start, 0, end - start);
+      if (nul != NULL) {
+        end = (size_t)(nul - source);
+      }
+    }
+    *data = (unsigned char*)malloc(end - start + 1);
+    if (*data != NULL) {
+      memcpy(*data, source + start, end - start);
+      *length = end - start;
+    }
+  }
+
+  if (*data == NULL) {
+    result = 3;
+  } else {
+    (*data)[*length] = 0;
+  }
+  GlobalUnlock(handle);
+  CloseClipboard();
+  return result;
+}
+
+static uint32_t PlatformWrite(const ClipboardItem* items, size_t count) {
+  // EmptyClipboard makes the window passed to OpenClipboard the owner:
+  // without one SetClipboardData fails
+  HWND owner = OwnerWindow();
+  if (owner == NULL) {
+    return 1;
+  }
+  if (!OpenClipboardRetry(owner)) {
+    return 3;
+  }
+
+  EmptyClipboard();
+  uint32_t result = 0;
+  for (size_t i = 0; i < count && result == 0; i++) {
+    UINT id = FormatId(items[i].format);
+    HGLOBAL global = NULL;
+    if (id == CF_UNICODETEXT) {
+      global = TextToGlobal(items[i].data, items[i].length);
+    } else if (strcmp(items[i].format, "text/html") == 0) {
+      global = HtmlToGlobal(items[i].data, items[i].length);
+    } else if (id != 0) {
+      global = BytesToGlobal(items[i].data, items[i].length);
+    }
+    if (global == NULL || SetClipboardData(id, global) == NULL) {
+      // The clipboard only takes ownership of the memory on success
+      if (global != NULL) {
+        GlobalFree(global);
+      }
+      LOG_WARN("clipboard", "Unable to set clipboard format %s", items[i].format);
+      result = 3;
+    }
+  }
+  CloseClipboard();
+  return result;
+}
+
+static uint32_t PlatformReadMark(void) {
+  return 0;
+}
+
+// Reads cannot be observed: give the target time to handle the paste chord
+static bool PlatformWaitForRead(uint32_t mark, uint32_t timeoutMs) {
+  (void)mark;
+  SleepMillis(timeoutMs < PASTE_SETTLE_MS ? timeoutMs : PASTE_SETTLE_MS);
+  return true;
+}
+
+static bool PlatformChangeMark(uint32_t* mark) {
+  // Start the listener so the wait is woken up by WM_CLIPBOARDUPDATE
+  if (OwnerWindow() == NULL) {
+    return false;
+  }
+  *mark = (uint32_t)GetClipboardSequenceNumber();
+  return true;
+}
+
+static bool PlatformWaitForChange(uint32_t mark, uint32_t timeoutMs) {
+  uint64_t deadline = MonotonicMillis() + timeoutMs;
+  MutexLock(&g_changeLock);
+  bool changed = (uint32_t)GetClipboardSequenceNumber() != mark;
+  while (!changed) {
+    uint64_t now = MonotonicMillis();
+    if (now >= deadline) {
+      break;
+    }
+    uint64_t wait = deadline - now;
+    ConditionTimedWait(&g_changed, &g_changeLock, (uint32_t)(wait < CHANGE_POLL_MS ? wait : CHANGE_POLL_MS));
+    changed = (uint32_t)GetClipboardSequenceNumber() != mark;
+  }
+  MutexUnlock(&g_changeLock);
+  return changed;
+}
+
+#elif defined(__APPLE__)
+
+// ============================================================================
+// macOS: Pasteboard Manager on the general pasteboard
+// ============================================================================
+
+static const FormatAlias g_aliases[] = {
+  { "text/plain", "public.utf8-plain-text" },
+  { "text/html", "public.html" },
+  { "text/rtf", "public.rtf" },
+  { "image/png", "public.png" },
+  { "image/tiff", "public.tiff" },
+  { NULL, NULL }
+};
+
+static PasteboardRef g_pasteboard = NULL;
+
+static void PlatformInitialize(void) {
+}
+
+static PasteboardRef Pasteboard(void) {
+  // Only used from the injector thread
+  if (g_pasteboard == NULL && PasteboardCreate(kPasteboardClipboard, &g_pasteboard) != noErr) {
+    g_pasteboard = NULL;
+  }
+  return g_pasteboard;
+}
+
+static CFStringRef CreateFlavor(const char* format) {
+  return CFStringCreateWithCString(NULL, NativeFormat(g_aliases, format), kCFStringEncodingUTF8);
+}
+
+// Identifier of the first item, the one holding the representations of a copy
+static bool FirstItem(PasteboardRef pasteboard, PasteboardItemID* item) {
+  PasteboardSynchronize(pasteboard);
+  ItemCount items = 0;
+  if (PasteboardGetItemCount(pasteboard, &items) != noErr || items == 0) {
+    return false;
+  }
+  return PasteboardGetItemIdentifier(pasteboard, 1, item) == noErr;
+}
+
+static uint32_t PlatformFormats(char*** formats, size_t* count, uint32_t timeoutMs) {
+  (void)timeoutMs;
+  *formats = NULL;
+  *count = 0;
+
+  PasteboardRef pasteboard = Pasteboard();
+  if (pasteboard == NULL) {
+    return 1;
+  }
+  PasteboardItemID item;
+  if (!FirstItem(pasteboard, &item)) {
+    return 0;
+  }
+  CFArrayRef flavors = NULL;
+  if (PasteboardCopyItemFlavors(pasteboard, item, &flavors) != noErr || flavors == NULL) {
+    return 3;
+  }
+
+  size_t capacity = 0;
+  bool ok = true;
+  char name[256];
+  for (CFIndex i = 0; ok && i < CFArrayGetCount(flavors); i++) {
+    CFStringRef flavor = (CFStringRef)CFArrayGetValueAtIndex(flavors, i);
+    if (CFStringGetCString(flavor, name, sizeof(name), kCFStringEncodingUTF8)) {
+      ok = AddFormat(formats, count, &capacity, MimeFormat(g_aliases, name));
+    }
+  }
+  CFRelease(flavors);
+
+  if (!ok) {
+    ClipboardFreeFormats(*formats, *count);
+    *formats = NULL;
+    *count = 0;
+    return 3;
+  }
+  return 0;
+}
+
+static uint32_t PlatformRead(const char* format, uint32_t timeoutMs, unsigned char** data, size_t* length) {
+  (void)timeoutMs;
+  *data = NULL;
+  *length = 0;
+
+  PasteboardRef pasteboard = Pasteboard();
+  if (pasteboard == NULL) {
+    return 1;
+  }
+  PasteboardItemID item;
+  if (!FirstItem(pasteboard, &item)) {
+    return 3;
+  }
+
+  CFStringRef flavor = CreateFlavor(format);
+  if (flavor == NULL) {
+    return 3;
+  }
+  CFDataRef content = NULL;
+  OSStatus status = PasteboardCopyItemFlavorData(pasteboard, item, flavor, &content);
+  CFRelease(flavor);
+  if (status != noErr || content == NULL) {
+    return 3;
+  }
+
+  size_t size = (size_t)CFDataGetLength(content);
+  *data = (unsigned char*)malloc(size + 1);
+  if (*data == NULL) {
+    CFRelease(content);
+    return 3;
+  }
+  memcpy(*data, CFDataGetBytePtr(content), size);
+  (*data)[size] = 0;
+  *length = size;
+  CFRelease(content);
+  return 0;
+}
+
+static uint32_t PlatformWrite(const ClipboardItem* items, size_t count) {
+  PasteboardRef pasteboard = Pasteboard();
+  if (pasteboard == NULL) {
+    return 1;
+  }
+  if (PasteboardClear(pasteboard) != noErr) {
+    return 3;
+  }
+  PasteboardSynchronize(pasteboard);
+
+  // All representations go on one item, like a copy from an application
+  uint32_t result = 0;
+  for (size_t i = 0; i < count && result == 0; i++) {
+    CFStringRef flavor = CreateFlavor(items[i].format);
+    CFDataRef content = CFDataCreate(NULL, items[i].data, (CFIndex)items[i].length);
+    if (flavor == NULL || content == NULL ||
+        PasteboardPutItemFlavor(pasteboard, (PasteboardItemID)1, flavor, content, kPasteboardFlavorNoFlags) != noErr) {
+      LOG_WARN("clipboard", "Unable to set clipboard format %s", items[i].format);
+      result = 3;
+    }
+    if (flavor != NULL) {
+      CFRelease(flavor);
+    }
+    if (content != NULL) {
+      CFRelease(content);
+    }
+  }
+  return result;
+}
+
+static uint32_t PlatformReadMark(void) {
+  return 0;
+}
+
+// Reads cannot be observed: give the target time to handle the paste chord
+static bool PlatformWaitForRead(uint32_t mark, uint32_t timeoutMs) {
+  (void)mark;
+  SleepMillis(timeoutMs < PASTE_SETTLE_MS ? timeoutMs : PASTE_SETTLE_MS);
+  return true;
+}
+
+// The Pasteboard Manager has no change notification: poll the change flag
+#define CHANGE_POLL_MS 10
+
+static bool PlatformChangeMark(uint32_t* mark) {
+  // Synchronizing resets the modified flag
+  PasteboardRef pasteboard = Pasteboard();
+  if (pasteboard == NULL) {
+    return false;
+  }
+  PasteboardSynchronize(pasteboard);
+  *mark = 0;
+  return true;
+}
+
+static bool PlatformWaitForChange(uint32_t mark, uint32_t timeoutMs) {
+  (void)mark;
+  PasteboardRef pasteboard = Pasteboard();
+  if (pasteboard == NULL) {
+    return false;
+  }
+  uint64_t deadline = MonotonicMillis() + timeoutMs;
+  for (;;) {
+    if (PasteboardSynchronize(pasteboard) & kPasteboardModified) {
+      return true;
+    }
+    if (MonotonicMillis() >= deadline) {
+      return false;
+    }
+    SleepMillis(CHANGE_POLL_MS);
+  }
+}
+
+#elif defined(__linux__)
+
+// ============================================================================
+// Linux: CLIPBOARD selection, read through the shared connection and served
+// by an owner thread with its own connection
+// ============================================================================
+
+static const FormatAlias g_aliases[] = {
+  { "text/plain", "UTF8_STRING" },
+  { NULL, NULL }
+};
+
+// Targets that describe the selection rather than its content
+static const char* g_metaTargets[] = {
+  "TARGETS", "TIMESTAMP", "MULTIPLE", "SAVE_TARGETS", "DELETE", "INCR",
+  "STRING", "TEXT", "COMPOUND_TEXT", "text/plain;charset=utf-8", NULL
+};
+
+// Largest chunk sent in one property change, whatever the server allows
+#define OWNER_MAX_CHUNK (256 * 1024)
+
+// Incremental transfer in progress for one requestor
+typedef struct Transfer {
+  Window requestor;
+  Atom property;
+  Atom type;
+  unsigned char* data;
+  size_t length;
+  size_t offset;
+  struct Transfer* next;
+} Transfer;
+
+// Owner state, items are shared with ClipboardWrite under g_ownerLock
+static Mutex g_ownerLock;
+static Condition g_ownerChanged;
+static bool g_ownerStarted = false;
+static Display* g_ownerDisplay = NULL;
+static Window g_ownerWindow = None;
+static int g_wakePipe[2] = { -1, -1 };
+static ClipboardItem* g_items = NULL;
+static size_t g_itemCount = 0;
+static uint32_t g_claimRequested = 0;
+static uint32_t g_claimDone = 0;
+static bool g_claimOk = false;
+static uint32_t g_served = 0;
+static uint32_t g_changes = 0;
+static int g_xfixesEvent = -1;
+static Time g_ownedSince = CurrentTime;
+
+// Owner thread only
+static Transfer* g_transfers = NULL;
+static size_t g_chunk = 0;
+static Atom g_clipboard, g_targets, g_timestamp, g_incr, g_utf8, g_plainUtf8;
+
+static void PlatformInitialize(void) {
+  MutexInit(&g_ownerLock);
+  ConditionInit(&g_ownerChanged);
+}
+
+static bool IsMetaTarget(const char* name) {
+  for (const char** meta = g_metaTargets; *meta != NULL; meta++) {
+    if (strcmp(*meta, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Item served for a requested target, text/plain answers every UTF-8 text target
+static const ClipboardItem* FindItem(Display* display, Atom target) {
+  for (size_t i = 0; i < g_itemCount; i++) {
+    if (strcmp(g_items[i].format, "text/plain") == 0) {
+      if (target == g_utf8 || target == g_plainUtf8) {
+        return &g_items[i];
+      }
+    } else if (XInternAtom(display, g_items[i].format, False) == target) {
+      return &g_items[i];
+    }
+  }
+  return NULL;
+}
+
+static void AnswerTargets(Display* display, Window requestor, Atom property) {
+  Atom* atoms = (Atom*)malloc((g_itemCount + 4) * sizeof(Atom));
+  if (atoms == NULL) {
+    return;
+  }
+  int count = 0;
+  atoms[count++] = g_targets;
+  atoms[count++] = g_timestamp;
+  for (size_t i = 0; i < g_itemCount; i++) {
+    if (strcmp(g_items[i].format, "text/plain") == 0) {
+      atoms[count++] = g_utf8;
+      atoms[count++] = g_plainUtf8;
+    } else {
+      atoms[count++] = XInternAtom(display, g_items[i].format, False);
+    }
+  }
+  XChangeProperty(display, requestor, property, XA_ATOM, 32, PropModeReplace, (unsigned char*)atoms, count);
+  free(atoms);
+}
+
+static bool AnswerData(Display* display, Window requestor, Atom property, Atom target, const ClipboardItem* item) {
+  if (item->length <= g_chunk) {
+    XChangeProperty(display, requestor, property, target, 8, PropModeReplace, item->data, (int)item->length);
+    return true;
+  }
+
+  // Too large for one request: announce the size, then send chunks each time
+  // the requestor deletes the property
+  Transfer* transfer = (Transfer*)calloc(1, sizeof(Transfer));
+  unsigned char* copy = (unsigned char*)malloc(item->length);
+  if (transfer == NULL || copy == NULL) {
+    free(transfer);
+    free(copy);
+    return false;
+  }
+  memcpy(copy, item->data, item->length);
+  transfer->requestor = requestor;
+  transfer->property = property;
+  transfer->type = target;
+  transfer->data = copy;
+  transfer->length = item->length;
+  transfer->next = g_transfers;
+  g_transfers = transfer;
+
+  XSelectInput(display, requestor, PropertyChangeMask);
+  long size = (long)item->length;
+  XChangeProperty(display, requestor, property, g_incr, 32, PropModeReplace, (unsigned char*)&size, 1);
+  LOG_DEBUG("clipboard", "Starting INCR transfer of %zu bytes", item->length);
+  return true;
+}
+
+static void HandleSelectionRequest(Display* display, XSelectionRequestEvent* request) {
+  XSelectionEvent reply;
+  memset(&reply, 0, sizeof(reply));
+  reply.type = SelectionNotify;
+  reply.display = display;
+  reply.requestor = request->requestor;
+  reply.selection = request->selection;
+  reply.target = request->target;
+  reply.time = request->time;
+  reply.property = None;
+
+  // Obsolete clients leave the property empty and expect the target name
+  Atom property = request->property != None ? request->property : request->target;
+
+  MutexLock(&g_ownerLock);
+  if (request->selection == g_clipboard && g_items != NULL) {
+    if (request->target == g_targets) {
+      AnswerTargets(display, request->requestor, property);
+      reply.property = property;
+    } else if (request->target == g_timestamp) {
+      long timestamp = (long)g_ownedSince;
+      XChangeProperty(display, request->requestor, property, XA_INTEGER, 32, PropModeReplace, (unsigned char*)&timestamp, 1);
+      reply.property = property;
+    } else {
+      const ClipboardItem* item = FindItem(display, request->target);
+      if (item != NULL && AnswerData(display, request->requestor, property, request->target, item)) {
+        reply.property = property;
+        // Content was handed over: wake up a paste waiting for its target to read
+        g_served++;
+        ConditionBroadcast(&g_ownerChanged);
+      }
+    }
+  }
+  MutexUnlock(&g_ownerLock);
+
+  XSendEvent(display, request->requestor, False, NoEventMask, (XEvent*)&reply);
+  XFlush(display);
+}
+
+static void HandlePropertyDelete(Display* display, XPropertyEvent* event) {
+  for (Transfer** link = &g_transfers; *link != NULL; link = &(*link)->next) {
+    Transfer* transfer = *link;
+    if (transfer->requestor != event->window || transfer->property != event->atom) {
+      continue;
+    }
+
+    // A zero-length chunk ends the transfer
+    size_t size = transfer->length - transfer->offset;
+    if (size > g_chunk) {
+      size = g_chunk;
+    }
+    XChangeProperty(display, transfer->requestor, transfer->property, transfer->type, 8, PropModeReplace,
+                    transfer->data + transfer->offset, (int)size);
+    transfer->offset += size;
+    if (size == 0) {
+      XSelectInput(display, transfer->requestor, NoEventMask);
+      *link = transfer->next;
+      free(transfer->data);
+      free(transfer);
+    }
+    XFlush(display);
+    return;
+  }
+}
+
+static Bool IsTimestampNotify(Display* display, XEvent* event, XPointer arg) {
+  (void)display;
+  (void)arg;
+  return event->type == PropertyNotify && event->xproperty.window == g_ownerWindow &&
+         event->xproperty.atom == g_timestamp;
+}
+
+// Current server time, from the PropertyNotify of a zero-length append
+// Ownership must not be taken with CurrentTime (ICCCM), and TIMESTAMP
+// answers with the time it was taken
+static Time ServerTime(Display* display) {
+  unsigned char none = 0;
+  XChangeProperty(display, g_ownerWindow, g_timestamp, XA_INTEGER, 32, PropModeAppend, &none, 0);
+  XEvent event;
+  XIfEvent(display, &event, IsTimestampNotify, NULL);
+  return event.xproperty.time;
+}
+
+static void HandleClaim(Display* display) {
+  MutexLock(&g_ownerLock);
+  uint32_t requested = g_claimRequested;
+  MutexUnlock(&g_ownerLock);
+
+  Time time = ServerTime(display);
+  XSetSelectionOwner(display, g_clipboard, g_ownerWindow, time);
+  bool ok = XGetSelectionOwner(display, g_clipboard) == g_ownerWindow;
+
+  MutexLock(&g_ownerLock);
+  g_claimDone = requested;
+  g_claimOk = ok;
+  if (ok) {
+    g_ownedSince = time;
+  }
+  ConditionBroadcast(&g_ownerChanged);
+  MutexUnlock(&g_ownerLock);
+}
+
+static THREAD_PROC(OwnerThread) {
+  (void)arg;
+  Display* display = g_ownerDisplay;
+  struct pollfd fds[2];
+  fds[0].fd = ConnectionNumber(display);
+  fds[0].events = POLLIN;
+  fds[1].fd = g_wakePipe[0];
+  fds[1].events = POLLIN;
+
+  // Only this thread talks on the owner connection: writes are handed over
+  // through the pipe so events are never read behind its back
+  for (;;) {
+    while (XPending(display) > 0) {
+      XEvent event;
+      XNextEvent(display, &event);
+      if (event.type == SelectionRequest) {
+        HandleSelectionRequest(display, &event.xselectionrequest);
+      } else if (event.type == PropertyNotify && event.xproperty.state == PropertyDelete) {
+        HandlePropertyDelete(display, &event.xproperty);
+      } else if (g_xfixesEvent >= 0 && event.type == g_xfixesEvent + XFixesSelectionNotify) {
+        // Another client took the clipboard (our own claims do not count)
+        XFixesSelectionNotifyEvent* notify = (XFixesSelectionNotifyEvent*)&event;
+        if (notify->owner != g_ownerWindow) {
+          MutexLock(&g_ownerLock);
+          g_changes++;
+          ConditionBroadcast(&g_ownerChanged);
+          MutexUnlock(&g_ownerLock);
+        }
+      } else if (event.type == SelectionClear && event.xselectionclear.selection == g_clipboard) {
+        // Someone else copied: our content is no longer needed
+        MutexLock(&g_ownerLock);
+        ClipboardFreeItems(g_items, g_itemCount);
+        g_items = NULL;
+        g_itemCount = 0;
+        MutexUnlock(&g_ownerLock);
+      }
+    }
+
+    if (poll(fds, 2, -1) < 0) {
+      continue;
+    }
+    if (fds[1].revents & POLLIN) {
+      char wake[16];
+      while (read(g_wakePipe[0], wake, sizeof(wake)) > 0) {
+      }
+      HandleClaim(display);
+    }
+  }
+  THREAD_RETURN;
+}
+
+// Start the owner thread on first write, it lives until the process exits
+static bool StartOwner(void) {
+  if (g_ownerStarted) {
+    return true;
+  }
+  if (!X11Available()) {
+    return false;
+  }
+
+  Display* display = XOpenDisplay(NULL);
+  if (display == NULL) {
+    return false;
+  }
+  if (pipe(g_wakePipe) != 0) {
+    XCloseDisplay(display);
+    return false;
+  }
+  fcntl(g_wakePipe[0], F_SETFL, O_NONBLOCK);
+
+  g_ownerWindow = XCreateSimpleWindow(display, DefaultRootWindow(display), -10, -10, 1, 1, 0, 0, 0);
+  XSelectInput(display, g_ownerWindow, PropertyChangeMask);
+  g_clipboard = XInternAtom(display, "CLIPBOARD", False);
+  g_targets = XInternAtom(display, "TARGETS", False);
+  g_timestamp = XInternAtom(display, "TIMESTAMP", False);
+  g_incr = XInternAtom(display, "INCR", False);
+  g_utf8 = XInternAtom(display, "UTF8_STRING", False);
+  g_plainUtf8 = XInternAtom(display, "text/plain;charset=utf-8", False);
+
+  // Leave room for the request header in each chunk
+  long maxRequest = XExtendedMaxRequestSize(display);
+  if (maxRequest == 0) {
+    maxRequest = XMaxRequestSize(display);
+  }
+  g_chunk = (size_t)maxRequest * 4 - 256;
+  if (g_chunk > OWNER_MAX_CHUNK) {
+    g_chunk = OWNER_MAX_CHUNK;
+  }
+
+  // Clipboard owner changes wake up copySelection
+  int errorBase;
+  if (XFixesQueryExtension(display, &g_xfixesEvent, &errorBase)) {
+    XFixesSelectSelectionInput(display, g_ownerWindow, g_clipboard, XFixesSetSelectionOwnerNotifyMask);
+  } else {
+    g_xfixesEvent = -1;
+    LOG_WARN("clipboard", "XFixes extension not available");
+  }
+  XFlush(display);
+  g_ownerDisplay = display;
+
+  Thread thread;
+  if (!ThreadCreate(&thread, OwnerThread, NULL)) {
+    XCloseDisplay(display);
+    g_ownerDisplay = NULL;
+    close(g_wakePipe[0]);
+    close(g_wakePipe[1]);
+    return false;
+  }
+  ThreadDetach(thread);
+  g_ownerStarted = true;
+  return true;
+}
+
+static uint32_t PlatformFormats(char*** formats, size_t* count, uint32_t timeoutMs) {
+  *formats = NULL;
+  *count = 0;
+
+  Display* display = X11Acquire();
+  if (display == NULL) {
+    return 1;
+  }
+  Atom clipboard = XInternAtom(display, "CLIPBOARD", False);
+  Atom targets = XInternAtom(display, "TARGETS", False);
+  X11Release();
+
+  unsigned char* data = NULL;
+  size_t length = 0;
+  int result = X11ReadSelection(clipboard, targets, timeoutMs, &data, &length, NULL);
+  if (result == 3) {
+    // No owner: the clipboard is empty
+    return 0;
+  }
+  if (result != 0) {
+    return (uint32_t)result;
+  }
+
+  // Resolve all names in one round trip
+  Atom* atoms = (Atom*)data;
+  int atomCount = (int)(length / sizeof(Atom));
+  char** names = atomCount > 0 ? (char**)calloc((size_t)atomCount, sizeof(char*)) : NULL;
+  if (names != NULL) {
+    display = X11Acquire();
+    if (display == NULL || !XGetAtomNames(display, atoms, atomCount, names)) {
+      atomCount = 0;
+    }
+    if (display != NULL) {
+      X11Release();
+    }
+  }
+
+  size_t capacity = 0;
+  bool ok = true;
+  bool hasText = false;
+  for (int i = 0; names != NULL && i < atomCount; i++) {
+    if (names[i] == NULL) {
+      continue;
+    }
+    if (strcmp(names[i], "UTF8_STRING") == 0 || strcmp(names[i], "STRING") == 0 ||
+        strncmp(names[i], "text/plain", 10) == 0) {
+      hasText = true;
+    } else if (ok && !IsMetaTarget(names[i])) {
+      ok = AddFormat(formats, count, &capacity, MimeFormat(g_aliases, names[i]));
+    }
+    XFree(names[i]);
+  }
+  free(names);
+  free(data);
+
+  // Text first, like other platforms where it is usually the main representation
+  if (ok && hasText) {
+    ok = AddFormat(formats, count, &capacity, "text/plain");
+    if (ok) {
+      char* text = (*formats)[*count - 1];
+      memmove(*formats + 1, *formats, (*count - 1) * sizeof(char*));
+      (*formats)[0] = text;
+    }
+  }
+
+  if (!ok) {
+    ClipboardFreeFormats(*formats, *count);
+    *formats = NULL;
+    *count = 0;
+    return 3;
+  }
+  return 0;
+}
+
+// Convert a Latin-1 STRING target to UTF-8
+static unsigned char* Latin1ToUtf8(const unsigned char* text, size_t length, size_t* size) {
+  unsigned char* converted = (unsigned char*)malloc(length * 2 + 1);
+  if (converted == NULL) {
+    return NULL;
+  }
+  size_t out = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (text[i] < 0x80) {
+      converted[out++] = text[i];
+    } else {
+      converted[out++] = (unsigned char)(0xC0 | (text[i] >> 6));
+      converted[out++] = (unsigned char)(0x80 | (text[i] & 0x3F));
+    }
+  }
+  converted[out] = 0;
+  *size = out;
+  return converted;
+}
+
+static uint32_t PlatformRead(const char* format, uint32_t timeoutMs, unsigned char** data, size_t* length) {
+  *data = NULL;
+  *length = 0;
+
+  Display* display = X11Acquire();
+  if (display == NULL) {
+    return 1;
+  }
+  Atom clipboard = XInternAtom(display, "CLIPBOARD", False);
+  Atom target = XInternAtom(display, NativeFormat(g_aliases, format), False);
+  X11Release();
+
+  // Large transfers come in INCR chunks, appended as they arrive
+  int result = X11ReadSelection(clipboard, target, timeoutMs, data, length, NULL);
+  if (result == 3 && strcmp(format, "text/plain") == 0) {
+    unsigned char* latin1 = NULL;
+    size_t size = 0;
+    result = X11ReadSelection(clipboard, XA_STRING, timeoutMs, &latin1, &size, NULL);
+    if (result == 0) {
+      *data = Latin1ToUtf8(latin1, size, length);
+      free(latin1);
+      result = *data != NULL ? 0 : 3;
+    }
+  }
+  return (uint32_t)result;
+}
+
+static uint32_t PlatformWrite(const ClipboardItem* items, size_t count) {
+  if (!StartOwner()) {
+    return 1;
+  }
+
+  // The owner serves its own copy, the caller keeps its items
+  ClipboardItem* copies = (ClipboardItem*)calloc(count ? count : 1, sizeof(ClipboardItem));
+  if (copies == NULL) {
+    return 3;
+  }
+  for (size_t i = 0; i < count; i++) {
+    copies[i].format = CopyString(items[i].format);
+    copies[i].data = (unsigned char*)malloc(items[i].length ? items[i].length : 1);
+    copies[i].length = items[i].length;
+    if (copies[i].format == NULL || copies[i].data == NULL) {
+      ClipboardFreeItems(copies, i + 1);
+      return 3;
+    }
+    memcpy(copies[i].data, items[i].data, items[i].length);
+  }
+
+  MutexLock(&g_ownerLock);
+  ClipboardFreeItems(g_items, g_itemCount);
+  g_items = copies;
+  g_itemCount = count;
+  uint32_t claim = ++g_claimRequested;
+  MutexUnlock(&g_ownerLock);
+
+  // Let the owner thread take the selection and wait until it did
+  char wake = 1;
+  if (write(g_wakePipe[1], &wake, 1) < 0) {
+    return 3;
+  }
+  MutexLock(&g_ownerLock);
+  bool answered = true;
+  while (answered && (int32_t)(g_claimDone - claim) < 0) {
+    answered = ConditionTimedWait(&g_ownerChanged, &g_ownerLock, CLIPBOARD_TIMEOUT_MS);
+  }
+  bool ok = answered && g_claimOk;
+  MutexUnlock(&g_ownerLock);
+
+  if (!ok) {
+    LOG_WARN("clipboard", "Unable to own the CLIPBOARD selection");
+    return 3;
+  }
+  return 0;
+}
+
+static uint32_t PlatformReadMark(void) {
+  MutexLock(&g_ownerLock);
+  uint32_t mark = g_served;
+  MutexUnlock(&g_ownerLock);
+  return mark;
+}
+
+// Wait until a client requested our content after mark
+static bool PlatformWaitForRead(uint32_t mark, uint32_t timeoutMs) {
+  uint64_t deadline = MonotonicMillis() + timeoutMs;
+  MutexLock(&g_ownerLock);
+  bool read = g_served != mark;
+  while (!read) {
+    uint64_t now = MonotonicMillis();
+    if (now >= deadline) {
+      break;
+    }
+    ConditionTimedWait(&g_ownerChanged, &g_ownerLock, (uint32_t)(deadline - now));
+    read = g_served != mark;
+  }
+  MutexUnlock(&g_ownerLock);
+  return read;
+}
+
+static bool PlatformChangeMark(uint32_t* mark) {
+  if (!StartOwner() || g_xfixesEvent < 0) {
+    return false;
+  }
+  MutexLock(&g_ownerLock);
+  *mark = g_changes;
+  MutexUnlock(&g_ownerLock);
+  return true;
+}
+
+// Wait until another client took the CLIPBOARD selection after mark
+static bool PlatformWaitForChange(uint32_t mark, uint32_t timeoutMs) {
+  uint64_t deadline = MonotonicMillis() + timeoutMs;
+  MutexLock(&g_ownerLock);
+  bool changed = g_changes != mark;
+  while (!changed) {
+    uint64_t now = MonotonicMillis();
+    if (now >= deadline) {
+      break;
+    }
+    ConditionTimedWait(&g_ownerChanged, &g_ownerLock, (uint32_t)(deadline - now));
+    changed = g_changes != mark;
+  }
+  MutexUnlock(&g_ownerLock);
+  return changed;
+}
+
+#else
+
+static void PlatformInitialize(void) {
+}
+
+static uint32_t PlatformFormats(char*** formats, size_t* count, uint32_t timeoutMs) {
+  (void)timeoutMs;
+  *formats = NULL;
+  *count = 0;
+  return 1;
+}
+
+static uint32_t PlatformRead(const char* format, uint32_t timeoutMs, unsigned char** data, size_t* length) {
+  (void)format;
+  (void)timeoutMs;
+  *data = NULL;
+  *length = 0;
+  return 1;
+}
+
+static uint32_t PlatformWrite(const ClipboardItem* items, size_t count) {
+  (void)items;
+  (void)count;
+  return 1;
+}
+
+static uint32_t PlatformReadMark(void) {
+  return 0;
+}
+
+// Reads cannot be observed: give the target time to handle the paste chord
+static bool PlatformWaitForRead(uint32_t mark, uint32_t timeoutMs) {
+  (void)mark;
+  SleepMillis(timeoutMs < PASTE_SETTLE_MS ? timeoutMs : PASTE_SETTLE_MS);
+  return true;
+}
+
+static bool PlatformChangeMark(uint32_t* mark) {
+  *mark = 0;
+  return false;
+}
+
+static bool PlatformWaitForChange(uint32_t mark, uint32_t timeoutMs) {
+  (void)mark;
+  (void)timeoutMs;
+  return false;
+}
+
+#endif
+
+// ============================================================================
+// Common: public functions are serialized, paste restores run on their own thread
+// ============================================================================
+
+#ifdef _WIN32
+static INIT_ONCE g_once = INIT_ONCE_STATIC_INIT;
+#else
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+#endif
+
+static Mutex g_lock;
+
+// Clipboard content to put back after a paste, replaced by newer pastes
+static ClipboardItem* g_restoreItems = NULL;
+static size_t g_restoreCount = 0;
+static bool g_restorePending = false;
+static uint32_t g_restoreGeneration = 0;
+
+static void InitializeState(void) {
+  MutexInit(&g_lock);
+  PlatformInitialize();
+}
+
+#ifdef _WIN32
+static BOOL CALLBACK InitializeOnce(PINIT_ONCE once, PVOID param, PVOID* context) {
+  (void)once;
+  (void)param;
+  (void)context;
+  InitializeState();
+  return TRUE;
+}
+#endif
+
+static void EnsureInitialized(void) {
+#ifdef _WIN32
+  InitOnceExecuteOnce(&g_once, InitializeOnce, NULL, NULL);
+#else
+  pthread_once(&g_once, InitializeState);
+#endif
+}
+
+uint32_t ClipboardFormats(char*** formats, size_t* count, uint32_t timeoutMs) {
+  EnsureInitialized();
+  MutexLock(&g_lock);
+  uint32_t result = PlatformFormats(formats, count, timeoutMs);
+  MutexUnlock(&g_lock);
+  return result;
+}
+
+uint32_t ClipboardRead(const char* format, uint32_t timeoutMs, unsigned char** data, size_t* length) {
+  EnsureInitialized();
+  MutexLock(&g_lock);
+  uint32_t result = PlatformRead(format, timeoutMs, data, length);
+  MutexUnlock(&g_lock);
+  return result;
+}
+
+uint32_t ClipboardWrite(const ClipboardItem* items, size_t count) {
+  EnsureInitialized();
+  MutexLock(&g_lock);
+  uint32_t result = PlatformWrite(items, count);
+  MutexUnlock(&g_lock);
+  return result;
+}
+
+// Read every format currently on the clipboard, must be called with the lock held
+static bool Snapshot(uint32_t timeoutMs, ClipboardItem** items, size_t* count) {
+  char** formats = NULL;
+  size_t formatCount = 0;
+  *items = NULL;
+  *count = 0;
+  if (PlatformFormats(&formats, &formatCount, timeoutMs) != 0) {
+    return false;
+  }
+
+  *items = (ClipboardItem*)calloc(formatCount ? formatCount : 1, sizeof(ClipboardItem));
+  if (*items == NULL) {
+    ClipboardFreeFormats(formats, formatCount);
+    return false;
+  }
+  for (size_t i = 0; i < formatCount; i++) {
+    ClipboardItem* item = &(*items)[*count];
+    if (PlatformRead(formats[i], timeoutMs, &item->data, &item->length) == 0) {
+      // The item takes the name over
+      item->format = formats[i];
+      formats[i] = NULL;
+      (*count)++;
+    }
+  }
+  ClipboardFreeFormats(formats, formatCount);
+  return true;
+}
+
+static THREAD_PROC(RestoreThread) {
+  uint32_t generation = (uint32_t)(uintptr_t)arg;
+  SleepMillis(PASTE_RESTORE_DELAY_MS);
+
+  // A newer paste took the snapshot over: it restores it when done
+  MutexLock(&g_lock);
+  if (g_restorePending && g_restoreGeneration == generation) {
+    // An empty snapshot clears the clipboard
+    if (PlatformWrite(g_restoreItems, g_restoreCount) != 0) {
+      LOG_WARN("clipboard", "Unable to restore the clipboard after paste");
+    }
+    ClipboardFreeItems(g_restoreItems, g_restoreCount);
+    g_restoreItems = NULL;
+    g_restoreCount = 0;
+    g_restorePending = false;
+  }
+  MutexUnlock(&g_lock);
+  THREAD_RETURN;
+}
+
+// Put back the snapshot of a paste now instead of from its thread,
+// must be called with the lock held
+static void FlushRestore(void) {
+  if (!g_restorePending) {
+    return;
+  }
+  PlatformWrite(g_restoreItems, g_restoreCount);
+  ClipboardFreeItems(g_restoreItems, g_restoreCount);
+  g_restoreItems = NULL;
+  g_restoreCount = 0;
+  g_restorePending = false;
+}
+
+uint32_t ClipboardCopySelection(uint32_t timeoutMs, unsigned char** text, size_t* length) {
+  *text = NULL;
+  *length = 0;
+  EnsureInitialized();
+  MutexLock(&g_lock);
+
+  // A pending restore would otherwise land on top of the copied text
+  FlushRestore();
+
+  uint32_t mark;
+  if (!PlatformChangeMark(&mark)) {
+    MutexUnlock(&g_lock);
+    return 1;
+  }
+  uint64_t deadline = MonotonicMillis() + timeoutMs;
+  uint32_t result = SendKeyWithTimeout("C", true, timeoutMs) == 0 ? 0 : 3;
+  if (result == 0) {
+    uint64_t now = MonotonicMillis();
+    uint32_t left = now < deadline ? (uint32_t)(deadline - now) : 0;
+    if (!PlatformWaitForChange(mark, left)) {
+      LOG_DEBUG("clipboard", "Clipboard did not change after the copy chord");
+      result = 2;
+    }
+  }
+  if (result == 0) {
+    // The new owner answers right away, give it the full timeout anyway
+    result = PlatformRead("text/plain", timeoutMs, text, length);
+  }
+
+  MutexUnlock(&g_lock);
+  return result;
+}
+
+uint32_t ClipboardPasteText(const char* text, size_t length, uint32_t timeoutMs) {
+  EnsureInitialized();
+  MutexLock(&g_lock);
+
+  // Back-to-back pastes keep the snapshot taken before the first one
+  ClipboardItem* saved = NULL;
+  size_t savedCount = 0;
+  if (g_restorePending) {
+    saved = g_restoreItems;
+    savedCount = g_restoreCount;
+    g_restoreItems = NULL;
+    g_restoreCount = 0;
+    g_restorePending = false;
+  } else if (!Snapshot(timeoutMs, &saved, &savedCount)) {
+    MutexUnlock(&g_lock);
+    return 1;
+  }
+
+  ClipboardItem item = { (char*)"text/plain", (unsigned char*)text, length };
+  uint32_t mark = PlatformReadMark();
+  uint32_t result = PlatformWrite(&item, 1);
+  if (result == 0) {
+    // Same injection path as sendKey, including the wait for released keys
+    uint32_t sent = SendKeyWithTimeout("V", true, timeoutMs);
+    if (sent != 0) {
+      result = 3;
+    } else if (!PlatformWaitForRead(mark, timeoutMs)) {
+      LOG_DEBUG("clipboard", "Paste target did not read the clipboard");
+      result = 2;
+    }
+  }
+
+  // Restore in the background: the promise resolves as soon as the text is in
+  g_restoreItems = saved;
+  g_restoreCount = savedCount;
+  g_restorePending = true;
+  uint32_t generation = ++g_restoreGeneration;
+  Thread thread;
+  if (ThreadCreate(&thread, RestoreThread, (void*)(uintptr_t)generation)) {
+    ThreadDetach(thread);
+  } else {
+    PlatformWrite(saved, savedCount);
+    ClipboardFreeItems(saved, savedCount);
+    g_restoreItems = NULL;
+    g_restoreCount = 0;
+    g_restorePending = false;
+  }
+  MutexUnlock(&g_lock);
+  return result;
+}
@@ -0,0 +1,70 @@
+#ifndef CLIPBOARD_H
+#define CLIPBOARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// How long to wait for the clipboard owner to answer (Linux)
+#define CLIPBOARD_TIMEOUT_MS 1000
+
+// One clipboard representation
+// Formats are MIME types: text/plain (UTF-8), text/html, text/rtf and image/png
+// map to the native equivalents, any other name is used as the native format
+// name (registered format on Windows, UTI on macOS, target atom on X11)
+typedef struct {
+  char* format;
+  unsigned char* data;
+  size_t length;
+} ClipboardItem;
+
+// List the formats currently on the clipboard
+// On success *formats is an array of *count malloc'ed names (release with ClipboardFreeFormats)
+// Returns 0 on success, 1 if unsupported or no clipboard, 2 on timeout, 3 on failure
+uint32_t ClipboardFormats(char*** formats, size_t* count, uint32_t timeoutMs);
+
+// Read one format from the clipboard
+// On success *data is a malloc'ed buffer of *length bytes
+// Returns 0 on success, 1 if unsupported or no clipboard, 2 on timeout,
+// 3 if the format is not on the clipboard
+uint32_t ClipboardRead(const char* format, uint32_t timeoutMs, unsigned char** data, size_t* length);
+
+// Replace the clipboard content with several formats at once
+// On Linux the data is copied and served by a background owner thread
+// (large payloads use the INCR protocol)
+// Returns 0 on success, 1 if unsupported or no clipboard, 3 on failure
+uint32_t ClipboardWrite(const ClipboardItem* items, size_t count);
+
+// Paste text into the focused application without losing the clipboard:
+// snapshot the clipboard, write the text, send the paste chord (through
+// SendKey) and wait for the target to read it, up to timeoutMs. Reads are
+// observed on X11, other platforms wait for a short settle delay.
+// The snapshot is restored on a background thread; back-to-back pastes
+// restore the content that was there before the first one.
+// Returns 0 on success, 1 if the clipboard is unavailable, 2 if the target
+// did not read the text in time, 3 if writing or sending the chord failed
+uint32_t ClipboardPasteText(const char* text, size_t length, uint32_t timeoutMs);
+
+// Copy the selection of the focused application through the clipboard:
+// send the copy chord (through SendKey) and wait for a clipboard change
+// notification (XFixes on Linux, WM_CLIPBOARDUPDATE on Windows, change
+// flag polling on macOS), then read the new text
+// On success *text is a malloc'ed UTF-8 buffer of *length bytes
+// Returns 0 on success, 1 if the clipboard is unavailable, 2 if the clipboard
+// did not change before timeoutMs, 3 on failure
+uint32_t ClipboardCopySelection(uint32_t timeoutMs, unsigned char** text, size_t* length);
+
+// Release the result of ClipboardFormats
+void ClipboardFreeFormats(char** formats, size_t count);
+
+// Release an array of items and their content
+void ClipboardFreeItems(ClipboardItem* items, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CLIPBOARD_H
@@ -0,0 +1,1233 @@
+#include "desktopindex.h"
+
+#ifdef __linux__
+
+#include "filemap.h"
+#include "log.h"
+#include "threads.h"
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define INDEX_MAGIC 0x49544441 // "ADTI"
+#define INDEX_FORMAT 2
+
+// Application directories scanned, subdirectories included up to this depth
+#define MAX_DIRECTORIES 24
+#define MAX_DEPTH 3
+
+// Quiet time after the last inotify event before rebuilding
+#define REFRESH_DELAY_MS 300
+
+// Key kinds, in lookup priority order
+enum { KEY_CLASS = 1, KEY_ID, KEY_PATH, KEY_EXE };
+
+// The index is one block, mapped as is from the cache file
+// Offsets in the header are from the start of the block, string offsets are
+// from the start of the string area (offset 0 is the empty string)
+typedef struct {
+  uint32_t magic;
+  uint32_t format;
+  uint64_t stamp;           // Locale and name, size and mtime of every .desktop file
+  uint32_t size;
+  uint32_t appCount;
+  uint32_t bucketCount;     // Power of two
+  uint32_t keyCount;
+  uint32_t apps;            // IndexApp[appCount]
+  uint32_t buckets;         // uint32_t[bucketCount]: first key index + 1, 0 if empty
+  uint32_t keys;            // IndexKey[keyCount]
+  uint32_t strings;
+} IndexHeader;
+
+typedef struct {
+  uint32_t id;
+  uint32_t name;
+  uint32_t icon;
+  uint32_t categories;
+} IndexApp;
+
+typedef struct {
+  uint32_t hash;
+  uint32_t kind;
+  uint32_t string;          // Lowercase except for paths
+  uint32_t app;
+  uint32_t next;            // Next key index + 1 in the bucket, 0 at the end
+} IndexKey;
+
+typedef struct {
+  char lang[16];
+  char country[16];
+  char modifier[32];
+} Locale;
+
+typedef struct {
+  char* directories[MAX_DIRECTORIES];
+  int count;
+  Locale locale;
+} ScanConfig;
+
+// Fields of a [Desktop Entry] group, malloc'ed
+typedef struct {
+  char* type;
+  char* name;
+  char* icon;
+  char* categories;
+  char* exec;
+  char* tryExec;
+  char* wmClass;
+  char* flatpak;
+  int nameRank;
+  bool noDisplay;
+  bool hidden;
+} DesktopFile;
+
+typedef struct {
+  char* id;
+  DesktopFile file;
+} ParsedApp;
+
+typedef struct {
+  char* data;
+  size_t size;
+  size_t capacity;
+} Buffer;
+
+typedef struct {
+  Buffer strings;
+  Buffer apps;
+  Buffer keys;
+  uint32_t appCount;
+  uint32_t keyCount;
+  bool failed;
+} Builder;
+
+// Open-addressing set of desktop ids, to honour directory precedence
+typedef struct {
+  char** items;
+  uint32_t capacity;
+  uint32_t count;
+} StringSet;
+
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static Mutex g_lock;
+static Condition g_ready;
+static bool g_built = false;
+static bool g_waited = false;
+static char* g_indexFile = NULL;
+static bool g_indexFileChanged = false;
+static int g_wake = -1;
+
+// Installed index: an in-memory block or a view of the cache file
+static const uint8_t* g_data = NULL;
+static uint8_t* g_owned = NULL;
+static FileMap g_map;
+static bool g_mapped = false;
+
+static uint32_t HashKey(uint32_t kind, const char* value) {
+  uint32_t hash = 2166136261u ^ kind;
+  for (const unsigned char* p = (const unsigned char*)value; *p; p++) {
+    hash = (hash ^ *p) * 16777619u;
+  }
+  return hash;
+}
+
+static uint64_t Hash64(uint64_t hash, const void* data, size_t length) {
+  const unsigned char* bytes = (const unsigned char*)data;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+// Keys other than paths compare case-insensitively (WM_CLASS is "Firefox",
+// StartupWMClass "firefox")
+static void KeyValue(uint32_t kind, const char* value, char* out, size_t size) {
+  size_t i = 0;
+  for (; value[i] != '\0' && i + 1 < size; i++) {
+    char c = value[i];
+    out[i] = kind != KEY_PATH && c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+  }
+  out[i] = '\0';
+}
+
+static char* CopyRange(const char* start, size_t length) {
+  char* copy = (char*)malloc(length + 1);
+  if (copy != NULL) {
+    memcpy(copy, start, length);
+    copy[length] = '\0';
+  }
+  return copy;
+}
+
+static char* CopyString(const char* value) {
+  return CopyRange(value, strlen(value));
+}
+
+static const char* BaseName(const char* path) {
+  const char* slash = strrchr(path, '/');
+  return slash != NULL ? slash + 1 : path;
+}
+
+// LC_ALL, LC_MESSAGES or LANG, as lang_COUNTRY.ENCODING@MODIFIER
+static void ReadLocale(Locale* locale) {
+  memset(locale, 0, sizeof(Locale));
+  const char* names[] = { "LC_ALL", "LC_MESSAGES", "LANG" };
+  const char* value = NULL;
+  for (int i = 0; i < 3 && value == NULL; i++) {
+    value = getenv(names[i]);
+    if (value != NULL && value[0] == '\0') {
+      value = NULL;
+    }
+  }
+  if (value == NULL || strcmp(value, "C") == 0 || strcmp(value, "POSIX") == 0) {
+    return;
+  }
+
+  size_t lang = strcspn(value, "_.@");
+  if (lang >= sizeof(locale->lang)) {
+    return;
+  }
+  memcpy(locale->lang, value, lang);
+  const char* rest = value + lang;
+  if (*rest == '_') {
+    size_t country = strcspn(rest + 1, ".@");
+    if (country < sizeof(locale->country)) {
+      memcpy(locale->country, rest + 1, country);
+    }
+  }
+  const char* modifier = strchr(value, '@');
+  if (modifier != NULL && strlen(modifier + 1) < sizeof(locale->modifier)) {
+    strcpy(locale->modifier, modifier + 1);
+  }
+}
+
+// How well a Name[tag] matches the locale, -1 if it does not
+// lang_COUNTRY@MODIFIER 4, lang_COUNTRY 3, lang@MODIFIER 2, lang 1
+static int LocaleRank(const Locale* locale, const char* tag, size_t length) {
+  if (locale->lang[0] == '\0') {
+    return -1;
+  }
+  char buffer[64];
+  if (length >= sizeof(buffer)) {
+    return -1;
+  }
+  memcpy(buffer, tag, length);
+  buffer[length] = '\0';
+
+  char* modifier = strchr(buffer, '@');
+  if (modifier != NULL) *modifier++ = '\0';
+  char* encoding = strchr(buffer, '.');
+  if (encoding != NULL) *encoding = '\0';
+  char* country = strchr(buffer, '_');
+  if (country != NULL) *country++ = '\0';
+
+  if (strcmp(buffer, locale->lang) != 0) {
+    return -1;
+  }
+  if (country != NULL && strcmp(country, locale->country) != 0) {
+    return -1;
+  }
+  if (modifier != NULL && strcmp(modifier, locale->modifier) != 0) {
+    return -1;
+  }
+  return 1 + (country != NULL ? 2 : 0) + (modifier != NULL ? 1 : 0);
+}
+
+// Decode \s \n \t \r \\ in a value, other escapes are kept
+static char* UnescapeValue(const char* start, size_t length) {
+  char* value = (char*)malloc(length + 1);
+  if (value == NULL) {
+    return NULL;
+  }
+  size_t out = 0;
+  for (size_t i = 0; i < length; i++) {
+    char c = start[i];
+    if (c == '\\' && i + 1 < length) {
+      char next = start[i + 1];
+      char decoded = next == 's' ? ' ' : next == 'n' ? '\n' : next == 't' ? '\t' : next == 'r' ? '\r' : next == '\\' ? '\\' : 0;
+      if (decoded != 0) {
+        value[out++] = decoded;
+        i++;
+        continue;
+      }
+    }
+    value[out++] = c;
+  }
+  value[out] = '\0';
+  return value;
+}
+
+static void SetField(char** field, char* value) {
+  free(*field);
+  *field = value;
+}
+
+static void FreeDesktopFile(DesktopFile* file) {
+  free(file->type);
+  free(file->name);
+  free(file->icon);
+  free(file->categories);
+  free(file->exec);
+  free(file->tryExec);
+  free(file->wmClass);
+  free(file->flatpak);
+  memset(file, 0, sizeof(DesktopFile));
+}
+
+// Read the keys of the [Desktop Entry] group that identify an application
+static void ParseDesktopFile(const char* text, size_t size, const Locale* locale, DesktopFile* file) {
+  memset(file, 0, sizeof(DesktopFile));
+  file->nameRank = -1;
+
+  bool inEntry = false;
+  const char* end = text + size;
+  for (const char* line = text; line < end; ) {
+    const char* lineEnd = memchr(line, '\n', (size_t)(end - line));
+    if (lineEnd == NULL) {
+      lineEnd = end;
+    }
+    const char* next = lineEnd < end ? lineEnd + 1 : end;
+    if (lineEnd > line && lineEnd[-1] == '\r') {
+      lineEnd--;
+    }
+
+    if (line < lineEnd && *line == '[') {
+      bool entry = (size_t)(lineEnd - line) == 15 && memcmp(line, "[Desktop Entry]", 15) == 0;
+      if (inEntry && !entry) {
+        // Actions and other groups follow the main one
+        break;
+      }
+      inEntry = entry;
+      line = next;
+      continue;
+    }
+
+    const char* equals = inEntry && line < lineEnd && *line != '#' ? memchr(line, '=', (size_t)(lineEnd - line)) : NULL;
+    if (equals == NULL) {
+      line = next;
+      continue;
+    }
+
+    const char* keyEnd = equals;
+    while (keyEnd > line && (keyEnd[-1] == ' ' || keyEnd[-1] == '\t')) keyEnd--;
+    const char* valueStart = equals + 1;
+    while (valueStart < lineEnd && (*valueStart == ' ' || *valueStart == '\t')) valueStart++;
+    size_t keyLength = (size_t)(keyEnd - line);
+    size_t valueLength = (size_t)(lineEnd - valueStart);
+
+    // Localized keys: Key[tag]
+    const char* bracket = memchr(line, '[', keyLength);
+    size_t baseLength = bracket != NULL ? (size_t)(bracket - line) : keyLength;
+    int rank = 0;
+    if (bracket != NULL) {
+      if (keyEnd[-1] != ']') {
+        line = next;
+        continue;
+      }
+      rank = LocaleRank(locale, bracket + 1, (size_t)(keyEnd - bracket - 2));
+    }
+
+#define KEY_IS(name) (baseLength == sizeof(name) - 1 && memcmp(line, name, baseLength) == 0)
+    if (KEY_IS("Name")) {
+      if (rank > file->nameRank) {
+        SetField(&file->name, UnescapeValue(valueStart, valueLength));
+        file->nameRank = rank;
+      }
+    } else if (bracket == NULL) {
+      if (KEY_IS("Type")) {
+        SetField(&file->type, UnescapeValue(valueStart, valueLength));
+      } else if (KEY_IS("Icon")) {
+        SetField(&file->icon, UnescapeValue(valueStart, valueLength));
+      } else if (KEY_IS("Categories")) {
+        SetField(&file->categories, UnescapeValue(valueStart, valueLength));
+      } else if (KEY_IS("Exec")) {
+        SetField(&file->exec, UnescapeValue(valueStart, valueLength));
+      } else if (KEY_IS("TryExec")) {
+        SetField(&file->tryExec, UnescapeValue(valueStart, valueLength));
+      } else if (KEY_IS("StartupWMClass")) {
+        SetField(&file->wmClass, UnescapeValue(valueStart, valueLength));
+      } else if (KEY_IS("X-Flatpak")) {
+        SetField(&file->flatpak, UnescapeValue(valueStart, valueLength));
+      } else if (KEY_IS("NoDisplay")) {
+        file->noDisplay = valueLength == 4 && memcmp(valueStart, "true", 4) == 0;
+      } else if (KEY_IS("Hidden")) {
+        file->hidden = valueLength == 4 && memcmp(valueStart, "true", 4) == 0;
+      }
+    }
+#undef KEY_IS
+
+    line = next;
+  }
+}
+
+// Next argument of an Exec line, with double quotes and their escapes removed
+// Returns false at the end of the line
+static bool NextArgument(const char** cursor, char* out, size_t size) {
+  const char* p = *cursor;
+  while (*p == ' ' || *p == '\t') p++;
+  if (*p == '\0') {
+    return false;
+  }
+
+  size_t length = 0;
+  bool quoted = false;
+  for (; *p != '\0'; p++) {
+    char c = *p;
+    if (quoted) {
+      if (c == '"') {
+        quoted = false;
+        continue;
+      }
+      if (c == '\\' && p[1] != '\0' && strchr("\"`$\\", p[1]) != NULL) {
+        c = *++p;
+      }
+    } else if (c == '"') {
+      quoted = true;
+      continue;
+    } else if (c == ' ' || c == '\t') {
+      break;
+    }
+    if (length + 1 < size) {
+      out[length++] = c;
+    }
+  }
+  out[length] = '\0';
+  *cursor = p;
+  return true;
+}
+
+// Program an Exec line starts, skipping env with its options and assignments
+// Flatpak launchers name the sandboxed program with --command, NULL if they do not
+static bool ExecProgram(const char* exec, bool flatpak, char* program, size_t size) {
+  const char* cursor = exec;
+  bool afterEnv = false;
+  while (NextArgument(&cursor, program, size)) {
+    if (strcmp(BaseName(program), "env") == 0) {
+      afterEnv = true;
+      continue;
+    }
+    if (afterEnv && (strchr(program, '=') != NULL || program[0] == '-')) {
+      // -u NAME and -C DIR take the next argument
+      if (strcmp(program, "-u") == 0 || strcmp(program, "--unset") == 0 ||
+          strcmp(program, "-C") == 0 || strcmp(program, "--chdir") == 0) {
+        NextArgument(&cursor, program, size);
+      }
+      continue;
+    }
+    if (flatpak && strcmp(BaseName(program), "flatpak") == 0) {
+      while (NextArgument(&cursor, program, size)) {
+        if (strncmp(program, "--command=", 10) == 0) {
+          memmove(program, program + 10, strlen(program + 10) + 1);
+          return program[0] != '\0';
+        }
+      }
+      return false;
+    }
+    return program[0] != '\0' && program[0] != '%';
+  }
+  return false;
+}
+
+static bool BufferReserve(Buffer* buffer, size_t length) {
+  if (buffer->size + length <= buffer->capacity) {
+    return true;
+  }
+  size_t capacity = buffer->capacity > 0 ? buffer->capacity : 4096;
+  while (capacity < buffer->size + length) {
+    capacity *= 2;
+  }
+  char* data = (char*)realloc(buffer->data, capacity);
+  if (data == NULL) {
+    return false;
+  }
+  buffer->data = data;
+  buffer->capacity = capacity;
+  return true;
+}
+
+static bool BufferAppend(Buffer* buffer, const void* data, size_t length) {
+  if (!BufferReserve(buffer, length)) {
+    return false;
+  }
+  memcpy(buffer->data + buffer->size, data, length);
+  buffer->size += length;
+  return true;
+}
+
+static uint32_t AddString(Builder* builder, const char* value) {
+  if (value == NULL || value[0] == '\0') {
+    return 0;
+  }
+  uint32_t offset = (uint32_t)builder->strings.size;
+  if (!BufferAppend(&builder->strings, value, strlen(value) + 1)) {
+    builder->failed = true;
+    return 0;
+  }
+  return offset;
+}
+
+static void AddKey(Builder* builder, uint32_t kind, const char* value, uint32_t app) {
+  if (value == NULL || value[0] == '\0') {
+    return;
+  }
+  char normalized[PATH_MAX];
+  KeyValue(kind, value, normalized, sizeof(normalized));
+  IndexKey key = { HashKey(kind, normalized), kind, AddString(builder, normalized), app, 0 };
+  if (!BufferAppend(&builder->keys, &key, sizeof(key))) {
+    builder->failed = true;
+    return;
+  }
+  builder->keyCount++;
+}
+
+// Shells, interpreters and runtimes started by many applications, by file
+// name without version suffix (python3.12, java-17, electron28...)
+static const char* const SHARED_LAUNCHERS[] = {
+  "sh", "bash", "dash", "zsh", "ksh", "csh", "tcsh", "fish",
+  "python", "pypy", "perl", "ruby", "node", "nodejs", "gjs", "lua", "php",
+  "java", "mono", "dotnet", "electron", "wine", "pkexec", NULL
+};
+
+// Their windows cannot be told apart by executable, so they claim none
+static bool SharedLauncher(const char* program) {
+  const char* name = BaseName(program);
+  size_t length = strcspn(name, "0123456789.-");
+  for (int i = 0; SHARED_LAUNCHERS[i] != NULL; i++) {
+    if (strlen(SHARED_LAUNCHERS[i]) == length && memcmp(SHARED_LAUNCHERS[i], name, length) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Index the path and file name of a program (searched in PATH when relative)
+// The resolved path is added when the link keeps the name: wrappers like
+// /snap/bin/firefox -> /usr/bin/snap would otherwise claim unrelated windows
+static void AddProgramKeys(Builder* builder, const char* program, uint32_t app) {
+  if (SharedLauncher(program)) {
+    return;
+  }
+
+  char path[PATH_MAX];
+  path[0] = '\0';
+  if (program[0] == '/') {
+    snprintf(path, sizeof(path), "%s", program);
+  } else if (strchr(program, '/') == NULL) {
+    const char* search = getenv("PATH");
+    if (search == NULL) {
+      search = "/usr/local/bin:/usr/bin:/bin";
+    }
+    while (*search != '\0') {
+      size_t length = strcspn(search, ":");
+      if (length > 0 && (size_t)snprintf(path, sizeof(path), "%.*s/%s", (int)length, search, program) < sizeof(path) &&
+          access(path, X_OK) == 0) {
+        break;
+      }
+      path[0] = '\0';
+      search += length + (search[length] == ':' ? 1 : 0);
+    }
+  }
+
+  if (path[0] != '\0') {
+    AddKey(builder, KEY_PATH, path, app);
+    char resolved[PATH_MAX];
+    if (realpath(path, resolved) != NULL && strcmp(resolved, path) != 0 &&
+        strcmp(BaseName(resolved), BaseName(program)) == 0) {
+      AddKey(builder, KEY_PATH, resolved, app);
+    }
+  }
+  AddKey(builder, KEY_EXE, BaseName(program), app);
+}
+
+static void AddApp(Builder* builder, const ParsedApp* parsed) {
+  const DesktopFile* file = &parsed->file;
+  IndexApp app = {
+    AddString(builder, parsed->id),
+    AddString(builder, file->name),
+    AddString(builder, file->icon),
+    AddString(builder, file->categories)
+  };
+  uint32_t index = builder->appCount;
+  if (!BufferAppend(&builder->apps, &app, sizeof(app))) {
+    builder->failed = true;
+    return;
+  }
+  builder->appCount++;
+
+  AddKey(builder, KEY_CLASS, file->wmClass, index);
+  AddKey(builder, KEY_ID, parsed->id, index);
+  AddKey(builder, KEY_ID, file->flatpak, index);
+
+  char program[PATH_MAX];
+  bool flatpak = file->flatpak != NULL;
+  if (file->exec != NULL && ExecProgram(file->exec, flatpak, program, sizeof(program))) {
+    AddProgramKeys(builder, program, index);
+  }
+  if (file->tryExec != NULL && !flatpak) {
+    AddProgramKeys(builder, file->tryExec, index);
+  }
+}
+
+// Lay out the index block, linking keys into their buckets in insertion
+// order: the first application to claim a key keeps it
+static uint8_t* FinishIndex(Builder* builder, uint64_t stamp, size_t* size) {
+  uint32_t bucketCount = 64;
+  while (bucketCount < builder->keyCount * 2) {
+    bucketCount *= 2;
+  }
+
+  size_t appsOffset = sizeof(IndexHeader);
+  size_t bucketsOffset = appsOffset + builder->apps.size;
+  size_t keysOffset = bucketsOffset + (size_t)bucketCount * sizeof(uint32_t);
+  size_t stringsOffset = keysOffset + builder->keys.size;
+  size_t total = stringsOffset + builder->strings.size;
+  if (builder->failed || total > UINT32_MAX) {
+    return NULL;
+  }
+
+  uint8_t* data = (uint8_t*)calloc(1, total);
+  if (data == NULL) {
+    return NULL;
+  }
+  IndexHeader* header = (IndexHeader*)data;
+  header->magic = INDEX_MAGIC;
+  header->format = INDEX_FORMAT;
+  header->stamp = stamp;
+  header->size = (uint32_t)total;
+  header->appCount = builder->appCount;
+  header->bucketCount = bucketCount;
+  header->keyCount = builder->keyCount;
+  header->apps = (uint32_t)appsOffset;
+  header->buckets = (uint32_t)bucketsOffset;
+  header->keys = (uint32_t)keysOffset;
+  header->strings = (uint32_t)stringsOffset;
+
+  memcpy(data + appsOffset, builder->apps.data, builder->apps.size);
+  memcpy(data + keysOffset, builder->keys.data, builder->keys.size);
+  memcpy(data + stringsOffset, builder->strings.data, builder->strings.size);
+
+  uint32_t* buckets = (uint32_t*)(data + bucketsOffset);
+  IndexKey* keys = (IndexKey*)(data + keysOffset);
+  const char* strings = (const char*)(data + stringsOffset);
+  for (uint32_t i = 0; i < builder->keyCount; i++) {
+    IndexKey* key = &keys[i];
+    uint32_t* link = &buckets[key->hash & (bucketCount - 1)];
+    bool duplicate = false;
+    while (*link != 0 && !duplicate) {
+      IndexKey* other = &keys[*link - 1];
+      duplicate = other->hash == key->hash && other->kind == key->kind && strcmp(strings + other->string, strings + key->string) == 0;
+      link = &other->next;
+    }
+    if (!duplicate) {
+      *link = i + 1;
+    }
+  }
+
+  *size = total;
+  return data;
+}
+
+// Check a block before trusting its offsets: it may come from any file
+static bool ValidIndex(const uint8_t* data, size_t size) {
+  if (data == NULL || size < sizeof(IndexHeader)) {
+    return false;
+  }
+  const IndexHeader* header = (const IndexHeader*)data;
+  if (header->magic != INDEX_MAGIC || header->format != INDEX_FORMAT || header->size != size ||
+      header->bucketCount == 0 || (header->bucketCount & (header->bucketCount - 1)) != 0 ||
+      header->apps != sizeof(IndexHeader) ||
+      header->buckets != header->apps + (uint64_t)header->appCount * sizeof(IndexApp) ||
+      header->keys != header->buckets + (uint64_t)header->bucketCount * sizeof(uint32_t) ||
+      header->strings != header->keys + (uint64_t)header->keyCount * sizeof(IndexKey) ||
+      header->strings >= size || data[size - 1] != '\0') {
+    return false;
+  }
+
+  uint32_t stringsSize = (uint32_t)size - header->strings;
+  const IndexApp* apps = (const IndexApp*)(data + header->apps);
+  for (uint32_t i = 0; i < header->appCount; i++) {
+    if (apps[i].id >= stringsSize || apps[i].name >= stringsSize ||
+        apps[i].icon >= stringsSize || apps[i].categories >= stringsSize) {
+      return false;
+    }
+  }
+  const uint32_t* buckets = (const uint32_t*)(data + header->buckets);
+  for (uint32_t i = 0; i < header->bucketCount; i++) {
+    if (buckets[i] > header->keyCount) {
+      return false;
+    }
+  }
+  const IndexKey* keys = (const IndexKey*)(data + header->keys);
+  for (uint32_t i = 0; i < header->keyCount; i++) {
+    // Chains only point forward, so they cannot loop
+    if (keys[i].string >= stringsSize || keys[i].app >= header->appCount ||
+        (keys[i].next != 0 && (keys[i].next <= i + 1 || keys[i].next > header->keyCount))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Application claiming a key, -1 if none
+static int64_t FindKey(const uint8_t* data, uint32_t kind, const char* value) {
+  if (value == NULL || value[0] == '\0') {
+    return -1;
+  }
+  const IndexHeader* header = (const IndexHeader*)data;
+  const uint32_t* buckets = (const uint32_t*)(data + header->buckets);
+  const IndexKey* keys = (const IndexKey*)(data + header->keys);
+  const char* strings = (const char*)(data + header->strings);
+
+  char normalized[PATH_MAX];
+  KeyValue(kind, value, normalized, sizeof(normalized));
+  uint32_t hash = HashKey(kind, normalized);
+  for (uint32_t index = buckets[hash & (header->bucketCount - 1)]; index != 0; index = keys[index - 1].next) {
+    const IndexKey* key = &keys[index - 1];
+    if (key->hash == hash && key->kind == kind && strcmp(strings + key->string, normalized) == 0) {
+      return key->app;
+    }
+  }
+  return -1;
+}
+
+static bool StringSetAdd(StringSet* set, const char* value) {
+  if (set->count * 2 >= set->capacity) {
+    uint32_t capacity = set->capacity > 0 ? set->capacity * 2 : 256;
+    char** items = (char**)calloc(capacity, sizeof(char*));
+    if (items == NULL) {
+      return false;
+    }
+    for (uint32_t i = 0; i < set->capacity; i++) {
+      if (set->items[i] == NULL) continue;
+      uint32_t slot = HashKey(0, set->items[i]) & (capacity - 1);
+      while (items[slot] != NULL) slot = (slot + 1) & (capacity - 1);
+      items[slot] = set->items[i];
+    }
+    free(set->items);
+    set->items = items;
+    set->capacity = capacity;
+  }
+
+  uint32_t slot = HashKey(0, value) & (set->capacity - 1);
+  while (set->items[slot] != NULL) {
+    if (strcmp(set->items[slot], value) == 0) {
+      return false;
+    }
+    slot = (slot + 1) & (set->capacity - 1);
+  }
+  set->items[slot] = CopyString(value);
+  set->count++;
+  return true;
+}
+
+static void StringSetFree(StringSet* set) {
+  for (uint32_t i = 0; i < set->capacity; i++) {
+    free(set->items[i]);
+  }
+  free(set->items);
+  memset(set, 0, sizeof(StringSet));
+}
+
+static void AddDirectory(ScanConfig* config, const char* base, const char* suffix) {
+  if (base == NULL || base[0] != '/' || config->count >= MAX_DIRECTORIES) {
+    return;
+  }
+  char path[PATH_MAX];
+  if ((size_t)snprintf(path, sizeof(path), "%s%s", base, suffix) >= sizeof(path)) {
+    return;
+  }
+  for (int i = 0; i < config->count; i++) {
+    if (strcmp(config->directories[i], path) == 0) {
+      return;
+    }
+  }
+  config->directories[config->count] = CopyString(path);
+  if (config->directories[config->count] != NULL) {
+    config->count++;
+  }
+}
+
+// Application directories in precedence order: XDG data home, flatpak
+// exports, XDG data directories, snap exports
+static void ReadScanConfig(ScanConfig* config) {
+  memset(config, 0, sizeof(ScanConfig));
+  ReadLocale(&config->locale);
+
+  const char* home = getenv("HOME");
+  const char* dataHome = getenv("XDG_DATA_HOME");
+  if (dataHome != NULL && dataHome[0] == '/') {
+    AddDirectory(config, dataHome, "/applications");
+  } else {
+    AddDirectory(config, home, "/.local/share/applications");
+  }
+  AddDirectory(config, home, "/.local/share/flatpak/exports/share/applications");
+  AddDirectory(config, "/var/lib/flatpak/exports/share/applications", "");
+
+  const char* dataDirs = getenv("XDG_DATA_DIRS");
+  if (dataDirs == NULL || dataDirs[0] == '\0') {
+    dataDirs = "/usr/local/share:/usr/share";
+  }
+  while (*dataDirs != '\0') {
+    size_t length = strcspn(dataDirs, ":");
+    char base[PATH_MAX];
+    if (length > 0 && length < sizeof(base)) {
+      memcpy(base, dataDirs, length);
+      base[length] = '\0';
+      AddDirectory(config, base, "/applications");
+    }
+    dataDirs += length + (dataDirs[length] == ':' ? 1 : 0);
+  }
+  AddDirectory(config, "/var/lib/snapd/desktop/applications", "");
+}
+
+static void FreeScanConfig(ScanConfig* config) {
+  for (int i = 0; i < config->count; i++) {
+    free(config->directories[i]);
+  }
+  config->count = 0;
+}
+
+static int CompareNames(const void* a, const void* b) {
+  return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+typedef void (*DesktopFileVisitor)(void* context, const char* path, const char* id, const struct stat* info);
+
+// Visit the .desktop files under a directory in name order, ids joining
+// subdirectories with '-' (kde4/konsole.desktop is kde4-konsole)
+static void WalkDirectory(const char* directory, const char* prefix, int depth, DesktopFileVisitor visitor, void* context) {
+  DIR* dir = opendir(directory);
+  if (dir == NULL) {
+    return;
+  }
+  char** names = NULL;
+  size_t count = 0, capacity = 0;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    if (count == capacity) {
+      capacity = capacity > 0 ? capacity * 2 : 64;
+      char** grown = (char**)realloc(names, capacity * sizeof(char*));
+      if (grown == NULL) {
+        break;
+      }
+      names = grown;
+    }
+    names[count] = CopyString(entry->d_name);
+    if (names[count] != NULL) {
+      count++;
+    }
+  }
+  closedir(dir);
+  if (count > 0) {
+    qsort(names, count, sizeof(char*), CompareNames);
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    char path[PATH_MAX];
+    char id[PATH_MAX];
+    struct stat info;
+    if ((size_t)snprintf(path, sizeof(path), "%s/%s", directory, names[i]) < sizeof(path) &&
+        (size_t)snprintf(id, sizeof(id), "%s%s", prefix, names[i]) < sizeof(id) &&
+        stat(path, &info) == 0) {
+      size_t length = strlen(id);
+      if (S_ISDIR(info.st_mode)) {
+        if (depth < MAX_DEPTH && length + 1 < sizeof(id)) {
+          id[length] = '-';
+          id[length + 1] = '\0';
+          WalkDirectory(path, id, depth + 1, visitor, context);
+        }
+      } else if (S_ISREG(info.st_mode) && length > 8 && strcmp(id + length - 8, ".desktop") == 0) {
+        id[length - 8] = '\0';
+        visitor(context, path, id, &info);
+      }
+    }
+    free(names[i]);
+  }
+  free(names);
+}
+
+static void StampVisitor(void* context, const char* path, const char* id, const struct stat* info) {
+  uint64_t* stamp = (uint64_t*)context;
+  int64_t values[3] = { (int64_t)info->st_size, (int64_t)info->st_mtim.tv_sec, (int64_t)info->st_mtim.tv_nsec };
+  uint64_t hash = Hash64(14695981039346656037ULL, path, strlen(path));
+  *stamp = Hash64(*stamp, &hash, sizeof(hash));
+  *stamp = Hash64(*stamp, values, sizeof(values));
+  (void)id;
+}
+
+// Changes to the locale, the directory list or any .desktop file change the stamp
+static uint64_t ComputeStamp(const ScanConfig* config) {
+  uint64_t stamp = Hash64(14695981039346656037ULL, &config->locale, sizeof(Locale));
+  for (int i = 0; i < config->count; i++) {
+    stamp = Hash64(stamp, config->directories[i], strlen(config->directories[i]) + 1);
+    WalkDirectory(config->directories[i], "", 0, StampVisitor, &stamp);
+  }
+  return stamp;
+}
+
+typedef struct {
+  const Locale* locale;
+  StringSet ids;
+  ParsedApp* apps;
+  size_t count;
+  size_t capacity;
+} ParseContext;
+
+static void ParseVisitor(void* context, const char* path, const char* id, const struct stat* info) {
+  ParseContext* parse = (ParseContext*)context;
+  (void)info;
+
+  // The first directory defining an id wins, hidden entries included
+  if (!StringSetAdd(&parse->ids, id)) {
+    return;
+  }
+
+  FileMap map;
+  if (!MapFile(path, &map)) {
+    return;
+  }
+  DesktopFile file;
+  ParseDesktopFile((const char*)map.data, map.size, parse->locale, &file);
+  UnmapFile(&map);
+
+  if (file.hidden || file.type == NULL || strcmp(file.type, "Application") != 0 || file.name == NULL) {
+    FreeDesktopFile(&file);
+    return;
+  }
+
+  if (parse->count == parse->capacity) {
+    size_t capacity = parse->capacity > 0 ? parse->capacity * 2 : 256;
+    ParsedApp* apps = (ParsedApp*)realloc(parse->apps, capacity * sizeof(ParsedApp));
+    if (apps == NULL) {
+      FreeDesktopFile(&file);
+      return;
+    }
+    parse->apps = apps;
+    parse->capacity = capacity;
+  }
+  parse->apps[parse->count].id = CopyString(id);
+  parse->apps[parse->count].file = file;
+  parse->count++;
+}
+
+// Parse every application and lay out the index
+// Visible applications claim keys before NoDisplay ones (helpers, handlers)
+static uint8_t* BuildIndex(const ScanConfig* config, uint64_t stamp, size_t* size) {
+  ParseContext parse;
+  memset(&parse, 0, sizeof(parse));
+  parse.locale = &config->locale;
+  for (int i = 0; i < config->count; i++) {
+    WalkDirectory(config->directories[i], "", 0, ParseVisitor, &parse);
+  }
+
+  Builder builder;
+  memset(&builder, 0, sizeof(builder));
+  BufferAppend(&builder.strings, "", 1);
+  for (int pass = 0; pass < 2; pass++) {
+    for (size_t i = 0; i < parse.count; i++) {
+      if (parse.apps[i].file.noDisplay == (pass == 1)) {
+        AddApp(&builder, &parse.apps[i]);
+      }
+    }
+  }
+  uint8_t* data = FinishIndex(&builder, stamp, size);
+
+  for (size_t i = 0; i < parse.count; i++) {
+    free(parse.apps[i].id);
+    FreeDesktopFile(&parse.apps[i].file);
+  }
+  free(parse.apps);
+  StringSetFree(&parse.ids);
+  free(builder.strings.data);
+  free(builder.apps.data);
+  free(builder.keys.data);
+
+  LOG_DEBUG("desktopindex", "Indexed %zu applications", parse.count);
+  return data;
+}
+
+// Written to a temporary file first so readers never map a partial index
+// The name has the pid so processes sharing the file do not write over each other
+static void WriteIndexFile(const char* path, const uint8_t* data, size_t size) {
+  size_t length = strlen(path) + 32;
+  char* temporary = (char*)malloc(length);
+  if (temporary == NULL) {
+    return;
+  }
+  snprintf(temporary, length, "%s.%ld.tmp", path, (long)getpid());
+
+  FILE* file = fopen(temporary, "wb");
+  bool ok = file != NULL && fwrite(data, size, 1, file) == 1;
+  if (file != NULL) {
+    ok = fclose(file) == 0 && ok;
+  }
+  if (!ok || rename(temporary, path) != 0) {
+    LOG_WARN("desktopindex", "Unable to write %s", path);
+    unlink(temporary);
+  }
+  free(temporary);
+}
+
+// Swap the index in, with the lock held
+static void InstallIndex(uint8_t* owned, const FileMap* map) {
+  if (g_mapped) {
+    UnmapFile(&g_map);
+    g_mapped = false;
+  }
+  free(g_owned);
+  g_owned = owned;
+  g_data = owned;
+  if (map != NULL) {
+    g_map = *map;
+    g_mapped = true;
+    g_data = g_map.data;
+  }
+  g_built = true;
+  ConditionBroadcast(&g_ready);
+}
+
+// Map the cache file when it matches the .desktop files, else parse them
+// Only this thread installs indexes, so it reads g_data without the lock
+static void RefreshIndex(void) {
+  MutexLock(&g_lock);
+  char* indexFile = g_indexFile != NULL ? CopyString(g_indexFile) : NULL;
+  bool indexFileChanged = g_indexFileChanged;
+  g_indexFileChanged = false;
+  MutexUnlock(&g_lock);
+
+  ScanConfig config;
+  ReadScanConfig(&config);
+  uint64_t stamp = ComputeStamp(&config);
+
+  // Keep the index when the events left the .desktop files as they were
+  // (mimeinfo.cache updates, attribute changes...)
+  if (g_data != NULL && ((const IndexHeader*)g_data)->stamp == stamp) {
+    LOG_DEBUG("desktopindex", "Desktop files unchanged");
+    if (indexFileChanged && indexFile != NULL) {
+      WriteIndexFile(indexFile, g_data, ((const IndexHeader*)g_data)->size);
+    }
+    FreeScanConfig(&config);
+    free(indexFile);
+    return;
+  }
+
+  FileMap map;
+  if (indexFile != NULL && MapFile(indexFile, &map)) {
+    if (ValidIndex(map.data, map.size) && ((const IndexHeader*)map.data)->stamp == stamp) {
+      LOG_DEBUG("desktopindex", "Mapped %s", indexFile);
+      MutexLock(&g_lock);
+      InstallIndex(NULL, &map);
+      MutexUnlock(&g_lock);
+      FreeScanConfig(&config);
+      free(indexFile);
+      return;
+    }
+    UnmapFile(&map);
+  }
+
+  size_t size = 0;
+  uint8_t* data = BuildIndex(&config, stamp, &size);
+  FreeScanConfig(&config);
+  if (data != NULL && indexFile != NULL) {
+    WriteIndexFile(indexFile, data, size);
+  }
+  free(indexFile);
+
+  MutexLock(&g_lock);
+  if (data != NULL) {
+    InstallIndex(data, NULL);
+  } else if (!g_built) {
+    // Let waiting lookups go: there is nothing to wait for
+    g_built = true;
+    ConditionBroadcast(&g_ready);
+  }
+  MutexUnlock(&g_lock);
+}
+
+// Watch the application directories and their subdirectories, or the parent
+// of a missing one so its creation is noticed
+static void WatchDirectories(int notify) {
+  const uint32_t mask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF | IN_ONLYDIR;
+  ScanConfig config;
+  ReadScanConfig(&config);
+  for (int i = 0; i < config.count; i++) {
+    const char* directory = config.directories[i];
+    if (inotify_add_watch(notify, directory, mask) >= 0) {
+      DIR* dir = opendir(directory);
+      struct dirent* entry;
+      while (dir != NULL && (entry = readdir(dir)) != NULL) {
+        char path[PATH_MAX];
+        if (entry->d_name[0] != '.' && (size_t)snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name) < sizeof(path)) {
+          inotify_add_watch(notify, path, mask);
+        }
+      }
+      if (dir != NULL) {
+        closedir(dir);
+      }
+    } else {
+      char parent[PATH_MAX];
+      snprintf(parent, sizeof(parent), "%s", directory);
+      char* slash = strrchr(parent, '/');
+      if (slash != NULL && slash != parent) {
+        *slash = '\0';
+        inotify_add_watch(notify, parent, IN_CREATE | IN_MOVED_TO | IN_ONLYDIR);
+      }
+    }
+  }
+  FreeScanConfig(&config);
+}
+
+// Read pending events, false if there were none
+static bool DrainEvents(int fd) {
+  char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  bool any = false;
+  while (read(fd, buffer, sizeof(buffer)) > 0) {
+    any = true;
+  }
+  return any;
+}
+
+static THREAD_PROC(IndexThread) {
+  (void)arg;
+
+  int notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (notify < 0) {
+    LOG_WARN("desktopindex", "inotify unavailable, the index will not refresh");
+  }
+
+  for (;;) {
+    // Watch first so changes made during the scan trigger another one
+    if (notify >= 0) {
+      WatchDirectories(notify);
+    }
+    RefreshIndex();
+
+    struct pollfd fds[2] = { { g_wake, POLLIN, 0 }, { notify, POLLIN, 0 } };
+    int count = notify >= 0 ? 2 : 1;
+    int ready;
+    while ((ready = poll(fds, count, -1)) < 0 && errno == EINTR) {
+      // Interrupted by a signal
+    }
+    if (ready < 0) {
+      LOG_ERROR("desktopindex", "Unable to wait for changes");
+      break;
+    }
+    bool changed = count == 2 && DrainEvents(notify);
+    DrainEvents(g_wake);
+
+    // Package managers touch many files: rebuild once they are done
+    while (changed && poll(&fds[1], 1, REFRESH_DELAY_MS) > 0) {
+      changed = DrainEvents(notify);
+    }
+  }
+
+  if (notify >= 0) {
+    close(notify);
+  }
+  THREAD_RETURN;
+}
+
+static void InitializeState(void) {
+  MutexInit(&g_lock);
+  ConditionInit(&g_ready);
+
+  g_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  Thread thread;
+  if (g_wake < 0 || !ThreadCreate(&thread, IndexThread, NULL)) {
+    LOG_ERROR("desktopindex", "Failed to start the desktop index thread");
+    // Lookups miss without waiting
+    g_built = true;
+    return;
+  }
+  ThreadDetach(thread);
+}
+
+static void EnsureStarted(void) {
+  pthread_once(&g_once, InitializeState);
+}
+
+static void CopyField(const char* strings, uint32_t offset, char* out) {
+  snprintf(out, DESKTOP_STRING_SIZE, "%s", strings + offset);
+}
+
+bool FindDesktopApp(const char* wmClass, const char* wmInstance, const char* exePath, uint32_t waitMs, DesktopApp* app) {
+  memset(app, 0, sizeof(DesktopApp));
+  EnsureStarted();
+
+  MutexLock(&g_lock);
+  if (!g_built && !g_waited && waitMs > 0) {
+    // Only the first lookup waits for the initial build
+    g_waited = true;
+    uint64_t deadline = MonotonicMillis() + waitMs;
+    uint64_t now;
+    while (!g_built && (now = MonotonicMillis()) < deadline) {
+      ConditionTimedWait(&g_ready, &g_lock, (uint32_t)(deadline - now));
+    }
+  }
+  if (g_data == NULL) {
+    MutexUnlock(&g_lock);
+    return false;
+  }
+
+  int64_t index = FindKey(g_data, KEY_CLASS, wmClass);
+  if (index < 0) index = FindKey(g_data, KEY_ID, wmClass);
+  if (index < 0) index = FindKey(g_data, KEY_CLASS, wmInstance);
+  if (index < 0) index = FindKey(g_data, KEY_ID, wmInstance);
+  if (index < 0) index = FindKey(g_data, KEY_PATH, exePath);
+  if (index < 0 && exePath != NULL) index = FindKey(g_data, KEY_EXE, BaseName(exePath));
+
+  if (index >= 0) {
+    const IndexHeader* header = (const IndexHeader*)g_data;
+    const IndexApp* entry = &((const IndexApp*)(g_data + header->apps))[index];
+    const char* strings = (const char*)(g_data + header->strings);
+    CopyField(strings, entry->id, app->id);
+    CopyField(strings, entry->name, app->name);
+    CopyField(strings, entry->icon, app->icon);
+    CopyField(strings, entry->categories, app->categories);
+  }
+  MutexUnlock(&g_lock);
+  return index >= 0;
+}
+
+bool SetDesktopIndexFile(const char* path) {
+  if (path != NULL) {
+    // Refuse to overwrite something else
+    FILE* file = fopen(path, "rb");
+    if (file != NULL) {
+      uint32_t magic = 0;
+      size_t read = fread(&magic, sizeof(magic), 1, file);
+      bool empty = read == 0 && feof(file);
+      fclose(file);
+      if (!empty && magic != INDEX_MAGIC) {
+        return false;
+      }
+    }
+  }
+
+  EnsureStarted();
+  MutexLock(&g_lock);
+  free(g_indexFile);
+  g_indexFile = path != NULL ? CopyString(path) : NULL;
+  g_indexFileChanged = true;
+  MutexUnlock(&g_lock);
+
+  // The thread maps the file, or writes it, on its next refresh
+  uint64_t one = 1;
+  if (path != NULL && g_wake >= 0 && write(g_wake, &one, sizeof(one)) < 0) {
+    LOG_DEBUG("desktopindex", "Unable to wake the index thread");
+  }
+  return true;
+}
+
+#endif // __linux__
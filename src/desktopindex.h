@@ -0,0 +1,51 @@
+#ifndef DESKTOPINDEX_H
+#define DESKTOPINDEX_H
+
+#ifdef __linux__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DESKTOP_STRING_SIZE 256
+
+// First lookups wait this long for the initial build, in milliseconds
+#define DESKTOP_INDEX_WAIT_MS 250
+
+// Identity of an installed application, UTF-8, empty when missing
+typedef struct {
+  char id[DESKTOP_STRING_SIZE];         // Desktop file id without .desktop
+  char name[DESKTOP_STRING_SIZE];       // Name in the current locale
+  char icon[DESKTOP_STRING_SIZE];       // Icon theme name or absolute path
+  char categories[DESKTOP_STRING_SIZE]; // Semicolon separated list
+} DesktopApp;
+
+// Find the application of a window (any argument may be NULL)
+// Probes StartupWMClass and desktop ids with the WM_CLASS class, then the
+// instance, then executables by resolved path, then by file name
+// Applications come from the .desktop files of the XDG data directories
+// (~/.local/share, /usr/share...) and the flatpak and snap exports, indexed
+// once on a background thread and refreshed with inotify: a lookup is a few
+// hash probes. Before the first build completes, the first lookup waits at
+// most waitMs (DESKTOP_INDEX_WAIT_MS, or 0 on latency sensitive paths) and
+// lookups miss
+// Returns false if no application matches
+bool FindDesktopApp(const char* wmClass, const char* wmInstance, const char* exePath, uint32_t waitMs, DesktopApp* app);
+
+// Persist the index to a file that later runs map instead of parsing the
+// .desktop files again, as long as none of them changed
+// Pass NULL to keep the index in memory only
+// Returns false if the file exists but is not a desktop index
+bool SetDesktopIndexFile(const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __linux__
+
+#endif // DESKTOPINDEX_H
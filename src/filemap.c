@@ -0,0 +1,143 @@
+#include "filemap.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+wchar_t* WidePath(const char* path) {
+  UINT codePage = CP_UTF8;
+  int length = MultiByteToWideChar(codePage, MB_ERR_INVALID_CHARS, path, -1, NULL, 0);
+  if (length <= 0) {
+    codePage = CP_ACP;
+    length = MultiByteToWideChar(codePage, 0, path, -1, NULL, 0);
+  }
+  if (length <= 0) {
+    return NULL;
+  }
+  wchar_t* wide = (wchar_t*)malloc((size_t)length * sizeof(wchar_t));
+  if (wide != NULL) {
+    MultiByteToWideChar(codePage, 0, path, -1, wide, length);
+  }
+  return wide;
+}
+
+bool MapFile(const char* path, FileMap* map) {
+  memset(map, 0, sizeof(FileMap));
+  wchar_t* wide = WidePath(path);
+  if (wide == NULL) {
+    return false;
+  }
+
+  // Share delete too: a running installer may replace the file under us
+  map->file = CreateFileW(wide, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  free(wide);
+  if (map->file == INVALID_HANDLE_VALUE) {
+    map->file = NULL;
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(map->file, &size) || (uint64_t)size.QuadPart > SIZE_MAX) {
+    UnmapFile(map);
+    return false;
+  }
+  map->size = (size_t)size.QuadPart;
+  if (map->size == 0) {
+    return true;
+  }
+
+  map->mapping = CreateFileMappingW(map->file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (map->mapping != NULL) {
+    map->data = (const uint8_t*)MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0);
+  }
+  if (map->data == NULL) {
+    UnmapFile(map);
+    return false;
+  }
+  return true;
+}
+
+void UnmapFile(FileMap* map) {
+  if (map->data != NULL) {
+    UnmapViewOfFile(map->data);
+  }
+  if (map->mapping != NULL) {
+    CloseHandle(map->mapping);
+  }
+  if (map->file != NULL) {
+    CloseHandle(map->file);
+  }
+  memset(map, 0, sizeof(FileMap));
+}
+
+bool FileStamp(const char* path, uint64_t* size, int64_t* mtime) {
+  wchar_t* wide = WidePath(path);
+  if (wide == NULL) {
+    return false;
+  }
+  struct _stat64 st;
+  bool ok = _wstat64(wide, &st) == 0;
+  free(wide);
+  if (ok) {
+    *size = (uint64_t)st.st_size;
+    *mtime = (int64_t)st.st_mtime;
+  }
+  return ok;
+}
+
+#else
+
+bool MapFile(const char* path, FileMap* map) {
+  memset(map, 0, sizeof(FileMap));
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (uint64_t)st.st_size > SIZE_MAX) {
+    close(fd);
+    return false;
+  }
+  map->size = (size_t)st.st_size;
+  if (map->size == 0) {
+    close(fd);
+    return true;
+  }
+
+  // The mapping stays valid once the descriptor is closed
+  void* data = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    map->size = 0;
+    return false;
+  }
+  map->data = (const uint8_t*)data;
+  return true;
+}
+
+void UnmapFile(FileMap* map) {
+  if (map->data != NULL) {
+    munmap((void*)map->data, map->size);
+  }
+  memset(map, 0, sizeof(FileMap));
+}
+
+bool FileStamp(const char* path, uint64_t* size, int64_t* mtime) {
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    return false;
+  }
+  *size = (uint64_t)st.st_size;
+  *mtime = (int64_t)st.st_mtime;
+  return true;
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef FILEMAP_H
+#define FILEMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Read-only view of a whole file
+typedef struct {
+  const uint8_t* data;
+  size_t size;
+#ifdef _WIN32
+  HANDLE file;
+  HANDLE mapping;
+#endif
+} FileMap;
+
+// Map a file read-only (path is UTF-8)
+// Empty files succeed with a NULL data pointer
+bool MapFile(const char* path, FileMap* map);
+
+// Release a view created by MapFile
+void UnmapFile(FileMap* map);
+
+// Size and modification time (seconds) of a file, without opening it
+bool FileStamp(const char* path, uint64_t* size, int64_t* mtime);
+
+#ifdef _WIN32
+// Convert a path for the wide Win32 APIs, free the result with free()
+// Paths from JavaScript are UTF-8, the ones from GetModuleFileNameExA use
+// the ANSI code page: takes UTF-8 when it decodes, else the ANSI code page
+wchar_t* WidePath(const char* path);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FILEMAP_H
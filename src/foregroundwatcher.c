@@ -0,0 +1,386 @@
+#include "foregroundwatcher.h"
+#include "window.h"
+#include "log.h"
+#include "watcher.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifdef __APPLE__
+#include "process.h"
+#include <CoreFoundation/CoreFoundation.h>
+#include <objc/message.h>
+#include <objc/runtime.h>
+#include <pthread.h>
+#endif
+
+#ifdef __linux__
+#include <X11/Xlib.h>
+#include <poll.h>
+#include <pthread.h>
+#include "x11.h"
+#endif
+
+static void ForegroundChanged(void);
+
+// Hash of what identifies the window for the caller
+static uint64_t HashWindow(const ForemostWindowInfo* info) {
+  uint64_t hash = WatcherHash(WATCHER_FNV_OFFSET_BASIS, &info->processId, sizeof(info->processId));
+  if (info->exePath != NULL) {
+    hash = WatcherHash(hash, info->exePath, strlen(info->exePath) + 1);
+  }
+  if (info->title != NULL) {
+    hash = WatcherHash(hash, info->title, strlen(info->title) + 1);
+  }
+  return hash;
+}
+
+static void SetStringProperty(napi_env env, napi_value object, const char* name, const char* value) {
+  if (value == NULL) {
+    return;
+  }
+  napi_value string;
+  napi_create_string_utf8(env, value, NAPI_AUTO_LENGTH, &string);
+  napi_set_named_property(env, object, name, string);
+}
+
+// Read the foreground window on the reader thread
+static void* ReadWindow(uint64_t* hash) {
+  ForemostWindowInfo* info = GetForemostWindow();
+  if (info == NULL) {
+    LOG_DEBUG("foregroundwatcher", "No foreground window");
+    return NULL;
+  }
+
+  *hash = HashWindow(info);
+  return info;
+}
+
+// Same shape as getForemostWindow
+static napi_value ConvertWindow(napi_env env, void* state) {
+  ForemostWindowInfo* info = (ForemostWindowInfo*)state;
+  napi_value value;
+  napi_create_object(env, &value);
+  SetStringProperty(env, value, "exePath", info->exePath);
+  SetStringProperty(env, value, "title", info->title);
+  SetStringProperty(env, value, "productName", info->productName);
+  napi_value processId;
+  napi_create_int32(env, info->processId, &processId);
+  napi_set_named_property(env, value, "processId", processId);
+  FreeWindowInfo(info);
+  return value;
+}
+
+static void ReleaseWindow(void* state) {
+  FreeWindowInfo((ForemostWindowInfo*)state);
+}
+
+// Platform notification source, started after the reader
+static int PlatformStart(void);
+static void PlatformStop(void);
+
+#ifdef _WIN32
+
+static HANDLE g_thread = NULL;
+static DWORD g_threadId = 0;
+static volatile bool g_hookInstalled = false;
+
+static void CALLBACK ForegroundProc(HWINEVENTHOOK hook, DWORD event, HWND hwnd, LONG idObject, LONG idChild,
+                                    DWORD eventThread, DWORD eventTime) {
+  (void)hook;
+  (void)hwnd;
+  (void)idObject;
+  (void)idChild;
+  (void)eventThread;
+  (void)eventTime;
+  if (event == EVENT_SYSTEM_FOREGROUND) {
+    ForegroundChanged();
+  }
+}
+
+// Out-of-context hooks are called on the thread that set them, from its message loop
+static DWORD WINAPI HookThread(LPVOID lpParam) {
+  HANDLE ready = (HANDLE)lpParam;
+
+  // Create the message queue so WM_QUIT cannot be posted before it exists
+  MSG msg;
+  PeekMessage(&msg, NULL, WM_USER, WM_USER, PM_NOREMOVE);
+
+  HWINEVENTHOOK hook = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, NULL,
+                                       ForegroundProc, 0, 0, WINEVENT_OUTOFCONTEXT);
+  g_hookInstalled = hook != NULL;
+  SetEvent(ready);
+  if (hook == NULL) {
+    LOG_ERROR("foregroundwatcher", "Failed to install foreground hook");
+    return 1;
+  }
+
+  while (GetMessage(&msg, NULL, 0, 0) > 0) {
+    TranslateMessage(&msg);
+    DispatchMessage(&msg);
+  }
+
+  UnhookWinEvent(hook);
+  return 0;
+}
+
+static int PlatformStart(void) {
+  HANDLE ready = CreateEvent(NULL, TRUE, FALSE, NULL);
+  if (ready == NULL) {
+    LOG_ERROR("foregroundwatcher", "Failed to create hook event");
+    return 5;
+  }
+
+  g_hookInstalled = false;
+  g_thread = CreateThread(NULL, 0, HookThread, ready, 0, &g_threadId);
+  if (g_thread == NULL) {
+    LOG_ERROR("foregroundwatcher", "Failed to create hook thread");
+    CloseHandle(ready);
+    g_threadId = 0;
+    return 5;
+  }
+
+  // Wait for the thread to have its queue and hook, or to have exited
+  HANDLE handles[2] = { ready, g_thread };
+  WaitForMultipleObjects(2, handles, FALSE, INFINITE);
+  CloseHandle(ready);
+
+  if (!g_hookInstalled) {
+    WaitForSingleObject(g_thread, INFINITE);
+    CloseHandle(g_thread);
+    g_thread = NULL;
+    g_threadId = 0;
+    return 3;
+  }
+  return 0;
+}
+
+static void PlatformStop(void) {
+  if (g_threadId != 0) {
+    PostThreadMessage(g_threadId, WM_QUIT, 0, 0);
+  }
+  if (g_thread != NULL) {
+    WaitForSingleObject(g_thread, 5000);
+    CloseHandle(g_thread);
+    g_thread = NULL;
+    g_threadId = 0;
+  }
+}
+
+#elif defined(__APPLE__)
+
+// NSWorkspace posts its notifications from the main run loop, which plain
+// Node never runs: a slow check of the frontmost pid covers that case
+#define FOREMOST_CHECK_INTERVAL 0.5
+
+static pthread_t g_thread;
+static volatile bool g_stopRequested = false;
+static CFRunLoopRef g_runLoop = NULL;
+static id g_observer = NULL;
+static pid_t g_foremostPid = 0;
+
+static void ApplicationActivated(id self, SEL command, id notification) {
+  (void)self;
+  (void)command;
+  (void)notification;
+  ForegroundChanged();
+}
+
+// Observer class built through the runtime, this file is plain C
+static Class ObserverClass(void) {
+  Class observerClass = objc_getClass("AutolibForegroundObserver");
+  if (observerClass == NULL) {
+    observerClass = objc_allocateClassPair(objc_getClass("NSObject"), "AutolibForegroundObserver", 0);
+    class_addMethod(observerClass, sel_registerName("applicationActivated:"), (IMP)ApplicationActivated, "v@:@");
+    objc_registerClassPair(observerClass);
+  }
+  return observerClass;
+}
+
+static id NotificationCenter(void) {
+  id (*send)(id, SEL) = (id (*)(id, SEL))objc_msgSend;
+  id workspace = send((id)objc_getClass("NSWorkspace"), sel_registerName("sharedWorkspace"));
+  return send(workspace, sel_registerName("notificationCenter"));
+}
+
+static void AddObserver(void) {
+  id (*send)(id, SEL) = (id (*)(id, SEL))objc_msgSend;
+  void (*addObserver)(id, SEL, id, SEL, CFStringRef, id) = (void (*)(id, SEL, id, SEL, CFStringRef, id))objc_msgSend;
+
+  g_observer = send((id)ObserverClass(), sel_registerName("new"));
+  addObserver(NotificationCenter(), sel_registerName("addObserver:selector:name:object:"), g_observer,
+              sel_registerName("applicationActivated:"), CFSTR("NSWorkspaceDidActivateApplicationNotification"), NULL);
+}
+
+static void RemoveObserver(void) {
+  if (g_observer == NULL) {
+    return;
+  }
+  void (*sendObject)(id, SEL, id) = (void (*)(id, SEL, id))objc_msgSend;
+  void (*send)(id, SEL) = (void (*)(id, SEL))objc_msgSend;
+  sendObject(NotificationCenter(), sel_registerName("removeObserver:"), g_observer);
+  send(g_observer, sel_registerName("release"));
+  g_observer = NULL;
+}
+
+static void CheckForemost(CFRunLoopTimerRef timer, void* info) {
+  (void)timer;
+  (void)info;
+  pid_t pid = GetForemostApplicationPID();
+  if (pid != g_foremostPid) {
+    g_foremostPid = pid;
+    ForegroundChanged();
+  }
+}
+
+static void* ObserverThread(void* arg) {
+  (void)arg;
+
+  g_runLoop = CFRunLoopGetCurrent();
+  CFRunLoopTimerRef timer = CFRunLoopTimerCreate(kCFAllocatorDefault, CFAbsoluteTimeGetCurrent() + FOREMOST_CHECK_INTERVAL,
+                                                 FOREMOST_CHECK_INTERVAL, 0, 0, CheckForemost, NULL);
+  CFRunLoopAddTimer(g_runLoop, timer, kCFRunLoopDefaultMode);
+
+  // Run in slices so a stop requested before the loop started is not missed
+  while (!g_stopRequested) {
+    CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.25, false);
+  }
+
+  CFRunLoopTimerInvalidate(timer);
+  CFRelease(timer);
+  g_runLoop = NULL;
+  return NULL;
+}
+
+static int PlatformStart(void) {
+  AddObserver();
+
+  g_foremostPid = GetForemostApplicationPID();
+  g_stopRequested = false;
+  if (pthread_create(&g_thread, NULL, ObserverThread, NULL) != 0) {
+    LOG_ERROR("foregroundwatcher", "Failed to create observer thread");
+    RemoveObserver();
+    return 5;
+  }
+  return 0;
+}
+
+static void PlatformStop(void) {
+  RemoveObserver();
+  g_stopRequested = true;
+  CFRunLoopRef runLoop = g_runLoop;
+  if (runLoop != NULL) {
+    CFRunLoopStop(runLoop);
+  }
+  pthread_join(g_thread, NULL);
+}
+
+#elif defined(__linux__)
+
+// The watcher has its own connection so it can block on the socket and
+// select root window events without touching the shared connection masks
+static Display* g_display = NULL;
+static Atom g_activeWindow = None;
+static pthread_t g_thread;
+static volatile bool g_stopRequested = false;
+
+static void* PropertyThread(void* arg) {
+  (void)arg;
+
+  struct pollfd pfd = { ConnectionNumber(g_display), POLLIN, 0 };
+  while (!g_stopRequested) {
+    while (XPending(g_display) > 0) {
+      XEvent event;
+      XNextEvent(g_display, &event);
+      if (event.type == PropertyNotify && event.xproperty.atom == g_activeWindow) {
+        ForegroundChanged();
+      }
+    }
+
+    // Use a timeout to allow checking g_stopRequested
+    poll(&pfd, 1, 100);
+  }
+
+  return NULL;
+}
+
+static int PlatformStart(void) {
+  // Makes sure Xlib is initialized for threads before opening another connection
+  if (!X11Available()) {
+    LOG_ERROR("foregroundwatcher", "No X server");
+    return 3;
+  }
+
+  g_display = XOpenDisplay(NULL);
+  if (g_display == NULL) {
+    LOG_ERROR("foregroundwatcher", "Failed to open X display");
+    return 3;
+  }
+
+  // The window manager updates _NET_ACTIVE_WINDOW on the root window
+  g_activeWindow = XInternAtom(g_display, "_NET_ACTIVE_WINDOW", False);
+  XSelectInput(g_display, DefaultRootWindow(g_display), PropertyChangeMask);
+  XFlush(g_display);
+
+  g_stopRequested = false;
+  if (pthread_create(&g_thread, NULL, PropertyThread, NULL) != 0) {
+    LOG_ERROR("foregroundwatcher", "Failed to create property thread");
+    XCloseDisplay(g_display);
+    g_display = NULL;
+    return 5;
+  }
+  return 0;
+}
+
+static void PlatformStop(void) {
+  g_stopRequested = true;
+  pthread_join(g_thread, NULL);
+
+  XCloseDisplay(g_display);
+  g_display = NULL;
+}
+
+#else
+
+static int PlatformStart(void) {
+  return WATCHER_NOT_SUPPORTED;
+}
+
+static void PlatformStop(void) {
+}
+
+#endif
+
+static const WatcherHooks g_hooks = {
+  "foregroundwatcher",
+  "ForegroundWatcherCallback",
+  true,                         // The current window is delivered on start
+  0,
+  ReadWindow,
+  ConvertWindow,
+  ReleaseWindow,
+  PlatformStart,
+  PlatformStop
+};
+
+static Watcher g_watcher = { .hooks = &g_hooks };
+
+// Called by the platform thread for every foreground change
+static void ForegroundChanged(void) {
+  WatcherChanged(&g_watcher);
+}
+
+int StartForegroundWatcher(napi_env env, napi_value callback, uint32_t debounceMs) {
+  return WatcherStart(&g_watcher, env, callback, debounceMs);
+}
+
+int StopForegroundWatcher(void) {
+  return WatcherStop(&g_watcher);
+}
+
+bool IsForegroundWatcherRunning(void) {
+  return g_watcher.running;
+}
@@ -0,0 +1,32 @@
+#ifndef FOREGROUNDWATCHER_H
+#define FOREGROUNDWATCHER_H
+
+#include <node_api.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Default quiet time after the last foreground change before the window is read
+#define FOREGROUND_WATCHER_DEFAULT_DEBOUNCE_MS 100
+
+// Start watching foreground window changes
+// callback: JavaScript function called with the new foreground window
+//           ({ exePath, title, productName, processId }, as getForemostWindow)
+// debounceMs: quiet time after the last change before reading the window,
+//             so an alt-tab sequence only delivers the window it ends on
+// Changes come from SetWinEventHook(EVENT_SYSTEM_FOREGROUND) on Windows,
+// NSWorkspace activation notifications on macOS and PropertyNotify on
+// _NET_ACTIVE_WINDOW on Linux. The current window is delivered on start,
+// then only windows that differ from the last delivered one.
+// Returns: 0 on success, 1 if already running, 2 or 5 if the callback or its
+// thread cannot be set up, 3 if the notification source is unavailable
+// (no X server or the hook was refused), 4 if the platform is not supported
+int StartForegroundWatcher(napi_env env, napi_value callback, uint32_t debounceMs);
+
+// Stop watching foreground window changes
+// Returns: 0 on success, non-zero on error
+int StopForegroundWatcher(void);
+
+// Check if the watcher is running
+bool IsForegroundWatcherRunning(void);
+
+#endif // FOREGROUNDWATCHER_H
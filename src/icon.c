@@ -0,0 +1,154 @@
+#include "icon.h"
+#include "filemap.h"
+#include "log.h"
+#include "pe.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ICO file and RT_GROUP_ICON layouts: both start with the same 6 bytes
+// header, group entries end with a resource id where ICO entries have a
+// file offset
+#define ICON_DIR_SIZE 6
+#define ICON_ENTRY_SIZE 16
+#define GROUP_ENTRY_SIZE 14
+#define ICON_TYPE 1
+
+static uint16_t ReadU16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t ReadU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t ReadU32BE(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void WriteU16(uint8_t* p, uint16_t value) {
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+}
+
+static void WriteU32(uint8_t* p, uint32_t value) {
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+  p[2] = (uint8_t)(value >> 16);
+  p[3] = (uint8_t)(value >> 24);
+}
+
+// Dimensions of an icon image, from its PNG or DIB header
+// The directory bytes are the fallback (0 stands for 256)
+static void ImageSize(const uint8_t* image, uint32_t size, const uint8_t* entry, int* width, int* height) {
+  static const uint8_t png[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  if (size >= 24 && memcmp(image, png, sizeof(png)) == 0) {
+    *width = (int)(ReadU32BE(image + 16) & INT_MAX);
+    *height = (int)(ReadU32BE(image + 20) & INT_MAX);
+  } else if (size >= 12 && ReadU32(image) >= 12) {
+    // DIB heights cover the color and the mask bitmaps
+    int32_t dibHeight = (int32_t)ReadU32(image + 8);
+    *width = (int)((int32_t)ReadU32(image + 4) & INT_MAX);
+    *height = (dibHeight < 0 ? -(dibHeight / 2) : dibHeight / 2);
+  } else {
+    *width = entry[0] != 0 ? entry[0] : 256;
+    *height = entry[1] != 0 ? entry[1] : 256;
+  }
+}
+
+IconData* ExtractIconFromPE(const char* exePath) {
+  if (!exePath) return NULL;
+
+  FileMap map;
+  if (!MapFile(exePath, &map)) {
+    return NULL;
+  }
+
+  IconData* result = NULL;
+  PeImage image;
+  const uint8_t* group;
+  uint32_t groupSize;
+  if (!PeOpen(map.data, map.size, &image) || !PeFindResource(&image, PE_RT_GROUP_ICON, PE_FIRST_RESOURCE, &group, &groupSize)) {
+    UnmapFile(&map);
+    return NULL;
+  }
+
+  uint16_t count = groupSize >= ICON_DIR_SIZE ? ReadU16(group + 4) : 0;
+  if (groupSize < ICON_DIR_SIZE + (uint32_t)count * GROUP_ENTRY_SIZE || ReadU16(group + 2) != ICON_TYPE) {
+    LOG_DEBUG("icon", "Invalid icon group in %s", exePath);
+    UnmapFile(&map);
+    return NULL;
+  }
+
+  // First pass sizes the ICO file so it is written with a single allocation
+  uint16_t found = 0;
+  uint64_t total = ICON_DIR_SIZE;
+  for (uint16_t i = 0; i < count; i++) {
+    const uint8_t* entry = group + ICON_DIR_SIZE + (size_t)i * GROUP_ENTRY_SIZE;
+    const uint8_t* icon;
+    uint32_t iconSize;
+    uint16_t id = ReadU16(entry + 12);
+    if (id != PE_FIRST_RESOURCE && PeFindResource(&image, PE_RT_ICON, id, &icon, &iconSize) && iconSize > 0) {
+      found++;
+      total += ICON_ENTRY_SIZE + (uint64_t)iconSize;
+    }
+  }
+  if (found == 0 || total > INT_MAX) {
+    UnmapFile(&map);
+    return NULL;
+  }
+
+  result = (IconData*)malloc(sizeof(IconData));
+  uint8_t* data = result != NULL ? (uint8_t*)malloc((size_t)total) : NULL;
+  if (data == NULL) {
+    free(result);
+    UnmapFile(&map);
+    return NULL;
+  }
+
+  result->data = data;
+  result->size = (int)total;
+  result->width = 0;
+  result->height = 0;
+
+  // ICONDIR, then the entries, then the images copied straight from the mapping
+  WriteU16(data, 0);
+  WriteU16(data + 2, ICON_TYPE);
+  WriteU16(data + 4, found);
+  uint8_t* out = data + ICON_DIR_SIZE;
+  uint32_t offset = ICON_DIR_SIZE + (uint32_t)found * ICON_ENTRY_SIZE;
+  for (uint16_t i = 0; i < count; i++) {
+    const uint8_t* entry = group + ICON_DIR_SIZE + (size_t)i * GROUP_ENTRY_SIZE;
+    const uint8_t* icon;
+    uint32_t iconSize;
+    uint16_t id = ReadU16(entry + 12);
+    if (id == PE_FIRST_RESOURCE || !PeFindResource(&image, PE_RT_ICON, id, &icon, &iconSize) || iconSize == 0) {
+      continue;
+    }
+
+    // Width, height, colors, reserved, planes and bit count carry over as is
+    memcpy(out, entry, 8);
+    WriteU32(out + 8, iconSize);
+    WriteU32(out + 12, offset);
+    memcpy(data + offset, icon, iconSize);
+    out += ICON_ENTRY_SIZE;
+    offset += iconSize;
+
+    int width, height;
+    ImageSize(icon, iconSize, entry, &width, &height);
+    if (width > result->width) {
+      result->width = width;
+      result->height = height;
+    }
+  }
+
+  UnmapFile(&map);
+  return result;
+}
+
+void FreeIconData(IconData* iconData) {
+  if (!iconData) return;
+
+  if (iconData->data) free(iconData->data);
+  free(iconData);
+}
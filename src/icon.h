@@ -0,0 +1,31 @@
+#ifndef ICON_H
+#define ICON_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Structure to hold icon data
+typedef struct {
+  void* data;      // ICO file bytes
+  int size;        // Size of icon data in bytes
+  int width;       // Width of the largest image
+  int height;      // Height of the largest image
+} IconData;
+
+// Get the application icon of a Windows executable (path is UTF-8)
+// The file is memory-mapped and its first RT_GROUP_ICON reassembled into an
+// ICO file from the RT_ICON entries as stored, PNG-compressed ones included:
+// nothing is redrawn or re-encoded and all resolutions are kept
+// Returns a dynamically allocated IconData structure that must be freed with
+// FreeIconData, or NULL if the file has no icon resource
+IconData* ExtractIconFromPE(const char* exePath);
+
+// Free the memory allocated for IconData
+void FreeIconData(IconData* iconData);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ICON_H
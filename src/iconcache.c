@@ -0,0 +1,546 @@
+#include "iconcache.h"
+#include "filemap.h"
+#include "log.h"
+#include "process.h"
+#include "threads.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Cache file layout: header, a fixed open-addressing index, then the data
+// area (paths and images, appended). Images are addressed by content, so
+// executables sharing an icon share the bytes
+#define CACHE_MAGIC 0x43434941u // "AICC"
+#define CACHE_VERSION 1
+#define CACHE_GROW_STEP (1024 * 1024)
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slotCount;
+  uint32_t count;
+  uint64_t dataEnd;
+  uint64_t reserved[5];
+} CacheHeader;
+
+// Index entry, key is 0 for free slots and written last
+typedef struct {
+  uint64_t key;
+  uint64_t contentHash;
+  uint64_t exeSize;
+  int64_t mtime;
+  uint64_t dataOffset;
+  uint64_t pathOffset;
+  uint32_t format;
+  uint32_t preferredSize;
+  int32_t width;
+  int32_t height;
+  uint32_t pathLength;
+  uint32_t dataLength;
+} CacheSlot;
+
+#define DATA_START (sizeof(CacheHeader) + ICON_CACHE_SLOTS * sizeof(CacheSlot))
+
+// Lookup key of one request
+typedef struct {
+  const char* path;
+  size_t pathLength;
+  uint64_t exeSize;
+  int64_t mtime;
+  uint32_t format;
+  uint32_t preferredSize;
+  uint64_t hash;
+} CacheKey;
+
+#ifdef _WIN32
+static INIT_ONCE g_once = INIT_ONCE_STATIC_INIT;
+static HANDLE g_file = NULL;
+static HANDLE g_mapping = NULL;
+#else
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static int g_fd = -1;
+#endif
+
+// Threads share the file descriptor, so the mutex orders them and the file lock orders processes
+static Mutex g_lock;
+static uint8_t* g_map = NULL;
+static size_t g_mapSize = 0;
+
+static void InitializeState(void) {
+  MutexInit(&g_lock);
+}
+
+#ifdef _WIN32
+static BOOL CALLBACK InitializeOnce(PINIT_ONCE once, PVOID param, PVOID* context) {
+  (void)once;
+  (void)param;
+  (void)context;
+  InitializeState();
+  return TRUE;
+}
+#endif
+
+static void EnsureInitialized(void) {
+#ifdef _WIN32
+  InitOnceExecuteOnce(&g_once, InitializeOnce, NULL, NULL);
+#else
+  pthread_once(&g_once, InitializeState);
+#endif
+}
+
+#ifdef _WIN32
+
+// Locks cover one byte far past the data so they never conflict with I/O
+#define LOCK_OFFSET_HIGH 0x7FFFFFFF
+
+static bool IsCacheOpen(void) {
+  return g_file != NULL;
+}
+
+static bool OpenCacheFile(const char* path) {
+  wchar_t* wide = WidePath(path);
+  if (wide == NULL) {
+    return false;
+  }
+  HANDLE file = CreateFileW(wide, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  free(wide);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  g_file = file;
+  return true;
+}
+
+static void UnmapCache(void) {
+  if (g_map != NULL) {
+    UnmapViewOfFile(g_map);
+    g_map = NULL;
+  }
+  if (g_mapping != NULL) {
+    CloseHandle(g_mapping);
+    g_mapping = NULL;
+  }
+  g_mapSize = 0;
+}
+
+static void CloseCacheFile(void) {
+  UnmapCache();
+  if (g_file != NULL) {
+    CloseHandle(g_file);
+    g_file = NULL;
+  }
+}
+
+static bool LockCache(bool exclusive) {
+  OVERLAPPED overlapped;
+  memset(&overlapped, 0, sizeof(overlapped));
+  overlapped.OffsetHigh = LOCK_OFFSET_HIGH;
+  return LockFileEx(g_file, exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0, 0, 1, 0, &overlapped) != 0;
+}
+
+static void UnlockCache(void) {
+  OVERLAPPED overlapped;
+  memset(&overlapped, 0, sizeof(overlapped));
+  overlapped.OffsetHigh = LOCK_OFFSET_HIGH;
+  UnlockFileEx(g_file, 0, 1, 0, &overlapped);
+}
+
+static size_t CacheFileSize(void) {
+  LARGE_INTEGER size;
+  return GetFileSizeEx(g_file, &size) ? (size_t)size.QuadPart : 0;
+}
+
+// Map the first size bytes, a mapping larger than the file extends it
+static bool MapCache(size_t size) {
+  UnmapCache();
+  g_mapping = CreateFileMappingW(g_file, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+  if (g_mapping != NULL) {
+    g_map = (uint8_t*)MapViewOfFile(g_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, size);
+  }
+  if (g_map == NULL) {
+    UnmapCache();
+    return false;
+  }
+  g_mapSize = size;
+  return true;
+}
+
+#else
+
+static bool IsCacheOpen(void) {
+  return g_fd >= 0;
+}
+
+static bool OpenCacheFile(const char* path) {
+  g_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  return g_fd >= 0;
+}
+
+static void UnmapCache(void) {
+  if (g_map != NULL) {
+    munmap(g_map, g_mapSize);
+    g_map = NULL;
+  }
+  g_mapSize = 0;
+}
+
+static void CloseCacheFile(void) {
+  UnmapCache();
+  if (g_fd >= 0) {
+    close(g_fd);
+    g_fd = -1;
+  }
+}
+
+static bool LockCache(bool exclusive) {
+  while (flock(g_fd, exclusive ? LOCK_EX : LOCK_SH) != 0) {
+    if (errno != EINTR) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void UnlockCache(void) {
+  flock(g_fd, LOCK_UN);
+}
+
+static size_t CacheFileSize(void) {
+  struct stat st;
+  return fstat(g_fd, &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+// Map the first size bytes, extending the file first when needed
+static bool MapCache(size_t size) {
+  UnmapCache();
+  if (CacheFileSize() < size && ftruncate(g_fd, (off_t)size) != 0) {
+    return false;
+  }
+  void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, g_fd, 0);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  g_map = (uint8_t*)map;
+  g_mapSize = size;
+  return true;
+}
+
+#endif
+
+static CacheHeader* Header(void) {
+  return (CacheHeader*)g_map;
+}
+
+static CacheSlot* Slots(void) {
+  return (CacheSlot*)(g_map + sizeof(CacheHeader));
+}
+
+// Clear the index and the data, with the exclusive lock held
+static void ResetCache(void) {
+  memset(g_map, 0, DATA_START);
+  CacheHeader* header = Header();
+  header->magic = CACHE_MAGIC;
+  header->version = CACHE_VERSION;
+  header->slotCount = ICON_CACHE_SLOTS;
+  header->dataEnd = DATA_START;
+}
+
+static bool HeaderValid(void) {
+  CacheHeader* header = Header();
+  return header->magic == CACHE_MAGIC && header->version == CACHE_VERSION &&
+         header->slotCount == ICON_CACHE_SLOTS && header->dataEnd >= DATA_START &&
+         header->dataEnd <= g_mapSize;
+}
+
+// Map the whole file, with the file lock held (another process may have grown it)
+// With the exclusive lock, a new or outdated file is initialized
+static bool SyncMapping(bool exclusive) {
+  size_t size = CacheFileSize();
+  if (size < DATA_START) {
+    if (!exclusive || !MapCache(DATA_START + CACHE_GROW_STEP)) {
+      return false;
+    }
+    ResetCache();
+    return true;
+  }
+  if (size != g_mapSize && !MapCache(size)) {
+    return false;
+  }
+  if (!HeaderValid()) {
+    if (!exclusive) {
+      return false;
+    }
+    LOG_INFO("iconcache", "Resetting the icon cache");
+    ResetCache();
+  }
+  return true;
+}
+
+static uint64_t Fnv1a(uint64_t hash, const void* data, size_t length) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001B3ull;
+  }
+  return hash;
+}
+
+#define FNV_OFFSET 0xCBF29CE484222325ull
+
+static void HashKey(CacheKey* key) {
+  uint64_t hash = Fnv1a(FNV_OFFSET, key->path, key->pathLength);
+  hash = Fnv1a(hash, &key->exeSize, sizeof(key->exeSize));
+  hash = Fnv1a(hash, &key->mtime, sizeof(key->mtime));
+  hash = Fnv1a(hash, &key->format, sizeof(key->format));
+  hash = Fnv1a(hash, &key->preferredSize, sizeof(key->preferredSize));
+  key->hash = hash != 0 ? hash : 1;
+}
+
+static bool InData(uint64_t offset, uint64_t length) {
+  uint64_t end = Header()->dataEnd;
+  return offset >= DATA_START && offset <= end && length <= end - offset;
+}
+
+static bool SlotMatches(const CacheSlot* slot, const CacheKey* key) {
+  return slot->key == key->hash && slot->exeSize == key->exeSize && slot->mtime == key->mtime &&
+         slot->format == key->format && slot->preferredSize == key->preferredSize &&
+         slot->pathLength == key->pathLength && InData(slot->pathOffset, slot->pathLength) &&
+         InData(slot->dataOffset, slot->dataLength) &&
+         memcmp(g_map + slot->pathOffset, key->path, key->pathLength) == 0;
+}
+
+// Index of the slot holding the key, or of the free slot where it goes
+// Returns false if the index is full
+static bool FindSlot(const CacheKey* key, size_t* index, bool* found) {
+  CacheSlot* slots = Slots();
+  for (size_t i = 0; i < ICON_CACHE_SLOTS; i++) {
+    size_t probe = (size_t)((key->hash + i) % ICON_CACHE_SLOTS);
+    if (slots[probe].key == 0) {
+      *index = probe;
+      *found = false;
+      return true;
+    }
+    if (SlotMatches(&slots[probe], key)) {
+      *index = probe;
+      *found = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Look a key up, with the mutex held
+// Returns true on a hit, with icon NULL when the executable has no icon
+static bool Lookup(const CacheKey* key, IconData** icon) {
+  if (!LockCache(false)) {
+    return false;
+  }
+
+  bool hit = false;
+  size_t index;
+  if (SyncMapping(false) && FindSlot(key, &index, &hit) && hit) {
+    const CacheSlot* slot = &Slots()[index];
+    *icon = NULL;
+    if (slot->dataLength > 0) {
+      // Copy out: another process may clear the cache once the lock is released
+      IconData* result = (IconData*)malloc(sizeof(IconData));
+      void* data = result != NULL ? malloc(slot->dataLength) : NULL;
+      if (data != NULL) {
+        memcpy(data, g_map + slot->dataOffset, slot->dataLength);
+        result->data = data;
+        result->size = (int)slot->dataLength;
+        result->width = slot->width;
+        result->height = slot->height;
+        *icon = result;
+      } else {
+        free(result);
+        hit = false;
+      }
+    }
+  }
+
+  UnlockCache();
+  return hit;
+}
+
+// Offset of stored bytes equal to data, 0 if there are none
+static uint64_t FindContent(uint64_t contentHash, const void* data, uint32_t length) {
+  CacheSlot* slots = Slots();
+  for (size_t i = 0; i < ICON_CACHE_SLOTS; i++) {
+    const CacheSlot* slot = &slots[i];
+    if (slot->key != 0 && slot->contentHash == contentHash && slot->dataLength == length &&
+        InData(slot->dataOffset, length) && memcmp(g_map + slot->dataOffset, data, length) == 0) {
+      return slot->dataOffset;
+    }
+  }
+  return 0;
+}
+
+static uint64_t Align8(uint64_t value) {
+  return (value + 7) & ~(uint64_t)7;
+}
+
+// Store a result, with the mutex held
+static void Store(const CacheKey* key, const IconData* icon) {
+  uint32_t length = icon != NULL ? (uint32_t)icon->size : 0;
+  uint64_t needed = Align8(key->pathLength) + Align8(length);
+  if (DATA_START + needed > ICON_CACHE_MAX_SIZE || !LockCache(true)) {
+    return;
+  }
+  if (!SyncMapping(true)) {
+    UnlockCache();
+    return;
+  }
+
+  // Start over when the index is crowded or the file would grow too large
+  CacheHeader* header = Header();
+  if (header->count + 1 > ICON_CACHE_SLOTS * 3 / 4 || header->dataEnd + needed > ICON_CACHE_MAX_SIZE) {
+    ResetCache();
+  }
+
+  size_t index;
+  bool found;
+  if (!FindSlot(key, &index, &found) || found) {
+    UnlockCache();
+    return;
+  }
+
+  uint64_t contentHash = length > 0 ? Fnv1a(FNV_OFFSET, icon->data, length) : 0;
+  uint64_t dataOffset = length > 0 ? FindContent(contentHash, icon->data, length) : 0;
+  if (dataOffset != 0) {
+    needed = Align8(key->pathLength);
+  }
+
+  // Grow by whole steps, the mapping moves so only offsets are kept across it
+  uint64_t dataEnd = Header()->dataEnd;
+  if (dataEnd + needed > g_mapSize) {
+    uint64_t size = ((dataEnd + needed + CACHE_GROW_STEP - 1) / CACHE_GROW_STEP) * CACHE_GROW_STEP;
+    if (!MapCache((size_t)size)) {
+      LOG_WARN("iconcache", "Unable to grow the icon cache");
+      UnlockCache();
+      return;
+    }
+  }
+
+  uint64_t pathOffset = dataEnd;
+  memcpy(g_map + pathOffset, key->path, key->pathLength);
+  dataEnd += Align8(key->pathLength);
+  if (length > 0 && dataOffset == 0) {
+    dataOffset = dataEnd;
+    memcpy(g_map + dataOffset, icon->data, length);
+    dataEnd += Align8(length);
+  }
+  Header()->dataEnd = dataEnd;
+
+  CacheSlot* slot = &Slots()[index];
+  slot->contentHash = contentHash;
+  slot->exeSize = key->exeSize;
+  slot->mtime = key->mtime;
+  slot->dataOffset = dataOffset;
+  slot->pathOffset = pathOffset;
+  slot->format = key->format;
+  slot->preferredSize = key->preferredSize;
+  slot->width = icon != NULL ? icon->width : 0;
+  slot->height = icon != NULL ? icon->height : 0;
+  slot->pathLength = (uint32_t)key->pathLength;
+  slot->dataLength = length;
+  slot->key = key->hash;
+  Header()->count++;
+
+  UnlockCache();
+}
+
+static IconData* ExtractIcon(const char* exePath, ImageFormat format, int preferredSize) {
+#ifdef WIN32
+  IconData* icon = GetIconFromExePath(exePath);
+#else
+  IconData* icon = ExtractIconFromPE(exePath);
+#endif
+  if (icon == NULL || format != IMAGE_FORMAT_PNG) {
+    return icon;
+  }
+
+  uint8_t* data = (uint8_t*)icon->data;
+  size_t size = (size_t)icon->size;
+  int width, height;
+  if (!IcoToPng(&data, &size, preferredSize, &width, &height)) {
+    FreeIconData(icon);
+    return NULL;
+  }
+  icon->data = data;
+  icon->size = (int)size;
+  icon->width = width;
+  icon->height = height;
+  return icon;
+}
+
+IconData* GetApplicationIcon(const char* exePath, ImageFormat format, int preferredSize) {
+  if (exePath == NULL) {
+    return NULL;
+  }
+
+  EnsureInitialized();
+  CacheKey key;
+  key.path = exePath;
+  key.pathLength = strlen(exePath);
+  key.format = (uint32_t)format;
+  key.preferredSize = format == IMAGE_FORMAT_PNG && preferredSize > 0 ? (uint32_t)preferredSize : 0;
+  bool cached = key.pathLength <= UINT32_MAX && FileStamp(exePath, &key.exeSize, &key.mtime);
+  if (cached) {
+    HashKey(&key);
+    MutexLock(&g_lock);
+    IconData* icon = NULL;
+    bool hit = IsCacheOpen() && Lookup(&key, &icon);
+    MutexUnlock(&g_lock);
+    if (hit) {
+      return icon;
+    }
+  }
+
+  // Extract without the mutex: other threads keep hitting the cache meanwhile
+  IconData* icon = ExtractIcon(exePath, format, preferredSize);
+  if (cached) {
+    MutexLock(&g_lock);
+    if (IsCacheOpen()) {
+      Store(&key, icon);
+    }
+    MutexUnlock(&g_lock);
+  }
+  return icon;
+}
+
+bool SetIconCacheFile(const char* path) {
+  EnsureInitialized();
+  MutexLock(&g_lock);
+  CloseCacheFile();
+  if (path == NULL) {
+    MutexUnlock(&g_lock);
+    return true;
+  }
+
+  bool ok = OpenCacheFile(path) && LockCache(true);
+  if (ok) {
+    // Never clobber a file that is not a cache
+    size_t size = CacheFileSize();
+    if (size > 0 && (size < sizeof(CacheHeader) || !MapCache(size) || Header()->magic != CACHE_MAGIC)) {
+      LOG_WARN("iconcache", "%s is not an icon cache", path);
+      ok = false;
+    } else {
+      ok = SyncMapping(true);
+    }
+    UnlockCache();
+  }
+  if (!ok) {
+    CloseCacheFile();
+  }
+  MutexUnlock(&g_lock);
+  return ok;
+}
@@ -0,0 +1,37 @@
+#ifndef ICONCACHE_H
+#define ICONCACHE_H
+
+#include <stdbool.h>
+#include "icon.h"
+#include "image.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Index slots of the cache file: it is cleared when three quarters are used
+#define ICON_CACHE_SLOTS 4096
+
+// The cache file is cleared instead of growing past this size
+#define ICON_CACHE_MAX_SIZE (64 * 1024 * 1024)
+
+// Get the application icon of an executable (path is UTF-8) in a format
+// preferredSize picks the PNG image (see IcoToPng), 0 for the largest
+// With a cache file, results (missing icons included) are looked up by path,
+// file size, modification time, format and preferred size before extracting
+// Returns a dynamically allocated IconData structure that must be freed with
+// FreeIconData, or NULL if the executable has no icon
+IconData* GetApplicationIcon(const char* exePath, ImageFormat format, int preferredSize);
+
+// Store icons in a memory-mapped cache file shared by all processes using it
+// Identical images are stored once, the index and the data live in the file
+// and updates are serialized with a file lock
+// Pass NULL to stop using the cache
+// Returns false if the file cannot be opened or is not a cache file
+bool SetIconCacheFile(const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ICONCACHE_H
@@ -0,0 +1,619 @@
+#include "image.h"
+#include <stdlib.h>
+#include <string.h>
+
+// IMAGE_SCALAR builds the portable kernels only, test/kernels.c compares both
+#if defined(IMAGE_SCALAR)
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define IMAGE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define ICON_DIR_SIZE 6
+#define ICON_ENTRY_SIZE 16
+#define DIB_HEADER_SIZE 40
+#define PNG_SIGNATURE_SIZE 8
+#define PNG_CHUNK_OVERHEAD 12
+#define PNG_IHDR_SIZE 13
+#define ZLIB_OVERHEAD 6
+#define STORED_HEADER_SIZE 5
+#define STORED_MAX 65535
+#define ADLER_MOD 65521
+#define ADLER_NMAX 5552
+
+// Frames beyond this would overflow the 32-bit sizes of the file formats
+#define MAX_DIMENSION 16384
+
+// Pixels per stored block when a single row does not fit in one
+#define PIXELS_PER_PIECE ((STORED_MAX - 1) / 4)
+
+static const uint8_t g_pngSignature[PNG_SIGNATURE_SIZE] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+// CRC-32 (ISO 3309, reflected 0xEDB88320) as used by PNG chunks
+static const uint32_t g_crcTable[256] = {
+  0x00000000u, 0x77073096u, 0xEE0E612Cu, 0x990951BAu, 0x076DC419u, 0x706AF48Fu,
+  0xE963A535u, 0x9E6495A3u, 0x0EDB8832u, 0x79DCB8A4u, 0xE0D5E91Eu, 0x97D2D988u,
+  0x09B64C2Bu, 0x7EB17CBDu, 0xE7B82D07u, 0x90BF1D91u, 0x1DB71064u, 0x6AB020F2u,
+  0xF3B97148u, 0x84BE41DEu, 0x1ADAD47Du, 0x6DDDE4EBu, 0xF4D4B551u, 0x83D385C7u,
+  0x136C9856u, 0x646BA8C0u, 0xFD62F97Au, 0x8A65C9ECu, 0x14015C4Fu, 0x63066CD9u,
+  0xFA0F3D63u, 0x8D080DF5u, 0x3B6E20C8u, 0x4C69105Eu, 0xD56041E4u, 0xA2677172u,
+  0x3C03E4D1u, 0x4B04D447u, 0xD20D85FDu, 0xA50AB56Bu, 0x35B5A8FAu, 0x42B2986Cu,
+  0xDBBBC9D6u, 0xACBCF940u, 0x32D86CE3u, 0x45DF5C75u, 0xDCD60DCFu, 0xABD13D59u,
+  0x26D930ACu, 0x51DE003Au, 0xC8D75180u, 0xBFD06116u, 0x21B4F4B5u, 0x56B3C423u,
+  0xCFBA9599u, 0xB8BDA50Fu, 0x2802B89Eu, 0x5F058808u, 0xC60CD9B2u, 0xB10BE924u,
+  0x2F6F7C87u, 0x58684C11u, 0xC1611DABu, 0xB6662D3Du, 0x76DC4190u, 0x01DB7106u,
+  0x98D220BCu, 0xEFD5102Au, 0x71B18589u, 0x06B6B51Fu, 0x9FBFE4A5u, 0xE8B8D433u,
+  0x7807C9A2u, 0x0F00F934u, 0x9609A88Eu, 0xE10E9818u, 0x7F6A0DBBu, 0x086D3D2Du,
+  0x91646C97u, 0xE6635C01u, 0x6B6B51F4u, 0x1C6C6162u, 0x856530D8u, 0xF262004Eu,
+  0x6C0695EDu, 0x1B01A57Bu, 0x8208F4C1u, 0xF50FC457u, 0x65B0D9C6u, 0x12B7E950u,
+  0x8BBEB8EAu, 0xFCB9887Cu, 0x62DD1DDFu, 0x15DA2D49u, 0x8CD37CF3u, 0xFBD44C65u,
+  0x4DB26158u, 0x3AB551CEu, 0xA3BC0074u, 0xD4BB30E2u, 0x4ADFA541u, 0x3DD895D7u,
+  0xA4D1C46Du, 0xD3D6F4FBu, 0x4369E96Au, 0x346ED9FCu, 0xAD678846u, 0xDA60B8D0u,
+  0x44042D73u, 0x33031DE5u, 0xAA0A4C5Fu, 0xDD0D7CC9u, 0x5005713Cu, 0x270241AAu,
+  0xBE0B1010u, 0xC90C2086u, 0x5768B525u, 0x206F85B3u, 0xB966D409u, 0xCE61E49Fu,
+  0x5EDEF90Eu, 0x29D9C998u, 0xB0D09822u, 0xC7D7A8B4u, 0x59B33D17u, 0x2EB40D81u,
+  0xB7BD5C3Bu, 0xC0BA6CADu, 0xEDB88320u, 0x9ABFB3B6u, 0x03B6E20Cu, 0x74B1D29Au,
+  0xEAD54739u, 0x9DD277AFu, 0x04DB2615u, 0x73DC1683u, 0xE3630B12u, 0x94643B84u,
+  0x0D6D6A3Eu, 0x7A6A5AA8u, 0xE40ECF0Bu, 0x9309FF9Du, 0x0A00AE27u, 0x7D079EB1u,
+  0xF00F9344u, 0x8708A3D2u, 0x1E01F268u, 0x6906C2FEu, 0xF762575Du, 0x806567CBu,
+  0x196C3671u, 0x6E6B06E7u, 0xFED41B76u, 0x89D32BE0u, 0x10DA7A5Au, 0x67DD4ACCu,
+  0xF9B9DF6Fu, 0x8EBEEFF9u, 0x17B7BE43u, 0x60B08ED5u, 0xD6D6A3E8u, 0xA1D1937Eu,
+  0x38D8C2C4u, 0x4FDFF252u, 0xD1BB67F1u, 0xA6BC5767u, 0x3FB506DDu, 0x48B2364Bu,
+  0xD80D2BDAu, 0xAF0A1B4Cu, 0x36034AF6u, 0x41047A60u, 0xDF60EFC3u, 0xA867DF55u,
+  0x316E8EEFu, 0x4669BE79u, 0xCB61B38Cu, 0xBC66831Au, 0x256FD2A0u, 0x5268E236u,
+  0xCC0C7795u, 0xBB0B4703u, 0x220216B9u, 0x5505262Fu, 0xC5BA3BBEu, 0xB2BD0B28u,
+  0x2BB45A92u, 0x5CB36A04u, 0xC2D7FFA7u, 0xB5D0CF31u, 0x2CD99E8Bu, 0x5BDEAE1Du,
+  0x9B64C2B0u, 0xEC63F226u, 0x756AA39Cu, 0x026D930Au, 0x9C0906A9u, 0xEB0E363Fu,
+  0x72076785u, 0x05005713u, 0x95BF4A82u, 0xE2B87A14u, 0x7BB12BAEu, 0x0CB61B38u,
+  0x92D28E9Bu, 0xE5D5BE0Du, 0x7CDCEFB7u, 0x0BDBDF21u, 0x86D3D2D4u, 0xF1D4E242u,
+  0x68DDB3F8u, 0x1FDA836Eu, 0x81BE16CDu, 0xF6B9265Bu, 0x6FB077E1u, 0x18B74777u,
+  0x88085AE6u, 0xFF0F6A70u, 0x66063BCAu, 0x11010B5Cu, 0x8F659EFFu, 0xF862AE69u,
+  0x616BFFD3u, 0x166CCF45u, 0xA00AE278u, 0xD70DD2EEu, 0x4E048354u, 0x3903B3C2u,
+  0xA7672661u, 0xD06016F7u, 0x4969474Du, 0x3E6E77DBu, 0xAED16A4Au, 0xD9D65ADCu,
+  0x40DF0B66u, 0x37D83BF0u, 0xA9BCAE53u, 0xDEBB9EC5u, 0x47B2CF7Fu, 0x30B5FFE9u,
+  0xBDBDF21Cu, 0xCABAC28Au, 0x53B39330u, 0x24B4A3A6u, 0xBAD03605u, 0xCDD70693u,
+  0x54DE5729u, 0x23D967BFu, 0xB3667A2Eu, 0xC4614AB8u, 0x5D681B02u, 0x2A6F2B94u,
+  0xB40BBE37u, 0xC30C8EA1u, 0x5A05DF1Bu, 0x2D02EF8Du
+};
+
+static uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t length) {
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc = g_crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+static uint32_t Adler32(uint32_t adler, const uint8_t* data, size_t length) {
+  uint32_t a = adler & 0xFFFF;
+  uint32_t b = adler >> 16;
+  while (length > 0) {
+    // Reduce once per NMAX bytes, the sums cannot overflow before that
+    size_t chunk = length < ADLER_NMAX ? length : ADLER_NMAX;
+    length -= chunk;
+    while (chunk-- > 0) {
+      a += *data++;
+      b += a;
+    }
+    a %= ADLER_MOD;
+    b %= ADLER_MOD;
+  }
+  return (b << 16) | a;
+}
+
+static uint32_t ReadU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t ReadU16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t ReadU32BE(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void WriteU16(uint8_t* p, uint16_t value) {
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+}
+
+static void WriteU32(uint8_t* p, uint32_t value) {
+  p[0] = (uint8_t)value;
+  p[1] = (uint8_t)(value >> 8);
+  p[2] = (uint8_t)(value >> 16);
+  p[3] = (uint8_t)(value >> 24);
+}
+
+static void WriteU32BE(uint8_t* p, uint32_t value) {
+  p[0] = (uint8_t)(value >> 24);
+  p[1] = (uint8_t)(value >> 16);
+  p[2] = (uint8_t)(value >> 8);
+  p[3] = (uint8_t)value;
+}
+
+// Kernels
+
+void BgraToRgba(const uint8_t* src, uint8_t* dst, size_t count) {
+  size_t i = 0;
+#if defined(IMAGE_SSE2)
+  // SSE2 has no byte shuffle: rotate the red/blue pair within each 32-bit lane
+  const __m128i greenAlpha = _mm_set1_epi32((int)0xFF00FF00);
+  const __m128i redBlue = _mm_set1_epi32(0x00FF00FF);
+  for (; i + 4 <= count; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+    __m128i rb = _mm_and_si128(v, redBlue);
+    rb = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+    _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_and_si128(v, greenAlpha), rb));
+  }
+#elif defined(IMAGE_NEON)
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x4_t v = vld4q_u8(src + i * 4);
+    uint8x16_t blue = v.val[0];
+    v.val[0] = v.val[2];
+    v.val[2] = blue;
+    vst4q_u8(dst + i * 4, v);
+  }
+#endif
+  for (; i < count; i++) {
+    uint8_t blue = src[i * 4];
+    dst[i * 4] = src[i * 4 + 2];
+    dst[i * 4 + 1] = src[i * 4 + 1];
+    dst[i * 4 + 2] = blue;
+    dst[i * 4 + 3] = src[i * 4 + 3];
+  }
+}
+
+#if defined(IMAGE_SSE2)
+static uint8_t ReverseBits(uint32_t b) {
+  b = ((b & 0xF0) >> 4) | ((b & 0x0F) << 4);
+  b = ((b & 0xCC) >> 2) | ((b & 0x33) << 2);
+  b = ((b & 0xAA) >> 1) | ((b & 0x55) << 1);
+  return (uint8_t)b;
+}
+#endif
+
+void AlphaToMask(const uint8_t* bgra, uint8_t* mask, size_t width) {
+  size_t x = 0;
+#if defined(IMAGE_SSE2)
+  // Gather 16 alpha bytes, their sign bits say alpha >= 128
+  for (; x + 16 <= width; x += 16) {
+    const uint8_t* p = bgra + x * 4;
+    __m128i a0 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)p), 24);
+    __m128i a1 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(p + 16)), 24);
+    __m128i a2 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(p + 32)), 24);
+    __m128i a3 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(p + 48)), 24);
+    __m128i alpha = _mm_packus_epi16(_mm_packs_epi32(a0, a1), _mm_packs_epi32(a2, a3));
+    uint32_t transparent = ~(uint32_t)_mm_movemask_epi8(alpha);
+    mask[x / 8] = ReverseBits(transparent & 0xFF);
+    mask[x / 8 + 1] = ReverseBits((transparent >> 8) & 0xFF);
+  }
+#elif defined(IMAGE_NEON)
+  static const uint8_t weights[16] = { 128, 64, 32, 16, 8, 4, 2, 1, 128, 64, 32, 16, 8, 4, 2, 1 };
+  const uint8x16_t weight = vld1q_u8(weights);
+  const uint8x16_t half = vdupq_n_u8(128);
+  for (; x + 16 <= width; x += 16) {
+    uint8x16x4_t v = vld4q_u8(bgra + x * 4);
+    uint8x16_t bits = vandq_u8(vcltq_u8(v.val[3], half), weight);
+    mask[x / 8] = vaddv_u8(vget_low_u8(bits));
+    mask[x / 8 + 1] = vaddv_u8(vget_high_u8(bits));
+  }
+#endif
+  // Bits past the width stay clear
+  for (size_t i = x / 8; i < (width + 7) / 8; i++) {
+    mask[i] = 0;
+  }
+  for (; x < width; x++) {
+    if (bgra[x * 4 + 3] < 128) {
+      mask[x / 8] |= (uint8_t)(0x80 >> (x % 8));
+    }
+  }
+}
+
+// PNG
+
+static bool ValidFrame(const ImageFrame* frame) {
+  return frame->pixels != NULL && frame->width > 0 && frame->height > 0 &&
+         frame->width <= MAX_DIMENSION && frame->height <= MAX_DIMENSION &&
+         frame->stride >= (size_t)frame->width * 4;
+}
+
+// Rows are grouped into stored deflate blocks; rows longer than a block are
+// split on pixel boundaries so the pixel kernels never straddle a block header
+static size_t StoredBlockCount(const ImageFrame* frame) {
+  size_t rowBytes = 1 + (size_t)frame->width * 4;
+  if (rowBytes <= STORED_MAX) {
+    size_t rowsPerBlock = STORED_MAX / rowBytes;
+    return ((size_t)frame->height + rowsPerBlock - 1) / rowsPerBlock;
+  }
+  size_t pieces = ((size_t)frame->width + PIXELS_PER_PIECE - 1) / PIXELS_PER_PIECE;
+  return (size_t)frame->height * pieces;
+}
+
+static size_t ZlibSize(const ImageFrame* frame) {
+  size_t raw = (size_t)frame->height * (1 + (size_t)frame->width * 4);
+  return ZLIB_OVERHEAD + raw + StoredBlockCount(frame) * STORED_HEADER_SIZE;
+}
+
+static size_t PngSize(const ImageFrame* frame) {
+  if (!ValidFrame(frame)) {
+    return 0;
+  }
+  return PNG_SIGNATURE_SIZE + PNG_CHUNK_OVERHEAD * 3 + PNG_IHDR_SIZE + ZlibSize(frame);
+}
+
+static uint8_t* WriteStoredHeader(uint8_t* p, size_t length, bool final) {
+  p[0] = final ? 1 : 0;
+  WriteU16(p + 1, (uint16_t)length);
+  WriteU16(p + 3, (uint16_t)~length);
+  return p + STORED_HEADER_SIZE;
+}
+
+static uint8_t* WriteChunkStart(uint8_t* p, uint32_t length, const char* type) {
+  WriteU32BE(p, length);
+  memcpy(p + 4, type, 4);
+  return p + 8;
+}
+
+// CRC covers the chunk type and data
+static uint8_t* WriteChunkEnd(uint8_t* start, uint8_t* p) {
+  WriteU32BE(p, Crc32(0, start + 4, (size_t)(p - start - 4)));
+  return p + 4;
+}
+
+static uint8_t* WritePng(const ImageFrame* frame, uint8_t* p) {
+  memcpy(p, g_pngSignature, PNG_SIGNATURE_SIZE);
+  p += PNG_SIGNATURE_SIZE;
+
+  // 8-bit RGBA, no interlace
+  uint8_t* chunk = p;
+  p = WriteChunkStart(p, PNG_IHDR_SIZE, "IHDR");
+  WriteU32BE(p, (uint32_t)frame->width);
+  WriteU32BE(p + 4, (uint32_t)frame->height);
+  p[8] = 8;
+  p[9] = 6;
+  p[10] = 0;
+  p[11] = 0;
+  p[12] = 0;
+  p = WriteChunkEnd(chunk, p + PNG_IHDR_SIZE);
+
+  chunk = p;
+  p = WriteChunkStart(p, (uint32_t)ZlibSize(frame), "IDAT");
+  p[0] = 0x78;
+  p[1] = 0x01;
+  p += 2;
+
+  // Scanlines use filter 0 and are converted straight into the output
+  uint32_t adler = 1;
+  size_t width = (size_t)frame->width;
+  size_t height = (size_t)frame->height;
+  size_t rowBytes = 1 + width * 4;
+  if (rowBytes <= STORED_MAX) {
+    size_t rowsPerBlock = STORED_MAX / rowBytes;
+    for (size_t y = 0; y < height; y += rowsPerBlock) {
+      size_t rows = height - y < rowsPerBlock ? height - y : rowsPerBlock;
+      p = WriteStoredHeader(p, rows * rowBytes, y + rows == height);
+      uint8_t* block = p;
+      for (size_t row = y; row < y + rows; row++) {
+        *p++ = 0;
+        BgraToRgba(frame->pixels + row * frame->stride, p, width);
+        p += width * 4;
+      }
+      adler = Adler32(adler, block, (size_t)(p - block));
+    }
+  } else {
+    for (size_t y = 0; y < height; y++) {
+      for (size_t x = 0; x < width; x += PIXELS_PER_PIECE) {
+        size_t pixels = width - x < PIXELS_PER_PIECE ? width - x : PIXELS_PER_PIECE;
+        p = WriteStoredHeader(p, pixels * 4 + (x == 0 ? 1 : 0), y + 1 == height && x + pixels == width);
+        uint8_t* block = p;
+        if (x == 0) {
+          *p++ = 0;
+        }
+        BgraToRgba(frame->pixels + y * frame->stride + x * 4, p, pixels);
+        p += pixels * 4;
+        adler = Adler32(adler, block, (size_t)(p - block));
+      }
+    }
+  }
+  WriteU32BE(p, adler);
+  p = WriteChunkEnd(chunk, p + 4);
+
+  chunk = p;
+  p = WriteChunkStart(p, 0, "IEND");
+  return WriteChunkEnd(chunk, p);
+}
+
+// ICO
+
+static bool IcoPngEntry(const ImageFrame* frame) {
+  return frame->width >= ICO_MAX_SIZE || frame->height >= ICO_MAX_SIZE;
+}
+
+static size_t MaskStride(int width) {
+  return (((size_t)width + 31) / 32) * 4;
+}
+
+static size_t IcoEntrySize(const ImageFrame* frame) {
+  if (!ValidFrame(frame) || frame->width > ICO_MAX_SIZE || frame->height > ICO_MAX_SIZE) {
+    return 0;
+  }
+  if (IcoPngEntry(frame)) {
+    return PngSize(frame);
+  }
+  return DIB_HEADER_SIZE + (size_t)frame->width * frame->height * 4 + MaskStride(frame->width) * frame->height;
+}
+
+// 32-bit DIB: the height covers the color and mask bitmaps, rows are bottom-up
+static uint8_t* WriteDib(const ImageFrame* frame, uint8_t* p) {
+  size_t width = (size_t)frame->width;
+  size_t height = (size_t)frame->height;
+  memset(p, 0, DIB_HEADER_SIZE);
+  WriteU32(p, DIB_HEADER_SIZE);
+  WriteU32(p + 4, (uint32_t)width);
+  WriteU32(p + 8, (uint32_t)height * 2);
+  WriteU16(p + 12, 1);
+  WriteU16(p + 14, 32);
+  WriteU32(p + 20, (uint32_t)(width * height * 4));
+  p += DIB_HEADER_SIZE;
+
+  for (size_t y = height; y-- > 0;) {
+    memcpy(p, frame->pixels + y * frame->stride, width * 4);
+    p += width * 4;
+  }
+
+  size_t maskStride = MaskStride(frame->width);
+  size_t maskBytes = (width + 7) / 8;
+  for (size_t y = height; y-- > 0;) {
+    AlphaToMask(frame->pixels + y * frame->stride, p, width);
+    memset(p + maskBytes, 0, maskStride - maskBytes);
+    p += maskStride;
+  }
+  return p;
+}
+
+size_t EncodedImageSize(const ImageFrame* frames, int count, ImageFormat format) {
+  if (frames == NULL || count <= 0) {
+    return 0;
+  }
+  if (format == IMAGE_FORMAT_PNG) {
+    return PngSize(&frames[0]);
+  }
+  if (count > UINT16_MAX) {
+    return 0;
+  }
+
+  size_t total = ICON_DIR_SIZE + (size_t)count * ICON_ENTRY_SIZE;
+  for (int i = 0; i < count; i++) {
+    size_t entry = IcoEntrySize(&frames[i]);
+    if (entry == 0) {
+      return 0;
+    }
+    total += entry;
+  }
+  return total <= UINT32_MAX ? total : 0;
+}
+
+bool EncodeImage(const ImageFrame* frames, int count, ImageFormat format, uint8_t* out, size_t size) {
+  if (out == NULL || size == 0 || EncodedImageSize(frames, count, format) != size) {
+    return false;
+  }
+  if (format == IMAGE_FORMAT_PNG) {
+    WritePng(&frames[0], out);
+    return true;
+  }
+
+  WriteU16(out, 0);
+  WriteU16(out + 2, 1);
+  WriteU16(out + 4, (uint16_t)count);
+  uint8_t* entry = out + ICON_DIR_SIZE;
+  uint8_t* p = entry + (size_t)count * ICON_ENTRY_SIZE;
+  for (int i = 0; i < count; i++, entry += ICON_ENTRY_SIZE) {
+    const ImageFrame* frame = &frames[i];
+
+    // Dimension bytes: 0 stands for 256
+    entry[0] = (uint8_t)(frame->width >= ICO_MAX_SIZE ? 0 : frame->width);
+    entry[1] = (uint8_t)(frame->height >= ICO_MAX_SIZE ? 0 : frame->height);
+    entry[2] = 0;
+    entry[3] = 0;
+    WriteU16(entry + 4, 1);
+    WriteU16(entry + 6, 32);
+    WriteU32(entry + 12, (uint32_t)(p - out));
+
+    uint8_t* image = p;
+    p = IcoPngEntry(frame) ? WritePng(frame, p) : WriteDib(frame, p);
+    WriteU32(entry + 8, (uint32_t)(p - image));
+  }
+  return true;
+}
+
+// ICO decoding
+
+// Dimensions of an ICO image from its PNG or DIB header
+static bool IcoImageSize(const uint8_t* image, size_t size, int* width, int* height, bool* png) {
+  *png = size >= 24 && memcmp(image, g_pngSignature, PNG_SIGNATURE_SIZE) == 0;
+  if (*png) {
+    *width = (int)(ReadU32BE(image + 16) & 0x7FFFFFFF);
+    *height = (int)(ReadU32BE(image + 20) & 0x7FFFFFFF);
+    return true;
+  }
+  if (size < DIB_HEADER_SIZE || ReadU32(image) < DIB_HEADER_SIZE) {
+    return false;
+  }
+  int32_t dibWidth = (int32_t)ReadU32(image + 4);
+  int32_t dibHeight = (int32_t)ReadU32(image + 8);
+  if (dibWidth <= 0 || dibHeight <= 0 || dibWidth > MAX_DIMENSION || dibHeight / 2 > MAX_DIMENSION) {
+    return false;
+  }
+  *width = dibWidth;
+  *height = dibHeight / 2;
+  return *height > 0;
+}
+
+// Decode a bottom-up DIB (1, 4, 8, 24 or 32 bits) and its AND mask to BGRA
+static bool DecodeDib(const uint8_t* image, size_t size, int width, int height, uint8_t* bgra) {
+  uint32_t headerSize = ReadU32(image);
+  uint16_t bitCount = ReadU16(image + 14);
+  uint32_t compression = ReadU32(image + 16);
+  uint32_t colorsUsed = ReadU32(image + 32);
+  if ((compression != 0 && !(compression == 3 && bitCount == 32)) || headerSize > size) {
+    return false;
+  }
+  if (bitCount != 1 && bitCount != 4 && bitCount != 8 && bitCount != 24 && bitCount != 32) {
+    return false;
+  }
+
+  // BI_BITFIELDS masks follow a 40 bytes header, assumed to be the usual BGRA
+  size_t offset = headerSize + (compression == 3 && headerSize == DIB_HEADER_SIZE ? 12 : 0);
+  size_t colors = bitCount <= 8 ? (colorsUsed != 0 && colorsUsed < (1u << bitCount) ? colorsUsed : (1u << bitCount)) : 0;
+  const uint8_t* palette = image + offset;
+  offset += colors * 4;
+
+  size_t stride = (((size_t)width * bitCount + 31) / 32) * 4;
+  size_t maskStride = MaskStride(width);
+  const uint8_t* pixels = image + offset;
+  const uint8_t* mask = pixels + stride * height;
+  bool hasMask = offset + stride * height + maskStride * height <= size;
+  if (offset + stride * height > size) {
+    return false;
+  }
+
+  bool alpha = false;
+  for (int y = 0; y < height; y++) {
+    const uint8_t* row = pixels + (size_t)(height - 1 - y) * stride;
+    uint8_t* out = bgra + (size_t)y * width * 4;
+    for (int x = 0; x < width; x++, out += 4) {
+      if (bitCount == 32) {
+        memcpy(out, row + x * 4, 4);
+        alpha = alpha || out[3] != 0;
+        continue;
+      }
+      if (bitCount == 24) {
+        memcpy(out, row + x * 3, 3);
+      } else {
+        int bitsPerPixel = bitCount;
+        int bit = x * bitsPerPixel;
+        uint32_t index = (row[bit / 8] >> (8 - bitsPerPixel - bit % 8)) & ((1u << bitsPerPixel) - 1);
+        if (index < colors) {
+          memcpy(out, palette + index * 4, 3);
+        } else {
+          memset(out, 0, 3);
+        }
+      }
+      out[3] = 255;
+    }
+  }
+
+  // Without per-pixel alpha the AND mask says which pixels are transparent
+  if (!alpha && hasMask) {
+    for (int y = 0; y < height; y++) {
+      const uint8_t* row = mask + (size_t)(height - 1 - y) * maskStride;
+      uint8_t* out = bgra + (size_t)y * width * 4;
+      for (int x = 0; x < width; x++) {
+        out[x * 4 + 3] = (row[x / 8] & (0x80 >> (x % 8))) ? 0 : 255;
+      }
+    }
+  } else if (!alpha) {
+    for (size_t i = 0; i < (size_t)width * height; i++) {
+      bgra[i * 4 + 3] = 255;
+    }
+  }
+  return true;
+}
+
+// Whether an image is a better pick than the current best for a preferred size
+static bool BetterImage(int width, int depth, int bestWidth, int bestDepth, int preferredSize) {
+  if (width == bestWidth) {
+    return depth > bestDepth;
+  }
+  bool fits = preferredSize > 0 && width >= preferredSize;
+  bool bestFits = preferredSize > 0 && bestWidth >= preferredSize;
+  if (fits && bestFits) {
+    return width < bestWidth;
+  }
+  if (fits != bestFits) {
+    return fits;
+  }
+  return width > bestWidth;
+}
+
+bool IcoToPng(uint8_t** data, size_t* dataSize, int preferredSize, int* width, int* height) {
+  const uint8_t* ico = *data;
+  size_t size = *dataSize;
+  if (ico == NULL || size < ICON_DIR_SIZE || ReadU16(ico + 2) != 1) {
+    return false;
+  }
+  uint16_t count = ReadU16(ico + 4);
+  if (size < ICON_DIR_SIZE + (size_t)count * ICON_ENTRY_SIZE) {
+    return false;
+  }
+
+  // Closest image to the preferred size, the deepest one on ties
+  const uint8_t* best = NULL;
+  size_t bestSize = 0;
+  int bestWidth = 0, bestHeight = 0, bestDepth = 0;
+  bool bestPng = false;
+  for (uint16_t i = 0; i < count; i++) {
+    const uint8_t* entry = ico + ICON_DIR_SIZE + (size_t)i * ICON_ENTRY_SIZE;
+    uint32_t length = ReadU32(entry + 8);
+    uint32_t offset = ReadU32(entry + 12);
+    if (offset > size || length > size - offset) {
+      continue;
+    }
+    int imageWidth, imageHeight;
+    bool isPng;
+    if (!IcoImageSize(ico + offset, length, &imageWidth, &imageHeight, &isPng)) {
+      continue;
+    }
+    int depth = isPng ? 32 : ReadU16(ico + offset + 14);
+    if (best == NULL || BetterImage(imageWidth, depth, bestWidth, bestDepth, preferredSize)) {
+      best = ico + offset;
+      bestSize = length;
+      bestWidth = imageWidth;
+      bestHeight = imageHeight;
+      bestDepth = depth;
+      bestPng = isPng;
+    }
+  }
+  if (best == NULL) {
+    return false;
+  }
+  *width = bestWidth;
+  *height = bestHeight;
+
+  // A PNG image moves to the front of the buffer it is already in
+  if (bestPng) {
+    memmove(*data, best, bestSize);
+    uint8_t* shrunk = (uint8_t*)realloc(*data, bestSize);
+    if (shrunk != NULL) {
+      *data = shrunk;
+    }
+    *dataSize = bestSize;
+    return true;
+  }
+
+  ImageFrame frame = { NULL, bestWidth, bestHeight, (size_t)bestWidth * 4 };
+  uint8_t* pixels = (uint8_t*)malloc(frame.stride * bestHeight);
+  if (pixels == NULL || !DecodeDib(best, bestSize, bestWidth, bestHeight, pixels)) {
+    free(pixels);
+    return false;
+  }
+  frame.pixels = pixels;
+
+  // Encode straight into the buffer that is returned
+  size_t pngSize = EncodedImageSize(&frame, 1, IMAGE_FORMAT_PNG);
+  uint8_t* png = pngSize > 0 ? (uint8_t*)malloc(pngSize) : NULL;
+  bool ok = png != NULL && EncodeImage(&frame, 1, IMAGE_FORMAT_PNG, png, pngSize);
+  free(pixels);
+  if (!ok) {
+    free(png);
+    return false;
+  }
+  free(*data);
+  *data = png;
+  *dataSize = pngSize;
+  return true;
+}
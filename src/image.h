@@ -0,0 +1,58 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  IMAGE_FORMAT_ICO = 0,
+  IMAGE_FORMAT_PNG = 1
+} ImageFormat;
+
+// Largest dimension an ICO entry can describe
+#define ICO_MAX_SIZE 256
+
+// 32-bit BGRA pixels (Windows DIB byte order), top-down rows
+typedef struct {
+  const uint8_t* pixels;
+  int width;
+  int height;
+  size_t stride;
+} ImageFrame;
+
+// Exact size of the encoded image, 0 if a frame cannot be encoded
+// ICO holds every frame (256 px ones as PNG, smaller ones as 32-bit DIBs
+// with an AND mask); PNG holds the first frame only
+size_t EncodedImageSize(const ImageFrame* frames, int count, ImageFormat format);
+
+// Encode frames into a buffer of EncodedImageSize bytes
+// PNG data is written uncompressed (stored deflate blocks): icons are small
+// and this keeps encoding a straight copy
+bool EncodeImage(const ImageFrame* frames, int count, ImageFormat format, uint8_t* out, size_t size);
+
+// Convert a malloc'ed ICO file to a PNG of one of its images: the smallest
+// one at least preferredSize wide, else the largest (preferredSize 0: the largest)
+// PNG entries are moved to the front of the buffer and kept as is, DIB
+// entries (1 to 32 bits) are decoded and encoded into a new buffer that
+// replaces the ICO one
+// Returns false, leaving the buffer alone, if the file has no usable image
+bool IcoToPng(uint8_t** data, size_t* size, int preferredSize, int* width, int* height);
+
+// Pixel kernels (SSE2 on x86, NEON on ARM, scalar otherwise)
+// Swap BGRA to RGBA, src and dst may be the same
+void BgraToRgba(const uint8_t* src, uint8_t* dst, size_t count);
+
+// Build one row of an ICO AND mask: bit set (MSB first) where alpha < 128
+// mask must hold (width + 7) / 8 bytes
+void AlphaToMask(const uint8_t* bgra, uint8_t* mask, size_t width);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMAGE_H
@@ -0,0 +1,211 @@
+#include "injector.h"
+#include "log.h"
+#include "threads.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct InjectorRequest {
+  InjectorRun run;
+  InjectorResolve resolve;
+  InjectorRelease release;
+  void* data;
+  uint64_t deadline;        // Monotonic milliseconds, 0 if none
+  uint32_t result;
+  napi_deferred deferred;
+  struct InjectorRequest* next;
+} InjectorRequest;
+
+static bool g_initialized = false;
+static bool g_stop = false;
+static Mutex g_mutex;
+static Condition g_condition;
+static Thread g_thread;
+static InjectorRequest* g_head = NULL;
+static InjectorRequest* g_tail = NULL;
+static napi_threadsafe_function g_tsfn = NULL;
+static uint32_t g_pending = 0; // Only touched on the JS thread
+
+static void FreeRequest(InjectorRequest* request) {
+  if (request->release) {
+    request->release(request->data);
+  }
+  free(request);
+}
+
+// Resolve the promise on the JS thread
+static void CompleteRequest(napi_env env, napi_value js_callback, void* context, void* data) {
+  (void)js_callback;
+  (void)context;
+
+  InjectorRequest* request = (InjectorRequest*)data;
+  if (env != NULL) {
+    napi_value result = NULL;
+    if (request->resolve != NULL) {
+      result = request->resolve(env, request->data, request->result);
+    }
+    if (result == NULL) {
+      napi_create_uint32(env, request->result, &result);
+    }
+    napi_resolve_deferred(env, request->deferred, result);
+
+    // Let the process exit once nothing is in flight
+    if (--g_pending == 0) {
+      napi_unref_threadsafe_function(env, g_tsfn);
+    }
+  }
+
+  FreeRequest(request);
+}
+
+static THREAD_PROC(InjectorThread) {
+  (void)arg;
+
+  MutexLock(&g_mutex);
+  for (;;) {
+    while (g_head == NULL && !g_stop) {
+      ConditionWait(&g_condition, &g_mutex);
+    }
+    if (g_stop) {
+      break;
+    }
+
+    InjectorRequest* request = g_head;
+    g_head = request->next;
+    if (g_head == NULL) {
+      g_tail = NULL;
+    }
+    MutexUnlock(&g_mutex);
+
+    // Requests that waited in the queue past their deadline are not run at all
+    uint32_t remaining = INJECTOR_NO_TIMEOUT;
+    if (request->deadline != 0) {
+      uint64_t now = MonotonicMillis();
+      remaining = now < request->deadline ? (uint32_t)(request->deadline - now) : 0;
+    }
+    if (remaining == 0) {
+      request->result = INJECTOR_TIMED_OUT;
+    } else {
+      request->result = request->run(request->data, remaining);
+    }
+
+    if (napi_call_threadsafe_function(g_tsfn, request, napi_tsfn_blocking) != napi_ok) {
+      FreeRequest(request);
+    }
+
+    MutexLock(&g_mutex);
+  }
+  MutexUnlock(&g_mutex);
+
+  THREAD_RETURN;
+}
+
+static void Shutdown(void* arg) {
+  (void)arg;
+
+  MutexLock(&g_mutex);
+  g_stop = true;
+  ConditionSignal(&g_condition);
+  MutexUnlock(&g_mutex);
+  ThreadJoin(g_thread);
+
+  // Drop whatever was still queued: the environment is going away
+  while (g_head != NULL) {
+    InjectorRequest* request = g_head;
+    g_head = request->next;
+    FreeRequest(request);
+  }
+  g_tail = NULL;
+
+  napi_release_threadsafe_function(g_tsfn, napi_tsfn_abort);
+  g_tsfn = NULL;
+  g_initialized = false;
+}
+
+static bool Initialize(napi_env env) {
+  if (g_initialized) {
+    return true;
+  }
+
+  napi_value resourceName;
+  napi_create_string_utf8(env, "Injector", NAPI_AUTO_LENGTH, &resourceName);
+
+  napi_status status = napi_create_threadsafe_function(
+    env,
+    NULL,                    // no JS function: CompleteRequest resolves promises
+    NULL,                    // async_resource
+    resourceName,            // async_resource_name
+    0,                       // max_queue_size (0 = unlimited)
+    1,                       // initial_thread_count
+    NULL,                    // thread_finalize_data
+    NULL,                    // thread_finalize_cb
+    NULL,                    // context
+    CompleteRequest,         // call_js_cb
+    &g_tsfn
+  );
+
+  if (status != napi_ok) {
+    LOG_ERROR("injector", "Failed to create threadsafe function");
+    return false;
+  }
+  napi_unref_threadsafe_function(env, g_tsfn);
+
+  MutexInit(&g_mutex);
+  ConditionInit(&g_condition);
+  g_stop = false;
+
+  if (!ThreadCreate(&g_thread, InjectorThread, NULL)) {
+    LOG_ERROR("injector", "Failed to create injector thread");
+    napi_release_threadsafe_function(g_tsfn, napi_tsfn_abort);
+    g_tsfn = NULL;
+    return false;
+  }
+
+  napi_add_env_cleanup_hook(env, Shutdown, NULL);
+  g_initialized = true;
+  return true;
+}
+
+napi_value InjectorQueue(napi_env env, InjectorRun run, InjectorRelease release, void* data, uint32_t timeoutMs) {
+  return InjectorQueueEx(env, run, NULL, release, data, timeoutMs);
+}
+
+napi_value InjectorQueueEx(napi_env env, InjectorRun run, InjectorResolve resolve, InjectorRelease release, void* data, uint32_t timeoutMs) {
+  if (!Initialize(env)) {
+    if (release) release(data);
+    napi_throw_error(env, NULL, "Failed to start injector thread");
+    return NULL;
+  }
+
+  InjectorRequest* request = (InjectorRequest*)calloc(1, sizeof(InjectorRequest));
+  if (request == NULL) {
+    if (release) release(data);
+    napi_throw_error(env, NULL, "Out of memory");
+    return NULL;
+  }
+
+  request->run = run;
+  request->resolve = resolve;
+  request->release = release;
+  request->data = data;
+  request->deadline = timeoutMs == INJECTOR_NO_TIMEOUT ? 0 : MonotonicMillis() + timeoutMs;
+
+  napi_value promise;
+  napi_create_promise(env, &request->deferred, &promise);
+
+  // Keep the process alive until the promise settles
+  if (g_pending++ == 0) {
+    napi_ref_threadsafe_function(env, g_tsfn);
+  }
+
+  MutexLock(&g_mutex);
+  if (g_tail != NULL) {
+    g_tail->next = request;
+  } else {
+    g_head = request;
+  }
+  g_tail = request;
+  ConditionSignal(&g_condition);
+  MutexUnlock(&g_mutex);
+
+  return promise;
+}
@@ -0,0 +1,40 @@
+#ifndef INJECTOR_H
+#define INJECTOR_H
+
+#include <node_api.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define INJECTOR_NO_TIMEOUT UINT32_MAX
+
+// Result code used when a request expires before it could run
+// Matches the SendKey "keys still pressed after timeout" code
+#define INJECTOR_TIMED_OUT 2
+
+// Work function run on the injector thread
+// timeoutMs is the time left before the request deadline (INJECTOR_NO_TIMEOUT if none)
+typedef uint32_t (*InjectorRun)(void* data, uint32_t timeoutMs);
+
+// Called once the request is done (or dropped) to free its data
+typedef void (*InjectorRelease)(void* data);
+
+// Build the value a request resolves with, on the JS thread
+// Used by requests that report more than a result code
+typedef napi_value (*InjectorResolve)(napi_env env, void* data, uint32_t result);
+
+// Queue a request on the injector thread
+// Requests run one at a time in submission order
+// Returns a promise resolving with the result code of the request
+napi_value InjectorQueue(napi_env env, InjectorRun run, InjectorRelease release, void* data, uint32_t timeoutMs);
+
+// Same as InjectorQueue with a custom resolution value
+napi_value InjectorQueueEx(napi_env env, InjectorRun run, InjectorResolve resolve, InjectorRelease release, void* data, uint32_t timeoutMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INJECTOR_H
@@ -0,0 +1,90 @@
+// External strings are still experimental in Node-API: only this file opts in,
+// the module itself keeps its stable Node-API version
+#define NAPI_EXPERIMENTAL
+#define NODE_API_EXPERIMENTAL_NOGC_ENV_OPT_OUT
+#define NODE_API_EXPERIMENTAL_BASIC_ENV_OPT_OUT
+
+#include "jsstring.h"
+#include "log.h"
+#include <stdbool.h>
+#include <stdlib.h>
+
+#ifdef NODE_API_EXPERIMENTAL_HAS_EXTERNAL_STRINGS
+
+static void FreeExternalText(napi_env env, void* data, void* hint) {
+  (void)env;
+  (void)hint;
+  free(data);
+}
+
+static bool IsAscii(const unsigned char* text, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    if (text[i] & 0x80) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Try to give the buffer to V8, returns NULL if the string must be copied
+static napi_value CreateExternal(napi_env env, SelectedText* text) {
+  napi_value value = NULL;
+  bool copied = true;
+  napi_status status = napi_generic_failure;
+
+  if (text->encoding == SELECTED_TEXT_UTF16) {
+    status = node_api_create_external_string_utf16(env, (char16_t*)text->data, text->length,
+                                                   FreeExternalText, NULL, &value, &copied);
+  } else if (text->encoding == SELECTED_TEXT_LATIN1 || IsAscii((const unsigned char*)text->data, text->length)) {
+    // ASCII is valid Latin-1: no UTF-8 decoding needed
+    status = node_api_create_external_string_latin1(env, (char*)text->data, text->length,
+                                                    FreeExternalText, NULL, &value, &copied);
+  }
+
+  if (status != napi_ok) {
+    return NULL;
+  }
+
+  // Either way the buffer is gone from here: a copying engine has already
+  // run the finalizer, otherwise the finalizer owns it
+  text->data = NULL;
+  text->length = 0;
+  LOG_DEBUG("jsstring", "External string (copied: %d)", copied);
+  return value;
+}
+
+#endif
+
+napi_value CreateSelectedTextValue(napi_env env, SelectedText* text) {
+  napi_value value = NULL;
+  if (text->data == NULL) {
+    napi_create_string_utf8(env, "", 0, &value);
+    return value;
+  }
+
+  size_t bytes = text->length * (text->encoding == SELECTED_TEXT_UTF16 ? 2 : 1);
+#ifdef NODE_API_EXPERIMENTAL_HAS_EXTERNAL_STRINGS
+  if (bytes >= EXTERNAL_STRING_MIN_BYTES) {
+    value = CreateExternal(env, text);
+    if (value != NULL) {
+      return value;
+    }
+  }
+#else
+  (void)bytes;
+#endif
+
+  switch (text->encoding) {
+    case SELECTED_TEXT_UTF16:
+      napi_create_string_utf16(env, (const char16_t*)text->data, text->length, &value);
+      break;
+    case SELECTED_TEXT_LATIN1:
+      napi_create_string_latin1(env, (const char*)text->data, text->length, &value);
+      break;
+    default:
+      napi_create_string_utf8(env, (const char*)text->data, text->length, &value);
+      break;
+  }
+  FreeSelectedText(text);
+  return value;
+}
@@ -0,0 +1,24 @@
+#ifndef JSSTRING_H
+#define JSSTRING_H
+
+#include <node_api.h>
+#include "selection.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Texts from this size (in bytes) are handed to V8 without a copy when possible
+#define EXTERNAL_STRING_MIN_BYTES (64 * 1024)
+
+// Create a JS string from selected text, converting straight from the source encoding
+// Large UTF-16 and Latin-1 (or pure ASCII) texts become external strings that
+// keep the buffer, otherwise the text is copied.
+// Takes ownership of the text buffer in all cases
+napi_value CreateSelectedTextValue(napi_env env, SelectedText* text);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JSSTRING_H
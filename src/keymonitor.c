@@ -1,4 +1,6 @@
 #include "keymonitor.h"
+#include "log.h"
+#include "keystate.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -22,6 +24,7 @@
 #include <linux/input.h>
 #include <sys/select.h>
 #include <errno.h>
+#include "uinput.h"
 #endif
 
 // Thread-safe function for calling back to JavaScript
@@ -90,6 +93,22 @@ static void CallJS(napi_env env, napi_value js_callback, void* context, void* da
   free(event);
 }
 
+// Work out whether a modifier went down or up from the device-dependent flag bits
+static bool IsModifierDown(uint16_t keyCode, CGEventFlags flags) {
+  switch (keyCode) {
+    case 56: return (flags & 0x00000002) != 0; // Left Shift
+    case 60: return (flags & 0x00000004) != 0; // Right Shift
+    case 59: return (flags & 0x00000001) != 0; // Left Control
+    case 62: return (flags & 0x00002000) != 0; // Right Control
+    case 58: return (flags & 0x00000020) != 0; // Left Option
+    case 61: return (flags & 0x00000040) != 0; // Right Option
+    case 55: return (flags & 0x00000008) != 0; // Left Command
+    case 54: return (flags & 0x00000010) != 0; // Right Command
+    case 63: return (flags & kCGEventFlagMaskSecondaryFn) != 0;
+    default: return false; // Caps Lock is a toggle, never held
+  }
+}
+
 // CGEventTap callback - runs on the event tap thread
 static CGEventRef EventTapCallback(CGEventTapProxy proxy, CGEventType type, CGEventRef event, void* refcon) {
   (void)proxy;
@@ -133,6 +152,13 @@ static CGEventRef EventTapCallback(CGEventTapProxy proxy, CGEventType type, CGEv
   keyEvent->flags = (uint64_t)CGEventGetFlags(event);
   keyEvent->isRepeat = CGEventGetIntegerValueField(event, kCGKeyboardEventAutorepeat) != 0;
 
+  // Keep the shared pressed-key bitmap current
+  if (type == kCGEventFlagsChanged) {
+    KeyStateUpdate(keyEvent->keyCode, IsModifierDown(keyEvent->keyCode, (CGEventFlags)keyEvent->flags));
+  } else {
+    KeyStateUpdate(keyEvent->keyCode, type == kCGEventKeyDown);
+  }
+
   // Queue the call to JavaScript
   if (g_tsfn != NULL) {
     napi_call_threadsafe_function(g_tsfn, keyEvent, napi_tsfn_nonblocking);
@@ -180,7 +206,7 @@ int StartKeyMonitor(napi_env env, napi_value callback) {
   );
 
   if (status != napi_ok) {
-    printf("Failed to create threadsafe function\n");
+    LOG_ERROR("keymonitor", "Failed to create threadsafe function");
     return 2;
   }
 
@@ -199,7 +225,7 @@ int StartKeyMonitor(napi_env env, napi_value callback) {
   );
 
   if (g_eventTap == NULL) {
-    printf("Failed to create event tap. Make sure accessibility permissions are granted.\n");
+    LOG_ERROR("keymonitor", "Failed to create event tap. Make sure accessibility permissions are granted.");
     napi_release_threadsafe_function(g_tsfn, napi_tsfn_abort);
     g_tsfn = NULL;
     return 3;
@@ -208,7 +234,7 @@ int StartKeyMonitor(napi_env env, napi_value callback) {
   // Create run loop source
   g_runLoopSource = CFMachPortCreateRunLoopSource(kCFAllocatorDefault, g_eventTap, 0);
   if (g_runLoopSource == NULL) {
-    printf("Failed to create run loop source\n");
+    LOG_ERROR("keymonitor", "Failed to create run loop source");
     CFRelease(g_eventTap);
     g_eventTap = NULL;
     napi_release_threadsafe_function(g_tsfn, napi_tsfn_abort);
@@ -218,10 +244,12 @@ int StartKeyMonitor(napi_env env, napi_value callback) {
 
   // Enable the event tap
   CGEventTapEnable(g_eventTap, true);
+  KeyStateSetTracking(true);
 
   // Start the thread
   if (pthread_create(&g_thread, NULL, EventTapThread, NULL) != 0) {
-    printf("Failed to create event tap thread\n");
+    LOG_ERROR("keymonitor", "Failed to create event tap thread");
+    KeyStateSetTracking(false);
     CFRelease(g_runLoopSource);
     g_runLoopSource = NULL;
     CFRelease(g_eventTap);
@@ -250,6 +278,7 @@ int StopKeyMonitor(void) {
 
   // Wait for thread to finish
   pthread_join(g_thread, NULL);
+  KeyStateSetTracking(false);
 
   // Clean up event tap
   if (g_eventTap != NULL) {
@@ -352,8 +381,10 @@ static LRESULT CALLBACK LowLevelKeyboardProc(int nCode, WPARAM wParam, LPARAM lP
         return CallNextHookEx(g_hook, nCode, wParam, lParam);
       }
       g_keyState[vkCode] = true;
+      KeyStateUpdate(vkCode, true);
     } else if (wParam == WM_KEYUP || wParam == WM_SYSKEYUP) {
       g_keyState[vkCode] = false;
+      KeyStateUpdate(vkCode, false);
     }
 
     KeyEvent* keyEvent = (KeyEvent*)malloc(sizeof(KeyEvent));
@@ -390,7 +421,7 @@ static DWORD WINAPI HookThread(LPVOID lpParam) {
   // Install the hook on this thread
   g_hook = SetWindowsHookEx(WH_KEYBOARD_LL, LowLevelKeyboardProc, NULL, 0);
   if (g_hook == NULL) {
-    printf("Failed to install keyboard hook\n");
+    LOG_ERROR("keymonitor", "Failed to install keyboard hook");
     return 1;
   }
 
@@ -434,14 +465,16 @@ int StartKeyMonitor(napi_env env, napi_value callback) {
   );
 
   if (status != napi_ok) {
-    printf("Failed to create threadsafe function\n");
+    LOG_ERROR("keymonitor", "Failed to create threadsafe function");
     return 2;
   }
 
   // Create thread for message loop
+  KeyStateSetTracking(true);
   g_thread = CreateThread(NULL, 0, HookThread, NULL, 0, &g_threadId);
   if (g_thread == NULL) {
-    printf("Failed to create hook thread\n");
+    LOG_ERROR("keymonitor", "Failed to create hook thread");
+    KeyStateSetTracking(false);
     napi_release_threadsafe_function(g_tsfn, napi_tsfn_abort);
     g_tsfn = NULL;
     return 3;
@@ -473,6 +506,7 @@ int StopKeyMonitor(void) {
     g_thread = NULL;
     g_threadId = 0;
   }
+  KeyStateSetTracking(false);
 
   // Release threadsafe function
   if (g_tsfn != NULL) {
@@ -579,6 +613,12 @@ static uint64_t GetModifierFlag(int keycode) {
   }
 }
 
+// Check if a device is one of our own uinput devices
+static bool IsOwnDevice(struct libevdev *dev) {
+  const char *name = libevdev_get_name(dev);
+  return name != NULL && strncmp(name, UINPUT_DEVICE_PREFIX, strlen(UINPUT_DEVICE_PREFIX)) == 0;
+}
+
 // Find a keyboard device
 static int FindKeyboardDevice(char *path, size_t path_size) {
   DIR *dir;
@@ -597,7 +637,8 @@ static int FindKeyboardDevice(char *path, size_t path_size) {
         fd = open(device_path, O_RDONLY | O_NONBLOCK);
         if (fd >= 0) {
           if (libevdev_new_from_fd(fd, &dev) == 0) {
-            if (libevdev_has_event_type(dev, EV_KEY) &&
+            if (!IsOwnDevice(dev) &&
+                libevdev_has_event_type(dev, EV_KEY) &&
                 libevdev_has_event_code(dev, EV_KEY, KEY_A)) {
               libevdev_free(dev);
               close(fd);
@@ -634,7 +675,8 @@ static int FindKeyboardDevice(char *path, size_t path_size) {
 
     if (libevdev_new_from_fd(fd, &dev) == 0) {
       // Check if this device has keyboard keys
-      if (libevdev_has_event_type(dev, EV_KEY) &&
+      if (!IsOwnDevice(dev) &&
+          libevdev_has_event_type(dev, EV_KEY) &&
           libevdev_has_event_code(dev, EV_KEY, KEY_A) &&
           libevdev_has_event_code(dev, EV_KEY, KEY_Z)) {
         libevdev_free(dev);
@@ -713,6 +755,11 @@ static void* KeyboardThread(void* arg) {
           keyEvent->keyCode = (uint16_t)ev.code;
           keyEvent->flags = g_modifier_flags;
 
+          // Keep the shared pressed-key bitmap current (repeats change nothing)
+          if (ev.value != 2) {
+            KeyStateUpdate(ev.code, ev.value == 1);
+          }
+
           if (g_tsfn != NULL) {
             napi_call_threadsafe_function(g_tsfn, keyEvent, napi_tsfn_nonblocking);
           } else {
@@ -730,32 +777,29 @@ static void* KeyboardThread(void* arg) {
 }
 
 int StartKeyMonitor(napi_env env, napi_value callback) {
-  fprintf(stderr, "[keymonitor] StartKeyMonitor called, g_running=%d\n", g_running); fflush(stderr);
   if (g_running) {
-    fprintf(stderr, "[keymonitor] Already running, returning 1\n"); fflush(stderr);
+    LOG_DEBUG("keymonitor", "Already running");
     return 1; // Already running
   }
 
   // Find keyboard device
   char device_path[512];
-  fprintf(stderr, "[keymonitor] Looking for keyboard device...\n"); fflush(stderr);
   if (FindKeyboardDevice(device_path, sizeof(device_path)) != 0) {
-    fprintf(stderr, "[keymonitor] Failed to find keyboard device. Make sure you have permission to access /dev/input devices.\n"); fflush(stderr);
+    LOG_ERROR("keymonitor", "Failed to find keyboard device. Make sure you have permission to access /dev/input devices.");
     return 3;
   }
-  fprintf(stderr, "[keymonitor] Found keyboard device: %s\n", device_path); fflush(stderr);
+  LOG_INFO("keymonitor", "Found keyboard device: %s", device_path);
 
   // Open the device (non-blocking for select-based reading)
   g_fd = open(device_path, O_RDONLY | O_NONBLOCK);
   if (g_fd < 0) {
-    fprintf(stderr, "[keymonitor] Failed to open keyboard device: %s (errno=%d)\n", device_path, errno); fflush(stderr);
+    LOG_ERROR("keymonitor", "Failed to open keyboard device: %s (errno=%d)", device_path, errno);
     return 3;
   }
-  fprintf(stderr, "[keymonitor] Opened device fd=%d\n", g_fd); fflush(stderr);
 
   // Create libevdev instance
   if (libevdev_new_from_fd(g_fd, &g_evdev) != 0) {
-    printf("Failed to create libevdev instance\n");
+    LOG_ERROR("keymonitor", "Failed to create libevdev instance");
     close(g_fd);
     g_fd = -1;
     return 3;
@@ -780,7 +824,7 @@ int StartKeyMonitor(napi_env env, napi_value callback) {
   );
 
   if (status != napi_ok) {
-    printf("Failed to create threadsafe function\n");
+    LOG_ERROR("keymonitor", "Failed to create threadsafe function");
     libevdev_free(g_evdev);
     g_evdev = NULL;
     close(g_fd);
@@ -790,10 +834,12 @@ int StartKeyMonitor(napi_env env, napi_value callback) {
 
   g_stop_requested = false;
   g_modifier_flags = 0;
+  KeyStateSetTracking(true);
 
   // Start the thread
   if (pthread_create(&g_thread, NULL, KeyboardThread, NULL) != 0) {
-    printf("Failed to create keyboard thread\n");
+    LOG_ERROR("keymonitor", "Failed to create keyboard thread");
+    KeyStateSetTracking(false);
     napi_release_threadsafe_function(g_tsfn, napi_tsfn_abort);
     g_tsfn = NULL;
     libevdev_free(g_evdev);
@@ -804,14 +850,13 @@ int StartKeyMonitor(napi_env env, napi_value callback) {
   }
 
   g_running = true;
-  printf("[keymonitor] Started successfully\n");
+  LOG_INFO("keymonitor", "Started");
   return 0;
 }
 
 int StopKeyMonitor(void) {
-  printf("[keymonitor] StopKeyMonitor called, g_running=%d\n", g_running);
   if (!g_running) {
-    printf("[keymonitor] Not running, returning 1\n");
+    LOG_DEBUG("keymonitor", "Not running");
     return 1; // Not running
   }
 
@@ -820,6 +865,7 @@ int StopKeyMonitor(void) {
 
   // Wait for thread to finish
   pthread_join(g_thread, NULL);
+  KeyStateSetTracking(false);
 
   // Clean up libevdev
   if (g_evdev != NULL) {
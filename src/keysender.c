@@ -1,4 +1,7 @@
 #include "keysender.h"
+#include "log.h"
+#include "keytable.h"
+#include "keystate.h"
 #include <string.h>
 #include <stdio.h>
 
@@ -6,56 +9,59 @@
 #include <windows.h>
 #elif defined(__APPLE__)
 #include <ApplicationServices/ApplicationServices.h>
+#elif defined(__linux__)
+#include "uinput.h"
+#endif
+
+#ifdef _WIN32
+
+// Keys that live on the extended part of the keyboard
+static bool IsExtendedKey(uint16_t nativeCode)
+{
+  if (nativeCode & KEY_EXTENDED) {
+    return true;
+  }
+  switch (nativeCode) {
+    case VK_INSERT: case VK_DELETE: case VK_HOME: case VK_END:
+    case VK_PRIOR: case VK_NEXT: case VK_LEFT: case VK_RIGHT:
+    case VK_UP: case VK_DOWN: case VK_DIVIDE: case VK_NUMLOCK:
+    case VK_RCONTROL: case VK_RMENU: case VK_LWIN: case VK_RWIN:
+    case VK_APPS: case VK_SNAPSHOT:
+      return true;
+    default:
+      return false;
+  }
+}
+
 #endif
 
 uint32_t SendKey(const char *key, bool useModifier)
 {
-#ifdef _WIN32
-  
-  BYTE keyCode = 0;
-  if (strcmp(key, "A") == 0) {
-    keyCode = 0x41; // VK_A
-  } else if (strcmp(key, "C") == 0) {
-    keyCode = 0x43; // VK_C
-  } else if (strcmp(key, "V") == 0) {
-    keyCode = 0x56; // VK_V
-  } else if (strcmp(key, "Delete") == 0) {
-    keyCode = VK_DELETE; // VK_DELETE
-  } else if (strcmp(key, "Enter") == 0) {
-    keyCode = VK_RETURN; // VK_RETURN
-  } else if (strcmp(key, "Down") == 0) {
-    keyCode = VK_DOWN; // VK_DOWN
-  } else {
-    printf("Unrecognized key: %s\n", key);
+  return SendKeyWithTimeout(key, useModifier, SEND_KEY_RELEASE_TIMEOUT_MS);
+}
+
+uint32_t SendKeyWithTimeout(const char *key, bool useModifier, uint32_t timeoutMs)
+{
+  // Resolve the key name for this platform
+  uint16_t nativeCode = NativeKeyCode(LookupKey(key));
+  if (nativeCode == KEY_UNMAPPED) {
+    LOG_WARN("keysender", "Unrecognized key: %s", key);
     return 1; // Error: Unsupported key
   }
 
   // before sending input, wait for existing key presses to be released
-  const int MAX_ATTEMPTS = 50; // 50 * 10ms = 500ms timeout
-  BOOL keysPressed = TRUE;
-  int attempts = 0;
-  
-  while (keysPressed && attempts < MAX_ATTEMPTS) {
-    keysPressed = FALSE;
-    for (int i = 0; i < 256; i++) {
-      if (GetAsyncKeyState(i) & 0x8000) {
-        keysPressed = TRUE;
-        break;
-      }
-    }
-    
-    if (keysPressed) {
-      Sleep(10);
-      attempts++;
-    }
-  }
-  
-  if (keysPressed) {
-    printf("Failed: keys still pressed after timeout\n");
+  // (wakes up as soon as the key monitor sees the last release)
+  if (!WaitForKeysReleased(KEYSTATE_ALL_KEYS, timeoutMs)) {
+    LOG_WARN("keysender", "Keys still pressed after timeout");
     return 2;  // Keys still pressed after timeout
   }
 
-  printf("Sending key: %s%s\n", useModifier ? "Ctrl+" : "", key);
+#ifdef _WIN32
+  
+  WORD keyCode = KEY_VIRTUAL_KEY(nativeCode);
+  DWORD extended = IsExtendedKey(nativeCode) ? KEYEVENTF_EXTENDEDKEY : 0;
+
+  LOG_DEBUG("keysender", "Sending key: %s%s", useModifier ? "Ctrl+" : "", key);
 
   // make sure window is active
   HWND hwnd = GetForegroundWindow();
@@ -65,7 +71,7 @@ uint32_t SendKey(const char *key, bool useModifier)
   int numInputs = useModifier ? 4 : 2;
   INPUT* inputs = (INPUT*)malloc(numInputs * sizeof(INPUT));
   if (inputs == NULL) {
-    printf("Failed to allocate memory for inputs\n");
+    LOG_ERROR("keysender", "Failed to allocate memory for inputs");
     return 9;
   }
   memset(inputs, 0, numInputs * sizeof(INPUT));
@@ -91,7 +97,7 @@ uint32_t SendKey(const char *key, bool useModifier)
   inputs[index].type = INPUT_KEYBOARD;
   inputs[index].ki.wVk = keyCode;
   inputs[index].ki.wScan = scanKey;
-  inputs[index].ki.dwFlags = 0;
+  inputs[index].ki.dwFlags = extended;
   inputs[index].ki.time = 0;
   inputs[index].ki.dwExtraInfo = 0;
   index++;
@@ -111,37 +117,19 @@ uint32_t SendKey(const char *key, bool useModifier)
   inputs[index].type = INPUT_KEYBOARD;
   inputs[index].ki.wVk = keyCode;
   inputs[index].ki.wScan = scanKey;
-  inputs[index].ki.dwFlags = KEYEVENTF_KEYUP;
+  inputs[index].ki.dwFlags = KEYEVENTF_KEYUP | extended;
   inputs[index].ki.time = 0;
   inputs[index].ki.dwExtraInfo = 0;
 
   UINT numSent = SendInput(numInputs, inputs, sizeof(INPUT));
-  printf("Sent keys: %d\n", numSent);
+  LOG_DEBUG("keysender", "Sent keys: %u", numSent);
   
   free(inputs);
   return numSent == numInputs ? 0 : 3;
 
 #elif defined(__APPLE__)
-  CGKeyCode keyCode;
-
-  // Define key codes for macOS
-  if (strcmp(key, "A") == 0) {
-    keyCode = 0; // A key on macOS
-  } else if (strcmp(key, "C") == 0) {
-    keyCode = 8; // C key on macOS
-  } else if (strcmp(key, "V") == 0) {
-    keyCode = 9; // V key on macOS
-  } else if (strcmp(key, "Delete") == 0) {
-    keyCode = 51; // Delete key on macOS
-  } else if (strcmp(key, "Enter") == 0) {
-    keyCode = 36; // Return key on macOS
-  } else if (strcmp(key, "Down") == 0) {
-    keyCode = 125; // Down arrow key on macOS
-  } else {
-    printf("Unrecognized key: %s\n", key);
-    return 1; // Error: Unsupported key
-  }
-  
+  CGKeyCode keyCode = nativeCode;
+
   // Get the current event source
   CGEventSourceRef sourceRef = CGEventSourceCreate(kCGEventSourceStateHIDSystemState);
 
@@ -167,8 +155,112 @@ uint32_t SendKey(const char *key, bool useModifier)
 
   return 0; // Success
 
+#elif defined(__linux__)
+
+  // Inject through the persistent virtual keyboard (Ctrl as modifier)
+  int fd = UInputKeyboard();
+  if (fd < 0) {
+    LOG_WARN("keysender", "Failed to open /dev/uinput");
+    return 1;
+  }
+
+  struct input_event events[8];
+  size_t count = 0;
+  if (useModifier) {
+    UInputEvent(&events[count++], EV_KEY, KEY_LEFTCTRL, 1);
+    UInputEvent(&events[count++], EV_SYN, SYN_REPORT, 0);
+  }
+  UInputEvent(&events[count++], EV_KEY, nativeCode, 1);
+  UInputEvent(&events[count++], EV_SYN, SYN_REPORT, 0);
+  UInputEvent(&events[count++], EV_KEY, nativeCode, 0);
+  UInputEvent(&events[count++], EV_SYN, SYN_REPORT, 0);
+  if (useModifier) {
+    UInputEvent(&events[count++], EV_KEY, KEY_LEFTCTRL, 0);
+    UInputEvent(&events[count++], EV_SYN, SYN_REPORT, 0);
+  }
+
+  return UInputWrite(fd, events, count) == 0 ? 0 : 3;
+
+#else
+  // For other platforms, just return an error without doing anything
+  (void)nativeCode;
+  return 1;
+#endif
+}
+
+uint32_t InjectKeyTransition(uint16_t nativeCode, bool down, bool useModifier)
+{
+  if (nativeCode == KEY_UNMAPPED) {
+    return 1;
+  }
+
+#ifdef _WIN32
+
+  INPUT inputs[2];
+  UINT count = 0;
+  memset(inputs, 0, sizeof(inputs));
+
+  // The modifier wraps the key: pressed first, released last
+  if (useModifier && down) {
+    inputs[count].type = INPUT_KEYBOARD;
+    inputs[count].ki.wVk = VK_CONTROL;
+    inputs[count].ki.wScan = MapVirtualKey(VK_CONTROL, 0);
+    count++;
+  }
+
+  inputs[count].type = INPUT_KEYBOARD;
+  inputs[count].ki.wVk = KEY_VIRTUAL_KEY(nativeCode);
+  inputs[count].ki.wScan = MapVirtualKey(KEY_VIRTUAL_KEY(nativeCode), 0);
+  inputs[count].ki.dwFlags = (down ? 0 : KEYEVENTF_KEYUP) | (IsExtendedKey(nativeCode) ? KEYEVENTF_EXTENDEDKEY : 0);
+  count++;
+
+  if (useModifier && !down) {
+    inputs[count].type = INPUT_KEYBOARD;
+    inputs[count].ki.wVk = VK_CONTROL;
+    inputs[count].ki.wScan = MapVirtualKey(VK_CONTROL, 0);
+    inputs[count].ki.dwFlags = KEYEVENTF_KEYUP;
+    count++;
+  }
+
+  return SendInput(count, inputs, sizeof(INPUT)) == count ? 0 : 3;
+
+#elif defined(__APPLE__)
+
+  CGEventSourceRef sourceRef = CGEventSourceCreate(kCGEventSourceStateHIDSystemState);
+  CGEventRef event = CGEventCreateKeyboardEvent(sourceRef, nativeCode, down);
+  if (useModifier) {
+    CGEventSetFlags(event, kCGEventFlagMaskCommand);
+  }
+  CGEventPost(kCGHIDEventTap, event);
+  CFRelease(event);
+  if (sourceRef) CFRelease(sourceRef);
+  return 0;
+
+#elif defined(__linux__)
+
+  int fd = UInputKeyboard();
+  if (fd < 0) {
+    return 1;
+  }
+
+  struct input_event events[4];
+  size_t count = 0;
+  if (useModifier && down) {
+    UInputEvent(&events[count++], EV_KEY, KEY_LEFTCTRL, 1);
+    UInputEvent(&events[count++], EV_SYN, SYN_REPORT, 0);
+  }
+  UInputEvent(&events[count++], EV_KEY, nativeCode, down ? 1 : 0);
+  UInputEvent(&events[count++], EV_SYN, SYN_REPORT, 0);
+  if (useModifier && !down) {
+    UInputEvent(&events[count++], EV_KEY, KEY_LEFTCTRL, 0);
+    UInputEvent(&events[count++], EV_SYN, SYN_REPORT, 0);
+  }
+
+  return UInputWrite(fd, events, count) == 0 ? 0 : 3;
+
 #else
-  // For other platforms, just return success without doing anything
+  (void)down;
+  (void)useModifier;
   return 1;
 #endif
 }
@@ -8,9 +8,24 @@
 extern "C" {
 #endif
 
-// Send a key with optional modifier (Ctrl on Windows, Command on macOS)
+// Send a key with optional modifier (Ctrl on Windows and Linux, Command on macOS)
+// Key names are resolved through the shared key table (see keytable.def)
 uint32_t SendKey(const char *key, bool useModifier);
 
+// How long SendKey waits for pressed keys to be released before giving up
+// (see WaitForKeysReleased in keystate.h)
+#define SEND_KEY_RELEASE_TIMEOUT_MS 500
+
+// Same as SendKey with an explicit limit on the key release wait
+// Returns 2 if keys are still pressed when the timeout expires
+uint32_t SendKeyWithTimeout(const char *key, bool useModifier, uint32_t timeoutMs);
+
+// Inject a single key transition immediately, without waiting for pressed keys
+// nativeCode comes from NativeKeyCode (see keytable.h)
+// The modifier is pressed before the key goes down and released after it goes up
+// Returns 0 on success, 1 if not supported, 3 if injection failed
+uint32_t InjectKeyTransition(uint16_t nativeCode, bool down, bool useModifier);
+
 #ifdef __cplusplus
 }
 #endif
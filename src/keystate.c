@@ -0,0 +1,187 @@
+#include "keystate.h"
+#include "keytable.h"
+#include "threads.h"
+#include <string.h>
+
+#ifdef __APPLE__
+#include <ApplicationServices/ApplicationServices.h>
+#endif
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#define WORD_BITS 64
+#define WORD_COUNT (KEYSTATE_MAX_CODE / WORD_BITS)
+
+// Key table names of the modifiers, indexed by mask bit
+static const char* g_modifierNames[4][2] = {
+  { "Shift", "RightShift" },
+  { "Control", "RightControl" },
+  { "Alt", "RightAlt" },
+  { "Meta", "RightMeta" },
+};
+
+#ifdef _WIN32
+static INIT_ONCE g_once = INIT_ONCE_STATIC_INIT;
+#else
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+#endif
+
+static Mutex g_mutex;
+static Condition g_condition;
+static bool g_tracking = false;
+static uint64_t g_pressed[WORD_COUNT];
+static uint32_t g_pressedCount = 0;
+static uint64_t g_modifierMasks[4][WORD_COUNT];
+
+static void InitializeState(void) {
+  MutexInit(&g_mutex);
+  ConditionInit(&g_condition);
+
+  // Precompute one bitmap per modifier so checks are a few ANDs
+  memset(g_modifierMasks, 0, sizeof(g_modifierMasks));
+  for (int modifier = 0; modifier < 4; modifier++) {
+    for (int side = 0; side < 2; side++) {
+      uint16_t code = NativeKeyCode(LookupKey(g_modifierNames[modifier][side]));
+      if (code < KEYSTATE_MAX_CODE) {
+        g_modifierMasks[modifier][code / WORD_BITS] |= 1ULL << (code % WORD_BITS);
+      }
+    }
+  }
+}
+
+#ifdef _WIN32
+static BOOL CALLBACK InitializeOnce(PINIT_ONCE once, PVOID param, PVOID* context) {
+  (void)once;
+  (void)param;
+  (void)context;
+  InitializeState();
+  return TRUE;
+}
+#endif
+
+static void EnsureInitialized(void) {
+#ifdef _WIN32
+  InitOnceExecuteOnce(&g_once, InitializeOnce, NULL, NULL);
+#else
+  pthread_once(&g_once, InitializeState);
+#endif
+}
+
+// Check the bitmap, must be called with the mutex held
+static bool AnyPressed(uint32_t modifiers) {
+  if (modifiers == KEYSTATE_ALL_KEYS) {
+    return g_pressedCount > 0;
+  }
+  for (int modifier = 0; modifier < 4; modifier++) {
+    if (!(modifiers & (1u << modifier))) continue;
+    for (int word = 0; word < WORD_COUNT; word++) {
+      if (g_pressed[word] & g_modifierMasks[modifier][word]) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Ask the OS directly when the monitor is not running
+static bool PollPressed(uint32_t modifiers) {
+#if defined(_WIN32) || defined(__APPLE__)
+#ifdef _WIN32
+  const uint16_t lastCode = 256;
+#else
+  const uint16_t lastCode = 128;
+#endif
+  for (uint16_t code = 0; code < lastCode; code++) {
+    if (modifiers != KEYSTATE_ALL_KEYS) {
+      bool relevant = false;
+      for (int modifier = 0; modifier < 4; modifier++) {
+        if ((modifiers & (1u << modifier)) && (g_modifierMasks[modifier][code / WORD_BITS] & (1ULL << (code % WORD_BITS)))) {
+          relevant = true;
+        }
+      }
+      if (!relevant) continue;
+    }
+#ifdef _WIN32
+    if (GetAsyncKeyState(code) & 0x8000) return true;
+#else
+    if (CGEventSourceKeyState(kCGEventSourceStateHIDSystemState, code)) return true;
+#endif
+  }
+  return false;
+#else
+  // No global key state without the monitor: assume released
+  (void)modifiers;
+  return false;
+#endif
+}
+
+static void SleepMillis(uint32_t ms) {
+#ifdef _WIN32
+  Sleep(ms);
+#else
+  usleep(ms * 1000);
+#endif
+}
+
+void KeyStateSetTracking(bool tracking) {
+  EnsureInitialized();
+  MutexLock(&g_mutex);
+  g_tracking = tracking;
+  memset(g_pressed, 0, sizeof(g_pressed));
+  g_pressedCount = 0;
+  ConditionBroadcast(&g_condition);
+  MutexUnlock(&g_mutex);
+}
+
+void KeyStateUpdate(uint16_t code, bool down) {
+  if (code >= KEYSTATE_MAX_CODE) {
+    return;
+  }
+
+  uint64_t bit = 1ULL << (code % WORD_BITS);
+  uint64_t* word = &g_pressed[code / WORD_BITS];
+
+  MutexLock(&g_mutex);
+  bool wasDown = (*word & bit) != 0;
+  if (down && !wasDown) {
+    *word |= bit;
+    g_pressedCount++;
+  } else if (!down && wasDown) {
+    *word &= ~bit;
+    g_pressedCount--;
+    ConditionBroadcast(&g_condition);
+  }
+  MutexUnlock(&g_mutex);
+}
+
+bool WaitForKeysReleased(uint32_t modifiers, uint32_t timeoutMs) {
+  EnsureInitialized();
+  uint64_t deadline = MonotonicMillis() + timeoutMs;
+
+  // Event-driven path: sleep until the monitor reports a release
+  MutexLock(&g_mutex);
+  while (g_tracking && AnyPressed(modifiers)) {
+    uint64_t now = MonotonicMillis();
+    if (now >= deadline) {
+      MutexUnlock(&g_mutex);
+      return false;
+    }
+    ConditionTimedWait(&g_condition, &g_mutex, (uint32_t)(deadline - now));
+  }
+  bool tracked = g_tracking;
+  MutexUnlock(&g_mutex);
+  if (tracked) {
+    return true;
+  }
+
+  // Polling fallback
+  while (PollPressed(modifiers)) {
+    if (MonotonicMillis() >= deadline) {
+      return false;
+    }
+    SleepMillis(10);
+  }
+  return true;
+}
@@ -0,0 +1,38 @@
+#ifndef KEYSTATE_H
+#define KEYSTATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Pressed-key bitmap shared between the key monitor and the injectors
+// Key codes are native: virtual keys on Windows, CGKeyCode on macOS, evdev codes on Linux
+#define KEYSTATE_MAX_CODE 768
+
+// Modifier masks for WaitForKeysReleased (0 waits for every key)
+#define KEYSTATE_ALL_KEYS 0
+#define KEYSTATE_SHIFT    (1 << 0)
+#define KEYSTATE_CONTROL  (1 << 1)
+#define KEYSTATE_ALT      (1 << 2)
+#define KEYSTATE_META     (1 << 3)
+
+// Start or stop tracking (called by the key monitor)
+// Stopping clears the bitmap and wakes up waiters so they fall back to polling
+void KeyStateSetTracking(bool tracking);
+
+// Record a key transition (called by the key monitor thread)
+void KeyStateUpdate(uint16_t code, bool down);
+
+// Block until the given modifiers (or all keys) are released
+// Event-driven while the key monitor runs, polls the OS otherwise
+// Returns true once released, false if the timeout expired first
+bool WaitForKeysReleased(uint32_t modifiers, uint32_t timeoutMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KEYSTATE_H
@@ -0,0 +1,60 @@
+#include "keytable.h"
+#include <stddef.h>
+
+static const KeyDefinition g_keys[] = {
+#define KEY(name, win, mac, evdev) { name, win, mac, evdev },
+#include "keytable.def"
+#undef KEY
+};
+
+#define KEY_COUNT (sizeof(g_keys) / sizeof(g_keys[0]))
+
+static int CompareNames(const char* a, const char* b) {
+  for (;; a++, b++) {
+    unsigned char ca = (unsigned char)*a;
+    unsigned char cb = (unsigned char)*b;
+    if (ca >= 'A' && ca <= 'Z') ca += 'a' - 'A';
+    if (cb >= 'A' && cb <= 'Z') cb += 'a' - 'A';
+    if (ca != cb || ca == 0) {
+      return (int)ca - (int)cb;
+    }
+  }
+}
+
+const KeyDefinition* LookupKey(const char* name) {
+  if (name == NULL) {
+    return NULL;
+  }
+
+  size_t low = 0;
+  size_t high = KEY_COUNT;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    int cmp = CompareNames(name, g_keys[middle].name);
+    if (cmp == 0) {
+      return &g_keys[middle];
+    }
+    if (cmp < 0) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+
+  return NULL;
+}
+
+uint16_t NativeKeyCode(const KeyDefinition* key) {
+  if (key == NULL) {
+    return KEY_UNMAPPED;
+  }
+#ifdef _WIN32
+  return key->win;
+#elif defined(__APPLE__)
+  return key->mac;
+#elif defined(__linux__)
+  return key->evdev;
+#else
+  return KEY_UNMAPPED;
+#endif
+}
@@ -0,0 +1,37 @@
+#ifndef KEYTABLE_H
+#define KEYTABLE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KEY_UNMAPPED 0xFFFF
+
+// Windows codes: extended-key flag above the 8-bit virtual key, for keys that
+// share their virtual key with a non-extended one (NumpadEnter is VK_RETURN)
+#define KEY_EXTENDED 0x100
+#define KEY_VIRTUAL_KEY(code) ((code) & 0xFF)
+
+// One entry of the key table (see keytable.def)
+typedef struct {
+  const char* name;
+  uint16_t win;     // Windows virtual key, with KEY_EXTENDED if needed
+  uint16_t mac;     // macOS CGKeyCode
+  uint16_t evdev;   // Linux evdev code
+} KeyDefinition;
+
+// Find a key by name (case-insensitive)
+// Returns NULL if the name is unknown
+const KeyDefinition* LookupKey(const char* name);
+
+// Get the key code for the current platform
+// Returns KEY_UNMAPPED if the key does not exist on this platform
+uint16_t NativeKeyCode(const KeyDefinition* key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KEYTABLE_H
@@ -0,0 +1,253 @@
+#include "log.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define SOURCE_SIZE 16
+
+typedef struct {
+  volatile uint64_t sequence;   // Index + 1 once written, 0 while being written
+  double time;                  // Milliseconds since the epoch
+  int level;
+  char source[SOURCE_SIZE];
+  char message[LOG_MESSAGE_SIZE];
+} LogEntry;
+
+#ifdef _WIN32
+#define ATOMIC_LOAD(ptr) ((uint64_t)InterlockedCompareExchange64((volatile LONG64*)(ptr), 0, 0))
+#define ATOMIC_STORE(ptr, value) InterlockedExchange64((volatile LONG64*)(ptr), (LONG64)(value))
+#define ATOMIC_FETCH_ADD(ptr, value) ((uint64_t)InterlockedExchangeAdd64((volatile LONG64*)(ptr), (LONG64)(value)))
+#define ATOMIC_EXCHANGE(ptr, value) ((uint64_t)InterlockedExchange64((volatile LONG64*)(ptr), (LONG64)(value)))
+#define ATOMIC_FENCE() MemoryBarrier()
+#else
+#define ATOMIC_LOAD(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+#define ATOMIC_FETCH_ADD(ptr, value) __atomic_fetch_add(ptr, value, __ATOMIC_ACQ_REL)
+#define ATOMIC_EXCHANGE(ptr, value) __atomic_exchange_n(ptr, value, __ATOMIC_ACQ_REL)
+#define ATOMIC_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
+
+static LogEntry g_ring[LOG_RING_SIZE];
+static volatile uint64_t g_head = 0;          // Next index to write
+static uint64_t g_tail = 0;                   // Next index to drain (JS thread only)
+static volatile int g_level = LOG_LEVEL_DEFAULT;
+
+// Subscription state: the threadsafe function lives until the env goes away
+static napi_threadsafe_function g_tsfn = NULL;
+static napi_ref g_callback = NULL;
+static volatile uint64_t g_notifyPending = 0;
+
+static const char* LevelName(int level) {
+  switch (level) {
+    case LOG_LEVEL_DEBUG: return "debug";
+    case LOG_LEVEL_INFO: return "info";
+    case LOG_LEVEL_WARN: return "warn";
+    case LOG_LEVEL_ERROR: return "error";
+    default: return "unknown";
+  }
+}
+
+static double NowMillis(void) {
+#ifdef _WIN32
+  FILETIME ft;
+  GetSystemTimeAsFileTime(&ft);
+  uint64_t ticks = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+  // FILETIME counts 100ns since 1601
+  return (double)(ticks - 116444736000000000ULL) / 10000.0;
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+#endif
+}
+
+bool LogEnabled(int level) {
+  return level >= g_level;
+}
+
+void LogSetLevel(int level) {
+  if (level < LOG_LEVEL_DEBUG) level = LOG_LEVEL_DEBUG;
+  if (level > LOG_LEVEL_SILENT) level = LOG_LEVEL_SILENT;
+  g_level = level;
+}
+
+int LogGetLevel(void) {
+  return g_level;
+}
+
+void LogWrite(int level, const char* source, const char* format, ...) {
+  if (!LogEnabled(level) || level >= LOG_LEVEL_SILENT) {
+    return;
+  }
+
+  // Claim a slot: writers never wait on each other
+  uint64_t index = ATOMIC_FETCH_ADD(&g_head, 1);
+  LogEntry* entry = &g_ring[index % LOG_RING_SIZE];
+  ATOMIC_STORE(&entry->sequence, 0);
+  ATOMIC_FENCE();
+
+  entry->time = NowMillis();
+  entry->level = level;
+  snprintf(entry->source, SOURCE_SIZE, "%s", source ? source : "");
+  va_list args;
+  va_start(args, format);
+  vsnprintf(entry->message, LOG_MESSAGE_SIZE, format, args);
+  va_end(args);
+
+  // Publish
+  ATOMIC_STORE(&entry->sequence, index + 1);
+
+  // Wake up the subscriber once per batch
+  napi_threadsafe_function tsfn = g_tsfn;
+  if (tsfn != NULL && ATOMIC_EXCHANGE(&g_notifyPending, 1) == 0) {
+    if (napi_call_threadsafe_function(tsfn, NULL, napi_tsfn_nonblocking) != napi_ok) {
+      ATOMIC_STORE(&g_notifyPending, 0);
+    }
+  }
+}
+
+napi_value LogDrain(napi_env env) {
+  napi_value array;
+  napi_create_array(env, &array);
+
+  uint64_t head = ATOMIC_LOAD(&g_head);
+  if (head - g_tail > LOG_RING_SIZE) {
+    // The oldest entries were overwritten before anyone drained them
+    g_tail = head - LOG_RING_SIZE;
+  }
+
+  uint32_t count = 0;
+  for (; g_tail < head; g_tail++) {
+    LogEntry* slot = &g_ring[g_tail % LOG_RING_SIZE];
+
+    // A slot still being written (or not yet claimed for this lap) stops the
+    // drain: it resumes there once the writer publishes and notifies again.
+    // A slot already recycled by a writer a lap ahead is lost.
+    uint64_t sequence = ATOMIC_LOAD(&slot->sequence);
+    if (sequence == 0 || sequence < g_tail + 1) {
+      break;
+    }
+    if (sequence != g_tail + 1) {
+      continue;
+    }
+
+    // Copy, then check the slot was not recycled meanwhile
+    LogEntry copy;
+    memcpy(&copy, slot, sizeof(copy));
+    ATOMIC_FENCE();
+    if (ATOMIC_LOAD(&slot->sequence) != g_tail + 1) {
+      continue;
+    }
+    copy.source[SOURCE_SIZE - 1] = '\0';
+    copy.message[LOG_MESSAGE_SIZE - 1] = '\0';
+
+    napi_value item, value;
+    napi_create_object(env, &item);
+    napi_create_double(env, copy.time, &value);
+    napi_set_named_property(env, item, "time", value);
+    napi_create_string_utf8(env, LevelName(copy.level), NAPI_AUTO_LENGTH, &value);
+    napi_set_named_property(env, item, "level", value);
+    napi_create_string_utf8(env, copy.source, NAPI_AUTO_LENGTH, &value);
+    napi_set_named_property(env, item, "source", value);
+    napi_create_string_utf8(env, copy.message, NAPI_AUTO_LENGTH, &value);
+    napi_set_named_property(env, item, "message", value);
+    napi_set_element(env, array, count++, item);
+  }
+
+  return array;
+}
+
+// Runs on the JS thread when new entries were written
+static void DeliverLogs(napi_env env, napi_value js_callback, void* context, void* data) {
+  (void)js_callback;
+  (void)context;
+  (void)data;
+
+  ATOMIC_STORE(&g_notifyPending, 0);
+  if (env == NULL || g_callback == NULL) {
+    return;
+  }
+
+  napi_value callback;
+  if (napi_get_reference_value(env, g_callback, &callback) != napi_ok || callback == NULL) {
+    return;
+  }
+
+  napi_value entries = LogDrain(env);
+  uint32_t length = 0;
+  napi_get_array_length(env, entries, &length);
+  if (length == 0) {
+    return;
+  }
+
+  napi_value undefined;
+  napi_get_undefined(env, &undefined);
+  napi_call_function(env, undefined, callback, 1, &entries, NULL);
+}
+
+static void Cleanup(void* arg) {
+  (void)arg;
+  napi_threadsafe_function tsfn = g_tsfn;
+  g_tsfn = NULL;
+  if (tsfn != NULL) {
+    napi_release_threadsafe_function(tsfn, napi_tsfn_abort);
+  }
+}
+
+int LogSubscribe(napi_env env, napi_value callback) {
+  if (g_callback != NULL) {
+    napi_delete_reference(env, g_callback);
+    g_callback = NULL;
+  }
+
+  napi_valuetype type = napi_undefined;
+  if (callback != NULL) {
+    napi_typeof(env, callback, &type);
+  }
+  if (type != napi_function) {
+    return 0; // Unsubscribed
+  }
+
+  if (g_tsfn == NULL) {
+    napi_value resourceName;
+    napi_create_string_utf8(env, "LogCallback", NAPI_AUTO_LENGTH, &resourceName);
+
+    napi_threadsafe_function tsfn;
+    napi_status status = napi_create_threadsafe_function(
+      env,
+      NULL,                    // the callback is looked up on every delivery
+      NULL,                    // async_resource
+      resourceName,            // async_resource_name
+      0,                       // max_queue_size (0 = unlimited)
+      1,                       // initial_thread_count
+      NULL,                    // thread_finalize_data
+      NULL,                    // thread_finalize_cb
+      NULL,                    // context
+      DeliverLogs,             // call_js_cb
+      &tsfn
+    );
+    if (status != napi_ok) {
+      return 2;
+    }
+
+    // Logging must never keep the process alive
+    napi_unref_threadsafe_function(env, tsfn);
+    napi_add_env_cleanup_hook(env, Cleanup, NULL);
+    g_tsfn = tsfn;
+  }
+
+  napi_create_reference(env, callback, 1, &g_callback);
+
+  // Deliver anything already buffered
+  if (ATOMIC_EXCHANGE(&g_notifyPending, 1) == 0) {
+    napi_call_threadsafe_function(g_tsfn, NULL, napi_tsfn_nonblocking);
+  }
+
+  return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <node_api.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Log levels, messages below the current level are dropped before formatting
+#define LOG_LEVEL_DEBUG  0
+#define LOG_LEVEL_INFO   1
+#define LOG_LEVEL_WARN   2
+#define LOG_LEVEL_ERROR  3
+#define LOG_LEVEL_SILENT 4
+
+// Default level: per-call traces (debug) cost one load and a compare
+#define LOG_LEVEL_DEFAULT LOG_LEVEL_WARN
+
+// Number of entries kept in memory, older ones are overwritten
+#define LOG_RING_SIZE 256
+#define LOG_MESSAGE_SIZE 192
+
+// Check if a level is currently recorded
+bool LogEnabled(int level);
+
+// Set the minimum recorded level
+void LogSetLevel(int level);
+
+// Get the minimum recorded level
+int LogGetLevel(void);
+
+// Record a message in the ring (lock-free, callable from any thread)
+void LogWrite(int level, const char* source, const char* format, ...);
+
+#define LOG_AT(level, ...) do { if (LogEnabled(level)) LogWrite(level, __VA_ARGS__); } while (0)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+// Move all pending entries into a JS array of { time, level, source, message }
+napi_value LogDrain(napi_env env);
+
+// Call back JS with batches of new entries (a null callback unsubscribes)
+// Entries are delivered on the JS thread, coalesced while the callback is pending
+// Returns 0 on success, non-zero on error
+int LogSubscribe(napi_env env, napi_value callback);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_H
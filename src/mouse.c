@@ -1,8 +1,100 @@
 #include "mouse.h"
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifdef _WIN32
 #include <windows.h>
+#include <math.h>
+
+// Screen metrics, cached until the display configuration changes
+typedef struct {
+    int primaryWidth;
+    int primaryHeight;
+    int virtualX;
+    int virtualY;
+    int virtualWidth;
+    int virtualHeight;
+} ScreenMetrics;
+
+static SRWLOCK g_metricsLock = SRWLOCK_INIT;
+static ScreenMetrics g_metrics;
+static LONG g_metricsGeneration = -1;
+static volatile LONG g_displayGeneration = 0;
+static volatile LONG g_listenerState = 0; // 0 not started, 1 starting, 2 running, 3 failed
+
+static LRESULT CALLBACK DisplayListenerProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+    if (msg == WM_DISPLAYCHANGE || (msg == WM_SETTINGCHANGE && wParam == SPI_SETWORKAREA)) {
+        InterlockedIncrement(&g_displayGeneration);
+    }
+    return DefWindowProcW(hwnd, msg, wParam, lParam);
+}
+
+static DWORD WINAPI DisplayListenerThread(LPVOID param)
+{
+    WNDCLASSW wc = {0};
+    wc.lpfnWndProc = DisplayListenerProc;
+    wc.hInstance = GetModuleHandleW(NULL);
+    wc.lpszClassName = L"AutolibDisplayListener";
+    RegisterClassW(&wc);
+
+    // Hidden top-level window: message-only windows do not get broadcasts like WM_DISPLAYCHANGE
+    HWND hwnd = CreateWindowExW(WS_EX_TOOLWINDOW, wc.lpszClassName, L"", WS_POPUP, 0, 0, 0, 0, NULL, NULL, wc.hInstance, NULL);
+    if (hwnd == NULL) {
+        InterlockedExchange(&g_listenerState, 3);
+        return 0;
+    }
+    InterlockedExchange(&g_listenerState, 2);
+
+    MSG msg;
+    while (GetMessageW(&msg, NULL, 0, 0) > 0) {
+        DispatchMessageW(&msg);
+    }
+    return 0;
+}
+
+static void GetScreenMetrics(ScreenMetrics* metrics)
+{
+    // Start the display change listener on first use
+    if (InterlockedCompareExchange(&g_listenerState, 1, 0) == 0) {
+        HANDLE thread = CreateThread(NULL, 0, DisplayListenerThread, NULL, 0, NULL);
+        if (thread == NULL) {
+            InterlockedExchange(&g_listenerState, 3);
+        } else {
+            CloseHandle(thread);
+        }
+    }
+
+    // Without a listener we cannot know when the cache is stale
+    LONG generation = g_displayGeneration;
+    bool cacheable = g_listenerState == 2;
+
+    AcquireSRWLockShared(&g_metricsLock);
+    bool valid = cacheable && g_metricsGeneration == generation;
+    if (valid) {
+        *metrics = g_metrics;
+    }
+    ReleaseSRWLockShared(&g_metricsLock);
+    if (valid) {
+        return;
+    }
+
+    metrics->primaryWidth = GetSystemMetrics(SM_CXSCREEN);
+    metrics->primaryHeight = GetSystemMetrics(SM_CYSCREEN);
+    metrics->virtualX = GetSystemMetrics(SM_XVIRTUALSCREEN);
+    metrics->virtualY = GetSystemMetrics(SM_YVIRTUALSCREEN);
+    metrics->virtualWidth = GetSystemMetrics(SM_CXVIRTUALSCREEN);
+    metrics->virtualHeight = GetSystemMetrics(SM_CYVIRTUALSCREEN);
+
+    if (cacheable) {
+        AcquireSRWLockExclusive(&g_metricsLock);
+        g_metrics = *metrics;
+        g_metricsGeneration = generation;
+        ReleaseSRWLockExclusive(&g_metricsLock);
+    }
+}
 
 uint32_t MouseClick(int x, int y)
 {
@@ -11,9 +103,10 @@ uint32_t MouseClick(int x, int y)
     GetCursorPos(&originalPos);
 
     // Convert screen coordinates to mouse event coordinates
-    double fScreenWidth = GetSystemMetrics(SM_CXSCREEN) - 1;
-    double fScreenHeight = GetSystemMetrics(SM_CYSCREEN) - 1;
-
+    ScreenMetrics metrics;
+    GetScreenMetrics(&metrics);
+    double fScreenWidth = metrics.primaryWidth - 1;
+    double fScreenHeight = metrics.primaryHeight - 1;
     // Prepare input structure for mouse movement and click
     INPUT input[4] = {0};
     UINT result;
@@ -60,11 +153,422 @@ uint32_t MouseClick(int x, int y)
 
 }
 
+static const DWORD kButtonDownFlags[] = { MOUSEEVENTF_LEFTDOWN, MOUSEEVENTF_RIGHTDOWN, MOUSEEVENTF_MIDDLEDOWN, MOUSEEVENTF_XDOWN, MOUSEEVENTF_XDOWN };
+static const DWORD kButtonUpFlags[] = { MOUSEEVENTF_LEFTUP, MOUSEEVENTF_RIGHTUP, MOUSEEVENTF_MIDDLEUP, MOUSEEVENTF_XUP, MOUSEEVENTF_XUP };
+
+static bool FlushInputs(INPUT* inputs, UINT* count)
+{
+    UINT pending = *count;
+    *count = 0;
+    return pending == 0 || SendInput(pending, inputs, sizeof(INPUT)) == pending;
+}
+
+uint32_t MouseActions(const PointerAction* actions, size_t count)
+{
+    // Moves are mapped over the whole virtual desktop, so every monitor is reachable
+    ScreenMetrics metrics;
+    GetScreenMetrics(&metrics);
+    if (metrics.virtualWidth <= 1 || metrics.virtualHeight <= 1) {
+        return 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (actions[i].type == POINTER_MOVE &&
+            (actions[i].x < metrics.virtualX || actions[i].y < metrics.virtualY ||
+             actions[i].x >= metrics.virtualX + metrics.virtualWidth || actions[i].y >= metrics.virtualY + metrics.virtualHeight)) {
+            return 0;
+        }
+    }
+
+    // A wheel action may need two inputs (vertical and horizontal)
+    INPUT* inputs = (INPUT*)calloc(count * 2 + 1, sizeof(INPUT));
+    if (inputs == NULL) {
+        return 0;
+    }
+
+    UINT pending = 0;
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; i++) {
+        const PointerAction* action = &actions[i];
+        switch (action->type) {
+        case POINTER_MOVE: {
+            INPUT* input = &inputs[pending++];
+            memset(input, 0, sizeof(INPUT));
+            input->type = INPUT_MOUSE;
+            input->mi.dx = (LONG)(((action->x - metrics.virtualX) * 65535.0) / (metrics.virtualWidth - 1));
+            input->mi.dy = (LONG)(((action->y - metrics.virtualY) * 65535.0) / (metrics.virtualHeight - 1));
+            input->mi.dwFlags = MOUSEEVENTF_MOVE | MOUSEEVENTF_ABSOLUTE | MOUSEEVENTF_VIRTUALDESK;
+            break;
+        }
+        case POINTER_DOWN:
+        case POINTER_UP: {
+            INPUT* input = &inputs[pending++];
+            memset(input, 0, sizeof(INPUT));
+            input->type = INPUT_MOUSE;
+            input->mi.dwFlags = action->type == POINTER_DOWN ? kButtonDownFlags[action->button] : kButtonUpFlags[action->button];
+            if (action->button == POINTER_BUTTON_X1) {
+                input->mi.mouseData = XBUTTON1;
+            } else if (action->button == POINTER_BUTTON_X2) {
+                input->mi.mouseData = XBUTTON2;
+            }
+            break;
+        }
+        case POINTER_WHEEL: {
+            // WHEEL_DELTA units allow fractional notches on high-resolution aware applications
+            LONG vertical = (LONG)lround(-action->deltaY * WHEEL_DELTA);
+            LONG horizontal = (LONG)lround(action->deltaX * WHEEL_DELTA);
+            if (vertical != 0) {
+                INPUT* input = &inputs[pending++];
+                memset(input, 0, sizeof(INPUT));
+                input->type = INPUT_MOUSE;
+                input->mi.dwFlags = MOUSEEVENTF_WHEEL;
+                input->mi.mouseData = (DWORD)vertical;
+            }
+            if (horizontal != 0) {
+                INPUT* input = &inputs[pending++];
+                memset(input, 0, sizeof(INPUT));
+                input->type = INPUT_MOUSE;
+                input->mi.dwFlags = MOUSEEVENTF_HWHEEL;
+                input->mi.mouseData = (DWORD)horizontal;
+            }
+            break;
+        }
+        case POINTER_WAIT:
+            ok = FlushInputs(inputs, &pending);
+            if (ok) {
+                Sleep(action->waitMs);
+            }
+            break;
+        }
+    }
+    if (ok) {
+        ok = FlushInputs(inputs, &pending);
+    }
+
+    free(inputs);
+    return ok ? 1 : 0;
+}
+
+#elif defined(__linux__)
+
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include "x11.h"
+#include "uinput.h"
+
+// Root window size, refreshed from ConfigureNotify events (guarded by the X11 lock)
+static int g_screenWidth = 0;
+static int g_screenHeight = 0;
+
+// Sub-notch wheel motion not yet reported as a whole REL_WHEEL step (injector thread only)
+static int g_wheelRemainderY = 0;
+static int g_wheelRemainderX = 0;
+
+static void GetScreenSize(Display* display, int* width, int* height)
+{
+    Window root = DefaultRootWindow(display);
+    if (g_screenWidth == 0) {
+        // Root ConfigureNotify events tell us when RandR changes the layout
+        XSelectInput(display, root, StructureNotifyMask);
+        g_screenWidth = DisplayWidth(display, DefaultScreen(display));
+        g_screenHeight = DisplayHeight(display, DefaultScreen(display));
+    } else {
+        // Only looks at events already received: no round trip
+        XEvent event;
+        while (XCheckWindowEvent(display, root, StructureNotifyMask, &event)) {
+            if (event.type == ConfigureNotify) {
+                g_screenWidth = event.xconfigure.width;
+                g_screenHeight = event.xconfigure.height;
+            }
+        }
+    }
+    *width = g_screenWidth;
+    *height = g_screenHeight;
+}
+
+uint32_t MouseClick(int x, int y)
+{
+    // Get the combined screen geometry and the current pointer position
+    Display* display = X11Acquire();
+    if (display == NULL) {
+        return 0;
+    }
+
+    Window root = DefaultRootWindow(display);
+    int width, height;
+    GetScreenSize(display, &width, &height);
+
+    Window rootReturn, childReturn;
+    int originalX = 0, originalY = 0, windowX, windowY;
+    unsigned int mask;
+    XQueryPointer(display, root, &rootReturn, &childReturn, &originalX, &originalY, &windowX, &windowY, &mask);
+    X11Release();
+
+    if (x < 0 || y < 0 || x >= width || y >= height) {
+        return 0;
+    }
+
+    int fd = UInputPointer(width, height);
+    if (fd < 0) {
+        return 0;
+    }
+
+    // Move, left button down, left button up, move back: one write, like the SendInput batch on Windows
+    struct input_event events[UINPUT_MOVE_EVENTS * 2 + 4];
+    size_t count = 0;
+    count += UInputMoveAbsolute(&events[count], x, y);
+    UInputEvent(&events[count++], EV_KEY, BTN_LEFT, 1);
+    UInputEvent(&events[count++], EV_SYN, SYN_REPORT, 0);
+    UInputEvent(&events[count++], EV_KEY, BTN_LEFT, 0);
+    UInputEvent(&events[count++], EV_SYN, SYN_REPORT, 0);
+    count += UInputMoveAbsolute(&events[count], originalX, originalY);
+
+    uint32_t result = UInputWrite(fd, events, count) == 0 ? 1 : 0;
+    UInputReleasePointer(fd);
+    return result;
+}
+
+static const uint16_t kButtonCodes[] = { BTN_LEFT, BTN_RIGHT, BTN_MIDDLE, BTN_SIDE, BTN_EXTRA };
+
+// Add a high-resolution wheel step (120 per notch) and the whole notches it completes
+static size_t WheelEvents(struct input_event* events, uint16_t hiResCode, uint16_t code, int* remainder, double delta)
+{
+    int hiRes = (int)lround(delta * 120);
+    if (hiRes == 0) {
+        return 0;
+    }
+
+    size_t count = 0;
+    UInputEvent(&events[count++], EV_REL, hiResCode, hiRes);
+    *remainder += hiRes;
+    int notches = *remainder / 120;
+    if (notches != 0) {
+        *remainder -= notches * 120;
+        UInputEvent(&events[count++], EV_REL, code, notches);
+    }
+    return count;
+}
+
+static void SleepMillis(uint32_t ms)
+{
+    struct timespec delay = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    while (nanosleep(&delay, &delay) != 0 && errno == EINTR) {
+    }
+}
+
+uint32_t MouseActions(const PointerAction* actions, size_t count)
+{
+    Display* display = X11Acquire();
+    if (display == NULL) {
+        return 0;
+    }
+    int width, height;
+    GetScreenSize(display, &width, &height);
+    X11Release();
+
+    for (size_t i = 0; i < count; i++) {
+        if (actions[i].type == POINTER_MOVE &&
+            (actions[i].x < 0 || actions[i].y < 0 || actions[i].x >= width || actions[i].y >= height)) {
+            return 0;
+        }
+    }
+
+    int fd = UInputPointer(width, height);
+    if (fd < 0) {
+        return 0;
+    }
+
+    // Every action fits in UINPUT_MOVE_EVENTS events, waits flush the batch
+    struct input_event* events = (struct input_event*)calloc(count * UINPUT_MOVE_EVENTS + 1, sizeof(struct input_event));
+    if (events == NULL) {
+        UInputReleasePointer(fd);
+        return 0;
+    }
+
+    size_t pending = 0;
+    bool ok = true;
+    for (size_t i = 0; i < count && ok; i++) {
+        const PointerAction* action = &actions[i];
+        switch (action->type) {
+        case POINTER_MOVE:
+            pending += UInputMoveAbsolute(&events[pending], action->x, action->y);
+            break;
+        case POINTER_DOWN:
+        case POINTER_UP:
+            UInputEvent(&events[pending++], EV_KEY, kButtonCodes[action->button], action->type == POINTER_DOWN ? 1 : 0);
+            UInputEvent(&events[pending++], EV_SYN, SYN_REPORT, 0);
+            break;
+        case POINTER_WHEEL: {
+            // Positive deltaY scrolls down, REL_WHEEL counts up
+            size_t added = WheelEvents(&events[pending], REL_WHEEL_HI_RES, REL_WHEEL, &g_wheelRemainderY, -action->deltaY);
+            added += WheelEvents(&events[pending + added], REL_HWHEEL_HI_RES, REL_HWHEEL, &g_wheelRemainderX, action->deltaX);
+            if (added > 0) {
+                pending += added;
+                UInputEvent(&events[pending++], EV_SYN, SYN_REPORT, 0);
+            }
+            break;
+        }
+        case POINTER_WAIT:
+            ok = pending == 0 || UInputWrite(fd, events, pending) == 0;
+            pending = 0;
+            if (ok) {
+                SleepMillis(action->waitMs);
+            }
+            break;
+        }
+    }
+    if (ok && pending > 0) {
+        ok = UInputWrite(fd, events, pending) == 0;
+    }
+
+    UInputReleasePointer(fd);
+    free(events);
+    return ok ? 1 : 0;
+}
+
+#elif defined(__APPLE__)
+
+#include <math.h>
+#include <unistd.h>
+#include <ApplicationServices/ApplicationServices.h>
+
+// Pixels per wheel notch for pixel-unit scroll events (fractional notches need pixel units)
+#define PIXELS_PER_NOTCH 10
+
+uint32_t MouseClick(int x, int y)
+{
+    // Not implemented for this platform
+    return 0;
+}
+
+static CGMouseButton MacButton(PointerButton button)
+{
+    switch (button) {
+    case POINTER_BUTTON_LEFT: return kCGMouseButtonLeft;
+    case POINTER_BUTTON_RIGHT: return kCGMouseButtonRight;
+    case POINTER_BUTTON_MIDDLE: return kCGMouseButtonCenter;
+    case POINTER_BUTTON_X1: return (CGMouseButton)3;
+    case POINTER_BUTTON_X2: return (CGMouseButton)4;
+    }
+    return kCGMouseButtonLeft;
+}
+
+static CGEventType ButtonEventType(PointerButton button, bool down)
+{
+    if (button == POINTER_BUTTON_LEFT) {
+        return down ? kCGEventLeftMouseDown : kCGEventLeftMouseUp;
+    } else if (button == POINTER_BUTTON_RIGHT) {
+        return down ? kCGEventRightMouseDown : kCGEventRightMouseUp;
+    }
+    return down ? kCGEventOtherMouseDown : kCGEventOtherMouseUp;
+}
+
+static bool PostEvent(CGEventRef event)
+{
+    if (event == NULL) {
+        return false;
+    }
+    CGEventPost(kCGHIDEventTap, event);
+    CFRelease(event);
+    return true;
+}
+
+uint32_t MouseActions(const PointerAction* actions, size_t count)
+{
+    // Quartz has no batch submission: events are posted back to back,
+    // coordinates are global display points so no screen metrics are needed
+    CGEventRef current = CGEventCreate(NULL);
+    if (current == NULL) {
+        return 0;
+    }
+    CGPoint position = CGEventGetLocation(current);
+    CFRelease(current);
+
+    uint32_t pressed = 0;
+    PointerButton lastButton = POINTER_BUTTON_LEFT;
+    CGPoint lastPosition = position;
+    int64_t clickState = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const PointerAction* action = &actions[i];
+        bool ok = true;
+        switch (action->type) {
+        case POINTER_MOVE: {
+            // Moves with a button held are drags for the receiving application
+            position = CGPointMake(action->x, action->y);
+            CGEventType type = kCGEventMouseMoved;
+            PointerButton button = POINTER_BUTTON_LEFT;
+            if (pressed & (1 << POINTER_BUTTON_LEFT)) {
+                type = kCGEventLeftMouseDragged;
+            } else if (pressed & (1 << POINTER_BUTTON_RIGHT)) {
+                type = kCGEventRightMouseDragged;
+                button = POINTER_BUTTON_RIGHT;
+            } else if (pressed != 0) {
+                type = kCGEventOtherMouseDragged;
+                button = POINTER_BUTTON_MIDDLE;
+                for (int b = POINTER_BUTTON_MIDDLE; b <= POINTER_BUTTON_X2; b++) {
+                    if (pressed & (1 << b)) {
+                        button = (PointerButton)b;
+                        break;
+                    }
+                }
+            }
+            ok = PostEvent(CGEventCreateMouseEvent(NULL, type, position, MacButton(button)));
+            break;
+        }
+        case POINTER_DOWN:
+        case POINTER_UP: {
+            // Repeated presses at the same spot are double/triple clicks
+            bool down = action->type == POINTER_DOWN;
+            if (down) {
+                bool repeat = clickState > 0 && lastButton == action->button &&
+                              lastPosition.x == position.x && lastPosition.y == position.y;
+                clickState = repeat ? clickState + 1 : 1;
+                lastButton = action->button;
+                lastPosition = position;
+                pressed |= 1 << action->button;
+            } else {
+                pressed &= ~(1 << action->button);
+            }
+            CGEventRef event = CGEventCreateMouseEvent(NULL, ButtonEventType(action->button, down), position, MacButton(action->button));
+            if (event != NULL) {
+                CGEventSetIntegerValueField(event, kCGMouseEventClickState, clickState > 0 ? clickState : 1);
+            }
+            ok = PostEvent(event);
+            break;
+        }
+        case POINTER_WHEEL: {
+            // Axis 1 is vertical (positive up), axis 2 horizontal (positive left)
+            int32_t vertical = (int32_t)lround(-action->deltaY * PIXELS_PER_NOTCH);
+            int32_t horizontal = (int32_t)lround(-action->deltaX * PIXELS_PER_NOTCH);
+            if (vertical != 0 || horizontal != 0) {
+                ok = PostEvent(CGEventCreateScrollWheelEvent(NULL, kCGScrollEventUnitPixel, 2, vertical, horizontal));
+            }
+            break;
+        }
+        case POINTER_WAIT:
+            usleep((useconds_t)action->waitMs * 1000);
+            break;
+        }
+        if (!ok) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
 #else
 
 uint32_t MouseClick(int x, int y)
 {
-    // Not implemented for platforms other than Windows
+    // Not implemented for this platform
+    return 0;
+}
+
+uint32_t MouseActions(const PointerAction* actions, size_t count)
+{
+    // Not implemented for this platform
     return 0;
 }
 
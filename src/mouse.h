@@ -1,6 +1,7 @@
 #ifndef MOUSE_H
 #define MOUSE_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -16,6 +17,56 @@ extern "C" {
  */
 uint32_t MouseClick(int x, int y);
 
+/**
+ * Pointer action kinds for MouseActions.
+ */
+typedef enum {
+    POINTER_MOVE,
+    POINTER_DOWN,
+    POINTER_UP,
+    POINTER_WHEEL,
+    POINTER_WAIT
+} PointerActionType;
+
+/**
+ * Pointer buttons, X1/X2 being the back/forward side buttons.
+ */
+typedef enum {
+    POINTER_BUTTON_LEFT,
+    POINTER_BUTTON_RIGHT,
+    POINTER_BUTTON_MIDDLE,
+    POINTER_BUTTON_X1,
+    POINTER_BUTTON_X2
+} PointerButton;
+
+/**
+ * One pointer action.
+ * - move: x, y in screen coordinates
+ * - down/up: button, at the current position
+ * - wheel: deltaX, deltaY in notches (fractions allowed), positive deltaY scrolls down
+ * - wait: waitMs
+ */
+typedef struct {
+    PointerActionType type;
+    PointerButton button;
+    int x;
+    int y;
+    double deltaX;
+    double deltaY;
+    uint32_t waitMs;
+} PointerAction;
+
+/**
+ * Performs a sequence of pointer actions. Consecutive actions are submitted
+ * as one native batch, waits split the sequence into several batches.
+ * Nothing is injected if a move is outside the screen.
+ *
+ * @param actions The actions to perform, in order
+ * @param count The number of actions
+ * @return 1 if successful, 0 if failed
+ */
+uint32_t MouseActions(const PointerAction* actions, size_t count);
+
 #ifdef __cplusplus
 }
 #endif
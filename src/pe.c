@@ -0,0 +1,159 @@
+#include "pe.h"
+#include <string.h>
+
+// Offsets from the Microsoft PE/COFF specification
+#define DOS_LFANEW 0x3C
+#define COFF_HEADER_SIZE 20
+#define SECTION_HEADER_SIZE 40
+#define OPTIONAL_MAGIC_PE32 0x10B
+#define OPTIONAL_MAGIC_PE32PLUS 0x20B
+#define RESOURCE_DIRECTORY_INDEX 2
+#define RESOURCE_DIRECTORY_SIZE 16
+#define RESOURCE_ENTRY_SIZE 8
+#define RESOURCE_DATA_ENTRY_SIZE 16
+#define RESOURCE_SUBDIRECTORY 0x80000000u
+
+// Images are little endian and fields may be unaligned
+static uint16_t ReadU16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t ReadU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool InImage(const PeImage* image, size_t offset, size_t length) {
+  return offset <= image->size && length <= image->size - offset;
+}
+
+// Translate a relative virtual address to a file offset through the section table
+static bool RvaToOffset(const PeImage* image, uint32_t rva, uint32_t length, size_t* offset) {
+  for (uint16_t i = 0; i < image->sectionCount; i++) {
+    const uint8_t* section = image->sections + (size_t)i * SECTION_HEADER_SIZE;
+    uint32_t virtualSize = ReadU32(section + 8);
+    uint32_t virtualAddress = ReadU32(section + 12);
+    uint32_t rawSize = ReadU32(section + 16);
+    uint32_t rawPointer = ReadU32(section + 20);
+    uint32_t extent = virtualSize != 0 ? virtualSize : rawSize;
+    if (rva < virtualAddress || rva - virtualAddress >= extent) {
+      continue;
+    }
+
+    // Only the raw part of a section is backed by file bytes
+    uint32_t delta = rva - virtualAddress;
+    if (delta > rawSize || length > rawSize - delta) {
+      return false;
+    }
+    *offset = (size_t)rawPointer + delta;
+    return InImage(image, *offset, length);
+  }
+  return false;
+}
+
+bool PeOpen(const uint8_t* data, size_t size, PeImage* image) {
+  memset(image, 0, sizeof(PeImage));
+  image->data = data;
+  image->size = size;
+
+  if (data == NULL || !InImage(image, 0, DOS_LFANEW + 4) || data[0] != 'M' || data[1] != 'Z') {
+    return false;
+  }
+
+  size_t header = ReadU32(data + DOS_LFANEW);
+  if (!InImage(image, header, 4 + COFF_HEADER_SIZE) || memcmp(data + header, "PE\0\0", 4) != 0) {
+    return false;
+  }
+
+  const uint8_t* coff = data + header + 4;
+  uint16_t sectionCount = ReadU16(coff + 2);
+  uint16_t optionalSize = ReadU16(coff + 16);
+  size_t optional = header + 4 + COFF_HEADER_SIZE;
+  if (!InImage(image, optional, optionalSize) || optionalSize < 2) {
+    return false;
+  }
+
+  // The data directories follow the fixed part, which differs between 32 and 64 bit
+  size_t countOffset;
+  switch (ReadU16(data + optional)) {
+    case OPTIONAL_MAGIC_PE32: countOffset = 92; break;
+    case OPTIONAL_MAGIC_PE32PLUS: countOffset = 108; break;
+    default: return false;
+  }
+  if (optionalSize < countOffset + 4) {
+    return false;
+  }
+  uint32_t directoryCount = ReadU32(data + optional + countOffset);
+  size_t directory = optional + countOffset + 4 + RESOURCE_DIRECTORY_INDEX * 8;
+  if (directoryCount <= RESOURCE_DIRECTORY_INDEX || directory + 8 > optional + optionalSize) {
+    return false;
+  }
+
+  size_t sections = optional + optionalSize;
+  if (!InImage(image, sections, (size_t)sectionCount * SECTION_HEADER_SIZE)) {
+    return false;
+  }
+
+  image->sections = data + sections;
+  image->sectionCount = sectionCount;
+  image->resourceRva = ReadU32(data + directory);
+  image->resourceSize = ReadU32(data + directory + 4);
+  return image->resourceRva != 0 && image->resourceSize >= RESOURCE_DIRECTORY_SIZE;
+}
+
+// Find an entry of a resource directory, offsets are relative to the resource root
+static bool FindEntry(const PeImage* image, const uint8_t* root, uint32_t directory, uint32_t id, uint32_t* target) {
+  if ((uint64_t)directory + RESOURCE_DIRECTORY_SIZE > image->resourceSize) {
+    return false;
+  }
+  const uint8_t* table = root + directory;
+  uint32_t count = (uint32_t)ReadU16(table + 12) + ReadU16(table + 14);
+  if ((uint64_t)directory + RESOURCE_DIRECTORY_SIZE + (uint64_t)count * RESOURCE_ENTRY_SIZE > image->resourceSize) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    const uint8_t* entry = table + RESOURCE_DIRECTORY_SIZE + (size_t)i * RESOURCE_ENTRY_SIZE;
+    uint32_t name = ReadU32(entry);
+    bool named = (name & 0x80000000u) != 0;
+    if (id == PE_FIRST_RESOURCE || (!named && name == id)) {
+      *target = ReadU32(entry + 4);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PeFindResource(const PeImage* image, uint32_t type, uint32_t id, const uint8_t** data, uint32_t* size) {
+  size_t rootOffset;
+  if (!RvaToOffset(image, image->resourceRva, image->resourceSize, &rootOffset)) {
+    return false;
+  }
+  const uint8_t* root = image->data + rootOffset;
+
+  // Three levels: type, then id, then language (the first one wins)
+  uint32_t typeEntry, idEntry, languageEntry;
+  if (!FindEntry(image, root, 0, type, &typeEntry) || !(typeEntry & RESOURCE_SUBDIRECTORY)) {
+    return false;
+  }
+  if (!FindEntry(image, root, typeEntry & ~RESOURCE_SUBDIRECTORY, id, &idEntry) || !(idEntry & RESOURCE_SUBDIRECTORY)) {
+    return false;
+  }
+  if (!FindEntry(image, root, idEntry & ~RESOURCE_SUBDIRECTORY, PE_FIRST_RESOURCE, &languageEntry) || (languageEntry & RESOURCE_SUBDIRECTORY)) {
+    return false;
+  }
+  if ((uint64_t)languageEntry + RESOURCE_DATA_ENTRY_SIZE > image->resourceSize) {
+    return false;
+  }
+
+  const uint8_t* dataEntry = root + languageEntry;
+  uint32_t rva = ReadU32(dataEntry);
+  uint32_t length = ReadU32(dataEntry + 4);
+  size_t offset;
+  if (!RvaToOffset(image, rva, length, &offset)) {
+    return false;
+  }
+
+  *data = image->data + offset;
+  *size = length;
+  return true;
+}
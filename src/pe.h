@@ -0,0 +1,44 @@
+#ifndef PE_H
+#define PE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Resource types (winuser.h RT_*)
+#define PE_RT_ICON 3
+#define PE_RT_GROUP_ICON 14
+#define PE_RT_VERSION 16
+
+// Resource id matching the first entry of a directory
+#define PE_FIRST_RESOURCE 0
+
+// Parsed headers of a PE image held in memory (typically a FileMap)
+// Nothing is copied: all pointers reference the image bytes
+typedef struct {
+  const uint8_t* data;
+  size_t size;
+  const uint8_t* sections;
+  uint16_t sectionCount;
+  uint32_t resourceRva;
+  uint32_t resourceSize;
+} PeImage;
+
+// Validate the DOS, COFF and optional headers of an image (PE32 or PE32+)
+// Returns false if the bytes are not a PE file or have no resource directory
+bool PeOpen(const uint8_t* data, size_t size, PeImage* image);
+
+// Find a resource by type and id, in any language
+// id PE_FIRST_RESOURCE takes the first entry (named or numbered)
+// Returns false if the resource is missing or points outside the image
+bool PeFindResource(const PeImage* image, uint32_t type, uint32_t id, const uint8_t** data, uint32_t* size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PE_H
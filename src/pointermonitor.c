@@ -0,0 +1,796 @@
+#include "pointermonitor.h"
+#include "log.h"
+#include "threads.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#ifdef __APPLE__
+#include <ApplicationServices/ApplicationServices.h>
+#include <pthread.h>
+#include <CoreFoundation/CoreFoundation.h>
+#endif
+
+#ifdef __linux__
+#include <libevdev/libevdev.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <pthread.h>
+#include <linux/input.h>
+#include <errno.h>
+#include "uinput.h"
+#include "x11.h"
+#endif
+
+// Thread-safe function for calling back to JavaScript
+static napi_threadsafe_function g_tsfn = NULL;
+static bool g_running = false;
+
+// Motion coalescing: the platform thread only records the latest position,
+// the pacer thread delivers it at most once per interval
+static Mutex g_lock;
+static Condition g_wake;
+static Thread g_pacer;
+static bool g_stopPacer = false;
+static bool g_motionPending = false;
+static int g_x = 0;
+static int g_y = 0;
+static uint32_t g_intervalMs = 0;
+static uint64_t g_lastMotionMs = 0;
+
+// Refresh the current position when the platform events do not carry it
+static void ResolvePosition(int* x, int* y);
+
+static const char* ButtonName(PointerButton button) {
+  switch (button) {
+    case POINTER_BUTTON_LEFT: return "left";
+    case POINTER_BUTTON_RIGHT: return "right";
+    case POINTER_BUTTON_MIDDLE: return "middle";
+    case POINTER_BUTTON_X1: return "x1";
+    case POINTER_BUTTON_X2: return "x2";
+  }
+  return "unknown";
+}
+
+// Callback that runs on the main JS thread
+static void CallJS(napi_env env, napi_value js_callback, void* context, void* data) {
+  (void)context;
+  if (env == NULL || js_callback == NULL) {
+    if (data) free(data);
+    return;
+  }
+
+  PointerEvent* event = (PointerEvent*)data;
+  if (event == NULL) return;
+
+  napi_value eventObj, value;
+  if (napi_create_object(env, &eventObj) != napi_ok) {
+    free(event);
+    return;
+  }
+
+  const char* typeStr;
+  switch (event->type) {
+    case POINTER_EVENT_MOVE: typeStr = "move"; break;
+    case POINTER_EVENT_DOWN: typeStr = "down"; break;
+    case POINTER_EVENT_UP: typeStr = "up"; break;
+    case POINTER_EVENT_WHEEL: typeStr = "wheel"; break;
+    default: typeStr = "unknown"; break;
+  }
+  napi_create_string_utf8(env, typeStr, NAPI_AUTO_LENGTH, &value);
+  napi_set_named_property(env, eventObj, "type", value);
+
+  napi_create_int32(env, event->x, &value);
+  napi_set_named_property(env, eventObj, "x", value);
+  napi_create_int32(env, event->y, &value);
+  napi_set_named_property(env, eventObj, "y", value);
+
+  if (event->type == POINTER_EVENT_DOWN || event->type == POINTER_EVENT_UP) {
+    napi_create_string_utf8(env, ButtonName(event->button), NAPI_AUTO_LENGTH, &value);
+    napi_set_named_property(env, eventObj, "button", value);
+  } else if (event->type == POINTER_EVENT_WHEEL) {
+    napi_create_double(env, event->deltaX, &value);
+    napi_set_named_property(env, eventObj, "deltaX", value);
+    napi_create_double(env, event->deltaY, &value);
+    napi_set_named_property(env, eventObj, "deltaY", value);
+  }
+
+  // Call the JavaScript callback
+  napi_value undefined;
+  napi_get_undefined(env, &undefined);
+  napi_call_function(env, undefined, js_callback, 1, &eventObj, NULL);
+
+  free(event);
+}
+
+// Queue an event at the current position (g_lock held)
+static void PostLocked(int type, PointerButton button, double deltaX, double deltaY) {
+  PointerEvent* event = (PointerEvent*)calloc(1, sizeof(PointerEvent));
+  if (event == NULL) {
+    return;
+  }
+  event->type = type;
+  event->x = g_x;
+  event->y = g_y;
+  event->button = button;
+  event->deltaX = deltaX;
+  event->deltaY = deltaY;
+
+  if (g_tsfn == NULL || napi_call_threadsafe_function(g_tsfn, event, napi_tsfn_nonblocking) != napi_ok) {
+    free(event);
+  }
+}
+
+static void FlushMotionLocked(void) {
+  g_motionPending = false;
+  g_lastMotionMs = MonotonicMillis();
+  PostLocked(POINTER_EVENT_MOVE, POINTER_BUTTON_LEFT, 0, 0);
+}
+
+// Record a motion, delivered later by the pacer
+static void PointerMoved(int x, int y) {
+  MutexLock(&g_lock);
+  g_x = x;
+  g_y = y;
+  if (!g_motionPending) {
+    g_motionPending = true;
+    ConditionSignal(&g_wake);
+  }
+  MutexUnlock(&g_lock);
+}
+
+#ifdef __linux__
+static void PointerMovedBy(int dx, int dy) {
+  MutexLock(&g_lock);
+  g_x += dx;
+  g_y += dy;
+  if (!g_motionPending) {
+    g_motionPending = true;
+    ConditionSignal(&g_wake);
+  }
+  MutexUnlock(&g_lock);
+}
+#endif
+
+// Deliver a button or wheel event immediately, after any pending motion
+// position is NULL when the platform event does not carry one
+static void PointerInput(int type, const int* position, PointerButton button, double deltaX, double deltaY) {
+  MutexLock(&g_lock);
+  if (position != NULL) {
+    g_x = position[0];
+    g_y = position[1];
+  } else {
+    ResolvePosition(&g_x, &g_y);
+  }
+  if (g_motionPending) {
+    FlushMotionLocked();
+  }
+  PostLocked(type, button, deltaX, deltaY);
+  MutexUnlock(&g_lock);
+}
+
+static THREAD_PROC(PacerThread) {
+  (void)arg;
+
+  MutexLock(&g_lock);
+  while (!g_stopPacer) {
+    if (!g_motionPending) {
+      ConditionWait(&g_wake, &g_lock);
+      continue;
+    }
+
+    // Keep collecting motion until the interval since the last delivery is over
+    uint64_t now = MonotonicMillis();
+    uint64_t due = g_lastMotionMs + g_intervalMs;
+    if (now < due) {
+      ConditionTimedWait(&g_wake, &g_lock, (uint32_t)(due - now));
+      continue;
+    }
+
+    ResolvePosition(&g_x, &g_y);
+    FlushMotionLocked();
+  }
+  MutexUnlock(&g_lock);
+
+  THREAD_RETURN;
+}
+
+static void StopPacer(void) {
+  MutexLock(&g_lock);
+  g_stopPacer = true;
+  ConditionSignal(&g_wake);
+  MutexUnlock(&g_lock);
+  ThreadJoin(g_pacer);
+  ConditionDestroy(&g_wake);
+  MutexDestroy(&g_lock);
+}
+
+// Platform event source, started after the pacer
+static int PlatformStart(void);
+static void PlatformStop(void);
+
+#ifdef __APPLE__
+
+static CFMachPortRef g_eventTap = NULL;
+static CFRunLoopSourceRef g_runLoopSource = NULL;
+static CFRunLoopRef g_runLoop = NULL;
+static pthread_t g_thread;
+
+static void ResolvePosition(int* x, int* y) {
+  // Every Quartz mouse event carries its location
+  (void)x;
+  (void)y;
+}
+
+static PointerButton MacButton(int64_t number) {
+  switch (number) {
+    case 0: return POINTER_BUTTON_LEFT;
+    case 1: return POINTER_BUTTON_RIGHT;
+    case 3: return POINTER_BUTTON_X1;
+    case 4: return POINTER_BUTTON_X2;
+    default: return POINTER_BUTTON_MIDDLE;
+  }
+}
+
+// CGEventTap callback - runs on the event tap thread
+static CGEventRef EventTapCallback(CGEventTapProxy proxy, CGEventType type, CGEventRef event, void* refcon) {
+  (void)proxy;
+  (void)refcon;
+
+  // Handle tap being disabled (system can disable it if it takes too long)
+  if (type == kCGEventTapDisabledByTimeout || type == kCGEventTapDisabledByUserInput) {
+    if (g_eventTap) {
+      CGEventTapEnable(g_eventTap, true);
+    }
+    return event;
+  }
+
+  CGPoint location = CGEventGetLocation(event);
+  int position[2] = { (int)location.x, (int)location.y };
+  PointerButton button = MacButton(CGEventGetIntegerValueField(event, kCGMouseEventButtonNumber));
+
+  switch (type) {
+    case kCGEventMouseMoved:
+    case kCGEventLeftMouseDragged:
+    case kCGEventRightMouseDragged:
+    case kCGEventOtherMouseDragged:
+      PointerMoved(position[0], position[1]);
+      break;
+    case kCGEventLeftMouseDown:
+    case kCGEventRightMouseDown:
+    case kCGEventOtherMouseDown:
+      PointerInput(POINTER_EVENT_DOWN, position, button, 0, 0);
+      break;
+    case kCGEventLeftMouseUp:
+    case kCGEventRightMouseUp:
+    case kCGEventOtherMouseUp:
+      PointerInput(POINTER_EVENT_UP, position, button, 0, 0);
+      break;
+    case kCGEventScrollWheel: {
+      // Line deltas, axis 1 positive up and axis 2 positive left
+      double deltaY = -CGEventGetDoubleValueField(event, kCGScrollWheelEventFixedPtDeltaAxis1);
+      double deltaX = -CGEventGetDoubleValueField(event, kCGScrollWheelEventFixedPtDeltaAxis2);
+      if (deltaX != 0 || deltaY != 0) {
+        PointerInput(POINTER_EVENT_WHEEL, position, POINTER_BUTTON_LEFT, deltaX, deltaY);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+
+  return event;
+}
+
+// Thread function to run the event tap run loop
+static void* EventTapThread(void* arg) {
+  (void)arg;
+
+  g_runLoop = CFRunLoopGetCurrent();
+  CFRunLoopAddSource(g_runLoop, g_runLoopSource, kCFRunLoopCommonModes);
+
+  // Run until stopped
+  CFRunLoopRun();
+
+  return NULL;
+}
+
+static int PlatformStart(void) {
+  CGEventMask eventMask = CGEventMaskBit(kCGEventMouseMoved) |
+                          CGEventMaskBit(kCGEventLeftMouseDragged) |
+                          CGEventMaskBit(kCGEventRightMouseDragged) |
+                          CGEventMaskBit(kCGEventOtherMouseDragged) |
+                          CGEventMaskBit(kCGEventLeftMouseDown) |
+                          CGEventMaskBit(kCGEventLeftMouseUp) |
+                          CGEventMaskBit(kCGEventRightMouseDown) |
+                          CGEventMaskBit(kCGEventRightMouseUp) |
+                          CGEventMaskBit(kCGEventOtherMouseDown) |
+                          CGEventMaskBit(kCGEventOtherMouseUp) |
+                          CGEventMaskBit(kCGEventScrollWheel);
+
+  g_eventTap = CGEventTapCreate(
+    kCGSessionEventTap,
+    kCGHeadInsertEventTap,
+    kCGEventTapOptionListenOnly,
+    eventMask,
+    EventTapCallback,
+    NULL
+  );
+
+  if (g_eventTap == NULL) {
+    LOG_ERROR("pointermonitor", "Failed to create event tap. Make sure accessibility permissions are granted.");
+    return 3;
+  }
+
+  g_runLoopSource = CFMachPortCreateRunLoopSource(kCFAllocatorDefault, g_eventTap, 0);
+  if (g_runLoopSource == NULL) {
+    LOG_ERROR("pointermonitor", "Failed to create run loop source");
+    CFRelease(g_eventTap);
+    g_eventTap = NULL;
+    return 4;
+  }
+
+  CGEventTapEnable(g_eventTap, true);
+
+  if (pthread_create(&g_thread, NULL, EventTapThread, NULL) != 0) {
+    LOG_ERROR("pointermonitor", "Failed to create event tap thread");
+    CFRelease(g_runLoopSource);
+    g_runLoopSource = NULL;
+    CFRelease(g_eventTap);
+    g_eventTap = NULL;
+    return 5;
+  }
+
+  return 0;
+}
+
+static void PlatformStop(void) {
+  if (g_runLoop != NULL) {
+    CFRunLoopStop(g_runLoop);
+    g_runLoop = NULL;
+  }
+  pthread_join(g_thread, NULL);
+
+  if (g_eventTap != NULL) {
+    CGEventTapEnable(g_eventTap, false);
+    CFRelease(g_eventTap);
+    g_eventTap = NULL;
+  }
+  if (g_runLoopSource != NULL) {
+    CFRelease(g_runLoopSource);
+    g_runLoopSource = NULL;
+  }
+}
+
+#elif defined(_WIN32)
+
+static HHOOK g_hook = NULL;
+static HANDLE g_thread = NULL;
+static DWORD g_threadId = 0;
+
+static void ResolvePosition(int* x, int* y) {
+  // Every low-level hook event carries its location
+  (void)x;
+  (void)y;
+}
+
+// Low-level mouse hook callback
+static LRESULT CALLBACK LowLevelMouseProc(int nCode, WPARAM wParam, LPARAM lParam) {
+  if (nCode >= 0) {
+    MSLLHOOKSTRUCT* info = (MSLLHOOKSTRUCT*)lParam;
+    int position[2] = { info->pt.x, info->pt.y };
+    PointerButton xButton = HIWORD(info->mouseData) == XBUTTON1 ? POINTER_BUTTON_X1 : POINTER_BUTTON_X2;
+    double wheel = (double)(short)HIWORD(info->mouseData) / WHEEL_DELTA;
+
+    switch (wParam) {
+      case WM_MOUSEMOVE:
+        PointerMoved(position[0], position[1]);
+        break;
+      case WM_LBUTTONDOWN: PointerInput(POINTER_EVENT_DOWN, position, POINTER_BUTTON_LEFT, 0, 0); break;
+      case WM_LBUTTONUP: PointerInput(POINTER_EVENT_UP, position, POINTER_BUTTON_LEFT, 0, 0); break;
+      case WM_RBUTTONDOWN: PointerInput(POINTER_EVENT_DOWN, position, POINTER_BUTTON_RIGHT, 0, 0); break;
+      case WM_RBUTTONUP: PointerInput(POINTER_EVENT_UP, position, POINTER_BUTTON_RIGHT, 0, 0); break;
+      case WM_MBUTTONDOWN: PointerInput(POINTER_EVENT_DOWN, position, POINTER_BUTTON_MIDDLE, 0, 0); break;
+      case WM_MBUTTONUP: PointerInput(POINTER_EVENT_UP, position, POINTER_BUTTON_MIDDLE, 0, 0); break;
+      case WM_XBUTTONDOWN: PointerInput(POINTER_EVENT_DOWN, position, xButton, 0, 0); break;
+      case WM_XBUTTONUP: PointerInput(POINTER_EVENT_UP, position, xButton, 0, 0); break;
+      // Positive wheel rotation is away from the user (scrolling up)
+      case WM_MOUSEWHEEL: PointerInput(POINTER_EVENT_WHEEL, position, POINTER_BUTTON_LEFT, 0, -wheel); break;
+      case WM_MOUSEHWHEEL: PointerInput(POINTER_EVENT_WHEEL, position, POINTER_BUTTON_LEFT, wheel, 0); break;
+      default: break;
+    }
+  }
+
+  return CallNextHookEx(g_hook, nCode, wParam, lParam);
+}
+
+// Thread function to run the message loop
+static DWORD WINAPI HookThread(LPVOID lpParam) {
+  (void)lpParam;
+
+  // Install the hook on this thread
+  g_hook = SetWindowsHookEx(WH_MOUSE_LL, LowLevelMouseProc, NULL, 0);
+  if (g_hook == NULL) {
+    LOG_ERROR("pointermonitor", "Failed to install mouse hook");
+    return 1;
+  }
+
+  // Run message loop
+  MSG msg;
+  while (GetMessage(&msg, NULL, 0, 0) > 0) {
+    TranslateMessage(&msg);
+    DispatchMessage(&msg);
+  }
+
+  // Unhook when done
+  if (g_hook != NULL) {
+    UnhookWindowsHookEx(g_hook);
+    g_hook = NULL;
+  }
+
+  return 0;
+}
+
+static int PlatformStart(void) {
+  g_thread = CreateThread(NULL, 0, HookThread, NULL, 0, &g_threadId);
+  if (g_thread == NULL) {
+    LOG_ERROR("pointermonitor", "Failed to create hook thread");
+    return 3;
+  }
+  return 0;
+}
+
+static void PlatformStop(void) {
+  if (g_threadId != 0) {
+    PostThreadMessage(g_threadId, WM_QUIT, 0, 0);
+  }
+  if (g_thread != NULL) {
+    WaitForSingleObject(g_thread, 5000);
+    CloseHandle(g_thread);
+    g_thread = NULL;
+    g_threadId = 0;
+  }
+}
+
+#elif defined(__linux__)
+
+#define MAX_POINTER_DEVICES 16
+
+typedef struct {
+  struct libevdev* evdev;
+  int fd;
+  bool hiResWheel;      // Reports REL_WHEEL_HI_RES, so REL_WHEEL is redundant
+  int dx, dy;           // Relative motion in the current frame
+  bool absMoved;        // Absolute motion in the current frame
+  int absX, absY;
+  int wheel, hwheel;    // Wheel motion in the current frame, 120 per notch
+} PointerDevice;
+
+static PointerDevice g_devices[MAX_POINTER_DEVICES];
+static int g_deviceCount = 0;
+static pthread_t g_thread;
+static volatile bool g_stopRequested = false;
+
+static void ResolvePosition(int* x, int* y) {
+  // evdev only reports device motion: the on-screen position comes from X
+  // Without an X server, relative motion is accumulated from the start
+  Display* display = X11Acquire();
+  if (display == NULL) {
+    return;
+  }
+
+  Window rootReturn, childReturn;
+  int rootX, rootY, windowX, windowY;
+  unsigned int mask;
+  if (XQueryPointer(display, DefaultRootWindow(display), &rootReturn, &childReturn, &rootX, &rootY, &windowX, &windowY, &mask)) {
+    *x = rootX;
+    *y = rootY;
+  }
+  X11Release();
+}
+
+// Check if a device is one of our own uinput devices
+static bool IsOwnDevice(struct libevdev* dev) {
+  const char* name = libevdev_get_name(dev);
+  return name != NULL && strncmp(name, UINPUT_DEVICE_PREFIX, strlen(UINPUT_DEVICE_PREFIX)) == 0;
+}
+
+// Mice and trackballs (relative), tablets and touchpads (absolute)
+static bool IsPointerDevice(struct libevdev* dev) {
+  if (IsOwnDevice(dev)) {
+    return false;
+  }
+  bool relative = libevdev_has_event_code(dev, EV_REL, REL_X) && libevdev_has_event_code(dev, EV_REL, REL_Y);
+  bool absolute = libevdev_has_event_code(dev, EV_ABS, ABS_X) && libevdev_has_event_code(dev, EV_ABS, ABS_Y);
+  bool buttons = libevdev_has_event_code(dev, EV_KEY, BTN_LEFT) || libevdev_has_event_code(dev, EV_KEY, BTN_TOUCH);
+  return (relative || absolute) && buttons;
+}
+
+static void OpenPointerDevices(void) {
+  DIR* dir = opendir("/dev/input");
+  if (dir == NULL) {
+    return;
+  }
+
+  struct dirent* entry;
+  char device_path[512];
+  while ((entry = readdir(dir)) != NULL && g_deviceCount < MAX_POINTER_DEVICES) {
+    if (strncmp(entry->d_name, "event", 5) != 0) {
+      continue;
+    }
+
+    snprintf(device_path, sizeof(device_path), "/dev/input/%s", entry->d_name);
+    int fd = open(device_path, O_RDONLY | O_NONBLOCK);
+    if (fd < 0) {
+      continue;
+    }
+
+    struct libevdev* dev = NULL;
+    if (libevdev_new_from_fd(fd, &dev) == 0 && IsPointerDevice(dev)) {
+      PointerDevice* device = &g_devices[g_deviceCount++];
+      memset(device, 0, sizeof(*device));
+      device->evdev = dev;
+      device->fd = fd;
+      device->hiResWheel = libevdev_has_event_code(dev, EV_REL, REL_WHEEL_HI_RES);
+      LOG_INFO("pointermonitor", "Found pointer device: %s (%s)", device_path, libevdev_get_name(dev));
+      continue;
+    }
+
+    if (dev != NULL) {
+      libevdev_free(dev);
+    }
+    close(fd);
+  }
+
+  closedir(dir);
+}
+
+static void ClosePointerDevices(void) {
+  for (int i = 0; i < g_deviceCount; i++) {
+    libevdev_free(g_devices[i].evdev);
+    close(g_devices[i].fd);
+  }
+  g_deviceCount = 0;
+}
+
+static PointerButton LinuxButton(uint16_t code) {
+  switch (code) {
+    case BTN_RIGHT: return POINTER_BUTTON_RIGHT;
+    case BTN_MIDDLE: return POINTER_BUTTON_MIDDLE;
+    case BTN_SIDE: return POINTER_BUTTON_X1;
+    case BTN_EXTRA: return POINTER_BUTTON_X2;
+    default: return POINTER_BUTTON_LEFT;
+  }
+}
+
+// Report the motion collected so far in the current frame
+static void FlushFrameMotion(PointerDevice* device) {
+  if (device->dx != 0 || device->dy != 0) {
+    PointerMovedBy(device->dx, device->dy);
+    device->dx = 0;
+    device->dy = 0;
+  }
+  if (device->absMoved) {
+    PointerMoved(device->absX, device->absY);
+    device->absMoved = false;
+  }
+}
+
+static void HandleEvent(PointerDevice* device, const struct input_event* ev) {
+  switch (ev->type) {
+    case EV_REL:
+      if (ev->code == REL_X) {
+        device->dx += ev->value;
+      } else if (ev->code == REL_Y) {
+        device->dy += ev->value;
+      } else if (ev->code == REL_WHEEL_HI_RES) {
+        device->wheel += ev->value;
+      } else if (ev->code == REL_HWHEEL_HI_RES) {
+        device->hwheel += ev->value;
+      } else if (ev->code == REL_WHEEL && !device->hiResWheel) {
+        device->wheel += ev->value * 120;
+      } else if (ev->code == REL_HWHEEL && !device->hiResWheel) {
+        device->hwheel += ev->value * 120;
+      }
+      break;
+    case EV_ABS:
+      if (ev->code == ABS_X) {
+        device->absX = ev->value;
+        device->absMoved = true;
+      } else if (ev->code == ABS_Y) {
+        device->absY = ev->value;
+        device->absMoved = true;
+      }
+      break;
+    case EV_KEY:
+      // Buttons are delivered as soon as they are read, after the motion preceding them
+      if (ev->code >= BTN_LEFT && ev->code <= BTN_EXTRA && ev->value != 2) {
+        FlushFrameMotion(device);
+        PointerInput(ev->value ? POINTER_EVENT_DOWN : POINTER_EVENT_UP, NULL, LinuxButton(ev->code), 0, 0);
+      }
+      break;
+    case EV_SYN:
+      if (ev->code == SYN_REPORT) {
+        FlushFrameMotion(device);
+        if (device->wheel != 0 || device->hwheel != 0) {
+          // REL_WHEEL counts up, deltaY counts down
+          PointerInput(POINTER_EVENT_WHEEL, NULL, POINTER_BUTTON_LEFT, device->hwheel / 120.0, -device->wheel / 120.0);
+          device->wheel = 0;
+          device->hwheel = 0;
+        }
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+// Thread function to read pointer events from every device
+static void* PointerThread(void* arg) {
+  (void)arg;
+
+  struct pollfd fds[MAX_POINTER_DEVICES];
+  for (int i = 0; i < g_deviceCount; i++) {
+    fds[i].fd = g_devices[i].fd;
+    fds[i].events = POLLIN;
+  }
+
+  while (!g_stopRequested) {
+    // Use a timeout to allow checking g_stopRequested
+    int ready = poll(fds, g_deviceCount, 100);
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+
+    for (int i = 0; i < g_deviceCount; i++) {
+      if (fds[i].revents == 0) {
+        continue;
+      }
+      if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+        // Device unplugged
+        fds[i].fd = -1;
+        continue;
+      }
+
+      struct input_event ev;
+      int rc;
+      while ((rc = libevdev_next_event(g_devices[i].evdev, LIBEVDEV_READ_FLAG_NORMAL, &ev)) == LIBEVDEV_READ_STATUS_SUCCESS ||
+             rc == LIBEVDEV_READ_STATUS_SYNC) {
+        HandleEvent(&g_devices[i], &ev);
+      }
+    }
+  }
+
+  return NULL;
+}
+
+static int PlatformStart(void) {
+  OpenPointerDevices();
+  if (g_deviceCount == 0) {
+    LOG_ERROR("pointermonitor", "Failed to find pointer devices. Make sure you have permission to access /dev/input devices.");
+    return 3;
+  }
+
+  g_stopRequested = false;
+  if (pthread_create(&g_thread, NULL, PointerThread, NULL) != 0) {
+    LOG_ERROR("pointermonitor", "Failed to create pointer thread");
+    ClosePointerDevices();
+    return 5;
+  }
+
+  return 0;
+}
+
+static void PlatformStop(void) {
+  g_stopRequested = true;
+  pthread_join(g_thread, NULL);
+  ClosePointerDevices();
+}
+
+#else
+
+static void ResolvePosition(int* x, int* y) {
+  (void)x;
+  (void)y;
+}
+
+static int PlatformStart(void) {
+  return 1; // Not supported
+}
+
+static void PlatformStop(void) {
+}
+
+#endif
+
+int StartPointerMonitor(napi_env env, napi_value callback, uint32_t rate) {
+  if (g_running) {
+    LOG_DEBUG("pointermonitor", "Already running");
+    return 1; // Already running
+  }
+
+  // Create threadsafe function
+  napi_value resourceName;
+  napi_create_string_utf8(env, "PointerMonitorCallback", NAPI_AUTO_LENGTH, &resourceName);
+
+  napi_status status = napi_create_threadsafe_function(
+    env,
+    callback,
+    NULL,                    // async_resource
+    resourceName,            // async_resource_name
+    0,                       // max_queue_size (0 = unlimited)
+    1,                       // initial_thread_count
+    NULL,                    // thread_finalize_data
+    NULL,                    // thread_finalize_cb
+    NULL,                    // context
+    CallJS,                  // call_js_cb
+    &g_tsfn
+  );
+
+  if (status != napi_ok) {
+    LOG_ERROR("pointermonitor", "Failed to create threadsafe function");
+    return 2;
+  }
+
+  // Start the pacer before the event source can record motion
+  MutexInit(&g_lock);
+  ConditionInit(&g_wake);
+  g_stopPacer = false;
+  g_motionPending = false;
+  g_lastMotionMs = 0;
+  g_intervalMs = rate > 0 ? 1000 / rate : 0;
+  if (!ThreadCreate(&g_pacer, PacerThread, NULL)) {
+    LOG_ERROR("pointermonitor", "Failed to create pacer thread");
+    ConditionDestroy(&g_wake);
+    MutexDestroy(&g_lock);
+    napi_release_threadsafe_function(g_tsfn, napi_tsfn_abort);
+    g_tsfn = NULL;
+    return 5;
+  }
+
+  int result = PlatformStart();
+  if (result != 0) {
+    StopPacer();
+    napi_release_threadsafe_function(g_tsfn, napi_tsfn_abort);
+    g_tsfn = NULL;
+    return result;
+  }
+
+  g_running = true;
+  LOG_INFO("pointermonitor", "Started (%u ms between moves)", g_intervalMs);
+  return 0;
+}
+
+int StopPointerMonitor(void) {
+  if (!g_running) {
+    LOG_DEBUG("pointermonitor", "Not running");
+    return 1; // Not running
+  }
+
+  g_running = false;
+
+  // Stop the event source first so nothing records motion once the pacer is gone
+  PlatformStop();
+  StopPacer();
+
+  // Release threadsafe function
+  if (g_tsfn != NULL) {
+    napi_release_threadsafe_function(g_tsfn, napi_tsfn_release);
+    g_tsfn = NULL;
+  }
+
+  return 0;
+}
+
+bool IsPointerMonitorRunning(void) {
+  return g_running;
+}
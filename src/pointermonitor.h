@@ -0,0 +1,42 @@
+#ifndef POINTERMONITOR_H
+#define POINTERMONITOR_H
+
+#include <node_api.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "mouse.h"
+
+// Pointer event types
+#define POINTER_EVENT_MOVE 1
+#define POINTER_EVENT_DOWN 2
+#define POINTER_EVENT_UP 3
+#define POINTER_EVENT_WHEEL 4
+
+// Default motion rate in events per second
+#define POINTER_MONITOR_DEFAULT_RATE 60
+
+// Pointer event structure passed to JavaScript callback
+typedef struct {
+  int type;              // POINTER_EVENT_MOVE, DOWN, UP or WHEEL
+  int x;                 // Screen position when the event happened
+  int y;
+  PointerButton button;  // For DOWN and UP
+  double deltaX;         // For WHEEL, in notches, positive scrolls right
+  double deltaY;         // For WHEEL, in notches, positive scrolls down
+} PointerEvent;
+
+// Start monitoring pointer events
+// callback: JavaScript function to call when events occur
+// rate: maximum number of move events per second (latest position wins),
+//       buttons and wheel are delivered immediately
+// Returns: 0 on success, non-zero on error
+int StartPointerMonitor(napi_env env, napi_value callback, uint32_t rate);
+
+// Stop monitoring pointer events
+// Returns: 0 on success, non-zero on error
+int StopPointerMonitor(void);
+
+// Check if monitor is running
+bool IsPointerMonitorRunning(void);
+
+#endif // POINTERMONITOR_H
@@ -0,0 +1,277 @@
+#include "scheduler.h"
+#include "keysender.h"
+#include "textsender.h"
+#include "mouse.h"
+#include "threads.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach/mach_time.h>
+#elif defined(__linux__)
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#define MAX_INPUT_RATES 32
+#define MAX_TARGET_LENGTH 128
+
+// Below this the remaining wait is spun: timer wakeups are not finer than that
+#define SPIN_THRESHOLD_NS 200000
+
+typedef struct {
+  char target[MAX_TARGET_LENGTH];
+  uint32_t intervalUs;
+} InputRate;
+
+#ifdef _WIN32
+static SRWLOCK g_ratesLock = SRWLOCK_INIT;
+#define RATES_LOCK() AcquireSRWLockExclusive(&g_ratesLock)
+#define RATES_UNLOCK() ReleaseSRWLockExclusive(&g_ratesLock)
+#else
+static pthread_mutex_t g_ratesLock = PTHREAD_MUTEX_INITIALIZER;
+#define RATES_LOCK() pthread_mutex_lock(&g_ratesLock)
+#define RATES_UNLOCK() pthread_mutex_unlock(&g_ratesLock)
+#endif
+
+static InputRate g_rates[MAX_INPUT_RATES];
+static size_t g_rateCount = 0;
+static uint32_t g_defaultIntervalUs = 0;
+
+void SetInputRate(const char* target, uint32_t intervalUs) {
+  RATES_LOCK();
+  if (target == NULL || target[0] == '\0') {
+    g_defaultIntervalUs = intervalUs;
+    RATES_UNLOCK();
+    return;
+  }
+
+  for (size_t i = 0; i < g_rateCount; i++) {
+    if (strcmp(g_rates[i].target, target) == 0) {
+      g_rates[i].intervalUs = intervalUs;
+      RATES_UNLOCK();
+      return;
+    }
+  }
+
+  if (g_rateCount < MAX_INPUT_RATES) {
+    snprintf(g_rates[g_rateCount].target, MAX_TARGET_LENGTH, "%s", target);
+    g_rates[g_rateCount].intervalUs = intervalUs;
+    g_rateCount++;
+  }
+  RATES_UNLOCK();
+}
+
+uint32_t GetInputRate(const char* target) {
+  RATES_LOCK();
+  uint32_t intervalUs = g_defaultIntervalUs;
+  if (target != NULL) {
+    for (size_t i = 0; i < g_rateCount; i++) {
+      if (strcmp(g_rates[i].target, target) == 0) {
+        intervalUs = g_rates[i].intervalUs;
+        break;
+      }
+    }
+  }
+  RATES_UNLOCK();
+  return intervalUs;
+}
+
+#ifdef _WIN32
+
+typedef struct {
+  HANDLE timer;
+  LARGE_INTEGER frequency;
+} Clock;
+
+// Not in older SDK headers
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+static void ClockOpen(Clock* clock) {
+  QueryPerformanceFrequency(&clock->frequency);
+  // High resolution timers need Windows 10 1803, fall back to a regular one
+  clock->timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+  if (clock->timer == NULL) {
+    clock->timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+  }
+}
+
+static void ClockClose(Clock* clock) {
+  if (clock->timer != NULL) CloseHandle(clock->timer);
+}
+
+static uint64_t ClockNow(Clock* clock) {
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  return (uint64_t)((double)counter.QuadPart * 1e9 / (double)clock->frequency.QuadPart);
+}
+
+static void ClockSleepUntil(Clock* clock, uint64_t target) {
+  uint64_t now = ClockNow(clock);
+  if (target > now + SPIN_THRESHOLD_NS && clock->timer != NULL) {
+    // Relative due time in 100ns units (negative)
+    LARGE_INTEGER due;
+    due.QuadPart = -(LONGLONG)((target - now - SPIN_THRESHOLD_NS) / 100);
+    if (SetWaitableTimer(clock->timer, &due, 0, NULL, NULL, FALSE)) {
+      WaitForSingleObject(clock->timer, INFINITE);
+    }
+  }
+  while (ClockNow(clock) < target) {
+    YieldProcessor();
+  }
+}
+
+#elif defined(__APPLE__)
+
+typedef struct {
+  mach_timebase_info_data_t timebase;
+} Clock;
+
+static void ClockOpen(Clock* clock) {
+  mach_timebase_info(&clock->timebase);
+}
+
+static void ClockClose(Clock* clock) {
+  (void)clock;
+}
+
+static uint64_t ClockNow(Clock* clock) {
+  return mach_absolute_time() * clock->timebase.numer / clock->timebase.denom;
+}
+
+static void ClockSleepUntil(Clock* clock, uint64_t target) {
+  uint64_t now = ClockNow(clock);
+  if (target > now + SPIN_THRESHOLD_NS) {
+    uint64_t ticks = (target - SPIN_THRESHOLD_NS) * clock->timebase.denom / clock->timebase.numer;
+    mach_wait_until(ticks);
+  }
+  while (ClockNow(clock) < target) {
+  }
+}
+
+#elif defined(__linux__)
+
+typedef struct {
+  int timer;
+} Clock;
+
+static void ClockOpen(Clock* clock) {
+  clock->timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+}
+
+static void ClockClose(Clock* clock) {
+  if (clock->timer >= 0) close(clock->timer);
+}
+
+static uint64_t ClockNow(Clock* clock) {
+  (void)clock;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static void ClockSleepUntil(Clock* clock, uint64_t target) {
+  uint64_t now = ClockNow(clock);
+  if (target > now + SPIN_THRESHOLD_NS && clock->timer >= 0) {
+    // Absolute expiry on the monotonic clock: no drift from computing relative delays
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    uint64_t wake = target - SPIN_THRESHOLD_NS;
+    spec.it_value.tv_sec = (time_t)(wake / 1000000000ULL);
+    spec.it_value.tv_nsec = (long)(wake % 1000000000ULL);
+    if (timerfd_settime(clock->timer, TFD_TIMER_ABSTIME, &spec, NULL) == 0) {
+      uint64_t expirations;
+      while (read(clock->timer, &expirations, sizeof(expirations)) < 0 && ClockNow(clock) < wake) {
+        // Interrupted by a signal: wait again
+      }
+    }
+  }
+  while (ClockNow(clock) < target) {
+  }
+}
+
+#else
+
+typedef struct {
+  int unused;
+} Clock;
+
+static void ClockOpen(Clock* clock) { (void)clock; }
+static void ClockClose(Clock* clock) { (void)clock; }
+static uint64_t ClockNow(Clock* clock) { (void)clock; return MonotonicMillis() * 1000000ULL; }
+static void ClockSleepUntil(Clock* clock, uint64_t target) {
+  while (ClockNow(clock) < target) {
+  }
+}
+
+#endif
+
+static uint32_t PlayEvent(const ScheduledEvent* event) {
+  switch (event->type) {
+    case SCHEDULED_KEY: {
+      uint32_t result = InjectKeyTransition(event->keyCode, true, event->useModifier);
+      if (result == 0) {
+        result = InjectKeyTransition(event->keyCode, false, event->useModifier);
+      }
+      return result;
+    }
+    case SCHEDULED_KEY_DOWN:
+      return InjectKeyTransition(event->keyCode, true, event->useModifier);
+    case SCHEDULED_KEY_UP:
+      return InjectKeyTransition(event->keyCode, false, event->useModifier);
+    case SCHEDULED_TEXT: {
+      // The chunk is played in one batch: pacing is the scheduler's job here
+      TypeTextOptions options;
+      TypeTextDefaultOptions(&options);
+      options.chunkSize = (uint32_t)(event->length > 0 ? event->length : 1);
+      options.chunkDelay = 0;
+      return TypeText(event->text, event->length, &options);
+    }
+    case SCHEDULED_CLICK:
+      return MouseClick(event->x, event->y) ? 0 : 3;
+    default:
+      return 1;
+  }
+}
+
+uint32_t RunSchedule(const ScheduledEvent* events, size_t count, ScheduleStats* stats) {
+  memset(stats, 0, sizeof(*stats));
+  if (count == 0) {
+    return 0;
+  }
+
+  Clock clock;
+  ClockOpen(&clock);
+
+  double totalJitterNs = 0;
+  uint64_t start = ClockNow(&clock);
+
+  for (size_t i = 0; i < count; i++) {
+    uint64_t target = start + events[i].offsetNs;
+    ClockSleepUntil(&clock, target);
+
+    // Lateness is measured right before injecting
+    uint64_t now = ClockNow(&clock);
+    double jitterNs = now > target ? (double)(now - target) : 0;
+    totalJitterNs += jitterNs;
+    if (jitterNs / 1000.0 > stats->maxJitterUs) {
+      stats->maxJitterUs = jitterNs / 1000.0;
+    }
+
+    if (PlayEvent(&events[i]) == 0) {
+      stats->injected++;
+    } else {
+      stats->failed++;
+    }
+  }
+
+  stats->meanJitterUs = totalJitterNs / 1000.0 / (double)count;
+
+  ClockClose(&clock);
+  return stats->failed > 0 ? 3 : 0;
+}
@@ -0,0 +1,56 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Kinds of synthetic events the scheduler can play
+typedef enum {
+  SCHEDULED_KEY = 1,      // Key press (down then up)
+  SCHEDULED_KEY_DOWN,     // Key down only
+  SCHEDULED_KEY_UP,       // Key up only
+  SCHEDULED_TEXT,         // Text chunk (see TypeText)
+  SCHEDULED_CLICK         // Left click at x, y (see MouseClick)
+} ScheduledEventType;
+
+typedef struct {
+  ScheduledEventType type;
+  uint64_t offsetNs;      // Target time relative to the start of the schedule
+  uint16_t keyCode;       // Native key code for key events
+  bool useModifier;       // Ctrl/Command for key events
+  char* text;             // UTF-8 text for text events (owned by the caller)
+  size_t length;
+  int x;                  // Coordinates for click events
+  int y;
+} ScheduledEvent;
+
+// Timing report of a schedule run
+typedef struct {
+  uint32_t injected;      // Events injected successfully
+  uint32_t failed;        // Events the OS rejected
+  double meanJitterUs;    // Mean lateness against the target offsets
+  double maxJitterUs;     // Worst lateness
+} ScheduleStats;
+
+// Play events at their exact offsets, events must be sorted by offset
+// Waits use timerfd on Linux, mach_wait_until on macOS and high-resolution waitable timers on Windows
+// Returns 0 on success, 3 if some events could not be injected
+uint32_t RunSchedule(const ScheduledEvent* events, size_t count, ScheduleStats* stats);
+
+// Set the default interval between events for a target (application name or any caller-chosen key)
+// A NULL target sets the global default
+void SetInputRate(const char* target, uint32_t intervalUs);
+
+// Get the interval for a target, falling back to the global default
+uint32_t GetInputRate(const char* target);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCHEDULER_H
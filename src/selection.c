@@ -1,6 +1,8 @@
 #include "selection.h"
+#include "log.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -8,33 +10,47 @@
 #include "process.h"
 #include <ApplicationServices/ApplicationServices.h>
 #include <CoreFoundation/CoreFoundation.h>
+#elif defined(__linux__)
+#include "x11.h"
+#include <X11/Xatom.h>
 #endif
 
-uint32_t GetSelectedText(char *buffer, size_t buffer_size)
+void FreeSelectedText(SelectedText *text)
 {
-  if (buffer == NULL || buffer_size == 0)
+  free(text->data);
+  text->data = NULL;
+  text->length = 0;
+}
+
+uint32_t GetSelectedText(SelectedText *text, uint32_t timeoutMs)
+{
+  if (text == NULL)
   {
     return 0;
   }
+  text->data = NULL;
+  text->length = 0;
+  text->encoding = SELECTED_TEXT_UTF8;
 
 #ifdef _WIN32
+  (void)timeoutMs;
+
   // Dummy implementation for Windows
   const char *dummyText = "This is a dummy selected text on Windows";
   size_t textLength = strlen(dummyText);
 
-  if (textLength >= buffer_size)
-  {
-    strncpy(buffer, dummyText, buffer_size - 1);
-    buffer[buffer_size - 1] = '\0';
-  }
-  else
+  text->data = malloc(textLength + 1);
+  if (text->data == NULL)
   {
-    strcpy(buffer, dummyText);
+    return 0;
   }
+  memcpy(text->data, dummyText, textLength + 1);
+  text->length = textLength;
 
   return 1;
 
 #elif defined(__APPLE__)
+  (void)timeoutMs;
 
   // // // Get the system-wide AXUIElementRef for the foreground application
   // AXUIElementRef systemWideElement = AXUIElementCreateSystemWide();
@@ -61,7 +77,6 @@ uint32_t GetSelectedText(char *buffer, size_t buffer_size)
   pid_t pid = GetForemostApplicationPID();
   if (pid == 0)
   {
-    buffer[0] = '\0';
     return 0;
   }
 
@@ -69,9 +84,8 @@ uint32_t GetSelectedText(char *buffer, size_t buffer_size)
   AXUIElementRef focusedApp = AXUIElementCreateApplication(pid);
   if (focusedApp == NULL)
   {
-    printf("Error: Unable to get focused application\n");
+    LOG_DEBUG("selection", "Unable to get focused application");
     // CFRelease(systemWideElement);
-    buffer[0] = '\0';
     return 0;
   }
 
@@ -88,10 +102,9 @@ uint32_t GetSelectedText(char *buffer, size_t buffer_size)
 
   if (result != kAXErrorSuccess || focusedElement == NULL)
   {
-    printf("Error: Unable to get focused UI element: %d\n", result);
+    LOG_DEBUG("selection", "Unable to get focused UI element: %d", result);
     CFRelease(focusedApp);
     // CFRelease(systemWideElement);
-    buffer[0] = '\0';
     return 0;
   }
 
@@ -115,7 +128,7 @@ uint32_t GetSelectedText(char *buffer, size_t buffer_size)
 
   if (result != kAXErrorSuccess || selectedText == NULL || CFStringGetLength(selectedText) == 0)
   {
-    printf("Warning: Trying Webkit compatibility\n");
+    LOG_DEBUG("selection", "Trying Webkit compatibility");
 
     CFTypeRef range;
     result = AXUIElementCopyAttributeValue(focusedElement, CFSTR("AXSelectedTextMarkerRange"), &range);
@@ -129,11 +142,10 @@ uint32_t GetSelectedText(char *buffer, size_t buffer_size)
 
   if (result != kAXErrorSuccess || selectedText == NULL)
   {
-    printf("Error: Unable to get selected text or value\n");
+    LOG_DEBUG("selection", "Unable to get selected text or value");
     CFRelease(focusedElement);
     CFRelease(focusedApp);
     // CFRelease(systemWideElement);
-    buffer[0] = '\0';
     return 0;
   }
 
@@ -147,8 +159,7 @@ uint32_t GetSelectedText(char *buffer, size_t buffer_size)
     if (textLength == 0)
     {
       // Selected text is empty
-      buffer[0] = '\0';
-      printf("Info: Selected text is empty\n");
+      LOG_DEBUG("selection", "Selected text is empty");
 
       // Clean up
       CFRelease(selectedText);
@@ -159,26 +170,20 @@ uint32_t GetSelectedText(char *buffer, size_t buffer_size)
       return 1; // Success but empty
     }
 
-    // Calculate buffer requirements
-    CFIndex maxSize = CFStringGetMaximumSizeForEncoding(textLength, kCFStringEncodingUTF8) + 1;
-
-    if (maxSize > (long)buffer_size)
+    // Copy the UTF-16 code units as they are, sized from the source
+    UniChar *characters = (UniChar *)malloc(((size_t)textLength + 1) * sizeof(UniChar));
+    Boolean success = characters != NULL;
+    if (success)
     {
-      printf("Warning: Selected text length (%ld bytes) exceeds buffer size (%zu bytes), text may be truncated\n",
-             (long)maxSize, buffer_size);
+      CFStringGetCharacters(selectedText, CFRangeMake(0, textLength), characters);
+      characters[textLength] = 0;
+      text->data = characters;
+      text->length = (size_t)textLength;
+      text->encoding = SELECTED_TEXT_UTF16;
     }
-
-    // Convert the string
-    Boolean success = CFStringGetCString(
-        selectedText,
-        buffer,
-        buffer_size,
-        kCFStringEncodingUTF8);
-
-    if (!success)
+    else
     {
-      printf("Error: Unable to convert selected text to C string\n");
-      buffer[0] = '\0';
+      LOG_WARN("selection", "Unable to allocate %ld characters for the selected text", (long)textLength);
     }
 
     // Clean up
@@ -192,8 +197,7 @@ uint32_t GetSelectedText(char *buffer, size_t buffer_size)
   else
   {
     // This shouldn't happen due to earlier checks, but just in case
-    printf("Error: Selected text reference is NULL\n");
-    buffer[0] = '\0';
+    LOG_DEBUG("selection", "Selected text reference is NULL");
 
     // Clean up
     CFRelease(focusedElement);
@@ -203,9 +207,41 @@ uint32_t GetSelectedText(char *buffer, size_t buffer_size)
     return 0;
   }
 
+#elif defined(__linux__)
+
+  Display *display = X11Acquire();
+  if (display == NULL)
+  {
+    LOG_DEBUG("selection", "No X server");
+    return 0;
+  }
+  Atom utf8String = XInternAtom(display, "UTF8_STRING", False);
+  X11Release();
+
+  // Prefer UTF-8, old clients only offer Latin-1 STRING (passed on as is)
+  unsigned char *data = NULL;
+  size_t size = 0;
+  int result = X11ReadSelection(XA_PRIMARY, utf8String, timeoutMs, &data, &size, NULL);
+  if (result == 3)
+  {
+    result = X11ReadSelection(XA_PRIMARY, XA_STRING, timeoutMs, &data, &size, NULL);
+    text->encoding = SELECTED_TEXT_LATIN1;
+  }
+
+  if (result != 0)
+  {
+    LOG_DEBUG("selection", "Unable to read PRIMARY selection: %d", result);
+    text->encoding = SELECTED_TEXT_UTF8;
+    return 0;
+  }
+
+  text->data = data;
+  text->length = size;
+  return 1;
+
 #else
   // Fallback for unsupported platforms
-  strcpy(buffer, "Platform not supported");
+  (void)timeoutMs;
   return 0;
 #endif
 }
@@ -4,13 +4,34 @@
 #include <stdint.h>
 #include <stddef.h>
 
+// How long to wait for the owner of the selection to answer (Linux)
+#define SELECTION_TIMEOUT_MS 1000
+
+// Encoding of the selected text, as produced by the platform
+typedef enum {
+  SELECTED_TEXT_UTF8,
+  SELECTED_TEXT_UTF16,   // macOS: the CFString code units
+  SELECTED_TEXT_LATIN1   // Linux: STRING selections from old clients
+} SelectedTextEncoding;
+
+// Selected text, allocated to the size of the source
+typedef struct {
+  void* data;                     // NUL-terminated, NULL when empty
+  size_t length;                  // In code units (bytes, or UniChars for UTF-16)
+  SelectedTextEncoding encoding;
+} SelectedText;
+
 /**
  * Get the currently selected text from the active application
+ * On Linux this is the PRIMARY selection, read over the shared X connection
  * 
- * @param buffer Buffer to store the selected text
- * @param buffer_size Size of the provided buffer
+ * @param text Receives the text, release it with FreeSelectedText
+ * @param timeoutMs How long to wait for the selection owner (Linux only)
  * @return 1 on success, 0 on failure
  */
-uint32_t GetSelectedText(char* buffer, size_t buffer_size);
+uint32_t GetSelectedText(SelectedText* text, uint32_t timeoutMs);
+
+// Release the text returned by GetSelectedText
+void FreeSelectedText(SelectedText* text);
 
-#endif // SELECTION_H
\ No newline at end of file
+#endif // SELECTION_H
@@ -0,0 +1,295 @@
+#include "selectionwatcher.h"
+#include "selection.h"
+#include "jsstring.h"
+#include "log.h"
+#include "watcher.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __APPLE__
+#include "process.h"
+#include <ApplicationServices/ApplicationServices.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <pthread.h>
+#endif
+
+#ifdef __linux__
+#include <X11/Xlib.h>
+#include <X11/Xatom.h>
+#include <X11/extensions/Xfixes.h>
+#include <poll.h>
+#include <pthread.h>
+#include "x11.h"
+#endif
+
+static void SelectionChanged(void);
+
+// Hash of the text bytes
+static uint64_t HashText(const SelectedText* text) {
+  size_t length = text->length * (text->encoding == SELECTED_TEXT_UTF16 ? 2 : 1);
+  return WatcherHash(WATCHER_FNV_OFFSET_BASIS, text->data, length);
+}
+
+// Read the selection on the reader thread
+static void* ReadSelection(uint64_t* hash) {
+  SelectedText* text = (SelectedText*)calloc(1, sizeof(SelectedText));
+  if (text == NULL) {
+    return NULL;
+  }
+
+  // No owner or no selection counts as an empty selection
+  if (!GetSelectedText(text, SELECTION_TIMEOUT_MS)) {
+    FreeSelectedText(text);
+  }
+
+  *hash = HashText(text);
+  return text;
+}
+
+static napi_value ConvertSelection(napi_env env, void* state) {
+  SelectedText* text = (SelectedText*)state;
+  napi_value value = CreateSelectedTextValue(env, text);
+  free(text);
+  return value;
+}
+
+static void ReleaseSelection(void* state) {
+  SelectedText* text = (SelectedText*)state;
+  FreeSelectedText(text);
+  free(text);
+}
+
+// Platform notification source, started after the reader
+static int PlatformStart(void);
+static void PlatformStop(void);
+
+#ifdef __APPLE__
+
+// How often the observed application follows the frontmost one, in seconds
+#define FOREMOST_CHECK_INTERVAL 0.5
+
+static pthread_t g_thread;
+static volatile bool g_stopRequested = false;
+static CFRunLoopRef g_runLoop = NULL;
+static AXObserverRef g_observer = NULL;
+static AXUIElementRef g_observedApp = NULL;
+static pid_t g_observedPid = 0;
+
+static void ObserverCallback(AXObserverRef observer, AXUIElementRef element, CFStringRef notification, void* refcon) {
+  (void)observer;
+  (void)element;
+  (void)notification;
+  (void)refcon;
+  SelectionChanged();
+}
+
+static void Unobserve(void) {
+  if (g_observer != NULL) {
+    CFRunLoopRemoveSource(CFRunLoopGetCurrent(), AXObserverGetRunLoopSource(g_observer), kCFRunLoopDefaultMode);
+    CFRelease(g_observer);
+    g_observer = NULL;
+  }
+  if (g_observedApp != NULL) {
+    CFRelease(g_observedApp);
+    g_observedApp = NULL;
+  }
+  g_observedPid = 0;
+}
+
+// Notifications registered on the application element cover all its elements
+static void Observe(pid_t pid) {
+  if (pid == g_observedPid) {
+    return;
+  }
+  Unobserve();
+  if (pid == 0) {
+    return;
+  }
+
+  AXObserverRef observer = NULL;
+  if (AXObserverCreate(pid, ObserverCallback, &observer) != kAXErrorSuccess) {
+    LOG_DEBUG("selectionwatcher", "Unable to observe pid %d", (int)pid);
+    return;
+  }
+  AXUIElementRef app = AXUIElementCreateApplication(pid);
+  AXObserverAddNotification(observer, app, kAXSelectedTextChangedNotification, NULL);
+  AXObserverAddNotification(observer, app, kAXFocusedUIElementChangedNotification, NULL);
+  CFRunLoopAddSource(CFRunLoopGetCurrent(), AXObserverGetRunLoopSource(observer), kCFRunLoopDefaultMode);
+
+  g_observer = observer;
+  g_observedApp = app;
+  g_observedPid = pid;
+
+  // Switching application switches selection
+  SelectionChanged();
+}
+
+static void CheckForemost(CFRunLoopTimerRef timer, void* info) {
+  (void)timer;
+  (void)info;
+  Observe(GetForemostApplicationPID());
+}
+
+static void* ObserverThread(void* arg) {
+  (void)arg;
+
+  g_runLoop = CFRunLoopGetCurrent();
+  CFRunLoopTimerRef timer = CFRunLoopTimerCreate(kCFAllocatorDefault, CFAbsoluteTimeGetCurrent(),
+                                                 FOREMOST_CHECK_INTERVAL, 0, 0, CheckForemost, NULL);
+  CFRunLoopAddTimer(g_runLoop, timer, kCFRunLoopDefaultMode);
+
+  // Run in slices so a stop requested before the loop started is not missed
+  while (!g_stopRequested) {
+    CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.25, false);
+  }
+
+  CFRunLoopTimerInvalidate(timer);
+  CFRelease(timer);
+  Unobserve();
+  g_runLoop = NULL;
+  return NULL;
+}
+
+static int PlatformStart(void) {
+  if (!AXIsProcessTrusted()) {
+    LOG_ERROR("selectionwatcher", "Accessibility permissions are required");
+    return 3;
+  }
+
+  g_stopRequested = false;
+  if (pthread_create(&g_thread, NULL, ObserverThread, NULL) != 0) {
+    LOG_ERROR("selectionwatcher", "Failed to create observer thread");
+    return 5;
+  }
+  return 0;
+}
+
+static void PlatformStop(void) {
+  g_stopRequested = true;
+  CFRunLoopRef runLoop = g_runLoop;
+  if (runLoop != NULL) {
+    CFRunLoopStop(runLoop);
+  }
+  pthread_join(g_thread, NULL);
+}
+
+#elif defined(__linux__)
+
+// The watcher has its own connection so it can block on the socket
+static Display* g_display = NULL;
+static Window g_window = None;
+static int g_eventBase = 0;
+static pthread_t g_thread;
+static volatile bool g_stopRequested = false;
+
+static void* XFixesThread(void* arg) {
+  (void)arg;
+
+  struct pollfd pfd = { ConnectionNumber(g_display), POLLIN, 0 };
+  while (!g_stopRequested) {
+    while (XPending(g_display) > 0) {
+      XEvent event;
+      XNextEvent(g_display, &event);
+      if (event.type == g_eventBase + XFixesSelectionNotify) {
+        SelectionChanged();
+      }
+    }
+
+    // Use a timeout to allow checking g_stopRequested
+    poll(&pfd, 1, 100);
+  }
+
+  return NULL;
+}
+
+static int PlatformStart(void) {
+  // Makes sure Xlib is initialized for threads before opening another connection
+  if (!X11Available()) {
+    LOG_ERROR("selectionwatcher", "No X server");
+    return 3;
+  }
+
+  g_display = XOpenDisplay(NULL);
+  if (g_display == NULL) {
+    LOG_ERROR("selectionwatcher", "Failed to open X display");
+    return 3;
+  }
+
+  int errorBase;
+  if (!XFixesQueryExtension(g_display, &g_eventBase, &errorBase)) {
+    LOG_ERROR("selectionwatcher", "XFixes extension not available");
+    XCloseDisplay(g_display);
+    g_display = NULL;
+    return 3;
+  }
+
+  // Owner changes, and owners going away, mean a new (or no) selection
+  g_window = XCreateSimpleWindow(g_display, DefaultRootWindow(g_display), -10, -10, 1, 1, 0, 0, 0);
+  XFixesSelectSelectionInput(g_display, g_window, XA_PRIMARY,
+                             XFixesSetSelectionOwnerNotifyMask |
+                             XFixesSelectionWindowDestroyNotifyMask |
+                             XFixesSelectionClientCloseNotifyMask);
+  XFlush(g_display);
+
+  g_stopRequested = false;
+  if (pthread_create(&g_thread, NULL, XFixesThread, NULL) != 0) {
+    LOG_ERROR("selectionwatcher", "Failed to create XFixes thread");
+    XDestroyWindow(g_display, g_window);
+    XCloseDisplay(g_display);
+    g_display = NULL;
+    return 5;
+  }
+  return 0;
+}
+
+static void PlatformStop(void) {
+  g_stopRequested = true;
+  pthread_join(g_thread, NULL);
+
+  XDestroyWindow(g_display, g_window);
+  XCloseDisplay(g_display);
+  g_window = None;
+  g_display = NULL;
+}
+
+#else
+
+static int PlatformStart(void) {
+  return WATCHER_NOT_SUPPORTED;
+}
+
+static void PlatformStop(void) {
+}
+
+#endif
+
+static const WatcherHooks g_hooks = {
+  "selectionwatcher",
+  "SelectionWatcherCallback",
+  false,                        // Only changes are delivered
+  WATCHER_FNV_OFFSET_BASIS,     // The empty selection
+  ReadSelection,
+  ConvertSelection,
+  ReleaseSelection,
+  PlatformStart,
+  PlatformStop
+};
+
+static Watcher g_watcher = { .hooks = &g_hooks };
+
+// Called by the platform thread for every change notification
+static void SelectionChanged(void) {
+  WatcherChanged(&g_watcher);
+}
+
+int StartSelectionWatcher(napi_env env, napi_value callback, uint32_t debounceMs) {
+  return WatcherStart(&g_watcher, env, callback, debounceMs);
+}
+
+int StopSelectionWatcher(void) {
+  return WatcherStop(&g_watcher);
+}
+
+bool IsSelectionWatcherRunning(void) {
+  return g_watcher.running;
+}
@@ -0,0 +1,29 @@
+#ifndef SELECTIONWATCHER_H
+#define SELECTIONWATCHER_H
+
+#include <node_api.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Default quiet time after the last notification before the text is read
+#define SELECTION_WATCHER_DEFAULT_DEBOUNCE_MS 150
+
+// Start watching selection changes
+// callback: JavaScript function called with the new selected text
+// debounceMs: quiet time after the last change notification before reading the text
+// Notifications come from XFixes (PRIMARY owner changes) on Linux and
+// AXObserver on macOS. The text is only delivered when its content changed.
+// Returns: 0 on success, 1 if already running, 2 or 5 if the callback or its
+// thread cannot be set up, 3 if the notification source is unavailable
+// (no X server or no accessibility permissions), 4 if the platform is not
+// supported
+int StartSelectionWatcher(napi_env env, napi_value callback, uint32_t debounceMs);
+
+// Stop watching selection changes
+// Returns: 0 on success, non-zero on error
+int StopSelectionWatcher(void);
+
+// Check if the watcher is running
+bool IsSelectionWatcherRunning(void);
+
+#endif // SELECTIONWATCHER_H
@@ -0,0 +1,369 @@
+#include "textsender.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <limits.h>
+#elif defined(__APPLE__)
+#include <ApplicationServices/ApplicationServices.h>
+#include <unistd.h>
+#elif defined(__linux__)
+#include "x11.h"
+#include "uinput.h"
+#include <X11/XKBlib.h>
+#include <X11/keysym.h>
+#include <unistd.h>
+#endif
+
+// CGEventKeyboardSetUnicodeString silently truncates longer strings
+#define MAC_MAX_UNICODE_PER_EVENT 20
+
+void TypeTextDefaultOptions(TypeTextOptions* options) {
+  options->chunkSize = TYPE_TEXT_DEFAULT_CHUNK_SIZE;
+  options->chunkDelay = TYPE_TEXT_DEFAULT_CHUNK_DELAY_MS;
+}
+
+// Chunk size to use, within the default and the maximum
+static inline uint32_t ChunkSize(const TypeTextOptions* options) {
+  if (options->chunkSize == 0) {
+    return TYPE_TEXT_DEFAULT_CHUNK_SIZE;
+  }
+  return options->chunkSize < TYPE_TEXT_MAX_CHUNK_SIZE ? options->chunkSize : TYPE_TEXT_MAX_CHUNK_SIZE;
+}
+
+#ifdef _WIN32
+
+uint32_t TypeText(const char* text, size_t length, const TypeTextOptions* options) {
+  if (text == NULL || length == 0 || length > INT_MAX) {
+    return 2;
+  }
+
+  uint32_t chunkSize = ChunkSize(options);
+
+  // KEYEVENTF_UNICODE takes UTF-16 code units
+  int wideLength = MultiByteToWideChar(CP_UTF8, 0, text, (int)length, NULL, 0);
+  if (wideLength <= 0) {
+    return 2;
+  }
+  WCHAR* wide = (WCHAR*)malloc(wideLength * sizeof(WCHAR));
+  if (wide == NULL) {
+    return 2;
+  }
+  MultiByteToWideChar(CP_UTF8, 0, text, (int)length, wide, wideLength);
+
+  // One down and one up per unit, plus room for a trailing surrogate
+  INPUT* inputs = (INPUT*)calloc(((size_t)chunkSize + 1) * 2, sizeof(INPUT));
+  if (inputs == NULL) {
+    free(wide);
+    return 2;
+  }
+
+  uint32_t result = 0;
+  int index = 0;
+  while (index < wideLength) {
+
+    UINT count = 0;
+    uint32_t units = 0;
+    memset(inputs, 0, ((size_t)chunkSize + 1) * 2 * sizeof(INPUT));
+
+    while (index < wideLength && units < chunkSize) {
+      WCHAR c = wide[index++];
+
+      // Normalize line endings: apps ignore a unicode newline but honor Enter
+      if (c == L'\r' && index < wideLength && wide[index] == L'\n') {
+        continue;
+      }
+      if (c == L'\r' || c == L'\n') {
+        inputs[count].type = INPUT_KEYBOARD;
+        inputs[count].ki.wVk = VK_RETURN;
+        count++;
+        inputs[count].type = INPUT_KEYBOARD;
+        inputs[count].ki.wVk = VK_RETURN;
+        inputs[count].ki.dwFlags = KEYEVENTF_KEYUP;
+        count++;
+      } else {
+        inputs[count].type = INPUT_KEYBOARD;
+        inputs[count].ki.wScan = c;
+        inputs[count].ki.dwFlags = KEYEVENTF_UNICODE;
+        count++;
+        inputs[count].type = INPUT_KEYBOARD;
+        inputs[count].ki.wScan = c;
+        inputs[count].ki.dwFlags = KEYEVENTF_UNICODE | KEYEVENTF_KEYUP;
+        count++;
+
+        // Never split a surrogate pair across batches
+        if (IS_HIGH_SURROGATE(c) && index < wideLength && units + 1 >= chunkSize) {
+          WCHAR low = wide[index++];
+          inputs[count].type = INPUT_KEYBOARD;
+          inputs[count].ki.wScan = low;
+          inputs[count].ki.dwFlags = KEYEVENTF_UNICODE;
+          count++;
+          inputs[count].type = INPUT_KEYBOARD;
+          inputs[count].ki.wScan = low;
+          inputs[count].ki.dwFlags = KEYEVENTF_UNICODE | KEYEVENTF_KEYUP;
+          count++;
+        }
+      }
+      units++;
+    }
+
+    if (count > 0 && SendInput(count, inputs, sizeof(INPUT)) != count) {
+      // Blocked by UIPI or the input desktop changed
+      result = 3;
+      break;
+    }
+
+    if (index < wideLength && options->chunkDelay > 0) {
+      Sleep(options->chunkDelay);
+    }
+  }
+
+  free(inputs);
+  free(wide);
+  return result;
+}
+
+#elif defined(__APPLE__)
+
+static void PostUnicode(CGEventSourceRef source, const UniChar* chars, UniCharCount count) {
+  CGEventRef keyDown = CGEventCreateKeyboardEvent(source, 0, true);
+  CGEventRef keyUp = CGEventCreateKeyboardEvent(source, 0, false);
+  CGEventKeyboardSetUnicodeString(keyDown, count, chars);
+  CGEventKeyboardSetUnicodeString(keyUp, count, chars);
+  CGEventPost(kCGHIDEventTap, keyDown);
+  CGEventPost(kCGHIDEventTap, keyUp);
+  CFRelease(keyDown);
+  CFRelease(keyUp);
+}
+
+static void PostReturn(CGEventSourceRef source) {
+  CGEventRef keyDown = CGEventCreateKeyboardEvent(source, 36, true);
+  CGEventRef keyUp = CGEventCreateKeyboardEvent(source, 36, false);
+  CGEventPost(kCGHIDEventTap, keyDown);
+  CGEventPost(kCGHIDEventTap, keyUp);
+  CFRelease(keyDown);
+  CFRelease(keyUp);
+}
+
+uint32_t TypeText(const char* text, size_t length, const TypeTextOptions* options) {
+  if (text == NULL || length == 0) {
+    return 2;
+  }
+
+  uint32_t chunkSize = ChunkSize(options);
+
+  CFStringRef string = CFStringCreateWithBytes(kCFAllocatorDefault, (const UInt8*)text, (CFIndex)length, kCFStringEncodingUTF8, false);
+  if (string == NULL) {
+    return 2;
+  }
+
+  CFIndex total = CFStringGetLength(string);
+  UniChar* chars = (UniChar*)malloc(total * sizeof(UniChar));
+  if (chars == NULL) {
+    CFRelease(string);
+    return 2;
+  }
+  CFStringGetCharacters(string, CFRangeMake(0, total), chars);
+  CFRelease(string);
+
+  CGEventSourceRef source = CGEventSourceCreate(kCGEventSourceStateHIDSystemState);
+
+  CFIndex index = 0;
+  uint32_t inChunk = 0;
+  while (index < total) {
+
+    if (chars[index] == '\r' || chars[index] == '\n') {
+      if (!(chars[index] == '\r' && index + 1 < total && chars[index + 1] == '\n')) {
+        PostReturn(source);
+      }
+      index++;
+      inChunk++;
+    } else {
+      // Take a run of regular characters bounded by the event and chunk limits
+      CFIndex limit = MAC_MAX_UNICODE_PER_EVENT;
+      if ((CFIndex)(chunkSize - inChunk) < limit) limit = chunkSize - inChunk;
+      CFIndex count = 0;
+      while (index + count < total && count < limit &&
+             chars[index + count] != '\r' && chars[index + count] != '\n') {
+        count++;
+      }
+      if (count > 1 && CFStringIsSurrogateHighCharacter(chars[index + count - 1])) {
+        count--;
+      }
+      PostUnicode(source, chars + index, count);
+      index += count;
+      inChunk += count;
+    }
+
+    if (inChunk >= chunkSize) {
+      inChunk = 0;
+      if (index < total && options->chunkDelay > 0) {
+        usleep(options->chunkDelay * 1000);
+      }
+    }
+  }
+
+  if (source) CFRelease(source);
+  free(chars);
+  return 0;
+}
+
+#elif defined(__linux__)
+
+// Decode one code point, returns the number of bytes consumed (0 on invalid input)
+static size_t Utf8Decode(const unsigned char* s, size_t length, uint32_t* codepoint) {
+  if (s[0] < 0x80) {
+    *codepoint = s[0];
+    return 1;
+  }
+  size_t count;
+  uint32_t cp;
+  if ((s[0] & 0xE0) == 0xC0) { count = 2; cp = s[0] & 0x1F; }
+  else if ((s[0] & 0xF0) == 0xE0) { count = 3; cp = s[0] & 0x0F; }
+  else if ((s[0] & 0xF8) == 0xF0) { count = 4; cp = s[0] & 0x07; }
+  else return 0;
+  if (count > length) return 0;
+  for (size_t i = 1; i < count; i++) {
+    if ((s[i] & 0xC0) != 0x80) return 0;
+    cp = (cp << 6) | (s[i] & 0x3F);
+  }
+  *codepoint = cp;
+  return count;
+}
+
+static KeySym CodepointToKeysym(uint32_t codepoint) {
+  switch (codepoint) {
+    case '\n': return XK_Return;
+    case '\t': return XK_Tab;
+    case '\b': return XK_BackSpace;
+  }
+  // Latin-1 keysyms match their code points, the rest use the Unicode keysym range
+  if ((codepoint >= 0x20 && codepoint <= 0x7E) || (codepoint >= 0xA0 && codepoint <= 0xFF)) {
+    return (KeySym)codepoint;
+  }
+  return (KeySym)(0x01000000 | codepoint);
+}
+
+// Resolve a keysym to an evdev code and the modifiers needed to produce it
+static bool ResolveKeysym(Display* display, KeySym keysym, uint16_t* code, bool* shift, bool* altgr) {
+  KeyCode keycode = XKeysymToKeycode(display, keysym);
+  if (keycode == 0) {
+    return false;
+  }
+
+  // Find the shift level of the keysym in the first group of the active layout
+  for (int level = 0; level < 4; level++) {
+    if (XkbKeycodeToKeysym(display, keycode, 0, level) == keysym) {
+      *shift = (level & 1) != 0;
+      *altgr = (level & 2) != 0;
+      // X keycodes are evdev codes offset by 8
+      *code = (uint16_t)(keycode - 8);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static size_t AppendKey(struct input_event* events, size_t count, uint16_t code, int32_t value) {
+  UInputEvent(&events[count++], EV_KEY, code, value);
+  UInputEvent(&events[count++], EV_SYN, SYN_REPORT, 0);
+  return count;
+}
+
+uint32_t TypeText(const char* text, size_t length, const TypeTextOptions* options) {
+  if (text == NULL || length == 0) {
+    return 2;
+  }
+
+  uint32_t chunkSize = ChunkSize(options);
+
+  int fd = UInputKeyboard();
+  if (fd < 0) {
+    return 1;
+  }
+
+  // Worst case per character: two modifiers down, key down, key up, two modifiers up, each with a SYN
+  struct input_event* events = (struct input_event*)malloc((size_t)chunkSize * 12 * sizeof(struct input_event));
+  if (events == NULL) {
+    return 2;
+  }
+
+  const unsigned char* cursor = (const unsigned char*)text;
+  const unsigned char* end = cursor + length;
+  uint32_t result = 0;
+
+  while (cursor < end) {
+
+    size_t count = 0;
+    uint32_t inChunk = 0;
+
+    // The X keymap tells us which evdev code produces each character
+    // Only hold the shared connection while resolving, not while pacing
+    Display* display = X11Acquire();
+    if (display == NULL) {
+      result = 1;
+      break;
+    }
+
+    while (cursor < end && inChunk < chunkSize) {
+      uint32_t codepoint;
+      size_t consumed = Utf8Decode(cursor, end - cursor, &codepoint);
+      if (consumed == 0) {
+        result = 2;
+        cursor = end;
+        break;
+      }
+      cursor += consumed;
+      inChunk++;
+
+      if (codepoint == '\r') {
+        if (cursor < end && *cursor == '\n') continue;
+        codepoint = '\n';
+      }
+
+      uint16_t code;
+      bool shift = false, altgr = false;
+      if (!ResolveKeysym(display, CodepointToKeysym(codepoint), &code, &shift, &altgr)) {
+        // Not reachable with the active layout
+        result = 4;
+        continue;
+      }
+
+      if (shift) count = AppendKey(events, count, KEY_LEFTSHIFT, 1);
+      if (altgr) count = AppendKey(events, count, KEY_RIGHTALT, 1);
+      count = AppendKey(events, count, code, 1);
+      count = AppendKey(events, count, code, 0);
+      if (altgr) count = AppendKey(events, count, KEY_RIGHTALT, 0);
+      if (shift) count = AppendKey(events, count, KEY_LEFTSHIFT, 0);
+    }
+
+    X11Release();
+
+    if (count > 0 && UInputWrite(fd, events, count) != 0) {
+      result = 3;
+      break;
+    }
+
+    if (cursor < end && options->chunkDelay > 0) {
+      usleep(options->chunkDelay * 1000);
+    }
+  }
+
+  free(events);
+  return result;
+}
+
+#else
+
+uint32_t TypeText(const char* text, size_t length, const TypeTextOptions* options) {
+  (void)text;
+  (void)length;
+  (void)options;
+  return 1;
+}
+
+#endif
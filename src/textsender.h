@@ -0,0 +1,36 @@
+#ifndef TEXTSENDER_H
+#define TEXTSENDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TYPE_TEXT_DEFAULT_CHUNK_SIZE 32
+#define TYPE_TEXT_DEFAULT_CHUNK_DELAY_MS 2
+
+// Larger chunk sizes are clamped: batch buffers are sized from it
+#define TYPE_TEXT_MAX_CHUNK_SIZE 4096
+
+// Pacing options for TypeText
+typedef struct {
+  uint32_t chunkSize;   // Characters injected per native batch (at most TYPE_TEXT_MAX_CHUNK_SIZE)
+  uint32_t chunkDelay;  // Pause between batches in milliseconds
+} TypeTextOptions;
+
+// Initialize options with the defaults
+void TypeTextDefaultOptions(TypeTextOptions* options);
+
+// Type a UTF-8 string into the focused application
+// This blocks until the whole string has been injected: call it from a worker thread
+// Returns 0 on success, 1 if not supported, 2 on invalid input,
+// 3 if injection failed, 4 if some characters could not be typed
+uint32_t TypeText(const char* text, size_t length, const TypeTextOptions* options);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TEXTSENDER_H
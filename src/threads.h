@@ -0,0 +1,133 @@
+#ifndef THREADS_H
+#define THREADS_H
+
+// Minimal threading primitives shared by the native workers
+// Win32 primitives on Windows, pthreads elsewhere
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE Condition;
+typedef HANDLE Thread;
+typedef DWORD (WINAPI *ThreadProc)(LPVOID);
+#define THREAD_PROC(name) DWORD WINAPI name(LPVOID arg)
+#define THREAD_RETURN return 0
+
+static inline void MutexInit(Mutex* mutex) { InitializeCriticalSection(mutex); }
+static inline void MutexDestroy(Mutex* mutex) { DeleteCriticalSection(mutex); }
+static inline void MutexLock(Mutex* mutex) { EnterCriticalSection(mutex); }
+static inline void MutexUnlock(Mutex* mutex) { LeaveCriticalSection(mutex); }
+
+static inline void ConditionInit(Condition* condition) { InitializeConditionVariable(condition); }
+static inline void ConditionDestroy(Condition* condition) { (void)condition; }
+static inline void ConditionSignal(Condition* condition) { WakeConditionVariable(condition); }
+static inline void ConditionBroadcast(Condition* condition) { WakeAllConditionVariable(condition); }
+static inline void ConditionWait(Condition* condition, Mutex* mutex) {
+  SleepConditionVariableCS(condition, mutex, INFINITE);
+}
+
+// Returns false on timeout
+static inline bool ConditionTimedWait(Condition* condition, Mutex* mutex, uint32_t timeoutMs) {
+  return SleepConditionVariableCS(condition, mutex, timeoutMs) != 0;
+}
+
+static inline bool ThreadCreate(Thread* thread, ThreadProc proc, void* arg) {
+  *thread = CreateThread(NULL, 0, proc, arg, 0, NULL);
+  return *thread != NULL;
+}
+
+static inline void ThreadJoin(Thread thread) {
+  WaitForSingleObject(thread, INFINITE);
+  CloseHandle(thread);
+}
+
+// Let a thread run to completion on its own
+static inline void ThreadDetach(Thread thread) {
+  CloseHandle(thread);
+}
+
+// Monotonic clock in milliseconds
+static inline uint64_t MonotonicMillis(void) {
+  return GetTickCount64();
+}
+
+#else
+
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Condition;
+typedef pthread_t Thread;
+typedef void* (*ThreadProc)(void*);
+#define THREAD_PROC(name) void* name(void* arg)
+#define THREAD_RETURN return NULL
+
+static inline void MutexInit(Mutex* mutex) { pthread_mutex_init(mutex, NULL); }
+static inline void MutexDestroy(Mutex* mutex) { pthread_mutex_destroy(mutex); }
+static inline void MutexLock(Mutex* mutex) { pthread_mutex_lock(mutex); }
+static inline void MutexUnlock(Mutex* mutex) { pthread_mutex_unlock(mutex); }
+
+static inline void ConditionInit(Condition* condition) {
+#ifdef __APPLE__
+  pthread_cond_init(condition, NULL);
+#else
+  // Timed waits use the monotonic clock so wall clock changes cannot stretch them
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(condition, &attr);
+  pthread_condattr_destroy(&attr);
+#endif
+}
+static inline void ConditionDestroy(Condition* condition) { pthread_cond_destroy(condition); }
+static inline void ConditionSignal(Condition* condition) { pthread_cond_signal(condition); }
+static inline void ConditionBroadcast(Condition* condition) { pthread_cond_broadcast(condition); }
+static inline void ConditionWait(Condition* condition, Mutex* mutex) { pthread_cond_wait(condition, mutex); }
+
+// Returns false on timeout
+static inline bool ConditionTimedWait(Condition* condition, Mutex* mutex, uint32_t timeoutMs) {
+#ifdef __APPLE__
+  struct timespec relative = { timeoutMs / 1000, (long)(timeoutMs % 1000) * 1000000L };
+  return pthread_cond_timedwait_relative_np(condition, mutex, &relative) != ETIMEDOUT;
+#else
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += timeoutMs / 1000;
+  deadline.tv_nsec += (long)(timeoutMs % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+  return pthread_cond_timedwait(condition, mutex, &deadline) != ETIMEDOUT;
+#endif
+}
+
+static inline bool ThreadCreate(Thread* thread, ThreadProc proc, void* arg) {
+  return pthread_create(thread, NULL, proc, arg) == 0;
+}
+
+static inline void ThreadJoin(Thread thread) {
+  pthread_join(thread, NULL);
+}
+
+static inline void ThreadDetach(Thread thread) {
+  pthread_detach(thread);
+}
+
+// Monotonic clock in milliseconds
+static inline uint64_t MonotonicMillis(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+#endif
+
+#endif // THREADS_H
@@ -0,0 +1,223 @@
+#include "uinput.h"
+
+#ifdef __linux__
+
+#include <linux/uinput.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+// A pointer device is only destroyed once no thread holds its descriptor:
+// after a geometry change the replaced device waits for its last writer
+typedef struct PointerDevice {
+  int fd;
+  int width;
+  int height;
+  int users;
+  struct PointerDevice* next;
+} PointerDevice;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_keyboard = -1;
+static PointerDevice* g_pointer = NULL;
+static PointerDevice* g_retired = NULL;
+static int g_pointerWidth = 0;
+static int g_pointerHeight = 0;
+
+static int CreateDevice(const char* name, void (*configure)(int fd, struct uinput_user_dev* dev)) {
+  int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+
+  // Legacy setup path: supported by every kernel that has uinput
+  struct uinput_user_dev dev;
+  memset(&dev, 0, sizeof(dev));
+  configure(fd, &dev);
+  snprintf(dev.name, UINPUT_MAX_NAME_SIZE, "%s", name);
+  dev.id.bustype = BUS_VIRTUAL;
+  dev.id.vendor = 0x5769;
+  dev.id.product = 0x7379;
+  dev.id.version = 1;
+
+  if (write(fd, &dev, sizeof(dev)) != sizeof(dev) || ioctl(fd, UI_DEV_CREATE) < 0) {
+    close(fd);
+    return -1;
+  }
+
+  // The display server needs a moment to pick up a new device
+  // Events written before that are silently lost, so pay this once here
+  usleep(200000);
+
+  return fd;
+}
+
+static void DestroyDevice(int fd) {
+  ioctl(fd, UI_DEV_DESTROY);
+  close(fd);
+}
+
+static void ConfigureKeyboard(int fd, struct uinput_user_dev* dev) {
+  (void)dev;
+  ioctl(fd, UI_SET_EVBIT, EV_SYN);
+  ioctl(fd, UI_SET_EVBIT, EV_KEY);
+  for (int code = KEY_ESC; code < BTN_TRIGGER_HAPPY; code++) {
+    if (code == BTN_MISC) {
+      // Skip the button ranges so the device is not classified as a pointer
+      code = KEY_OK - 1;
+      continue;
+    }
+    ioctl(fd, UI_SET_KEYBIT, code);
+  }
+}
+
+int UInputKeyboard(void) {
+  pthread_mutex_lock(&g_lock);
+  if (g_keyboard < 0) {
+    g_keyboard = CreateDevice(UINPUT_DEVICE_PREFIX " keyboard", ConfigureKeyboard);
+  }
+  int fd = g_keyboard;
+  pthread_mutex_unlock(&g_lock);
+  return fd;
+}
+
+static void ConfigurePointer(int fd, struct uinput_user_dev* dev) {
+  ioctl(fd, UI_SET_EVBIT, EV_SYN);
+  ioctl(fd, UI_SET_EVBIT, EV_KEY);
+  ioctl(fd, UI_SET_KEYBIT, BTN_LEFT);
+  ioctl(fd, UI_SET_KEYBIT, BTN_RIGHT);
+  ioctl(fd, UI_SET_KEYBIT, BTN_MIDDLE);
+  ioctl(fd, UI_SET_KEYBIT, BTN_SIDE);
+  ioctl(fd, UI_SET_KEYBIT, BTN_EXTRA);
+
+  // Absolute axes spanning the whole X screen, like a VM tablet
+  ioctl(fd, UI_SET_EVBIT, EV_ABS);
+  ioctl(fd, UI_SET_ABSBIT, ABS_X);
+  ioctl(fd, UI_SET_ABSBIT, ABS_Y);
+  dev->absmin[ABS_X] = 0;
+  dev->absmax[ABS_X] = g_pointerWidth - 1;
+  dev->absmin[ABS_Y] = 0;
+  dev->absmax[ABS_Y] = g_pointerHeight - 1;
+
+  ioctl(fd, UI_SET_EVBIT, EV_REL);
+  ioctl(fd, UI_SET_RELBIT, REL_WHEEL);
+  ioctl(fd, UI_SET_RELBIT, REL_HWHEEL);
+  ioctl(fd, UI_SET_RELBIT, REL_WHEEL_HI_RES);
+  ioctl(fd, UI_SET_RELBIT, REL_HWHEEL_HI_RES);
+}
+
+// Retire a device, with the lock held
+static void RetirePointer(PointerDevice* device) {
+  if (device->users == 0) {
+    DestroyDevice(device->fd);
+    free(device);
+    return;
+  }
+  device->next = g_retired;
+  g_retired = device;
+}
+
+int UInputPointer(int width, int height) {
+  if (width <= 0 || height <= 0) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&g_lock);
+  if (g_pointer != NULL && (width != g_pointer->width || height != g_pointer->height)) {
+    // Screen layout changed: the axis ranges must follow, and uinput only
+    // sets them before the device is created
+    RetirePointer(g_pointer);
+    g_pointer = NULL;
+  }
+  if (g_pointer == NULL) {
+    PointerDevice* device = (PointerDevice*)calloc(1, sizeof(PointerDevice));
+    if (device != NULL) {
+      g_pointerWidth = width;
+      g_pointerHeight = height;
+      device->fd = CreateDevice(UINPUT_DEVICE_PREFIX " pointer", ConfigurePointer);
+      device->width = width;
+      device->height = height;
+      if (device->fd >= 0) {
+        g_pointer = device;
+      } else {
+        free(device);
+      }
+    }
+  }
+  int fd = -1;
+  if (g_pointer != NULL) {
+    g_pointer->users++;
+    fd = g_pointer->fd;
+  }
+  pthread_mutex_unlock(&g_lock);
+  return fd;
+}
+
+void UInputReleasePointer(int fd) {
+  pthread_mutex_lock(&g_lock);
+  if (g_pointer != NULL && g_pointer->fd == fd) {
+    g_pointer->users--;
+  } else {
+    for (PointerDevice** link = &g_retired; *link != NULL; link = &(*link)->next) {
+      PointerDevice* device = *link;
+      if (device->fd == fd) {
+        if (--device->users == 0) {
+          *link = device->next;
+          DestroyDevice(device->fd);
+          free(device);
+        }
+        break;
+      }
+    }
+  }
+  pthread_mutex_unlock(&g_lock);
+}
+
+void UInputEvent(struct input_event* event, uint16_t type, uint16_t code, int32_t value) {
+  memset(event, 0, sizeof(*event));
+  event->type = type;
+  event->code = code;
+  event->value = value;
+}
+
+size_t UInputMoveAbsolute(struct input_event* events, int x, int y) {
+  // The input core drops absolute events equal to the axis' last value, but the
+  // real pointer may have moved since (physical mouse): pass through a
+  // neighbouring value in the same frame so the target is always delivered
+  size_t count = 0;
+  UInputEvent(&events[count++], EV_ABS, ABS_X, x > 0 ? x - 1 : x + 1);
+  UInputEvent(&events[count++], EV_ABS, ABS_X, x);
+  UInputEvent(&events[count++], EV_ABS, ABS_Y, y > 0 ? y - 1 : y + 1);
+  UInputEvent(&events[count++], EV_ABS, ABS_Y, y);
+  UInputEvent(&events[count++], EV_SYN, SYN_REPORT, 0);
+  return count;
+}
+
+int UInputWrite(int fd, const struct input_event* events, size_t count) {
+  const char* data = (const char*)events;
+  size_t remaining = count * sizeof(struct input_event);
+
+  while (remaining > 0) {
+    ssize_t written = write(fd, data, remaining);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN) {
+        // Kernel buffer is full: give the consumer a chance to drain it
+        usleep(1000);
+        continue;
+      }
+      return 1;
+    }
+    data += written;
+    remaining -= (size_t)written;
+  }
+
+  return 0;
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef UINPUT_H
+#define UINPUT_H
+
+#ifdef __linux__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/input.h>
+
+// High-resolution wheel axes (120 per notch) from kernel 5.0 headers
+#ifndef REL_WHEEL_HI_RES
+#define REL_WHEEL_HI_RES 0x0b
+#define REL_HWHEEL_HI_RES 0x0c
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Name prefix of the virtual devices, so the monitors can skip them
+#define UINPUT_DEVICE_PREFIX "autolib virtual"
+
+// Get the persistent virtual keyboard device
+// The device is created on first use and kept for the lifetime of the process
+// Returns the uinput file descriptor or -1 on failure (usually missing permissions on /dev/uinput)
+int UInputKeyboard(void);
+
+// Get the persistent virtual absolute pointer device
+// The axes span width x height (the combined screen geometry) and the device
+// is recreated when the geometry changes
+// Every successful call must be paired with UInputReleasePointer once the
+// writes are done: a replaced device stays open until then
+// Returns the uinput file descriptor or -1 on failure
+int UInputPointer(int width, int height);
+
+// Release a descriptor returned by UInputPointer
+void UInputReleasePointer(int fd);
+
+// Number of events written by UInputMoveAbsolute
+#define UINPUT_MOVE_EVENTS 5
+
+// Fill events moving the absolute pointer to x, y (including the SYN)
+// Returns the number of events written
+size_t UInputMoveAbsolute(struct input_event* events, int x, int y);
+
+// Fill an input event
+void UInputEvent(struct input_event* event, uint16_t type, uint16_t code, int32_t value);
+
+// Write a batch of events in a single syscall
+// Returns 0 on success, non-zero on error
+int UInputWrite(int fd, const struct input_event* events, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif // UINPUT_H
@@ -0,0 +1,687 @@
+#include "versioninfo.h"
+#include "filemap.h"
+#include "log.h"
+#include "pe.h"
+#include "threads.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+// Cache file layout: magic, format version, entry count, then entries
+#define CACHE_MAGIC 0x49435641u // "AVCI"
+#define CACHE_FORMAT 1
+
+// Lookups only mark the cache dirty, it is saved this long after the first change
+#define CACHE_SAVE_DELAY_MS 1000
+
+typedef struct {
+  char* path;
+  uint64_t size;
+  int64_t mtime;
+  bool found;
+  VersionInfo info;
+  uint64_t lastUse;
+} CacheEntry;
+
+#ifdef _WIN32
+static INIT_ONCE g_once = INIT_ONCE_STATIC_INIT;
+#else
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+#endif
+
+static Mutex g_lock;
+static CacheEntry g_entries[VERSION_CACHE_SIZE];
+static uint64_t g_useCounter = 0;
+static char* g_cacheFile = NULL;
+
+// Saving: g_saveLock serializes file writes and is taken before g_lock
+static Mutex g_saveLock;
+static Condition g_saveWake;
+static bool g_dirty = false;
+static uint64_t g_dirtySince = 0;
+static bool g_saverStarted = false;
+
+static void InitializeState(void) {
+  MutexInit(&g_lock);
+  MutexInit(&g_saveLock);
+  ConditionInit(&g_saveWake);
+}
+
+#ifdef _WIN32
+static BOOL CALLBACK InitializeOnce(PINIT_ONCE once, PVOID param, PVOID* context) {
+  (void)once;
+  (void)param;
+  (void)context;
+  InitializeState();
+  return TRUE;
+}
+#endif
+
+static void EnsureInitialized(void) {
+#ifdef _WIN32
+  InitOnceExecuteOnce(&g_once, InitializeOnce, NULL, NULL);
+#else
+  pthread_once(&g_once, InitializeState);
+#endif
+}
+
+#ifdef _WIN32
+
+static FILE* OpenFile(const char* path, const wchar_t* mode) {
+  wchar_t* wide = WidePath(path);
+  if (wide == NULL) {
+    return NULL;
+  }
+  FILE* file = _wfopen(wide, mode);
+  free(wide);
+  return file;
+}
+
+static bool ReplaceFile(const char* from, const char* to) {
+  wchar_t* wideFrom = WidePath(from);
+  wchar_t* wideTo = WidePath(to);
+  bool ok = wideFrom != NULL && wideTo != NULL && MoveFileExW(wideFrom, wideTo, MOVEFILE_REPLACE_EXISTING);
+  free(wideFrom);
+  free(wideTo);
+  return ok;
+}
+
+static unsigned long CurrentProcessId(void) {
+  return (unsigned long)GetCurrentProcessId();
+}
+
+#define OPEN_READ L"rb"
+#define OPEN_WRITE L"wb"
+
+#else
+
+static FILE* OpenFile(const char* path, const char* mode) {
+  return fopen(path, mode);
+}
+
+static bool ReplaceFile(const char* from, const char* to) {
+  return rename(from, to) == 0;
+}
+
+static unsigned long CurrentProcessId(void) {
+  return (unsigned long)getpid();
+}
+
+#define OPEN_READ "rb"
+#define OPEN_WRITE "wb"
+
+#endif
+
+// VS_VERSIONINFO is a tree of blocks: length, value length, type, a UTF-16
+// key, then the value and the children, each aligned on 32 bits
+typedef struct {
+  const uint8_t* key;
+  size_t keyLength;
+  const uint8_t* value;
+  size_t valueSize;
+  const uint8_t* children;
+  const uint8_t* end;
+} VersionBlock;
+
+#define VERSION_BLOCK_HEADER 6
+#define VERSION_TEXT_TYPE 1
+#define FIXED_FILE_INFO_SIGNATURE 0xFEEF04BDu
+#define FIXED_FILE_INFO_SIZE 52
+#define MAX_STRING_TABLES 16
+
+static uint16_t ReadU16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t ReadU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Blocks are aligned relative to the start of the resource
+static const uint8_t* Align(const uint8_t* base, const uint8_t* p) {
+  return base + (((size_t)(p - base) + 3) & ~(size_t)3);
+}
+
+static bool ReadBlock(const uint8_t* base, const uint8_t* p, const uint8_t* limit, VersionBlock* block) {
+  if (p >= limit || (size_t)(limit - p) < VERSION_BLOCK_HEADER) {
+    return false;
+  }
+  size_t length = ReadU16(p);
+  if (length < VERSION_BLOCK_HEADER || length > (size_t)(limit - p)) {
+    return false;
+  }
+  block->end = p + length;
+
+  size_t valueLength = ReadU16(p + 2);
+  bool text = ReadU16(p + 4) == VERSION_TEXT_TYPE;
+  block->key = p + VERSION_BLOCK_HEADER;
+  block->keyLength = 0;
+  const uint8_t* q = block->key;
+  while (q + 2 <= block->end && ReadU16(q) != 0) {
+    q += 2;
+    block->keyLength++;
+  }
+  if (q + 2 > block->end) {
+    return false;
+  }
+
+  // Text values are sized in characters, binary ones in bytes;
+  // some linkers get it wrong so the value is clamped to the block
+  block->value = Align(base, q + 2);
+  if (block->value > block->end) {
+    block->value = block->end;
+  }
+  block->valueSize = text ? valueLength * 2 : valueLength;
+  if (block->valueSize > (size_t)(block->end - block->value)) {
+    block->valueSize = (size_t)(block->end - block->value);
+  }
+  block->children = Align(base, block->value + block->valueSize);
+  return true;
+}
+
+static bool KeyEquals(const VersionBlock* block, const char* key) {
+  size_t length = strlen(key);
+  if (block->keyLength != length) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i++) {
+    uint16_t c = ReadU16(block->key + i * 2);
+    if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+    char k = key[i];
+    if (k >= 'A' && k <= 'Z') k += 'a' - 'A';
+    if (c != (uint8_t)k) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Decode UTF-16LE text into a UTF-8 buffer, truncating on a character boundary
+static void DecodeText(const uint8_t* text, size_t size, char* out, size_t outSize) {
+  size_t length = 0;
+  for (size_t i = 0; i + 2 <= size; i += 2) {
+    uint32_t c = ReadU16(text + i);
+    if (c == 0) {
+      break;
+    }
+    if (c >= 0xD800 && c <= 0xDBFF && i + 4 <= size) {
+      uint32_t low = ReadU16(text + i + 2);
+      if (low >= 0xDC00 && low <= 0xDFFF) {
+        c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+        i += 2;
+      }
+    }
+    if (c >= 0xD800 && c <= 0xDFFF) {
+      c = 0xFFFD;
+    }
+
+    char bytes[4];
+    size_t count;
+    if (c < 0x80) {
+      bytes[0] = (char)c;
+      count = 1;
+    } else if (c < 0x800) {
+      bytes[0] = (char)(0xC0 | (c >> 6));
+      bytes[1] = (char)(0x80 | (c & 0x3F));
+      count = 2;
+    } else if (c < 0x10000) {
+      bytes[0] = (char)(0xE0 | (c >> 12));
+      bytes[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+      bytes[2] = (char)(0x80 | (c & 0x3F));
+      count = 3;
+    } else {
+      bytes[0] = (char)(0xF0 | (c >> 18));
+      bytes[1] = (char)(0x80 | ((c >> 12) & 0x3F));
+      bytes[2] = (char)(0x80 | ((c >> 6) & 0x3F));
+      bytes[3] = (char)(0x80 | (c & 0x3F));
+      count = 4;
+    }
+    if (length + count >= outSize) {
+      break;
+    }
+    memcpy(out + length, bytes, count);
+    length += count;
+  }
+  out[length] = '\0';
+}
+
+// Compare a string table key ("040904b0") with a translation pair
+static bool TableMatches(const VersionBlock* table, uint32_t translation) {
+  static const char digits[] = "0123456789abcdef";
+  char key[9];
+  uint32_t code = ((translation & 0xFFFF) << 16) | (translation >> 16);
+  for (int i = 0; i < 8; i++) {
+    key[i] = digits[(code >> (28 - i * 4)) & 0xF];
+  }
+  key[8] = '\0';
+  return KeyEquals(table, key);
+}
+
+bool ParseVersionResource(const uint8_t* data, size_t size, VersionInfo* info) {
+  memset(info, 0, sizeof(VersionInfo));
+  const uint8_t* limit = data + size;
+  VersionBlock root;
+  if (!ReadBlock(data, data, limit, &root) || !KeyEquals(&root, "VS_VERSION_INFO")) {
+    return false;
+  }
+
+  // Collect the string tables and the preferred translation in one walk
+  VersionBlock tables[MAX_STRING_TABLES];
+  int tableCount = 0;
+  uint32_t translation = 0;
+  bool translated = false;
+  VersionBlock child;
+  for (const uint8_t* p = root.children; ReadBlock(data, p, root.end, &child); p = Align(data, child.end)) {
+    VersionBlock entry;
+    if (KeyEquals(&child, "StringFileInfo")) {
+      for (const uint8_t* q = child.children; ReadBlock(data, q, child.end, &entry); q = Align(data, entry.end)) {
+        if (tableCount < MAX_STRING_TABLES) {
+          tables[tableCount++] = entry;
+        }
+      }
+    } else if (KeyEquals(&child, "VarFileInfo")) {
+      for (const uint8_t* q = child.children; ReadBlock(data, q, child.end, &entry); q = Align(data, entry.end)) {
+        if (KeyEquals(&entry, "Translation") && entry.valueSize >= 4 && !translated) {
+          translation = ReadU32(entry.value);
+          translated = true;
+        }
+      }
+    }
+  }
+
+  // The first translation names the default table, else take the first one
+  const VersionBlock* table = tableCount > 0 ? &tables[0] : NULL;
+  for (int i = 0; translated && i < tableCount; i++) {
+    if (TableMatches(&tables[i], translation)) {
+      table = &tables[i];
+      break;
+    }
+  }
+
+  if (table != NULL) {
+    VersionBlock entry;
+    for (const uint8_t* p = table->children; ReadBlock(data, p, table->end, &entry); p = Align(data, entry.end)) {
+      if (KeyEquals(&entry, "ProductName")) {
+        DecodeText(entry.value, entry.valueSize, info->productName, sizeof(info->productName));
+      } else if (KeyEquals(&entry, "FileDescription")) {
+        DecodeText(entry.value, entry.valueSize, info->fileDescription, sizeof(info->fileDescription));
+      } else if (KeyEquals(&entry, "CompanyName")) {
+        DecodeText(entry.value, entry.valueSize, info->companyName, sizeof(info->companyName));
+      } else if (KeyEquals(&entry, "FileVersion")) {
+        DecodeText(entry.value, entry.valueSize, info->fileVersion, sizeof(info->fileVersion));
+      } else if (KeyEquals(&entry, "ProductVersion")) {
+        DecodeText(entry.value, entry.valueSize, info->productVersion, sizeof(info->productVersion));
+      }
+    }
+  }
+
+  // Fall back to the numeric versions of VS_FIXEDFILEINFO
+  if (root.valueSize >= FIXED_FILE_INFO_SIZE && ReadU32(root.value) == FIXED_FILE_INFO_SIGNATURE) {
+    if (info->fileVersion[0] == '\0') {
+      uint32_t ms = ReadU32(root.value + 8), ls = ReadU32(root.value + 12);
+      snprintf(info->fileVersion, sizeof(info->fileVersion), "%u.%u.%u.%u", ms >> 16, ms & 0xFFFF, ls >> 16, ls & 0xFFFF);
+    }
+    if (info->productVersion[0] == '\0') {
+      uint32_t ms = ReadU32(root.value + 16), ls = ReadU32(root.value + 20);
+      snprintf(info->productVersion, sizeof(info->productVersion), "%u.%u.%u.%u", ms >> 16, ms & 0xFFFF, ls >> 16, ls & 0xFFFF);
+    }
+  }
+  return true;
+}
+
+// Map the executable and read RT_VERSION straight from its resource directory
+static bool ReadVersionInfo(const char* path, VersionInfo* info) {
+  FileMap map;
+  if (!MapFile(path, &map)) {
+    return false;
+  }
+
+  PeImage image;
+  const uint8_t* resource;
+  uint32_t size;
+  bool found = PeOpen(map.data, map.size, &image) &&
+               PeFindResource(&image, PE_RT_VERSION, PE_FIRST_RESOURCE, &resource, &size) &&
+               ParseVersionResource(resource, size, info);
+  UnmapFile(&map);
+  return found;
+}
+
+static char* CopyString(const char* value) {
+  size_t length = strlen(value);
+  char* copy = (char*)malloc(length + 1);
+  if (copy != NULL) {
+    memcpy(copy, value, length + 1);
+  }
+  return copy;
+}
+
+// Find the entry for a path, with the lock held
+static CacheEntry* FindEntry(const char* path) {
+  for (int i = 0; i < VERSION_CACHE_SIZE; i++) {
+    if (g_entries[i].path != NULL && strcmp(g_entries[i].path, path) == 0) {
+      return &g_entries[i];
+    }
+  }
+  return NULL;
+}
+
+// Entry to reuse for a new path: a free one or the least recently used
+static CacheEntry* EvictEntry(void) {
+  CacheEntry* oldest = &g_entries[0];
+  for (int i = 0; i < VERSION_CACHE_SIZE; i++) {
+    if (g_entries[i].path == NULL) {
+      return &g_entries[i];
+    }
+    if (g_entries[i].lastUse < oldest->lastUse) {
+      oldest = &g_entries[i];
+    }
+  }
+  free(oldest->path);
+  oldest->path = NULL;
+  return oldest;
+}
+
+static uint8_t* PutString(uint8_t* out, const char* value) {
+  size_t size = strlen(value);
+  uint16_t length = size > UINT16_MAX ? UINT16_MAX : (uint16_t)size;
+  memcpy(out, &length, sizeof(length));
+  memcpy(out + sizeof(length), value, length);
+  return out + sizeof(length) + length;
+}
+
+// Values that do not fit are skipped and read as empty
+static bool ReadString(FILE* file, char* value, size_t size) {
+  uint16_t length = 0;
+  if (fread(&length, sizeof(length), 1, file) != 1) {
+    return false;
+  }
+  if (length >= size) {
+    value[0] = '\0';
+    return fseek(file, length, SEEK_CUR) == 0;
+  }
+  if (fread(value, 1, length, file) != length) {
+    return false;
+  }
+  value[length] = '\0';
+  return true;
+}
+
+#define PUT_VALUE(out, value) (memcpy(out, &(value), sizeof(value)), out + sizeof(value))
+
+// Serialize the entries, with the lock held
+static uint8_t* SerializeCache(size_t* size) {
+  uint32_t count = 0;
+  size_t total = 3 * sizeof(uint32_t);
+  for (int i = 0; i < VERSION_CACHE_SIZE; i++) {
+    CacheEntry* entry = &g_entries[i];
+    if (entry->path == NULL) {
+      continue;
+    }
+    count++;
+    total += 6 * sizeof(uint16_t) + strlen(entry->path) + sizeof(entry->size) + sizeof(entry->mtime) + 1 +
+             strlen(entry->info.productName) + strlen(entry->info.fileDescription) +
+             strlen(entry->info.companyName) + strlen(entry->info.fileVersion) +
+             strlen(entry->info.productVersion);
+  }
+
+  uint8_t* data = (uint8_t*)malloc(total);
+  if (data == NULL) {
+    return NULL;
+  }
+  uint32_t header[3] = { CACHE_MAGIC, CACHE_FORMAT, count };
+  uint8_t* out = PUT_VALUE(data, header);
+  for (int i = 0; i < VERSION_CACHE_SIZE; i++) {
+    CacheEntry* entry = &g_entries[i];
+    if (entry->path == NULL) {
+      continue;
+    }
+    uint8_t found = entry->found ? 1 : 0;
+    out = PutString(out, entry->path);
+    out = PUT_VALUE(out, entry->size);
+    out = PUT_VALUE(out, entry->mtime);
+    out = PUT_VALUE(out, found);
+    out = PutString(out, entry->info.productName);
+    out = PutString(out, entry->info.fileDescription);
+    out = PutString(out, entry->info.companyName);
+    out = PutString(out, entry->info.fileVersion);
+    out = PutString(out, entry->info.productVersion);
+  }
+  *size = (size_t)(out - data);
+  return data;
+}
+
+// Written to a temporary file first so readers never see a partial cache
+// The name has the pid so processes sharing the file do not write over each other
+static void WriteCacheFile(const char* path, const uint8_t* data, size_t size) {
+  size_t length = strlen(path) + 32;
+  char* temporary = (char*)malloc(length);
+  if (temporary == NULL) {
+    return;
+  }
+  snprintf(temporary, length, "%s.%lu.tmp", path, CurrentProcessId());
+
+  FILE* file = OpenFile(temporary, OPEN_WRITE);
+  if (file == NULL) {
+    LOG_WARN("versioninfo", "Unable to write %s", temporary);
+    free(temporary);
+    return;
+  }
+  bool ok = fwrite(data, 1, size, file) == size;
+  ok = fclose(file) == 0 && ok;
+
+  if (!ok || !ReplaceFile(temporary, path)) {
+    LOG_WARN("versioninfo", "Unable to save the version cache to %s", path);
+    remove(temporary);
+  }
+  free(temporary);
+}
+
+// Save the cache if it changed, without holding g_lock during the write
+static void SaveCache(void) {
+  MutexLock(&g_saveLock);
+  MutexLock(&g_lock);
+  char* path = NULL;
+  uint8_t* data = NULL;
+  size_t size = 0;
+  if (g_dirty && g_cacheFile != NULL) {
+    path = CopyString(g_cacheFile);
+    data = SerializeCache(&size);
+  }
+  g_dirty = false;
+  MutexUnlock(&g_lock);
+
+  if (path != NULL && data != NULL) {
+    WriteCacheFile(path, data, size);
+  }
+  free(path);
+  free(data);
+  MutexUnlock(&g_saveLock);
+}
+
+// Flag a change, with the lock held
+static void MarkDirty(void) {
+  if (!g_dirty && g_cacheFile != NULL) {
+    g_dirty = true;
+    g_dirtySince = MonotonicMillis();
+    ConditionSignal(&g_saveWake);
+  }
+}
+
+// Save changes once they are CACHE_SAVE_DELAY_MS old, so a batch of lookups
+// is written once
+static THREAD_PROC(SaveThread) {
+  (void)arg;
+
+  MutexLock(&g_lock);
+  for (;;) {
+    if (!g_dirty) {
+      ConditionWait(&g_saveWake, &g_lock);
+      continue;
+    }
+    uint64_t now = MonotonicMillis();
+    uint64_t due = g_dirtySince + CACHE_SAVE_DELAY_MS;
+    if (now < due) {
+      ConditionTimedWait(&g_saveWake, &g_lock, (uint32_t)(due - now));
+      continue;
+    }
+    MutexUnlock(&g_lock);
+    SaveCache();
+    MutexLock(&g_lock);
+  }
+  MutexUnlock(&g_lock);
+
+  THREAD_RETURN;
+}
+
+// Start the saver thread on first use, it lives until the process exits
+static void StartSaver(void) {
+  if (g_saverStarted) {
+    return;
+  }
+  g_saverStarted = true;
+
+  // Pending changes are written at exit
+  atexit(SaveCache);
+
+  Thread thread;
+  if (!ThreadCreate(&thread, SaveThread, NULL)) {
+    LOG_WARN("versioninfo", "Failed to create the cache saver thread, saving at exit only");
+    return;
+  }
+  ThreadDetach(thread);
+}
+
+// Load entries from the cache file, with the lock held
+static bool LoadCache(void) {
+  FILE* file = OpenFile(g_cacheFile, OPEN_READ);
+  if (file == NULL) {
+    // Nothing persisted yet
+    return true;
+  }
+
+  uint32_t header[3];
+  bool ok = fread(header, sizeof(header), 1, file) == 1 && header[0] == CACHE_MAGIC && header[1] == CACHE_FORMAT;
+  char path[4096];
+  for (uint32_t i = 0; ok && i < header[2]; i++) {
+    CacheEntry loaded;
+    memset(&loaded, 0, sizeof(loaded));
+    uint8_t found = 0;
+    ok = ReadString(file, path, sizeof(path)) &&
+         fread(&loaded.size, sizeof(loaded.size), 1, file) == 1 &&
+         fread(&loaded.mtime, sizeof(loaded.mtime), 1, file) == 1 &&
+         fread(&found, sizeof(found), 1, file) == 1 &&
+         ReadString(file, loaded.info.productName, sizeof(loaded.info.productName)) &&
+         ReadString(file, loaded.info.fileDescription, sizeof(loaded.info.fileDescription)) &&
+         ReadString(file, loaded.info.companyName, sizeof(loaded.info.companyName)) &&
+         ReadString(file, loaded.info.fileVersion, sizeof(loaded.info.fileVersion)) &&
+         ReadString(file, loaded.info.productVersion, sizeof(loaded.info.productVersion));
+    // Paths too long for the buffer read as empty: only that entry is skipped
+    if (!ok || path[0] == '\0' || FindEntry(path) != NULL) {
+      continue;
+    }
+
+    // Entries are checked against the file stamp on lookup, stale ones get refreshed
+    CacheEntry* entry = EvictEntry();
+    *entry = loaded;
+    entry->path = CopyString(path);
+    entry->found = found != 0;
+    entry->lastUse = ++g_useCounter;
+  }
+  fclose(file);
+
+  if (!ok) {
+    LOG_WARN("versioninfo", "Ignoring invalid version cache %s", g_cacheFile);
+  }
+  return ok;
+}
+
+bool GetVersionInfo(const char* path, VersionInfo* info) {
+  memset(info, 0, sizeof(VersionInfo));
+  uint64_t size = 0;
+  int64_t mtime = 0;
+  if (path == NULL || !FileStamp(path, &size, &mtime)) {
+    return false;
+  }
+
+  EnsureInitialized();
+  MutexLock(&g_lock);
+  CacheEntry* entry = FindEntry(path);
+  if (entry != NULL && entry->size == size && entry->mtime == mtime) {
+    entry->lastUse = ++g_useCounter;
+    bool found = entry->found;
+    *info = entry->info;
+    MutexUnlock(&g_lock);
+    return found;
+  }
+  MutexUnlock(&g_lock);
+
+  // Parse without the lock: another thread may look up other executables meanwhile
+  bool found = ReadVersionInfo(path, info);
+  if (!found) {
+    memset(info, 0, sizeof(VersionInfo));
+  }
+
+  MutexLock(&g_lock);
+  entry = FindEntry(path);
+  if (entry == NULL) {
+    entry = EvictEntry();
+    entry->path = CopyString(path);
+  }
+  if (entry->path != NULL) {
+    entry->size = size;
+    entry->mtime = mtime;
+    entry->found = found;
+    entry->info = *info;
+    entry->lastUse = ++g_useCounter;
+    MarkDirty();
+  }
+  MutexUnlock(&g_lock);
+  return found;
+}
+
+bool GetVersionProductName(const char* path, char* name, size_t size) {
+  VersionInfo info;
+  if (size == 0 || !GetVersionInfo(path, &info)) {
+    return false;
+  }
+
+  // Prefer ProductName, then FileDescription
+  const char* value = info.productName[0] != '\0' ? info.productName : info.fileDescription;
+  if (value[0] != '\0') {
+    strncpy(name, value, size - 1);
+    name[size - 1] = '\0';
+    return true;
+  }
+
+  // Fall back to the file name without its extension
+  const char* filename = path + strlen(path);
+  while (filename > path && *(filename - 1) != '\\' && *(filename - 1) != '/') {
+    filename--;
+  }
+  strncpy(name, filename, size - 1);
+  name[size - 1] = '\0';
+  char* dot = strrchr(name, '.');
+  if (dot != NULL) *dot = '\0';
+  return true;
+}
+
+bool SetVersionCacheFile(const char* path) {
+  EnsureInitialized();
+
+  // Changes pending for the previous file go there
+  SaveCache();
+
+  MutexLock(&g_lock);
+  free(g_cacheFile);
+  g_cacheFile = path != NULL ? CopyString(path) : NULL;
+  bool ok = g_cacheFile == NULL || LoadCache();
+  if (g_cacheFile != NULL) {
+    StartSaver();
+  }
+  MutexUnlock(&g_lock);
+  return ok;
+}
@@ -0,0 +1,56 @@
+#ifndef VERSIONINFO_H
+#define VERSIONINFO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VERSION_STRING_SIZE 256
+#define VERSION_NUMBER_SIZE 64
+
+// Number of executables remembered, least recently used ones are evicted
+#define VERSION_CACHE_SIZE 128
+
+// Version resource strings of an executable, UTF-8, empty when missing
+typedef struct {
+  char productName[VERSION_STRING_SIZE];
+  char fileDescription[VERSION_STRING_SIZE];
+  char companyName[VERSION_STRING_SIZE];
+  char fileVersion[VERSION_NUMBER_SIZE];
+  char productVersion[VERSION_NUMBER_SIZE];
+} VersionInfo;
+
+// Get the version resource of an executable (path is UTF-8)
+// The file is memory-mapped and RT_VERSION read straight from the PE resource
+// directory, so this works on any platform (Wine and Proton apps on Linux)
+// Results, including missing resources, are memoized by path, file size and
+// modification time: a repeated lookup costs one stat and no file read
+// Returns false if the file has no version resource or cannot be read
+bool GetVersionInfo(const char* path, VersionInfo* info);
+
+// Get the display name of an executable: ProductName, else FileDescription,
+// else the file name without its extension
+// Returns false if the file has no version resource or cannot be read
+bool GetVersionProductName(const char* path, char* name, size_t size);
+
+// Decode a VS_VERSIONINFO resource: the string table of the first translation
+// (else the first table), with the fixed file info as the version fallback
+// Returns false if the bytes are not a version resource
+bool ParseVersionResource(const uint8_t* data, size_t size, VersionInfo* info);
+
+// Persist the cache to a file, loading the entries it already holds
+// Changes are saved by a background thread about a second after they are made,
+// and at exit
+// Pass NULL to stop persisting (the in-memory cache is kept)
+// Returns false if the file exists but cannot be read
+bool SetVersionCacheFile(const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VERSIONINFO_H
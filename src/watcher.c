@@ -0,0 +1,182 @@
+#include "watcher.h"
+#include "log.h"
+#include <stdlib.h>
+
+uint64_t WatcherHash(uint64_t hash, const void* data, size_t length) {
+  const unsigned char* bytes = (const unsigned char*)data;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= bytes[i];
+    hash *= WATCHER_FNV_PRIME;
+  }
+  return hash;
+}
+
+// Callback that runs on the main JS thread
+static void CallJS(napi_env env, napi_value js_callback, void* context, void* data) {
+  Watcher* watcher = (Watcher*)context;
+  if (data == NULL) return;
+
+  if (env == NULL || js_callback == NULL) {
+    watcher->hooks->release(data);
+    return;
+  }
+
+  napi_value value = watcher->hooks->convert(env, data);
+  if (value == NULL) {
+    return;
+  }
+
+  napi_value undefined;
+  napi_get_undefined(env, &undefined);
+  napi_call_function(env, undefined, js_callback, 1, &value, NULL);
+}
+
+void WatcherChanged(Watcher* watcher) {
+  MutexLock(&watcher->lock);
+  watcher->changed = true;
+  watcher->lastChangeMs = MonotonicMillis();
+  ConditionSignal(&watcher->wake);
+  MutexUnlock(&watcher->lock);
+}
+
+// Read the state and deliver it if it is not the last delivered one
+static void Deliver(Watcher* watcher) {
+  const WatcherHooks* hooks = watcher->hooks;
+  uint64_t hash = 0;
+  void* state = hooks->read(&hash);
+  if (state == NULL) {
+    return;
+  }
+
+  if (hash == watcher->lastHash) {
+    LOG_DEBUG(hooks->name, "Duplicate notification suppressed");
+    hooks->release(state);
+    return;
+  }
+  watcher->lastHash = hash;
+
+  if (watcher->tsfn == NULL || napi_call_threadsafe_function(watcher->tsfn, state, napi_tsfn_nonblocking) != napi_ok) {
+    hooks->release(state);
+  }
+}
+
+static THREAD_PROC(ReaderThread) {
+  Watcher* watcher = (Watcher*)arg;
+
+  MutexLock(&watcher->lock);
+  while (!watcher->stopReader) {
+    if (!watcher->changed) {
+      ConditionWait(&watcher->wake, &watcher->lock);
+      continue;
+    }
+
+    // Wait until changes have been quiet long enough
+    uint64_t now = MonotonicMillis();
+    uint64_t due = watcher->lastChangeMs + watcher->debounceMs;
+    if (now < due) {
+      ConditionTimedWait(&watcher->wake, &watcher->lock, (uint32_t)(due - now));
+      continue;
+    }
+
+    // Read without the lock: the platform thread keeps flagging changes meanwhile
+    watcher->changed = false;
+    MutexUnlock(&watcher->lock);
+    Deliver(watcher);
+    MutexLock(&watcher->lock);
+  }
+  MutexUnlock(&watcher->lock);
+
+  THREAD_RETURN;
+}
+
+static void StopReader(Watcher* watcher) {
+  MutexLock(&watcher->lock);
+  watcher->stopReader = true;
+  ConditionSignal(&watcher->wake);
+  MutexUnlock(&watcher->lock);
+  ThreadJoin(watcher->reader);
+  ConditionDestroy(&watcher->wake);
+  MutexDestroy(&watcher->lock);
+}
+
+int WatcherStart(Watcher* watcher, napi_env env, napi_value callback, uint32_t debounceMs) {
+  const WatcherHooks* hooks = watcher->hooks;
+  if (watcher->running) {
+    LOG_DEBUG(hooks->name, "Already running");
+    return 1; // Already running
+  }
+
+  // Create threadsafe function
+  napi_value resourceName;
+  napi_create_string_utf8(env, hooks->resourceName, NAPI_AUTO_LENGTH, &resourceName);
+
+  napi_status status = napi_create_threadsafe_function(
+    env,
+    callback,
+    NULL,                    // async_resource
+    resourceName,            // async_resource_name
+    0,                       // max_queue_size (0 = unlimited)
+    1,                       // initial_thread_count
+    NULL,                    // thread_finalize_data
+    NULL,                    // thread_finalize_cb
+    watcher,                 // context
+    CallJS,                  // call_js_cb
+    &watcher->tsfn
+  );
+
+  if (status != napi_ok) {
+    LOG_ERROR(hooks->name, "Failed to create threadsafe function");
+    return 2;
+  }
+
+  // Start the reader before the notification source can flag changes,
+  // with a pending change when the current state is delivered right away
+  MutexInit(&watcher->lock);
+  ConditionInit(&watcher->wake);
+  watcher->stopReader = false;
+  watcher->changed = hooks->deliverOnStart;
+  watcher->lastChangeMs = 0;
+  watcher->debounceMs = debounceMs;
+  watcher->lastHash = hooks->initialHash;
+  if (!ThreadCreate(&watcher->reader, ReaderThread, watcher)) {
+    LOG_ERROR(hooks->name, "Failed to create reader thread");
+    ConditionDestroy(&watcher->wake);
+    MutexDestroy(&watcher->lock);
+    napi_release_threadsafe_function(watcher->tsfn, napi_tsfn_abort);
+    watcher->tsfn = NULL;
+    return 5;
+  }
+
+  int result = hooks->platformStart();
+  if (result != 0) {
+    StopReader(watcher);
+    napi_release_threadsafe_function(watcher->tsfn, napi_tsfn_abort);
+    watcher->tsfn = NULL;
+    return result;
+  }
+
+  watcher->running = true;
+  LOG_INFO(hooks->name, "Started (%u ms debounce)", debounceMs);
+  return 0;
+}
+
+int WatcherStop(Watcher* watcher) {
+  if (!watcher->running) {
+    LOG_DEBUG(watcher->hooks->name, "Not running");
+    return 1; // Not running
+  }
+
+  watcher->running = false;
+
+  // Stop the notification source first so nothing flags changes once the reader is gone
+  watcher->hooks->platformStop();
+  StopReader(watcher);
+
+  // Release threadsafe function
+  if (watcher->tsfn != NULL) {
+    napi_release_threadsafe_function(watcher->tsfn, napi_tsfn_release);
+    watcher->tsfn = NULL;
+  }
+
+  return 0;
+}
@@ -0,0 +1,81 @@
+#ifndef WATCHER_H
+#define WATCHER_H
+
+#include <node_api.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Debounced watcher core shared by the selection and foreground watchers:
+// a platform thread only flags changes, a reader thread reads the state once
+// changes have been quiet for the debounce time and delivers it to a JS
+// callback when it differs from the last delivered state
+
+// Start result of platforms without a notification source
+#define WATCHER_NOT_SUPPORTED 4
+
+#define WATCHER_FNV_OFFSET_BASIS 14695981039346656037ULL
+#define WATCHER_FNV_PRIME 1099511628211ULL
+
+// FNV-1a, to chain over the fields that identify a state
+uint64_t WatcherHash(uint64_t hash, const void* data, size_t length);
+
+typedef struct {
+  const char* name;           // Log tag
+  const char* resourceName;   // Threadsafe function resource name
+  bool deliverOnStart;        // Read and deliver the current state right away
+  uint64_t initialHash;       // Hash of the state considered already delivered
+
+  // Read the current state on the reader thread and hash it
+  // Returns NULL if there is nothing to deliver
+  void* (*read)(uint64_t* hash);
+
+  // Build the callback argument on the JS thread and free the state
+  napi_value (*convert)(napi_env env, void* state);
+
+  // Free a state that will not be delivered
+  void (*release)(void* state);
+
+  // Notification source, started after the reader and stopped before it
+  // platformStart returns 0 on success or the error code of the start call
+  int (*platformStart)(void);
+  void (*platformStop)(void);
+} WatcherHooks;
+
+typedef struct {
+  const WatcherHooks* hooks;
+  napi_threadsafe_function tsfn;
+  bool running;
+  Mutex lock;
+  Condition wake;
+  Thread reader;
+  bool stopReader;
+  bool changed;
+  uint64_t lastChangeMs;
+  uint32_t debounceMs;
+  uint64_t lastHash;
+} Watcher;
+
+// Start watching
+// Returns: 0 on success, 1 if already running, 2 if the threadsafe function
+// cannot be created, 5 if the reader thread cannot be created, or the error
+// of platformStart
+int WatcherStart(Watcher* watcher, napi_env env, napi_value callback, uint32_t debounceMs);
+
+// Stop watching
+// Returns: 0 on success, 1 if not running
+int WatcherStop(Watcher* watcher);
+
+// Flag a change, from the platform thread
+void WatcherChanged(Watcher* watcher);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WATCHER_H
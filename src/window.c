@@ -1,5 +1,6 @@
 #include "window.h"
 #include "process.h"
+#include "log.h"
 
 #ifdef WIN32
 
@@ -26,7 +27,7 @@ static BOOL GetWindoWinfo(HWND hwnd, WindowInfo* info) {
   // Skip windows with no title
   char title[256];
   if (GetWindowTextA(hwnd, title, sizeof(title)) == 0) {
-    printf("GetWindowTextA failed\n");
+    LOG_DEBUG("window", "GetWindowTextA failed");
     return FALSE;
   }
   
@@ -73,14 +74,14 @@ ForemostWindowInfo* GetForemostWindow() {
 
   HWND hwnd = GetForegroundWindow();
   if (!hwnd) {
-    printf("GetForegroundWindow failed\n");
+    LOG_DEBUG("window", "GetForegroundWindow failed");
     return NULL;
   }
 
   WindowInfo info;
   ZeroMemory(&info, sizeof(WindowInfo));
   if (!GetWindoWinfo(hwnd, &info)) {
-    printf("GetForegroundWindow failed\n");
+    LOG_DEBUG("window", "Unable to get foreground window info");
     return NULL;
   }
 
@@ -107,7 +108,7 @@ void FreeWindowInfo(ForemostWindowInfo* info) {
 
 BOOL ActivateWindow(HWND hwnd) {
   if (!hwnd) {
-    printf("Invalid window handle\n");
+    LOG_WARN("window", "Invalid window handle");
     return FALSE;
   }
   
@@ -121,4 +122,369 @@ BOOL ActivateWindow(HWND hwnd) {
   return TRUE;
 }
 
+#elif defined(__linux__)
+
+#include "desktopindex.h"
+#include <xcb/xcb.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Processes remembered between calls, a pid is only reused if its start time matches
+#define PROCESS_CACHE_SIZE 32
+
+// Longest title read, in 32-bit units
+#define TITLE_MAX_WORDS 1024
+
+// Longest WM_CLASS read, in 32-bit units
+#define CLASS_MAX_WORDS 64
+
+typedef struct {
+  int pid;
+  unsigned long long startTime;
+  char* exePath;
+  char* productName;
+  uint64_t lastUse;
+} ProcessEntry;
+
+// Connection and cache are shared by all callers
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static xcb_connection_t* g_connection = NULL;
+static xcb_window_t g_root = XCB_NONE;
+static bool g_failed = false;
+static xcb_atom_t g_activeWindow = XCB_NONE;
+static xcb_atom_t g_wmPid = XCB_NONE;
+static xcb_atom_t g_wmName = XCB_NONE;
+static xcb_atom_t g_utf8 = XCB_NONE;
+static ProcessEntry g_processes[PROCESS_CACHE_SIZE];
+static uint64_t g_useCounter = 0;
+
+static bool Connect(void) {
+  if (g_connection != NULL) {
+    if (!xcb_connection_has_error(g_connection)) {
+      return true;
+    }
+    // The server went away: try once more with a new connection
+    xcb_disconnect(g_connection);
+    g_connection = NULL;
+  } else if (g_failed) {
+    // Do not retry on every call: connecting to a missing server is slow
+    return false;
+  }
+
+  int screenNumber = 0;
+  xcb_connection_t* connection = xcb_connect(NULL, &screenNumber);
+  if (xcb_connection_has_error(connection)) {
+    xcb_disconnect(connection);
+    g_failed = true;
+    return false;
+  }
+
+  xcb_screen_iterator_t screens = xcb_setup_roots_iterator(xcb_get_setup(connection));
+  for (int i = 0; i < screenNumber && screens.rem > 0; i++) {
+    xcb_screen_next(&screens);
+  }
+  if (screens.rem == 0) {
+    xcb_disconnect(connection);
+    g_failed = true;
+    return false;
+  }
+  g_root = screens.data->root;
+
+  // All atoms in one round trip
+  static const char* names[] = { "_NET_ACTIVE_WINDOW", "_NET_WM_PID", "_NET_WM_NAME", "UTF8_STRING" };
+  xcb_atom_t* atoms[] = { &g_activeWindow, &g_wmPid, &g_wmName, &g_utf8 };
+  xcb_intern_atom_cookie_t cookies[4];
+  for (int i = 0; i < 4; i++) {
+    cookies[i] = xcb_intern_atom(connection, 0, (uint16_t)strlen(names[i]), names[i]);
+  }
+  for (int i = 0; i < 4; i++) {
+    xcb_intern_atom_reply_t* reply = xcb_intern_atom_reply(connection, cookies[i], NULL);
+    *atoms[i] = reply != NULL ? reply->atom : XCB_NONE;
+    free(reply);
+  }
+
+  g_connection = connection;
+  return true;
+}
+
+// Copy a property value as a string, NULL if missing
+static char* PropertyString(xcb_get_property_reply_t* reply) {
+  if (reply == NULL || reply->format != 8 || reply->type == XCB_NONE) {
+    return NULL;
+  }
+  int length = xcb_get_property_value_length(reply);
+  char* value = (char*)malloc((size_t)length + 1);
+  if (value != NULL) {
+    memcpy(value, xcb_get_property_value(reply), (size_t)length);
+    value[length] = '\0';
+  }
+  return value;
+}
+
+// Field 22 of /proc/<pid>/stat, in clock ticks after boot
+static unsigned long long ProcessStartTime(int pid) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    return 0;
+  }
+  char buffer[1024];
+  size_t length = fread(buffer, 1, sizeof(buffer) - 1, file);
+  fclose(file);
+  buffer[length] = '\0';
+
+  // The command name may contain spaces and parentheses: skip to the last ')'
+  char* field = strrchr(buffer, ')');
+  if (field == NULL) {
+    return 0;
+  }
+  for (int index = 2; index < 22 && field != NULL; index++) {
+    field = strchr(field + 1, ' ');
+  }
+  return field != NULL ? strtoull(field + 1, NULL, 10) : 0;
+}
+
+// Look up (or resolve and remember) the executable of a process, with the lock held
+static ProcessEntry* ProcessMetadata(int pid) {
+  unsigned long long startTime = ProcessStartTime(pid);
+  ProcessEntry* oldest = &g_processes[0];
+  for (int i = 0; i < PROCESS_CACHE_SIZE; i++) {
+    ProcessEntry* entry = &g_processes[i];
+    if (entry->exePath != NULL && entry->pid == pid && entry->startTime == startTime) {
+      entry->lastUse = ++g_useCounter;
+      return entry;
+    }
+    if (entry->lastUse < oldest->lastUse) {
+      oldest = entry;
+    }
+  }
+
+  char path[64];
+  char exePath[PATH_MAX];
+  snprintf(path, sizeof(path), "/proc/%d/exe", pid);
+  ssize_t length = readlink(path, exePath, sizeof(exePath) - 1);
+  if (length < 0) {
+    // Processes of other users cannot be inspected
+    LOG_DEBUG("window", "Unable to read %s", path);
+    length = 0;
+  }
+  exePath[length] = '\0';
+
+  // Use the executable name like the Windows fallback, when no .desktop file matches
+  const char* name = strrchr(exePath, '/');
+  name = name != NULL ? name + 1 : exePath;
+
+  free(oldest->exePath);
+  free(oldest->productName);
+  oldest->pid = pid;
+  oldest->startTime = startTime;
+  oldest->exePath = strdup(exePath);
+  oldest->productName = strdup(name);
+  oldest->lastUse = ++g_useCounter;
+  if (oldest->exePath == NULL || oldest->productName == NULL) {
+    free(oldest->exePath);
+    free(oldest->productName);
+    oldest->exePath = NULL;
+    oldest->productName = NULL;
+    return NULL;
+  }
+  return oldest;
+}
+
+ForemostWindowInfo* GetForemostWindow() {
+  pthread_mutex_lock(&g_lock);
+  if (!Connect()) {
+    LOG_DEBUG("window", "No X server");
+    pthread_mutex_unlock(&g_lock);
+    return NULL;
+  }
+
+  // The window manager publishes the active window on the root
+  xcb_get_property_reply_t* active = xcb_get_property_reply(g_connection,
+    xcb_get_property(g_connection, 0, g_root, g_activeWindow, XCB_ATOM_WINDOW, 0, 1), NULL);
+  xcb_window_t window = XCB_NONE;
+  if (active != NULL && active->format == 32 && xcb_get_property_value_length(active) >= 4) {
+    window = *(xcb_window_t*)xcb_get_property_value(active);
+  }
+  free(active);
+  if (window == XCB_NONE) {
+    LOG_DEBUG("window", "No active window");
+    pthread_mutex_unlock(&g_lock);
+    return NULL;
+  }
+
+  // Send every request before waiting for the first reply: one round trip
+  xcb_get_property_cookie_t pidCookie = xcb_get_property(g_connection, 0, window, g_wmPid, XCB_ATOM_CARDINAL, 0, 1);
+  xcb_get_property_cookie_t nameCookie = xcb_get_property(g_connection, 0, window, g_wmName, g_utf8, 0, TITLE_MAX_WORDS);
+  xcb_get_property_cookie_t legacyCookie = xcb_get_property(g_connection, 0, window, XCB_ATOM_WM_NAME, XCB_GET_PROPERTY_TYPE_ANY, 0, TITLE_MAX_WORDS);
+  xcb_get_property_cookie_t classCookie = xcb_get_property(g_connection, 0, window, XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, 0, CLASS_MAX_WORDS);
+  xcb_get_property_reply_t* pidReply = xcb_get_property_reply(g_connection, pidCookie, NULL);
+  xcb_get_property_reply_t* nameReply = xcb_get_property_reply(g_connection, nameCookie, NULL);
+  xcb_get_property_reply_t* legacyReply = xcb_get_property_reply(g_connection, legacyCookie, NULL);
+  xcb_get_property_reply_t* classReply = xcb_get_property_reply(g_connection, classCookie, NULL);
+
+  int pid = 0;
+  if (pidReply != NULL && pidReply->format == 32 && xcb_get_property_value_length(pidReply) >= 4) {
+    pid = (int)*(uint32_t*)xcb_get_property_value(pidReply);
+  }
+
+  // Prefer the UTF-8 EWMH title over the legacy one
+  char* title = PropertyString(nameReply);
+  if (title == NULL) {
+    title = PropertyString(legacyReply);
+  }
+  // WM_CLASS holds the instance then the class, NUL separated
+  char* instance = PropertyString(classReply);
+  const char* wmClass = instance != NULL ? instance + strlen(instance) + 1 : NULL;
+  if (wmClass != NULL && wmClass >= instance + xcb_get_property_value_length(classReply)) {
+    wmClass = NULL;
+  }
+  free(pidReply);
+  free(nameReply);
+  free(legacyReply);
+  free(classReply);
+
+  ForemostWindowInfo* result = (ForemostWindowInfo*)calloc(1, sizeof(ForemostWindowInfo));
+  if (result != NULL) {
+    ProcessEntry* process = pid > 0 ? ProcessMetadata(pid) : NULL;
+    result->processId = pid;
+    result->title = title != NULL ? title : strdup("");
+    result->exePath = strdup(process != NULL ? process->exePath : "");
+    result->productName = strdup(process != NULL ? process->productName : "");
+    title = NULL;
+  }
+  free(title);
+  pthread_mutex_unlock(&g_lock);
+
+  // Prefer the name of the installed application over the executable name
+  // Outside the lock, and without waiting for the index: this is the hotkey path
+  DesktopApp app;
+  const char* exePath = result != NULL && result->exePath != NULL && result->exePath[0] != '\0' ? result->exePath : NULL;
+  if (result != NULL && FindDesktopApp(wmClass, instance, exePath, 0, &app) && app.name[0] != '\0') {
+    char* name = strdup(app.name);
+    if (name != NULL) {
+      free(result->productName);
+      result->productName = name;
+    }
+  }
+  free(instance);
+  return result;
+}
+
+void FreeWindowInfo(ForemostWindowInfo* info) {
+  if (!info) return;
+
+  free(info->exePath);
+  free(info->title);
+  free(info->productName);
+
+  free(info);
+}
+
+#elif defined(__APPLE__)
+
+#include <ApplicationServices/ApplicationServices.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <libproc.h>
+#include <objc/message.h>
+#include <objc/runtime.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Copy a CFString as a malloc'ed UTF-8 string
+static char* CopyUTF8(CFStringRef string) {
+  CFIndex size = CFStringGetMaximumSizeForEncoding(CFStringGetLength(string), kCFStringEncodingUTF8) + 1;
+  char* value = (char*)malloc((size_t)size);
+  if (value != NULL && !CFStringGetCString(string, value, size, kCFStringEncodingUTF8)) {
+    value[0] = '\0';
+  }
+  return value;
+}
+
+// Localized name of the application (NSRunningApplication, through the runtime)
+static char* ApplicationName(pid_t pid) {
+  id (*send)(id, SEL) = (id (*)(id, SEL))objc_msgSend;
+  id (*sendPid)(id, SEL, pid_t) = (id (*)(id, SEL, pid_t))objc_msgSend;
+
+  // The lookup returns autoreleased objects and this may run outside of any pool
+  id pool = send(send((id)objc_getClass("NSAutoreleasePool"), sel_registerName("alloc")), sel_registerName("init"));
+  char* name = NULL;
+  id app = sendPid((id)objc_getClass("NSRunningApplication"), sel_registerName("runningApplicationWithProcessIdentifier:"), pid);
+  if (app != NULL) {
+    CFStringRef localizedName = (CFStringRef)send(app, sel_registerName("localizedName"));
+    if (localizedName != NULL) {
+      name = CopyUTF8(localizedName);
+    }
+  }
+  send(pool, sel_registerName("drain"));
+  return name;
+}
+
+// Title of the focused window, only readable with accessibility permissions
+static char* FocusedWindowTitle(pid_t pid) {
+  AXUIElementRef app = AXUIElementCreateApplication(pid);
+  if (app == NULL) {
+    return NULL;
+  }
+  char* title = NULL;
+  AXUIElementRef window = NULL;
+  if (AXUIElementCopyAttributeValue(app, kAXFocusedWindowAttribute, (CFTypeRef*)&window) == kAXErrorSuccess && window != NULL) {
+    CFStringRef value = NULL;
+    if (AXUIElementCopyAttributeValue(window, kAXTitleAttribute, (CFTypeRef*)&value) == kAXErrorSuccess && value != NULL) {
+      title = CopyUTF8(value);
+      CFRelease(value);
+    }
+    CFRelease(window);
+  }
+  CFRelease(app);
+  return title;
+}
+
+ForemostWindowInfo* GetForemostWindow() {
+  pid_t pid = GetForemostApplicationPID();
+  if (pid == 0) {
+    return NULL;
+  }
+
+  ForemostWindowInfo* result = (ForemostWindowInfo*)calloc(1, sizeof(ForemostWindowInfo));
+  if (result == NULL) {
+    return NULL;
+  }
+
+  char exePath[PROC_PIDPATHINFO_MAXSIZE];
+  if (proc_pidpath(pid, exePath, sizeof(exePath)) <= 0) {
+    exePath[0] = '\0';
+  }
+
+  result->processId = (int)pid;
+  result->exePath = strdup(exePath);
+  result->title = FocusedWindowTitle(pid);
+  result->productName = ApplicationName(pid);
+  if (result->title == NULL) {
+    result->title = strdup("");
+  }
+  if (result->productName == NULL) {
+    // Fall back to the executable name
+    const char* name = strrchr(exePath, '/');
+    result->productName = strdup(name != NULL ? name + 1 : exePath);
+  }
+  return result;
+}
+
+void FreeWindowInfo(ForemostWindowInfo* info) {
+  if (!info) return;
+
+  free(info->exePath);
+  free(info->title);
+  free(info->productName);
+
+  free(info);
+}
+
 #endif
@@ -7,25 +7,34 @@
 extern "C" {
 #endif
 
-#ifdef WIN32
-
-#include <windows.h>
+#if defined(WIN32) || defined(__linux__) || defined(__APPLE__)
 
 // Structure to hold window information
 typedef struct {
   char* exePath;      // Path to the executable
   char* title;        // Window title
-  char* productName;  // Product name from exe resources
+  char* productName;  // Product name from exe resources (.desktop file Name or executable name on Linux, application name on macOS)
   int processId;      // Process ID
 } ForemostWindowInfo;
 
 // Get information about the foremost window
+// On Linux this reads _NET_ACTIVE_WINDOW from the window manager on a
+// persistent xcb connection, process metadata is cached per pid and start time
+// and the product name comes from the desktop index (see FindDesktopApp),
+// the executable name until the index is built: this never waits for it
+// On macOS this is the frontmost application, the title needs accessibility permissions
 // Returns a pointer to a WindowInfo struct that must be freed with FreeWindowInfo
 ForemostWindowInfo* GetForemostWindow();
 
 // Free the memory allocated for WindowInfo
 void FreeWindowInfo(ForemostWindowInfo* info);
 
+#endif
+
+#ifdef WIN32
+
+#include <windows.h>
+
 // Activate a window by sending WM_ACTIVATE message
 // Returns TRUE if successful, FALSE otherwise
 BOOL ActivateWindow(HWND hwnd);
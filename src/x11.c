@@ -0,0 +1,258 @@
+#include "x11.h"
+
+#ifdef __linux__
+
+#include <pthread.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "threads.h"
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static Display* g_display = NULL;
+static bool g_failed = false;
+
+static int IgnoreXErrors(Display* display, XErrorEvent* error) {
+  // Stale window ids and similar are expected: never let Xlib abort the process
+  (void)display;
+  (void)error;
+  return 0;
+}
+
+Display* X11Acquire(void) {
+  pthread_mutex_lock(&g_lock);
+
+  if (g_display == NULL && !g_failed) {
+    XInitThreads();
+    XSetErrorHandler(IgnoreXErrors);
+    g_display = XOpenDisplay(NULL);
+    if (g_display == NULL) {
+      // Do not retry on every call: connecting to a missing server is slow
+      g_failed = true;
+    }
+  }
+
+  if (g_display == NULL) {
+    pthread_mutex_unlock(&g_lock);
+    return NULL;
+  }
+
+  return g_display;
+}
+
+void X11Release(void) {
+  pthread_mutex_unlock(&g_lock);
+}
+
+// Selection transfers share one requestor window and property, one at a time
+static pthread_mutex_t g_selectionLock = PTHREAD_MUTEX_INITIALIZER;
+static Window g_requestor = None;
+static Atom g_property = None;
+static Atom g_incr = None;
+
+// Interval between checks for events read by another thread
+#define SELECTION_POLL_MS 10
+
+// Largest property read in one request, in 32-bit units
+#define SELECTION_MAX_READ 0x1FFFFFFF
+
+static Window Requestor(Display* display) {
+  if (g_requestor == None) {
+    // Never mapped: it only exists to receive the converted data
+    g_requestor = XCreateSimpleWindow(display, DefaultRootWindow(display), -10, -10, 1, 1, 0, 0, 0);
+    XSelectInput(display, g_requestor, PropertyChangeMask);
+    g_property = XInternAtom(display, "AUTOLIB_SELECTION", False);
+    g_incr = XInternAtom(display, "INCR", False);
+  }
+  return g_requestor;
+}
+
+// Wait for an event on the requestor window, without holding the X lock while idle
+// For PropertyNotify, only new values of our property count
+static bool WaitForEvent(int type, uint64_t deadline, XEvent* event) {
+  for (;;) {
+    Display* display = X11Acquire();
+    if (display == NULL) {
+      return false;
+    }
+    bool found = false;
+    while (!found && XCheckTypedWindowEvent(display, g_requestor, type, event)) {
+      found = type != PropertyNotify ||
+              (event->xproperty.atom == g_property && event->xproperty.state == PropertyNewValue);
+    }
+    int fd = ConnectionNumber(display);
+    X11Release();
+    if (found) {
+      return true;
+    }
+
+    uint64_t now = MonotonicMillis();
+    if (now >= deadline) {
+      return false;
+    }
+
+    // Another thread may read our event into the queue: never sleep long on the socket
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    uint64_t wait = deadline - now;
+    poll(&pfd, 1, wait < SELECTION_POLL_MS ? (int)wait : SELECTION_POLL_MS);
+  }
+}
+
+// Read and delete our property (X lock held)
+static bool ReadProperty(Display* display, Atom* type, unsigned char** data, size_t* length) {
+  Atom actualType;
+  int format;
+  unsigned long items, after;
+  unsigned char* value = NULL;
+  if (XGetWindowProperty(display, g_requestor, g_property, 0, SELECTION_MAX_READ, True, AnyPropertyType,
+                         &actualType, &format, &items, &after, &value) != Success || actualType == None) {
+    return false;
+  }
+
+  // 32-bit items are stored as longs by Xlib
+  size_t unit = format == 32 ? sizeof(long) : (size_t)format / 8;
+  size_t bytes = items * unit;
+  *data = (unsigned char*)malloc(bytes + 1);
+  if (*data != NULL) {
+    if (bytes > 0) {
+      memcpy(*data, value, bytes);
+    }
+    (*data)[bytes] = '\0';
+  }
+  XFree(value);
+
+  *type = actualType;
+  *length = bytes;
+  return *data != NULL;
+}
+
+int X11ReadSelection(Atom selection, Atom target, uint32_t timeoutMs, unsigned char** data, size_t* length, Atom* type) {
+  *data = NULL;
+  *length = 0;
+
+  pthread_mutex_lock(&g_selectionLock);
+
+  Display* display = X11Acquire();
+  if (display == NULL) {
+    pthread_mutex_unlock(&g_selectionLock);
+    return 1;
+  }
+
+  // Drop leftovers of an earlier transfer that timed out
+  Window requestor = Requestor(display);
+  XEvent event;
+  while (XCheckTypedWindowEvent(display, requestor, SelectionNotify, &event) ||
+         XCheckTypedWindowEvent(display, requestor, PropertyNotify, &event)) {
+  }
+  XDeleteProperty(display, requestor, g_property);
+  XConvertSelection(display, selection, target, g_property, requestor, CurrentTime);
+  XFlush(display);
+  X11Release();
+
+  int result = 2;
+  bool ok;
+  unsigned char* chunk = NULL;
+  size_t chunkLength = 0;
+  unsigned char* buffer = NULL;
+  size_t size = 0;
+  Atom actualType = None;
+  uint64_t deadline = MonotonicMillis() + timeoutMs;
+
+  if (!WaitForEvent(SelectionNotify, deadline, &event)) {
+    goto done;
+  }
+  if (event.xselection.property == None) {
+    result = 3;
+    goto done;
+  }
+
+  // Deleting the property also tells an INCR owner to send the first chunk
+  display = X11Acquire();
+  if (display == NULL) {
+    result = 1;
+    goto done;
+  }
+  ok = ReadProperty(display, &actualType, &chunk, &chunkLength);
+  XFlush(display);
+  X11Release();
+  if (!ok) {
+    result = 3;
+    goto done;
+  }
+
+  if (actualType != g_incr) {
+    *data = chunk;
+    *length = chunkLength;
+    result = 0;
+    goto done;
+  }
+
+  // INCR: chunks arrive as new values of the property until an empty one
+  free(chunk);
+  for (;;) {
+    deadline = MonotonicMillis() + timeoutMs;
+    if (!WaitForEvent(PropertyNotify, deadline, &event)) {
+      free(buffer);
+      goto done;
+    }
+
+    display = X11Acquire();
+    if (display == NULL) {
+      free(buffer);
+      result = 1;
+      goto done;
+    }
+    ok = ReadProperty(display, &actualType, &chunk, &chunkLength);
+    XFlush(display);
+    X11Release();
+    if (!ok) {
+      free(buffer);
+      result = 3;
+      goto done;
+    }
+
+    if (chunkLength == 0) {
+      free(chunk);
+      break;
+    }
+
+    unsigned char* grown = (unsigned char*)realloc(buffer, size + chunkLength + 1);
+    if (grown == NULL) {
+      free(chunk);
+      free(buffer);
+      result = 3;
+      goto done;
+    }
+    buffer = grown;
+    memcpy(buffer + size, chunk, chunkLength);
+    size += chunkLength;
+    buffer[size] = '\0';
+    free(chunk);
+  }
+
+  if (buffer == NULL) {
+    buffer = (unsigned char*)calloc(1, 1);
+  }
+  *data = buffer;
+  *length = size;
+  result = buffer != NULL ? 0 : 3;
+
+done:
+  if (result == 0 && type != NULL) {
+    *type = actualType;
+  }
+  pthread_mutex_unlock(&g_selectionLock);
+  return result;
+}
+
+bool X11Available(void) {
+  Display* display = X11Acquire();
+  if (display == NULL) {
+    return false;
+  }
+  X11Release();
+  return true;
+}
+
+#endif
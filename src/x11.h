@@ -0,0 +1,42 @@
+#ifndef X11_H
+#define X11_H
+
+#ifdef __linux__
+
+#include <X11/Xlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Get the persistent X connection shared by the Linux backends and lock it
+// Returns NULL (and holds no lock) if no X server is reachable
+// Every successful call must be balanced by X11Release
+Display* X11Acquire(void);
+
+// Unlock the shared X connection
+void X11Release(void);
+
+// Check if an X server is reachable
+bool X11Available(void);
+
+// Ask the owner of a selection (PRIMARY, CLIPBOARD...) to convert it to target
+// and read the result through a hidden requestor window, following the INCR
+// protocol for large transfers. Must be called without holding the X lock:
+// the lock is released while waiting for the owner.
+// On success *data is a malloc'ed, NUL-terminated buffer of *length bytes
+// and *type (if not NULL) the type the owner actually used
+// Returns 0 on success, 1 if no X server, 2 on timeout,
+// 3 if there is no owner or it refused the target
+int X11ReadSelection(Atom selection, Atom target, uint32_t timeoutMs, unsigned char** data, size_t* length, Atom* type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif // X11_H
@@ -0,0 +1,44 @@
+// Prints the output of the pixel kernels on rows of every width up to 70,
+// covering the SIMD bodies and their scalar tails
+// test.js builds it with and without IMAGE_SCALAR and compares the outputs
+#include "../src/image.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_WIDTH 70
+
+static void Print(const uint8_t* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    printf("%02x", data[i]);
+  }
+  printf("\n");
+}
+
+int main(void) {
+  uint8_t bgra[MAX_WIDTH * 4] = {0};
+  uint8_t rgba[MAX_WIDTH * 4];
+  uint8_t mask[(MAX_WIDTH + 7) / 8];
+  uint32_t seed = 1;
+
+  for (size_t width = 0; width <= MAX_WIDTH; width++) {
+    for (size_t i = 0; i < width * 4; i++) {
+      seed = seed * 1103515245u + 12345u;
+      bgra[i] = (uint8_t)(seed >> 16);
+    }
+    // Alpha on both sides of the mask threshold
+    for (size_t x = 0; x < width; x += 3) {
+      bgra[x * 4 + 3] = (uint8_t)(127 + x % 2);
+    }
+
+    BgraToRgba(bgra, rgba, width);
+    Print(rgba, width * 4);
+
+    memset(mask, 0xAA, sizeof(mask));
+    AlphaToMask(bgra, mask, width);
+    Print(mask, (width + 7) / 8);
+
+    BgraToRgba(bgra, bgra, width);
+    Print(bgra, width * 4);
+  }
+  return 0;
+}
@@ -0,0 +1,67 @@
+// Checks key name lookups: every entry in any case, unknown names and the
+// Windows extended-key flags
+// test.js builds and runs it, the exit status is the number of failures
+#include "../src/keytable.h"
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+static int g_failures = 0;
+
+static void Expect(const char* name, const KeyDefinition* key, const KeyDefinition* expected) {
+  if (key != expected) {
+    printf("%s: expected %s, got %s\n", name ? name : "(null)",
+           expected ? expected->name : "no key", key ? key->name : "no key");
+    g_failures++;
+  }
+}
+
+static void ExpectAnyCase(const char* name) {
+  char lower[32];
+  char upper[32];
+  size_t length = strlen(name);
+  for (size_t i = 0; i <= length; i++) {
+    lower[i] = (char)tolower((unsigned char)name[i]);
+    upper[i] = (char)toupper((unsigned char)name[i]);
+  }
+
+  const KeyDefinition* key = LookupKey(name);
+  if (key == NULL || strcmp(key->name, name) != 0) {
+    printf("%s: not found\n", name);
+    g_failures++;
+    return;
+  }
+  Expect(lower, LookupKey(lower), key);
+  Expect(upper, LookupKey(upper), key);
+}
+
+static void ExpectExtended(const char* name, bool extended) {
+  const KeyDefinition* key = LookupKey(name);
+  if (key == NULL || ((key->win & KEY_EXTENDED) != 0) != extended) {
+    printf("%s: expected %s\n", name, extended ? "extended" : "not extended");
+    g_failures++;
+  }
+}
+
+int main(void) {
+#define KEY(name, win, mac, evdev) ExpectAnyCase(name);
+#include "../src/keytable.def"
+#undef KEY
+
+  const char* unknown[] = { NULL, "", "Enterr", "Ente", "F25", "Numpad", "Numpad10", "Space ", "Ctrl" };
+  for (size_t i = 0; i < sizeof(unknown) / sizeof(unknown[0]); i++) {
+    Expect(unknown[i], LookupKey(unknown[i]), NULL);
+  }
+
+  ExpectExtended("NumpadEnter", true);
+  ExpectExtended("Enter", false);
+  ExpectExtended("MediaPlayPause", true);
+  ExpectExtended("VolumeMute", true);
+  if (KEY_VIRTUAL_KEY(LookupKey("NumpadEnter")->win) != LookupKey("Enter")->win) {
+    printf("NumpadEnter: expected the Enter virtual key\n");
+    g_failures++;
+  }
+
+  return g_failures;
+}
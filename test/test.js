@@ -1,7 +1,12 @@
 
 /* eslint-disable @typescript-eslint/no-require-imports */
 const assert = require('assert');
-const { describe, it } = require('mocha');
+const { spawnSync } = require('child_process');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const zlib = require('zlib');
+const { describe, it, before, after } = require('mocha');
 const keysender = require('../index');
 
 describe('KeySender Module', function() {
@@ -22,4 +27,384 @@ describe('KeySender Module', function() {
       assert.ok(error, 'Expected an error to be thrown for invalid key');
     }
   });
-});
\ No newline at end of file
+});
+
+// Version resource block: header, UTF-16 key, then value and children aligned on 32 bits
+function versionBlock(key, value, text, children = []) {
+  const align = (buffer) => Buffer.concat([buffer, Buffer.alloc((4 - (buffer.length % 4)) % 4)]);
+  const header = Buffer.alloc(6);
+  header.writeUInt16LE(text ? value.length / 2 : value.length, 2);
+  header.writeUInt16LE(text ? 1 : 0, 4);
+  const block = Buffer.concat([align(Buffer.concat([header, Buffer.from(key + '\0', 'utf16le')])), align(value), ...children.map(align)]);
+  block.writeUInt16LE(block.length, 0);
+  return block;
+}
+
+function versionString(key, value) {
+  return versionBlock(key, Buffer.from(value + '\0', 'utf16le'), true);
+}
+
+// Minimal PE32 image with a single .rsrc section holding [type, id, data] resources
+function syntheticPE(resources) {
+  const types = [...new Set(resources.map(([type]) => type))].sort((a, b) => a - b);
+  const directory = (count) => Buffer.alloc(16 + count * 8);
+  const root = directory(types.length);
+  const tables = [root];
+  let offset = root.length;
+  const leaves = [];
+  types.forEach((type, t) => {
+    const ids = resources.filter((resource) => resource[0] === type).sort((a, b) => a[1] - b[1]);
+    const table = directory(ids.length);
+    root.writeUInt16LE(types.length, 14);
+    root.writeUInt32LE(type, 16 + t * 8);
+    root.writeUInt32LE((0x80000000 | offset) >>> 0, 20 + t * 8);
+    tables.push(table);
+    offset += table.length;
+    ids.forEach(([, id, data], i) => {
+      // type -> id -> language 0x409 -> data entry
+      const language = directory(1);
+      table.writeUInt16LE(ids.length, 14);
+      table.writeUInt32LE(id, 16 + i * 8);
+      table.writeUInt32LE((0x80000000 | offset) >>> 0, 20 + i * 8);
+      language.writeUInt16LE(1, 14);
+      language.writeUInt32LE(0x409, 16);
+      tables.push(language);
+      leaves.push({ language, data });
+      offset += language.length;
+    });
+  });
+  const entries = leaves.map(({ language }) => {
+    language.writeUInt32LE(offset, 20);
+    offset += 16;
+    return Buffer.alloc(16);
+  });
+  const blobs = leaves.map(({ data }, i) => {
+    entries[i].writeUInt32LE(0x1000 + offset, 0);
+    entries[i].writeUInt32LE(data.length, 4);
+    const padded = Buffer.concat([data, Buffer.alloc((4 - (data.length % 4)) % 4)]);
+    offset += padded.length;
+    return padded;
+  });
+  const section = Buffer.concat([...tables, ...entries, ...blobs]);
+
+  const image = Buffer.alloc(0x200);
+  image.write('MZ', 0);
+  image.writeUInt32LE(0x40, 0x3c);
+  image.write('PE\0\0', 0x40, 'latin1');
+  image.writeUInt16LE(0x14c, 0x44);
+  image.writeUInt16LE(1, 0x46);
+  image.writeUInt16LE(224, 0x54);
+  image.writeUInt16LE(0x10b, 0x58);
+  image.writeUInt32LE(16, 0x58 + 92);
+  image.writeUInt32LE(0x1000, 0x58 + 96 + 2 * 8);
+  image.writeUInt32LE(section.length, 0x58 + 96 + 2 * 8 + 4);
+  const header = 0x58 + 224;
+  image.write('.rsrc', header);
+  image.writeUInt32LE(section.length, header + 8);
+  image.writeUInt32LE(0x1000, header + 12);
+  image.writeUInt32LE(section.length, header + 16);
+  image.writeUInt32LE(0x200, header + 20);
+  return Buffer.concat([image, section]);
+}
+
+function withSyntheticPE(resources, callback) {
+  const exePath = path.join(os.tmpdir(), `autolib-${process.pid}-${Date.now()}.exe`);
+  fs.writeFileSync(exePath, syntheticPE(resources));
+  let result;
+  try {
+    result = callback(exePath);
+  } finally {
+    // Async callbacks keep the file until they settle
+    if (!(result instanceof Promise)) fs.unlinkSync(exePath);
+  }
+  return result instanceof Promise ? result.finally(() => fs.unlinkSync(exePath)) : result;
+}
+
+// PNG chunk checksum
+function crc32(buffer) {
+  let crc = 0xffffffff;
+  for (const byte of buffer) {
+    crc ^= byte;
+    for (let bit = 0; bit < 8; bit++) {
+      crc = (crc >>> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+  }
+  return (crc ^ 0xffffffff) >>> 0;
+}
+
+// zlib stream checksum
+function adler32(buffer) {
+  let a = 1;
+  let b = 0;
+  for (const byte of buffer) {
+    a = (a + byte) % 65521;
+    b = (b + a) % 65521;
+  }
+  return ((b << 16) | a) >>> 0;
+}
+
+// Build a C test program from the repository root and run it
+// Returns the spawnSync result, or null if it cannot be compiled
+function runTestProgram(sources, defines = []) {
+  const exePath = path.join(os.tmpdir(), `autolib-test-${process.pid}-${Date.now()}`);
+  const build = spawnSync(process.env.CC || 'cc', ['-O2', ...defines, '-o', exePath, ...sources], { cwd: path.join(__dirname, '..') });
+  if (build.status !== 0) {
+    return null;
+  }
+  try {
+    return spawnSync(exePath);
+  } finally {
+    fs.rmSync(exePath, { force: true });
+  }
+}
+
+describe('Version info', function() {
+  it('should read the version resource of a PE file', function() {
+    const fixed = Buffer.alloc(52);
+    fixed.writeUInt32LE(0xfeef04bd, 0);
+    fixed.writeUInt32LE(0x00010002, 8);
+    fixed.writeUInt32LE(0x00030004, 12);
+    const version = versionBlock('VS_VERSION_INFO', fixed, false, [
+      versionBlock('StringFileInfo', Buffer.alloc(0), true, [
+        versionBlock('040904b0', Buffer.alloc(0), true, [versionString('ProductName', 'English')]),
+        versionBlock('041104b0', Buffer.alloc(0), true, [
+          versionString('ProductName', 'Ünïcødé 製品'),
+          versionString('CompanyName', 'Witsy'),
+          versionString('ProductVersion', '2.0'),
+        ]),
+      ]),
+      versionBlock('VarFileInfo', Buffer.alloc(0), true, [
+        versionBlock('Translation', Buffer.from([0x11, 0x04, 0xb0, 0x04]), false),
+      ]),
+    ]);
+
+    withSyntheticPE([[16, 1, version]], (exePath) => {
+      assert.deepStrictEqual(keysender.getVersionInfo(exePath), {
+        productName: 'Ünïcødé 製品',
+        fileDescription: '',
+        companyName: 'Witsy',
+        fileVersion: '1.2.3.4',
+        productVersion: '2.0',
+      });
+    });
+  });
+
+  it('should return null for files that are not PE images', function() {
+    assert.strictEqual(keysender.getVersionInfo(__filename), null);
+  });
+
+  it('should resolve product names in batch, in input order', function() {
+    const version = versionBlock('VS_VERSION_INFO', Buffer.alloc(0), false, [
+      versionBlock('StringFileInfo', Buffer.alloc(0), true, [
+        versionBlock('040904b0', Buffer.alloc(0), true, [versionString('FileDescription', 'Batch')]),
+      ]),
+    ]);
+
+    return withSyntheticPE([[16, 1, version]], async (exePath) => {
+      const names = await keysender.getProductNames([exePath, __filename, exePath]);
+      assert.deepStrictEqual(names, ['Batch', null, 'Batch']);
+    });
+  });
+});
+
+describe('Application icon', function() {
+  it('should reassemble the icon group of a PE file', function() {
+    // A 32 px DIB and a 256 px PNG (only its header matters here)
+    const dib = Buffer.alloc(40 + 32 * 32 * 4 + 32 * 4);
+    dib.writeUInt32LE(40, 0);
+    dib.writeInt32LE(32, 4);
+    dib.writeInt32LE(64, 8);
+    const png = Buffer.alloc(33);
+    Buffer.from([0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a]).copy(png);
+    png.writeUInt32BE(256, 16);
+    png.writeUInt32BE(256, 20);
+    const group = Buffer.alloc(6 + 2 * 14);
+    group.writeUInt16LE(1, 2);
+    group.writeUInt16LE(2, 4);
+    [[32, dib, 1], [0, png, 2]].forEach(([size, data, id], i) => {
+      group.writeUInt8(size, 6 + i * 14);
+      group.writeUInt8(size, 7 + i * 14);
+      group.writeUInt16LE(1, 10 + i * 14);
+      group.writeUInt16LE(32, 12 + i * 14);
+      group.writeUInt32LE(data.length, 14 + i * 14);
+      group.writeUInt16LE(id, 18 + i * 14);
+    });
+
+    withSyntheticPE([[3, 1, dib], [3, 2, png], [14, 1, group]], (exePath) => {
+      const icon = keysender.getApplicationIcon(exePath);
+      assert.strictEqual(icon.iconWidth, 256);
+      assert.strictEqual(icon.iconHeight, 256);
+      const ico = icon.iconData;
+      assert.strictEqual(ico.readUInt16LE(2), 1);
+      assert.strictEqual(ico.readUInt16LE(4), 2);
+      assert.strictEqual(ico.length, 6 + 2 * 16 + dib.length + png.length);
+      assert.ok(ico.subarray(ico.readUInt32LE(6 + 12), ico.readUInt32LE(6 + 12) + dib.length).equals(dib));
+      assert.ok(ico.subarray(ico.readUInt32LE(22 + 12)).equals(png));
+    });
+  });
+
+  it('should encode a DIB icon as a valid PNG', function() {
+    // 21 px wide so rows end in the scalar tail of the pixel kernels
+    const width = 21;
+    const height = 3;
+    const dib = Buffer.alloc(40 + width * height * 4 + 4 * height);
+    dib.writeUInt32LE(40, 0);
+    dib.writeInt32LE(width, 4);
+    dib.writeInt32LE(height * 2, 8);
+    dib.writeUInt16LE(1, 12);
+    dib.writeUInt16LE(32, 14);
+    const rgba = Buffer.alloc(width * height * 4);
+    for (let y = 0; y < height; y++) {
+      for (let x = 0; x < width; x++) {
+        const i = (y * width + x) * 4;
+        const [r, g, b, a] = [x * 12, y * 80, 255 - x * 7, 1 + x * 12 + y];
+        rgba.set([r, g, b, a], i);
+        // DIB rows are stored bottom-up in BGRA order
+        dib.set([b, g, r, a], 40 + ((height - 1 - y) * width + x) * 4);
+      }
+    }
+    const group = Buffer.alloc(6 + 14);
+    group.writeUInt16LE(1, 2);
+    group.writeUInt16LE(1, 4);
+    group.writeUInt8(width, 6);
+    group.writeUInt8(height, 7);
+    group.writeUInt16LE(1, 10);
+    group.writeUInt16LE(32, 12);
+    group.writeUInt32LE(dib.length, 14);
+    group.writeUInt16LE(1, 18);
+
+    withSyntheticPE([[3, 1, dib], [14, 1, group]], (exePath) => {
+      const icon = keysender.getApplicationIcon(exePath, { format: 'png' });
+      assert.strictEqual(icon.iconWidth, width);
+      assert.strictEqual(icon.iconHeight, height);
+      const png = icon.iconData;
+      assert.ok(png.subarray(0, 8).equals(Buffer.from([0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a])));
+
+      // Walk the chunks and check their CRCs
+      const chunks = [];
+      for (let offset = 8; offset < png.length;) {
+        const length = png.readUInt32BE(offset);
+        const type = png.toString('latin1', offset + 4, offset + 8);
+        const data = png.subarray(offset + 8, offset + 8 + length);
+        assert.strictEqual(png.readUInt32BE(offset + 8 + length), crc32(png.subarray(offset + 4, offset + 8 + length)), `${type} CRC`);
+        chunks.push({ type, data });
+        offset += 12 + length;
+      }
+      assert.strictEqual(chunks[0].type, 'IHDR');
+      assert.strictEqual(chunks[chunks.length - 1].type, 'IEND');
+      const ihdr = chunks[0].data;
+      assert.strictEqual(ihdr.readUInt32BE(0), width);
+      assert.strictEqual(ihdr.readUInt32BE(4), height);
+      assert.deepStrictEqual([...ihdr.subarray(8)], [8, 6, 0, 0, 0]);
+
+      // The zlib stream ends with the Adler-32 of the scanlines
+      const stream = Buffer.concat(chunks.filter((chunk) => chunk.type === 'IDAT').map((chunk) => chunk.data));
+      const scanlines = zlib.inflateSync(stream);
+      assert.strictEqual(stream.readUInt32BE(stream.length - 4), adler32(scanlines));
+      assert.strictEqual(scanlines.length, height * (1 + width * 4));
+      for (let y = 0; y < height; y++) {
+        const row = scanlines.subarray(y * (1 + width * 4), (y + 1) * (1 + width * 4));
+        assert.strictEqual(row[0], 0);
+        assert.ok(row.subarray(1).equals(rgba.subarray(y * width * 4, (y + 1) * width * 4)), `row ${y}`);
+      }
+    });
+  });
+
+  it('should convert pixels the same way with and without SIMD', function() {
+    // test/kernels.c prints the kernel outputs, built against the SIMD and the scalar paths
+    const simd = runTestProgram(['test/kernels.c', 'src/image.c']);
+    if (simd === null) {
+      this.skip(); // No C compiler
+    }
+    const scalar = runTestProgram(['test/kernels.c', 'src/image.c'], ['-DIMAGE_SCALAR']);
+    assert.strictEqual(scalar.status, 0);
+    assert.ok(simd.stdout.length > 0);
+    assert.ok(simd.stdout.equals(scalar.stdout));
+  });
+});
+
+describe('Key table', function() {
+  it('should look up key names in any case and reject unknown ones', function() {
+    // test/keytable.c exits with the number of failed lookups
+    const result = runTestProgram(['test/keytable.c', 'src/keytable.c']);
+    if (result === null) {
+      this.skip(); // No C compiler
+    }
+    assert.strictEqual(result.status, 0, result.stdout.toString());
+  });
+});
+
+// The desktop index reads the XDG directories and the locale once, on the first lookup
+if (process.platform === 'linux') {
+  describe('Desktop applications', function() {
+    const variables = ['XDG_DATA_HOME', 'XDG_DATA_DIRS', 'LC_ALL'];
+    const saved = {};
+    let root;
+
+    const desktopFile = (base, id, lines) => {
+      fs.mkdirSync(path.join(root, base, 'applications'), { recursive: true });
+      fs.writeFileSync(path.join(root, base, 'applications', `${id}.desktop`), ['[Desktop Entry]', 'Type=Application', ...lines, ''].join('\n'));
+    };
+
+    before(function() {
+      root = fs.mkdtempSync(path.join(os.tmpdir(), 'autolib-xdg-'));
+      desktopFile('home', 'org.autolib.Editor', [
+        'Name=Editor', 'Name[fr]=Éditeur', 'Name[fr_FR]=Éditeur (France)', 'Name[de]=Bearbeiter',
+        'Icon=autolib-editor', 'Categories=Utility;TextEditor;', 'StartupWMClass=AutolibEditor',
+        'Exec=/opt/autolib/autolib-editor %F',
+      ]);
+      desktopFile('sys', 'autolib-masked', ['Name=Masked', 'StartupWMClass=AutolibMasked', 'Exec=/opt/autolib/autolib-masked']);
+      desktopFile('home', 'autolib-masked', ['Name=Masked', 'Hidden=true']);
+      desktopFile('sys', 'org.autolib.Flat', [
+        'Name=Flat', 'X-Flatpak=org.autolib.Flat',
+        'Exec=/usr/bin/flatpak run --branch=stable --command=autolib-flat org.autolib.Flat %U',
+      ]);
+      desktopFile('sys', 'autolib-env', ['Name=Env', 'Exec=env GDK_BACKEND=x11 -u DISPLAY /opt/autolib/autolib-env --flag']);
+      desktopFile('sys', 'autolib-script', ['Name=Script', 'Exec=python3 /opt/autolib/script.py']);
+
+      variables.forEach((name) => { saved[name] = process.env[name]; });
+      process.env.XDG_DATA_HOME = path.join(root, 'home');
+      process.env.XDG_DATA_DIRS = path.join(root, 'sys');
+      process.env.LC_ALL = 'fr_FR.UTF-8';
+    });
+
+    after(function() {
+      variables.forEach((name) => {
+        if (saved[name] === undefined) {
+          delete process.env[name];
+        } else {
+          process.env[name] = saved[name];
+        }
+      });
+      fs.rmSync(root, { recursive: true, force: true });
+    });
+
+    it('should find applications by StartupWMClass and desktop id, in the current locale', function() {
+      const editor = { id: 'org.autolib.Editor', name: 'Éditeur (France)', icon: 'autolib-editor', categories: ['Utility', 'TextEditor'] };
+      assert.deepStrictEqual(keysender.getDesktopApplication(null, 'AutolibEditor'), editor);
+      assert.deepStrictEqual(keysender.getDesktopApplication(null, 'org.autolib.editor'), editor);
+    });
+
+    it('should find applications by executable path, then file name', function() {
+      assert.strictEqual(keysender.getDesktopApplication('/opt/autolib/autolib-editor', null).id, 'org.autolib.Editor');
+      assert.strictEqual(keysender.getDesktopApplication('/usr/local/bin/autolib-editor', null).id, 'org.autolib.Editor');
+    });
+
+    it('should read the program of env and flatpak launchers', function() {
+      assert.strictEqual(keysender.getDesktopApplication('/opt/autolib/autolib-env', null).id, 'autolib-env');
+      assert.strictEqual(keysender.getDesktopApplication('/app/bin/autolib-flat', null).id, 'org.autolib.Flat');
+      assert.strictEqual(keysender.getDesktopApplication('/usr/bin/python3', null), null);
+    });
+
+    it('should let Hidden entries mask system ones', function() {
+      assert.strictEqual(keysender.getDesktopApplication('/opt/autolib/autolib-masked', 'AutolibMasked'), null);
+    });
+
+    it('should refuse index files it did not write', function() {
+      const indexFile = path.join(root, 'index.bin');
+      fs.writeFileSync(indexFile, 'not a desktop index');
+      assert.strictEqual(keysender.setDesktopIndexFile(indexFile), false);
+      assert.strictEqual(fs.readFileSync(indexFile, 'utf8'), 'not a desktop index');
+    });
+  });
+}